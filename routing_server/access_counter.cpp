@@ -0,0 +1,123 @@
+#include "access_counter.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <random>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "db_manager.h"
+#include "gossip.h"
+#include "image_search.h"
+#include "routing_server.h"
+
+static std::atomic<DecayingCounters*> g_counters(nullptr);
+
+static std::string access_key(int image_id, const std::string& spectrum) {
+    return std::to_string(image_id) + "/" + spectrum;
+}
+
+static int64_t current_epoch(const DecayingCounters& counters) {
+    return counters.epoch_of(std::time(nullptr));
+}
+
+// Полное состояние случайного маршрутизатора
+static void pull_state(DecayingCounters& counters, const std::string& self_address, std::mt19937& rng) {
+    DBManager db_manager;
+    std::vector<std::string> peers;
+    for (const auto& router : db_manager.get_all_routing_servers()) {
+        std::string address = normalize_router_address(router.adress);
+        if (address != self_address) {
+            peers.push_back(address);
+        }
+    }
+    if (peers.empty()) {
+        return;
+    }
+    std::string reply = send_request_to_server(peers[rng() % peers.size()], "GET", "/crdt/access", "", {}, false);
+    size_t body_pos = reply.find("\r\n\r\n");
+    if (reply.compare(0, 12, "HTTP/1.1 200") == 0 && body_pos != std::string::npos) {
+        size_t changed = 0;
+        counters.merge(reply.substr(body_pos + 4), changed);
+    }
+}
+
+void access_counter_start(const std::string& self_address, const DecayConfig& config, int flush_ms,
+                          int sync_period_ms) {
+    if (g_counters.load()) {
+        return;
+    }
+    // Узел счетчиков - адрес с воплощением (время запуска в мс): после перезапуска
+    // ячейки начинаются с нуля, и под прежним именем их приращения терялись бы
+    // в максимуме с уже разосланными значениями. Ячейки прошлых воплощений
+    // остаются в сумме и уходят вместе со своими эпохами
+    int64_t incarnation = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    DecayingCounters* counters = new DecayingCounters(self_address + "#" + std::to_string(incarnation), config);
+    g_counters = counters;
+    std::thread([counters, self_address, flush_ms, sync_period_ms]() {
+        std::mt19937 rng(std::random_device{}());
+        auto last_sync = std::chrono::steady_clock::now();
+        while (!g_routing_server_stop) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(flush_ms));
+            std::string delta = counters->take_delta();
+            if (!delta.empty()) {
+                gossip_broadcast("POST", "/crdt/access", delta);
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (sync_period_ms > 0 && now - last_sync >= std::chrono::milliseconds(sync_period_ms)) {
+                last_sync = now;
+                counters->expire(current_epoch(*counters));
+                pull_state(*counters, self_address, rng);
+            }
+        }
+    }).detach();
+}
+
+void access_counter_record(int image_id, const std::string& spectrum) {
+    DecayingCounters* counters = g_counters.load();
+    if (counters) {
+        counters->increment(access_key(image_id, spectrum), current_epoch(*counters));
+    }
+}
+
+long long access_counter_frequency(int image_id, const std::string& spectrum) {
+    DecayingCounters* counters = g_counters.load();
+    if (!counters) {
+        return -1;
+    }
+    double hotness = counters->hotness(access_key(image_id, spectrum), current_epoch(*counters));
+    return hotness < 0 ? -1 : std::llround(hotness);
+}
+
+bool access_counter_merge(const std::string& body) {
+    DecayingCounters* counters = g_counters.load();
+    size_t changed = 0;
+    if (!counters || !counters->merge(body, changed)) {
+        return false;
+    }
+    // Ячейки только максимумом растут, поэтому без изменений пересылать нечего
+    if (changed > 0) {
+        gossip_broadcast("POST", "/crdt/access", body);
+    }
+    return true;
+}
+
+std::string access_counter_state() {
+    DecayingCounters* counters = g_counters.load();
+    return counters ? counters->state() : "{\"cells\":[]}";
+}
+
+std::string access_counter_key_json(int image_id, const std::string& spectrum) {
+    nlohmann::json json_data;
+    json_data["hotness"] = access_counter_frequency(image_id, spectrum);
+    json_data["nodes"] = nlohmann::json::object();
+    DecayingCounters* counters = g_counters.load();
+    if (counters) {
+        for (const auto& node : counters->per_node(access_key(image_id, spectrum))) {
+            json_data["nodes"][node.first] = node.second;
+        }
+    }
+    return json_data.dump();
+}
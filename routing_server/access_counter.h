@@ -0,0 +1,34 @@
+#ifndef ACCESS_COUNTER_H
+#define ACCESS_COUNTER_H
+
+#include <string>
+#include "gcounter.h"
+
+// Общая для кластера частота обращений к парам (снимок, спектр) на
+// DecayingCounters (gcounter.h) вместо Spectrums.frequency: каждый маршрутизатор
+// считает свои чтения тайлов, раз в flush_ms рассылает дельту через gossip
+// (POST /crdt/access), а раз в sync_period_ms забирает полное состояние
+// у случайного маршрутизатора - на случай дельт, до него не дошедших.
+// Узел счетчиков - "ip:port#<время запуска в мс>", новый на каждый запуск
+
+// Запуск счетчиков и потока рассылки; до запуска обращения не считаются
+void access_counter_start(const std::string& self_address, const DecayConfig& config, int flush_ms,
+                          int sync_period_ms);
+
+// Чтение тайла спектра снимка этим маршрутизатором
+void access_counter_record(int image_id, const std::string& spectrum);
+
+// Горячесть пары с затуханием, округленная; -1 - данных нет
+long long access_counter_frequency(int image_id, const std::string& spectrum);
+
+// POST /crdt/access: слияние ячеек; если что-то выросло, дельта идет дальше
+// по gossip. false - неверное тело
+bool access_counter_merge(const std::string& body);
+
+// GET /crdt/access: все ячейки
+std::string access_counter_state();
+
+// GET /crdt/access?image_id=&spectrum=: {"hotness", "nodes": {узел: обращений}}
+std::string access_counter_key_json(int image_id, const std::string& spectrum);
+
+#endif // ACCESS_COUNTER_H
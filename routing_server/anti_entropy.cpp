@@ -0,0 +1,215 @@
+#include "anti_entropy.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <nlohmann/json.hpp>
+#include "image_search.h"
+#include "routing_server.h"
+#include "server_table.h"
+
+// Дерево перестраивается не реже, чем раз в минуту: строки могли появиться в БД
+// не через этот маршрутизатор
+const int MERKLE_TREE_MAX_AGE_SEC = 60;
+
+static std::mutex g_tree_mutex;
+static std::shared_ptr<const MerkleTree> g_tree;
+static std::chrono::steady_clock::time_point g_tree_built;
+static std::atomic<bool> g_tree_dirty(true);
+// Вставки строк сверки идут по одной, чтобы два раунда не добавили строку дважды
+static std::mutex g_apply_mutex;
+static std::mutex g_removed_mutex;
+static std::set<std::string> g_removed_servers;
+static std::mutex g_stats_mutex;
+static AntiEntropyStats g_stats;
+
+std::shared_ptr<const MerkleTree> anti_entropy_tree(DBManager& db_manager) {
+    std::lock_guard<std::mutex> lock(g_tree_mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (g_tree && !g_tree_dirty && now - g_tree_built < std::chrono::seconds(MERKLE_TREE_MAX_AGE_SEC)) {
+        return g_tree;
+    }
+    // Флаг снимается до чтения БД: запись во время сборки пометит дерево снова
+    g_tree_dirty = false;
+    std::vector<CatalogRow> rows;
+    for (const auto& image : db_manager.get_all_images()) {
+        rows.push_back(catalog_image_row(image));
+    }
+    for (const char* class_type : {"hot", "cold", "mixed"}) {
+        for (const auto& server : db_manager.get_servers_by_type(class_type)) {
+            rows.push_back(catalog_server_row(server));
+        }
+    }
+    g_tree = std::make_shared<const MerkleTree>(rows);
+    g_tree_built = now;
+    return g_tree;
+}
+
+void anti_entropy_mark_dirty() {
+    g_tree_dirty = true;
+}
+
+void anti_entropy_server_removed(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_removed_mutex);
+    g_removed_servers.insert(location);
+}
+
+void anti_entropy_server_added(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_removed_mutex);
+    g_removed_servers.erase(location);
+}
+
+static bool server_removed(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_removed_mutex);
+    return g_removed_servers.count(location) > 0;
+}
+
+// Вставка строк, которых еще нет в каталоге, с id источника; возвращает число
+// вставленных. Строка, чей id здесь занят другой строкой, отвергается и считается
+// в conflicts: перенумеровать ее нельзя, на id ссылаются тайлы и счетчики
+static size_t apply_rows(DBManager& db_manager, const std::vector<nlohmann::json>& rows) {
+    std::lock_guard<std::mutex> lock(g_apply_mutex);
+    std::shared_ptr<const MerkleTree> tree = anti_entropy_tree(db_manager);
+    size_t applied = 0;
+    size_t conflicts = 0;
+    bool servers_changed = false;
+    for (const auto& row : rows) {
+        try {
+            std::string table = row.at("table").get<std::string>();
+            int inserted = -1;
+            if (table == "images") {
+                ImageInfo image;
+                image.image_id = row.at("image_id").get<int>();
+                image.filename = row.at("filename").get<std::string>();
+                image.source = row.at("source").get<std::string>();
+                image.timestamp = row.at("timestamp").get<std::string>();
+                image.geohash = row.at("geohash").get<std::string>();
+                if (image.image_id <= 0 || tree->row(catalog_image_row(image).key)) {
+                    continue;
+                }
+                inserted = db_manager.insert_image_record(image);
+            } else if (table == "servers") {
+                ServerInfo server;
+                server.server_id = row.at("server_id").get<int>();
+                server.location = row.at("location").get<std::string>();
+                server.class_type = row.at("class").get<std::string>();
+                server.ssd_volume = row.at("ssd_volume").get<int>();
+                server.hdd_volume = row.at("hdd_volume").get<int>();
+                server.ssd_fullness = row.value("ssd_fullness", 0);
+                server.hdd_fullness = row.value("hdd_fullness", 0);
+                if (server.server_id <= 0 || server_removed(server.location) ||
+                    tree->row(catalog_server_row(server).key)) {
+                    continue;
+                }
+                inserted = db_manager.insert_server_record(server);
+                servers_changed = servers_changed || inserted > 0;
+            }
+            if (inserted > 0) {
+                applied++;
+            } else if (inserted == 0) {
+                conflicts++;
+            }
+        } catch (...) {
+        }
+    }
+    if (applied > 0) {
+        anti_entropy_mark_dirty();
+    }
+    if (servers_changed) {
+        server_table_rebuild(db_manager);
+    }
+    if (conflicts > 0) {
+        std::lock_guard<std::mutex> stats_lock(g_stats_mutex);
+        g_stats.conflicts += conflicts;
+    }
+    return applied;
+}
+
+bool anti_entropy_serve(DBManager& db_manager, const std::string& path, const std::string& body,
+                        std::string& response) {
+    if (path == "/sync/apply") {
+        std::vector<nlohmann::json> rows;
+        try {
+            rows = nlohmann::json::parse(body).at("rows").get<std::vector<nlohmann::json>>();
+        } catch (...) {
+            return false;
+        }
+        response = "{\"applied\":" + std::to_string(apply_rows(db_manager, rows)) + "}";
+        return true;
+    }
+    return merkle_serve(*anti_entropy_tree(db_manager), path, body, response);
+}
+
+AntiEntropyRound anti_entropy_run(DBManager& db_manager, const std::string& peer) {
+    std::shared_ptr<const MerkleTree> tree = anti_entropy_tree(db_manager);
+    SyncTransport transport = [&peer](const std::string& path, const std::string& body, std::string& response) {
+        std::string reply = send_request_to_server(peer, "POST", path, body, {}, false);
+        size_t body_pos = reply.find("\r\n\r\n");
+        if (reply.compare(0, 12, "HTTP/1.1 200") != 0 || body_pos == std::string::npos) {
+            return false;
+        }
+        response = reply.substr(body_pos + 4);
+        return true;
+    };
+    std::vector<std::string> pulled;
+    AntiEntropyRound round = merkle_sync(*tree, transport, pulled);
+    round.peer = peer;
+
+    std::vector<nlohmann::json> rows;
+    for (const auto& row : pulled) {
+        rows.push_back(nlohmann::json::parse(row));
+    }
+    apply_rows(db_manager, rows);
+
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    g_stats.rounds++;
+    g_stats.failed_rounds += round.ok ? 0 : 1;
+    g_stats.rows_pulled += round.rows_pulled;
+    g_stats.rows_pushed += round.rows_pushed;
+    g_stats.conflicts += round.conflicts;
+    g_stats.bytes += round.bytes;
+    g_stats.last = round;
+    return round;
+}
+
+void anti_entropy_start(const std::string& self_address, int period_ms) {
+    std::thread([self_address, period_ms]() {
+        std::mt19937 rng(std::random_device{}());
+        while (!g_routing_server_stop) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(period_ms));
+            DBManager db_manager;
+            std::vector<std::string> peers;
+            for (const auto& router : db_manager.get_all_routing_servers()) {
+                std::string address = normalize_router_address(router.adress);
+                if (address != self_address) {
+                    peers.push_back(address);
+                }
+            }
+            if (!peers.empty()) {
+                anti_entropy_run(db_manager, peers[rng() % peers.size()]);
+            }
+        }
+    }).detach();
+}
+
+AntiEntropyStats anti_entropy_stats() {
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    return g_stats;
+}
+
+std::string anti_entropy_round_json(const AntiEntropyRound& round) {
+    nlohmann::json json_data;
+    json_data["peer"] = round.peer;
+    json_data["ok"] = round.ok;
+    json_data["requests"] = round.requests;
+    json_data["nodes_compared"] = round.nodes_compared;
+    json_data["buckets_differing"] = round.buckets_differing;
+    json_data["rows_pulled"] = round.rows_pulled;
+    json_data["rows_pushed"] = round.rows_pushed;
+    json_data["conflicts"] = round.conflicts;
+    json_data["bytes"] = round.bytes;
+    return json_data.dump();
+}
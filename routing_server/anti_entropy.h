@@ -0,0 +1,50 @@
+#ifndef ANTI_ENTROPY_H
+#define ANTI_ENTROPY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "db_manager.h"
+#include "merkle_tree.h"
+
+// Периодическая сверка каталога этого маршрутизатора с другими (merkle_tree.h)
+// и обслуживание их запросов /sync/*
+
+struct AntiEntropyStats {
+    uint64_t rounds = 0;
+    uint64_t failed_rounds = 0;
+    uint64_t rows_pulled = 0;
+    uint64_t rows_pushed = 0;
+    uint64_t conflicts = 0;
+    uint64_t bytes = 0;
+    AntiEntropyRound last;
+};
+
+// Дерево над текущими Images и Servers. Перестраивается, если после
+// anti_entropy_mark_dirty были запросы или снимок старше минуты
+std::shared_ptr<const MerkleTree> anti_entropy_tree(DBManager& db_manager);
+
+// Локальная запись в Images или Servers
+void anti_entropy_mark_dirty();
+
+// Удаленный на этом маршрутизаторе сервер не возвращается сверкой
+// до нового /server/add с тем же location
+void anti_entropy_server_removed(const std::string& location);
+void anti_entropy_server_added(const std::string& location);
+
+// Запрос другого маршрутизатора: /sync/tree, /sync/bucket, /sync/rows
+// или /sync/apply (вставка присланных строк). false - неверный запрос
+bool anti_entropy_serve(DBManager& db_manager, const std::string& path, const std::string& body,
+                        std::string& response);
+
+// Раунд сверки с маршрутизатором peer ("ip:port")
+AntiEntropyRound anti_entropy_run(DBManager& db_manager, const std::string& peer);
+
+// Сверка со случайным маршрутизатором раз в period_ms до остановки сервера
+void anti_entropy_start(const std::string& self_address, int period_ms);
+
+AntiEntropyStats anti_entropy_stats();
+
+std::string anti_entropy_round_json(const AntiEntropyRound& round);
+
+#endif // ANTI_ENTROPY_H
@@ -0,0 +1,204 @@
+// Имитация поиска в кольце DHT маршрутизаторов (chord.h).
+//
+// Запуск:
+//   ./bench_chord [поисков] [задержка_перехода_мс]
+// Для колец от 10 до 10000 узлов печатаются:
+//   - среднее, p99 и максимум переходов итеративного поиска по пальцам
+//     и переходов прежнего обхода по successor;
+//   - время поиска в процессе и оценка задержки сети (переходы * задержка);
+//   - сходимость протокола: в кольцо через join входят еще 10% узлов,
+//     после скольких раундов stabilize/fix_fingers все поиски верны
+//     и сколько переходов после 64 раундов (все пальцы обновлены);
+//   - вход и выход маршрутизатора с виртуальными узлами: сколько ключей
+//     передано против идеальной доли, за сколько шагов handoff_step
+//     и все ли ключи читались во время передачи.
+#include "chord.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+struct LookupResult {
+    double avg_hops = 0;
+    int p99_hops = 0;
+    int max_hops = 0;
+    double correct = 0;  // Доля верно найденных владельцев
+    double ns_per_lookup = 0;
+};
+
+static LookupResult measure(const DHTRing& ring, int lookups, std::mt19937_64& rng) {
+    std::vector<int> hops;
+    hops.reserve(lookups);
+    std::vector<Hash> keys(lookups);
+    std::vector<Node*> starts(lookups);
+    for (int i = 0; i < lookups; ++i) {
+        keys[i] = rng();
+        starts[i] = ring.nodes[rng() % ring.nodes.size()];
+    }
+
+    int correct = 0;
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; ++i) {
+        ChordLookup lookup = starts[i]->find_successor(keys[i]);
+        hops.push_back(lookup.hops);
+        correct += lookup.owner == ring.owner_of(keys[i]);
+    }
+    double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+
+    LookupResult result;
+    std::sort(hops.begin(), hops.end());
+    long long total = 0;
+    for (int h : hops) total += h;
+    result.avg_hops = static_cast<double>(total) / lookups;
+    result.p99_hops = hops[hops.size() * 99 / 100];
+    result.max_hops = hops.back();
+    result.correct = static_cast<double>(correct) / lookups;
+    result.ns_per_lookup = elapsed_ns / lookups;
+    return result;
+}
+
+// Переходы прежнего поиска: от узла к узлу по successor до владельца
+static double successor_walk_hops(const DHTRing& ring, int lookups, std::mt19937_64& rng) {
+    long long total = 0;
+    for (int i = 0; i < lookups; ++i) {
+        Hash key = rng();
+        Node* n = ring.nodes[rng() % ring.nodes.size()];
+        while (!chord_in_range(key, n->id, n->successor->id)) {
+            n = n->successor;
+            total++;
+        }
+    }
+    return static_cast<double>(total) / lookups;
+}
+
+// Доля ключей, которые читаются через DHTRing::get
+static double readable(const DHTRing& ring, const std::vector<Hash>& keys) {
+    size_t found = 0;
+    for (Hash key : keys) {
+        found += ring.get(key) != nullptr;
+    }
+    return static_cast<double>(found) / keys.size();
+}
+
+// Передача по max_keys за шаг; возвращает число шагов и худшую долю читаемых ключей
+static int drain_handoffs(DHTRing& ring, const std::vector<Hash>& keys, size_t max_keys, double& min_readable) {
+    int steps = 0;
+    min_readable = readable(ring, keys);
+    while (!ring.handoffs.empty()) {
+        ring.handoff_step(max_keys);
+        steps++;
+        min_readable = std::min(min_readable, readable(ring, keys));
+    }
+    return steps;
+}
+
+static double key_imbalance(const DHTRing& ring, int routers) {
+    std::map<std::string, size_t> per_router;
+    size_t total = 0;
+    for (const Node* node : ring.nodes) {
+        per_router[node->address] += node->metadata.size();
+        total += node->metadata.size();
+    }
+    size_t peak = 0;
+    for (const auto& entry : per_router) {
+        peak = std::max(peak, entry.second);
+    }
+    return peak / (static_cast<double>(total) / routers);
+}
+
+static void membership_changes(std::mt19937_64& rng) {
+    const int routers = 32;
+    const int key_count = 100000;
+    const size_t keys_per_step = 1000;
+    printf("\n%d маршрутизаторов, %d ключей, передача по %zu ключей за шаг\n", routers, key_count, keys_per_step);
+    printf("%-7s %10s %14s %10s %7s %10s %14s %7s %10s\n", "vnodes", "max/ср", "вход: ключей", "идеал", "шагов",
+           "читается", "выход: ключей", "шагов", "читается");
+    for (int vnodes_per_router : {1, 8, 32}) {
+        DHTRing ring;
+        std::vector<std::vector<Node*>> owned;
+        for (int i = 0; i < routers; ++i) {
+            owned.push_back(make_virtual_nodes("10.1.0." + std::to_string(i + 1) + ":8080", vnodes_per_router));
+            ring.join_router(owned.back());
+        }
+        std::vector<Hash> keys;
+        for (int i = 0; i < key_count; ++i) {
+            keys.push_back(rng());
+            ring.put(keys.back(), "scene_" + std::to_string(i) + ".tif");
+        }
+        double imbalance = key_imbalance(ring, routers);
+
+        owned.push_back(make_virtual_nodes("10.1.1.1:8080", vnodes_per_router));
+        size_t joined = ring.join_router(owned.back());
+        double join_readable;
+        int join_steps = drain_handoffs(ring, keys, keys_per_step, join_readable);
+
+        size_t left = ring.leave_router(owned[rng() % routers]);
+        double leave_readable;
+        int leave_steps = drain_handoffs(ring, keys, keys_per_step, leave_readable);
+
+        printf("%-7d %10.2f %14zu %10d %7d %9.1f%% %14zu %7d %9.1f%%\n", vnodes_per_router, imbalance,
+               ring.changes[joined].keys_moved, key_count / (routers + 1), join_steps, 100 * join_readable,
+               ring.changes[left].keys_moved, leave_steps, 100 * leave_readable);
+        for (const auto& router : owned) {
+            for (Node* node : router) {
+                delete node;
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int lookups = argc > 1 ? std::atoi(argv[1]) : 20000;
+    double hop_ms = argc > 2 ? std::atof(argv[2]) : 0.5;
+    std::mt19937_64 rng(42);
+
+    printf("%-7s %9s %5s %5s %11s %12s %14s %10s %8s %10s\n", "nodes", "avg hops", "p99", "max",
+           "walk hops", "ns/lookup", "est. ms/lookup", "join: rnds", "correct", "hops@64");
+    for (int nodes_count : {10, 100, 1000, 10000}) {
+        std::vector<Node*> owned;
+        DHTRing ring;
+        for (int i = 0; i < nodes_count; ++i) {
+            owned.push_back(new Node("10." + std::to_string(i / 65536) + "." + std::to_string(i / 256 % 256) +
+                                     "." + std::to_string(i % 256) + ":8080"));
+            ring.nodes.push_back(owned.back());
+        }
+        std::sort(ring.nodes.begin(), ring.nodes.end(), [](Node* a, Node* b) { return a->id < b->id; });
+        ring.update_neighbors();
+
+        LookupResult stable = measure(ring, lookups, rng);
+        double walk = successor_walk_hops(ring, std::min(lookups, 2000), rng);
+
+        // Вход новых узлов через протокол
+        int joining = std::max(1, nodes_count / 10);
+        for (int i = 0; i < joining; ++i) {
+            Node* known = ring.nodes[rng() % ring.nodes.size()];
+            owned.push_back(new Node("172.16." + std::to_string(i / 256) + "." + std::to_string(i % 256) + ":8080"));
+            ring.join_node(owned.back(), known);
+        }
+        int rounds_to_correct = -1;
+        LookupResult after;
+        for (int round = 1; round <= CHORD_BITS; ++round) {
+            ring.maintenance_round();
+            if (rounds_to_correct < 0) {
+                after = measure(ring, std::min(lookups, 2000), rng);
+                if (after.correct == 1.0) {
+                    rounds_to_correct = round;
+                }
+            }
+        }
+        after = measure(ring, lookups, rng);
+
+        printf("%-7d %9.2f %5d %5d %11.1f %12.0f %14.2f %10d %7.1f%% %10.2f\n", nodes_count, stable.avg_hops,
+               stable.p99_hops, stable.max_hops, walk, stable.ns_per_lookup, stable.avg_hops * hop_ms,
+               rounds_to_correct, 100.0 * after.correct, after.avg_hops);
+        for (Node* node : owned) {
+            delete node;
+        }
+    }
+    membership_changes(rng);
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Сравнение разбиения ключей по hash_key (std::hash имени снимка, как в
+// gossip.cpp) и по диапазонам geohash (geo_partition.h).
+//
+// Запуск:
+//   ./bench_geo_partition [маршрутизаторов] [снимков]
+// Снимки сгущены вокруг 20 центров (как сцены над населенными районами) и
+// частично разбросаны по суше. Для запросов по областям 0.2, 1 и 5 градусов
+// печатается, сколько маршрутизаторов затрагивает запрос:
+//   - hash: при разбиении по имени нужно спрашивать всех; в скобках - у скольких
+//     действительно нашлись снимки области;
+//   - geo: владельцы диапазонов, пересекающих покрытие области ячейками geohash.
+// Затем запросы смещаются к одному центру, и видно, как деление горячих
+// диапазонов и сдвиг границ выравнивают нагрузку маршрутизаторов.
+#include "geo_partition.h"
+#include "geohash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// Как SEARCH_COVER_CELLS в image_search.cpp
+const size_t BENCH_COVER_CELLS = 64;
+
+struct BenchImage {
+    std::string filename;
+    double lat, lon;
+    GeoKey key;
+};
+
+struct BenchQuery {
+    double north, south, east, west;
+};
+
+static double clamp(double value, double low, double high) {
+    return std::max(low, std::min(high, value));
+}
+
+// Снимки области: перебор по диапазонам ключей ячеек покрытия
+static std::vector<size_t> images_in(const std::vector<BenchImage>& images, const BenchQuery& query,
+                                     const std::vector<std::string>& cells) {
+    std::vector<size_t> found;
+    for (const auto& cell : cells) {
+        GeoKey lo, hi;
+        geo_key_range(cell, lo, hi);
+        auto it = std::lower_bound(images.begin(), images.end(), lo,
+                                   [](const BenchImage& image, GeoKey key) { return image.key < key; });
+        for (; it != images.end() && it->key <= hi; ++it) {
+            if (it->lat <= query.north && it->lat >= query.south && it->lon <= query.east && it->lon >= query.west) {
+                found.push_back(it - images.begin());
+            }
+        }
+    }
+    return found;
+}
+
+static double imbalance(const std::vector<double>& loads) {
+    double total = 0, peak = 0;
+    for (double load : loads) {
+        total += load;
+        peak = std::max(peak, load);
+    }
+    return total > 0 ? peak / (total / loads.size()) : 0;
+}
+
+int main(int argc, char** argv) {
+    int router_count = argc > 1 ? std::atoi(argv[1]) : 32;
+    int image_count = argc > 2 ? std::atoi(argv[2]) : 200000;
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> normal(0, 1);
+
+    std::vector<std::pair<double, double>> centers;
+    for (int i = 0; i < 20; ++i) {
+        centers.push_back({-40 + 100 * uniform(rng), -170 + 340 * uniform(rng)});
+    }
+    std::vector<BenchImage> images;
+    for (int i = 0; i < image_count; ++i) {
+        BenchImage image;
+        image.filename = "scene_" + std::to_string(i) + ".tif";
+        if (uniform(rng) < 0.7) {
+            const auto& center = centers[rng() % centers.size()];
+            image.lat = clamp(center.first + 1.5 * normal(rng), -89.9, 89.9);
+            image.lon = clamp(center.second + 1.5 * normal(rng), -179.9, 179.9);
+        } else {
+            image.lat = -60 + 130 * uniform(rng);
+            image.lon = -180 + 360 * uniform(rng);
+        }
+        geo_key(geohash_encode(image.lat, image.lon, 9), image.key);
+        images.push_back(image);
+    }
+    std::sort(images.begin(), images.end(), [](const BenchImage& a, const BenchImage& b) { return a.key < b.key; });
+
+    std::vector<std::string> routers;
+    for (int i = 0; i < router_count; ++i) {
+        routers.push_back("10.0.0." + std::to_string(i + 1) + ":8080");
+    }
+    std::vector<GeoKey> sample;
+    for (size_t i = 0; i < images.size(); i += 10) {
+        sample.push_back(images[i].key);
+    }
+    GeoPartitioner partitioner(routers, sample);
+    std::hash<std::string> hasher;
+    auto hash_owner = [&](const BenchImage& image) { return static_cast<int>(hasher(image.filename) % router_count); };
+
+    std::vector<double> hash_images(router_count, 0), geo_images(router_count, 0);
+    for (const auto& image : images) {
+        hash_images[hash_owner(image)]++;
+        geo_images[partitioner.owner_of(image.key)]++;
+    }
+    printf("маршрутизаторов: %d, снимков: %d, диапазонов: %zu\n", router_count, image_count,
+           partitioner.ranges().size());
+    printf("снимков на маршрутизатор, max/среднее: hash %.2f, geo %.2f\n\n", imbalance(hash_images),
+           imbalance(geo_images));
+
+    auto make_query = [&](double size, const std::pair<double, double>* near) {
+        const BenchImage& anchor = images[rng() % images.size()];
+        double lat = near ? near->first + normal(rng) : anchor.lat;
+        double lon = near ? near->second + normal(rng) : anchor.lon;
+        return BenchQuery{clamp(lat + size / 2, -90, 90), clamp(lat - size / 2, -90, 90),
+                          clamp(lon + size / 2, -180, 180), clamp(lon - size / 2, -180, 180)};
+    };
+
+    printf("%-8s %9s %16s %10s %10s\n", "область", "запросов", "hash (с данными)", "geo", "geo p99");
+    for (double size : {0.2, 1.0, 5.0}) {
+        const int queries = 1000;
+        double hash_with_data = 0, geo_total = 0;
+        std::vector<size_t> geo_touched;
+        for (int q = 0; q < queries; ++q) {
+            BenchQuery query = make_query(size, nullptr);
+            std::vector<std::string> cells =
+                geohash_cover(query.north, query.south, query.east, query.west, BENCH_COVER_CELLS);
+            std::set<int> owners;
+            for (size_t index : images_in(images, query, cells)) {
+                owners.insert(hash_owner(images[index]));
+            }
+            hash_with_data += owners.size();
+            geo_touched.push_back(partitioner.owners_of_cells(cells).size());
+            geo_total += geo_touched.back();
+        }
+        std::sort(geo_touched.begin(), geo_touched.end());
+        printf("%-8.1f %9d %6d (%6.1f) %10.2f %10zu\n", size, queries, router_count, hash_with_data / queries,
+               geo_total / queries, geo_touched[queries * 99 / 100]);
+    }
+
+    // Горячая точка: 80% чтений - снимки вокруг одного центра
+    printf("\nнагрузка смещается к центру (%.1f, %.1f):\n", centers[0].first, centers[0].second);
+    printf("%-6s %12s %12s %8s %8s %8s %10s\n", "раунд", "hash max/ср", "geo max/ср", "деления", "слияния",
+           "передано", "диапазонов");
+    for (int round = 1; round <= 8; ++round) {
+        std::vector<double> hash_load(router_count, 0), geo_load(router_count, 0);
+        for (int q = 0; q < 2000; ++q) {
+            BenchQuery query = make_query(1.0, uniform(rng) < 0.8 ? &centers[0] : nullptr);
+            std::vector<std::string> cells =
+                geohash_cover(query.north, query.south, query.east, query.west, BENCH_COVER_CELLS);
+            for (size_t index : images_in(images, query, cells)) {
+                hash_load[hash_owner(images[index])]++;
+                geo_load[partitioner.owner_of(images[index].key)]++;
+                partitioner.record(images[index].key);
+            }
+        }
+        GeoRebalanceResult result = partitioner.rebalance();
+        printf("%-6d %12.2f %12.2f %8zu %8zu %8zu %10zu\n", round, imbalance(hash_load), imbalance(geo_load),
+               result.splits, result.merges, result.moved, partitioner.ranges().size());
+    }
+    return 0;
+}
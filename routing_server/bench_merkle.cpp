@@ -0,0 +1,109 @@
+// Имитация сверки каталогов двух маршрутизаторов деревом Меркла (merkle_tree.h).
+//
+// Запуск:
+//   ./bench_merkle [снимков]
+// У двух сторон общий каталог; затем у каждой пропадает по d/2 своих строк
+// и d/2 строк получает только она. Для d от 0 до 10000 печатаются:
+//   - число запросов и байт обмена против передачи всего каталога;
+//   - сколько строк получено и отправлено;
+//   - сошлись ли корни деревьев после вставки переданных строк.
+#include "merkle_tree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+static ImageInfo random_image(int index, std::mt19937_64& rng) {
+    static const char BASE32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+    ImageInfo image;
+    image.image_id = index;
+    image.filename = "scene_" + std::to_string(index) + ".tif";
+    image.source = rng() % 2 ? "sentinel-2" : "landsat-8";
+    image.timestamp = "2024-0" + std::to_string(1 + rng() % 9) + "-1" + std::to_string(rng() % 10) + " 10:00:00";
+    for (int i = 0; i < 9; ++i) {
+        image.geohash += BASE32[rng() % 32];
+    }
+    return image;
+}
+
+static CatalogRow row_from_json(const std::string& json) {
+    nlohmann::json row = nlohmann::json::parse(json);
+    ImageInfo image;
+    image.image_id = row.at("image_id");
+    image.filename = row.at("filename");
+    image.source = row.at("source");
+    image.timestamp = row.at("timestamp");
+    image.geohash = row.at("geohash");
+    return catalog_image_row(image);
+}
+
+int main(int argc, char** argv) {
+    int images = argc > 1 ? std::atoi(argv[1]) : 100000;
+    std::mt19937_64 rng(42);
+    std::vector<CatalogRow> catalog;
+    size_t catalog_bytes = 0;
+    for (int i = 0; i < images; ++i) {
+        catalog.push_back(catalog_image_row(random_image(i, rng)));
+        catalog_bytes += catalog.back().json.size() + 1;
+    }
+
+    printf("каталог: %d снимков, %.1f МБ\n", images, catalog_bytes / 1048576.0);
+    printf("%-7s %9s %12s %10s %10s %9s %9s %9s %10s\n", "diff", "requests", "bytes", "of full", "nodes",
+           "buckets", "pulled", "pushed", "converged");
+    for (int diff : {0, 1, 10, 100, 1000, 10000}) {
+        // Первые diff строк каталога: четные есть только у local, нечетные - только у remote
+        std::vector<CatalogRow> local_rows, remote_rows;
+        std::vector<size_t> order(catalog.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+        std::set<size_t> differing(order.begin(), order.begin() + std::min<size_t>(diff, order.size()));
+        int parity = 0;
+        for (size_t i = 0; i < catalog.size(); ++i) {
+            if (!differing.count(i)) {
+                local_rows.push_back(catalog[i]);
+                remote_rows.push_back(catalog[i]);
+            } else if (parity++ % 2 == 0) {
+                local_rows.push_back(catalog[i]);
+            } else {
+                remote_rows.push_back(catalog[i]);
+            }
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        MerkleTree local(local_rows);
+        MerkleTree remote(remote_rows);
+        double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+        std::vector<std::string> pushed;
+        SyncTransport transport = [&](const std::string& path, const std::string& body, std::string& response) {
+            if (path == "/sync/apply") {
+                nlohmann::json request = nlohmann::json::parse(body);
+                for (const auto& row : request.at("rows")) {
+                    pushed.push_back(row.dump());
+                }
+                response = "{\"applied\":0}";
+                return true;
+            }
+            return merkle_serve(remote, path, body, response);
+        };
+        std::vector<std::string> pulled;
+        AntiEntropyRound round = merkle_sync(local, transport, pulled);
+
+        for (const auto& json : pulled) local_rows.push_back(row_from_json(json));
+        for (const auto& json : pushed) remote_rows.push_back(row_from_json(json));
+        bool converged = round.ok && MerkleTree(local_rows).root() == MerkleTree(remote_rows).root();
+
+        printf("%-7d %9zu %12zu %9.3f%% %10zu %9zu %9zu %9zu %10s\n", diff, round.requests, round.bytes,
+               100.0 * round.bytes / catalog_bytes, round.nodes_compared, round.buckets_differing,
+               round.rows_pulled, round.rows_pushed, converged ? "yes" : "NO");
+        if (diff == 0) {
+            printf("(сборка двух деревьев: %.0f мс)\n", build_ms);
+        }
+    }
+    return 0;
+}
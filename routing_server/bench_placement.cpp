@@ -0,0 +1,179 @@
+// Имитация размещения загрузок на сотнях storage-серверов.
+//
+// Запуск:
+//   ./bench_placement [uploads]
+// Сравниваются три стратегии:
+//   stale-max-free - прежнее поведение: максимум свободного места по данным,
+//                    записанным один раз при /server/add;
+//   live-max-free  - максимум свободного места по актуальным данным;
+//   power-of-two   - select_power_of_two из placement.cpp.
+// Серверы разнородны по объему и скорости записи, загрузки приходят
+// всплесками. Для каждой стратегии печатаются дисбаланс очередей
+// (максимум к среднему), хвостовые задержки и разброс заполненности.
+#include "placement.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SimServer {
+    double capacity_bytes;
+    double used_bytes = 0;
+    double throughput_bps;      // Скорость записи
+    double available_at = 0;    // Когда сервер освободится от очереди
+    std::deque<std::pair<double, double>> pending;  // (время завершения, задержка)
+    double latency_ewma_ms = 0;
+};
+
+enum Strategy { STALE_MAX_FREE, LIVE_MAX_FREE, POWER_OF_TWO };
+
+struct SimResult {
+    double max_to_mean_queue = 0;
+    double p50_ms = 0;
+    double p99_ms = 0;
+    double fill_stddev = 0;
+    int rejected = 0;
+};
+
+// Завершенные к моменту now запросы снимаются с очереди и обновляют задержку
+static void drain(SimServer& server, double now) {
+    while (!server.pending.empty() && server.pending.front().first <= now) {
+        double latency_ms = server.pending.front().second * 1000.0;
+        server.latency_ewma_ms = server.latency_ewma_ms == 0
+            ? latency_ms
+            : 0.2 * latency_ms + 0.8 * server.latency_ewma_ms;
+        server.pending.pop_front();
+    }
+}
+
+static SimResult simulate(int servers_count, int uploads, Strategy strategy, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> capacity_tb(1.0, 8.0);
+    std::uniform_real_distribution<double> throughput_mbps(80.0, 500.0);
+    std::exponential_distribution<double> upload_mb(1.0 / 100.0);
+
+    std::vector<SimServer> servers(servers_count);
+    double total_throughput = 0;
+    for (auto& server : servers) {
+        server.capacity_bytes = capacity_tb(rng) * 1e12;
+        server.used_bytes = server.capacity_bytes * std::uniform_real_distribution<double>(0.0, 0.5)(rng);
+        server.throughput_bps = throughput_mbps(rng) * 1e6;
+        total_throughput += server.throughput_bps;
+    }
+    std::vector<double> initial_free(servers_count);
+    for (int i = 0; i < servers_count; ++i) {
+        initial_free[i] = servers[i].capacity_bytes - servers[i].used_bytes;
+    }
+
+    // Средняя нагрузка 60% от суммарной пропускной способности,
+    // каждые 2000 загрузок - всплеск в 5 раз интенсивнее
+    double mean_size = 100e6;
+    double base_rate = 0.6 * total_throughput / mean_size;
+    double now = 0;
+    std::vector<double> latencies;
+    latencies.reserve(uploads);
+    double queue_ratio_sum = 0;
+    int queue_samples = 0;
+    SimResult result;
+
+    std::vector<PlacementCandidate> candidates(servers_count);
+    for (int u = 0; u < uploads; ++u) {
+        bool burst = (u / 2000) % 2 == 1 && (u % 2000) < 500;
+        now += std::exponential_distribution<double>(burst ? base_rate * 5 : base_rate)(rng);
+        double size = upload_mb(rng) * 1e6;
+
+        for (auto& server : servers) {
+            drain(server, now);
+        }
+
+        int chosen = -1;
+        if (strategy == STALE_MAX_FREE) {
+            chosen = std::max_element(initial_free.begin(), initial_free.end()) - initial_free.begin();
+        } else if (strategy == LIVE_MAX_FREE) {
+            double best = -1;
+            for (int i = 0; i < servers_count; ++i) {
+                double free_bytes = servers[i].capacity_bytes - servers[i].used_bytes;
+                if (free_bytes >= size && free_bytes > best) {
+                    best = free_bytes;
+                    chosen = i;
+                }
+            }
+        } else {
+            for (int i = 0; i < servers_count; ++i) {
+                candidates[i].server_id = i;
+                candidates[i].free_bytes = servers[i].capacity_bytes - servers[i].used_bytes;
+                candidates[i].in_flight = servers[i].pending.size();
+                candidates[i].queue_depth = 0;
+                candidates[i].latency_ms = servers[i].latency_ewma_ms;
+            }
+            chosen = select_power_of_two(candidates, static_cast<size_t>(size), rng);
+        }
+
+        if (chosen < 0 || servers[chosen].capacity_bytes - servers[chosen].used_bytes < size) {
+            result.rejected++;
+            continue;
+        }
+
+        SimServer& server = servers[chosen];
+        double start = std::max(now, server.available_at);
+        double finish = start + size / server.throughput_bps;
+        server.available_at = finish;
+        server.pending.emplace_back(finish, finish - now);
+        server.used_bytes += size;
+        latencies.push_back((finish - now) * 1000.0);
+
+        if (u % 100 == 0) {
+            size_t max_queue = 0;
+            size_t total_queue = 0;
+            for (const auto& s : servers) {
+                max_queue = std::max(max_queue, s.pending.size());
+                total_queue += s.pending.size();
+            }
+            if (total_queue > 0) {
+                queue_ratio_sum += max_queue / (static_cast<double>(total_queue) / servers_count);
+                queue_samples++;
+            }
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    if (!latencies.empty()) {
+        result.p50_ms = latencies[latencies.size() / 2];
+        result.p99_ms = latencies[latencies.size() * 99 / 100];
+    }
+    result.max_to_mean_queue = queue_samples > 0 ? queue_ratio_sum / queue_samples : 0;
+
+    double mean_fill = 0;
+    for (const auto& s : servers) {
+        mean_fill += s.used_bytes / s.capacity_bytes;
+    }
+    mean_fill /= servers_count;
+    double variance = 0;
+    for (const auto& s : servers) {
+        double fill = s.used_bytes / s.capacity_bytes;
+        variance += (fill - mean_fill) * (fill - mean_fill);
+    }
+    result.fill_stddev = std::sqrt(variance / servers_count);
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int uploads = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const char* names[] = {"stale-max-free", "live-max-free", "power-of-two"};
+
+    printf("%-8s %-15s %12s %12s %12s %12s %9s\n",
+           "servers", "strategy", "max/mean q", "p50, ms", "p99, ms", "fill stddev", "rejected");
+    for (int servers_count : {100, 300, 1000}) {
+        for (int strategy = STALE_MAX_FREE; strategy <= POWER_OF_TWO; ++strategy) {
+            SimResult r = simulate(servers_count, uploads, static_cast<Strategy>(strategy), 7);
+            printf("%-8d %-15s %12.1f %12.0f %12.0f %12.4f %9d\n", servers_count, names[strategy],
+                   r.max_to_mean_queue, r.p50_ms, r.p99_ms, r.fill_stddev, r.rejected);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+// Сборка и разбор снимка каталога (catalog_snapshot.h) для старта нового
+// маршрутизатора.
+//
+// Запуск:
+//   ./bench_snapshot [снимков]
+// Каталог: снимки, по 13 спектров на снимок, 500 серверов и 50 маршрутизаторов
+// в текстовом формате COPY. Для уровней zlib 1 и 6 печатаются:
+//   - размер снимка и степень сжатия;
+//   - время сборки и разбора;
+//   - обнаруживается ли порча байта, обрезка и чужая версия.
+#include "catalog_snapshot.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+static CatalogSnapshot make_catalog(int images, std::mt19937_64& rng) {
+    static const char BASE32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+    static const char* SPECTRUMS[] = {"B01", "B02", "B03", "B04", "B05", "B06", "B07",
+                                      "B08", "B8A", "B09", "B10", "B11", "B12"};
+    const int servers = 500;
+    const int routers = 50;
+    CatalogSnapshot snapshot;
+    snapshot.source = "10.0.0.1:8080";
+    snapshot.wal_position = "2A/5F01C3D8";
+    snapshot.created_at = 1700000000;
+    snapshot.tables = catalog_snapshot_tables();
+
+    for (int s = 1; s <= servers; ++s) {
+        snapshot.tables[0].data += std::to_string(s) + "\t" + std::to_string(rng() % 101) + "\t4096\t16384\t" +
+                                   std::to_string(rng() % 101) + "\t10.1." + std::to_string(s / 256) + "." +
+                                   std::to_string(s % 256) + ":9000\t" + (s % 3 ? "cold" : "hot") + "\n";
+    }
+    for (int i = 1; i <= images; ++i) {
+        std::string geohash;
+        for (int c = 0; c < 9; ++c) {
+            geohash += BASE32[rng() % 32];
+        }
+        snapshot.tables[1].data += std::to_string(i) + "\tscene_" + std::to_string(i) + ".tif\t" +
+                                   (rng() % 2 ? "sentinel-2" : "landsat-8") + "\t2024-0" +
+                                   std::to_string(1 + rng() % 9) + "-1" + std::to_string(rng() % 10) +
+                                   " 10:00:00\t" + geohash + "\n";
+        for (int k = 0; k < 13; ++k) {
+            snapshot.tables[3].data += std::to_string(i * 13 + k) + "\t" + std::to_string(i) + "\t" +
+                                       SPECTRUMS[k] + "\t" + std::to_string(i % 1000) + "\t#000000\t" +
+                                       std::to_string(rng() % 1000) + "\t\\N\n";
+        }
+    }
+    for (int g = 0; g < 1000; ++g) {
+        for (int r = 0; r < 3; ++r) {
+            snapshot.tables[2].data += std::to_string(g) + "\t" + std::to_string(1 + (g * 3 + r) % servers) + "\t" +
+                                       (r ? "cold" : "hot") + "\n";
+        }
+    }
+    for (int r = 1; r <= routers; ++r) {
+        snapshot.tables[4].data += std::to_string(r) + "\t10.2.0." + std::to_string(r) + ":8080\t1\t" +
+                                   BASE32[r % 32] + "\n";
+    }
+    return snapshot;
+}
+
+int main(int argc, char** argv) {
+    int images = argc > 1 ? std::atoi(argv[1]) : 200000;
+    std::mt19937_64 rng(1);
+    CatalogSnapshot snapshot = make_catalog(images, rng);
+    size_t raw = 0, rows = 0;
+    for (const auto& table : snapshot.tables) {
+        raw += table.data.size();
+        rows += catalog_snapshot_rows(table);
+    }
+    printf("каталог: %d снимков, %zu строк, %.1f МБ текста COPY\n", images, rows, raw / 1048576.0);
+    printf("%-7s %10s %8s %11s %11s %13s\n", "zlib", "МБ", "сжатие", "сборка мс", "разбор мс", "строк/с разбор");
+
+    std::string encoded;
+    for (int level : {1, 6}) {
+        auto started = std::chrono::steady_clock::now();
+        encoded = catalog_snapshot_encode(snapshot, level);
+        double encode_ms = elapsed_ms(started);
+        started = std::chrono::steady_clock::now();
+        CatalogSnapshot decoded;
+        std::string error;
+        bool ok = catalog_snapshot_decode(encoded, decoded, error);
+        double decode_ms = elapsed_ms(started);
+        bool same = ok && decoded.wal_position == snapshot.wal_position &&
+                    decoded.tables.size() == snapshot.tables.size();
+        for (size_t i = 0; same && i < decoded.tables.size(); ++i) {
+            same = decoded.tables[i].data == snapshot.tables[i].data;
+        }
+        printf("%-7d %10.1f %7.1fx %11.0f %11.0f %13.0f%s\n", level, encoded.size() / 1048576.0,
+               static_cast<double>(raw) / encoded.size(), encode_ms, decode_ms, rows / (decode_ms / 1000),
+               same ? "" : "  РАСХОЖДЕНИЕ");
+    }
+
+    // Порча: каждая должна отвергаться, а не загружаться
+    CatalogSnapshot decoded;
+    std::string error;
+    int detected = 0, trials = 0;
+    for (int i = 0; i < 20; ++i, ++trials) {
+        std::string broken = encoded;
+        broken[20 + rng() % (broken.size() - 20)] ^= static_cast<char>(1 + rng() % 255);
+        detected += !catalog_snapshot_decode(broken, decoded, error);
+    }
+    printf("\nпорча байта: отвергнуто %d из %d\n", detected, trials);
+    printf("обрезка: %s\n", catalog_snapshot_decode(encoded.substr(0, encoded.size() / 2), decoded, error)
+                                ? "принят" : error.c_str());
+    std::string other_version = encoded;
+    other_version[4] = 9;
+    printf("версия 9: %s\n", catalog_snapshot_decode(other_version, decoded, error) ? "принят" : error.c_str());
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include "catalog_snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+static const char SNAPSHOT_MAGIC[4] = {'R', 'S', 'N', 'P'};
+// Магия, версия, размер несжатых данных, CRC32
+const size_t SNAPSHOT_HEADER_SIZE = 4 + 4 + 8 + 4;
+// Снимок больше этого считается поврежденным, а не выделяет память
+const uint64_t SNAPSHOT_MAX_RAW_SIZE = 16ULL * 1024 * 1024 * 1024;
+
+std::vector<CatalogTableCopy> catalog_snapshot_tables() {
+    // Порядок загрузки: сначала таблицы, на которые ссылаются другие
+    const char* tables[][2] = {
+        {"servers", "server_id"},
+        {"images", "image_id"},
+        {"segment_staorage", ""},
+        {"spectrums", "img_spectrum_id"},
+        {"routing_servers", ""},
+    };
+    std::vector<CatalogTableCopy> result;
+    for (const auto& table : tables) {
+        CatalogTableCopy copy;
+        copy.table = table[0];
+        copy.serial_column = table[1];
+        result.push_back(copy);
+    }
+    return result;
+}
+
+size_t catalog_snapshot_rows(const CatalogTableCopy& table) {
+    // Переводы строк внутри значений COPY экранирует как \n
+    return std::count(table.data.begin(), table.data.end(), '\n');
+}
+
+static void put_u32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+static void put_u64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+static void put_string(std::string& out, const std::string& value) {
+    put_u32(out, static_cast<uint32_t>(value.size()));
+    out += value;
+}
+
+// Последовательное чтение полей с проверкой границ
+struct SnapshotReader {
+    const std::string& data;
+    size_t pos;
+
+    bool u32(uint32_t& value) {
+        if (data.size() - pos < 4) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+        }
+        pos += 4;
+        return true;
+    }
+
+    bool u64(uint64_t& value) {
+        if (data.size() - pos < 8) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+        }
+        pos += 8;
+        return true;
+    }
+
+    bool string(std::string& value) {
+        uint32_t length;
+        if (!u32(length) || data.size() - pos < length) {
+            return false;
+        }
+        value.assign(data, pos, length);
+        pos += length;
+        return true;
+    }
+};
+
+static uint32_t checksum(const std::string& data) {
+    // crc32 принимает длину uInt: большие данные считаются частями
+    uLong crc = crc32(0L, Z_NULL, 0);
+    const size_t chunk = 1 << 30;
+    for (size_t pos = 0; pos < data.size(); pos += chunk) {
+        size_t length = std::min(chunk, data.size() - pos);
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(data.data() + pos), static_cast<uInt>(length));
+    }
+    return static_cast<uint32_t>(crc);
+}
+
+std::string catalog_snapshot_encode(const CatalogSnapshot& snapshot, int level) {
+    std::string raw;
+    put_string(raw, snapshot.source);
+    put_string(raw, snapshot.wal_position);
+    put_u64(raw, static_cast<uint64_t>(snapshot.created_at));
+    put_u32(raw, static_cast<uint32_t>(snapshot.tables.size()));
+    for (const auto& table : snapshot.tables) {
+        put_string(raw, table.table);
+        put_string(raw, table.serial_column);
+        put_u64(raw, table.data.size());
+        raw += table.data;
+    }
+
+    std::string out(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    put_u32(out, CATALOG_SNAPSHOT_VERSION);
+    put_u64(out, raw.size());
+    put_u32(out, checksum(raw));
+
+    // Потоковое сжатие: compress2 ограничен размером uLong на части платформ
+    z_stream stream = {};
+    deflateInit(&stream, level);
+    std::string compressed(deflateBound(&stream, raw.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(&raw[0]);
+    stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+    size_t in_left = raw.size();
+    size_t out_left = compressed.size();
+    int status = Z_OK;
+    while (status == Z_OK) {
+        stream.avail_in = static_cast<uInt>(std::min<size_t>(in_left, UINT32_MAX));
+        stream.avail_out = static_cast<uInt>(std::min<size_t>(out_left, UINT32_MAX));
+        uInt avail_in = stream.avail_in;
+        uInt avail_out = stream.avail_out;
+        status = deflate(&stream, stream.avail_in == in_left ? Z_FINISH : Z_NO_FLUSH);
+        in_left -= avail_in - stream.avail_in;
+        out_left -= avail_out - stream.avail_out;
+    }
+    compressed.resize(compressed.size() - out_left);
+    deflateEnd(&stream);
+    return out + compressed;
+}
+
+bool catalog_snapshot_decode(const std::string& data, CatalogSnapshot& snapshot, std::string& error) {
+    if (data.size() < SNAPSHOT_HEADER_SIZE || data.compare(0, 4, SNAPSHOT_MAGIC, 4) != 0) {
+        error = "not a catalog snapshot";
+        return false;
+    }
+    SnapshotReader header = {data, 4};
+    uint32_t version = 0, expected_crc = 0;
+    uint64_t raw_size = 0;
+    header.u32(version);
+    header.u64(raw_size);
+    header.u32(expected_crc);
+    if (version != CATALOG_SNAPSHOT_VERSION) {
+        error = "unsupported snapshot version " + std::to_string(version);
+        return false;
+    }
+    if (raw_size > SNAPSHOT_MAX_RAW_SIZE) {
+        error = "snapshot size out of range";
+        return false;
+    }
+
+    std::string raw(raw_size, '\0');
+    z_stream stream = {};
+    inflateInit(&stream);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data() + SNAPSHOT_HEADER_SIZE));
+    stream.next_out = reinterpret_cast<Bytef*>(&raw[0]);
+    size_t in_left = data.size() - SNAPSHOT_HEADER_SIZE;
+    size_t out_left = raw.size();
+    int status = Z_OK;
+    while (status == Z_OK) {
+        stream.avail_in = static_cast<uInt>(std::min<size_t>(in_left, UINT32_MAX));
+        stream.avail_out = static_cast<uInt>(std::min<size_t>(out_left, UINT32_MAX));
+        uInt avail_in = stream.avail_in;
+        uInt avail_out = stream.avail_out;
+        status = inflate(&stream, Z_NO_FLUSH);
+        in_left -= avail_in - stream.avail_in;
+        out_left -= avail_out - stream.avail_out;
+        if (status == Z_OK && avail_in == stream.avail_in && avail_out == stream.avail_out) {
+            status = Z_BUF_ERROR;  // Ни байта вперед: данные обрезаны
+        }
+    }
+    inflateEnd(&stream);
+    if (status != Z_STREAM_END || out_left != 0 || in_left != 0) {
+        error = "snapshot is truncated or corrupted";
+        return false;
+    }
+    if (checksum(raw) != expected_crc) {
+        error = "snapshot checksum mismatch";
+        return false;
+    }
+
+    SnapshotReader reader = {raw, 0};
+    uint64_t created_at = 0;
+    uint32_t table_count = 0;
+    snapshot = CatalogSnapshot();
+    if (!reader.string(snapshot.source) || !reader.string(snapshot.wal_position) || !reader.u64(created_at) ||
+        !reader.u32(table_count)) {
+        error = "snapshot header is malformed";
+        return false;
+    }
+    snapshot.created_at = static_cast<int64_t>(created_at);
+    for (uint32_t i = 0; i < table_count; ++i) {
+        CatalogTableCopy table;
+        uint64_t length;
+        if (!reader.string(table.table) || !reader.string(table.serial_column) || !reader.u64(length) ||
+            raw.size() - reader.pos < length) {
+            error = "snapshot table is malformed";
+            return false;
+        }
+        table.data.assign(raw, reader.pos, length);
+        reader.pos += length;
+        snapshot.tables.push_back(std::move(table));
+    }
+    if (reader.pos != raw.size()) {
+        error = "trailing data in snapshot";
+        return false;
+    }
+    return true;
+}
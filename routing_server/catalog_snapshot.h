@@ -0,0 +1,37 @@
+#ifndef CATALOG_SNAPSHOT_H
+#define CATALOG_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "db_manager.h"
+
+// Двоичный снимок каталога маршрутизатора для быстрого старта нового узла.
+// Формат: заголовок "RSNP", версия, размер несжатых данных и их CRC32, затем
+// данные, сжатые zlib: источник, позиция WAL источника на момент снимка,
+// время создания и таблицы в текстовом формате COPY. Числа - little-endian,
+// строки - длина (4 байта) и байты
+
+const uint32_t CATALOG_SNAPSHOT_VERSION = 1;
+
+struct CatalogSnapshot {
+    std::string source;        // Маршрутизатор, снявший снимок, "ip:port"
+    std::string wal_position;  // pg_current_wal_lsn() источника на момент снимка
+    int64_t created_at = 0;    // Секунды Unix
+    std::vector<CatalogTableCopy> tables;
+};
+
+// Таблицы каталога в порядке внешних ключей, с пустыми данными
+std::vector<CatalogTableCopy> catalog_snapshot_tables();
+
+// Строк в таблице (строк текста COPY)
+size_t catalog_snapshot_rows(const CatalogTableCopy& table);
+
+// Сжатый снимок; level - уровень zlib (1 - быстрее, 9 - плотнее)
+std::string catalog_snapshot_encode(const CatalogSnapshot& snapshot, int level = 6);
+
+// Разбор с проверкой заголовка, версии, размера и CRC32. false - в error причина
+bool catalog_snapshot_decode(const std::string& data, CatalogSnapshot& snapshot, std::string& error);
+
+#endif // CATALOG_SNAPSHOT_H
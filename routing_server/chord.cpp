@@ -0,0 +1,291 @@
+#include "chord.h"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <set>
+
+// Предел переходов при поиске: при недостроенных пальцах поиск может идти
+// по преемникам, но не должен зацикливаться на разорванном кольце
+const int CHORD_MAX_HOPS = 1 << 16;
+
+Hash chord_hash(const std::string& key) {
+    return std::hash<std::string>{}(key);
+}
+
+bool chord_in_range(Hash key, Hash start, Hash end) {
+    if (start < end) return key > start && key <= end;
+    else return key > start || key <= end; // Обход через 0
+}
+
+// Лежит ли key в открытом интервале (start, end)
+static bool in_open_range(Hash key, Hash start, Hash end) {
+    return key != end && chord_in_range(key, start, end);
+}
+
+Node::Node(std::string addr) : address(std::move(addr)), fingers(CHORD_BITS, nullptr) {
+    id = chord_hash(address);
+}
+
+Node::Node(std::string addr, int vnode_index)
+    : address(std::move(addr)), vnode(vnode_index), fingers(CHORD_BITS, nullptr) {
+    id = chord_hash(vnode == 0 ? address : address + "#" + std::to_string(vnode));
+}
+
+std::vector<Node*> make_virtual_nodes(const std::string& address, int count) {
+    std::vector<Node*> vnodes;
+    for (int i = 0; i < count; ++i) {
+        vnodes.push_back(new Node(address, i));
+    }
+    return vnodes;
+}
+
+void Node::store(Hash key, const std::string& filename) {
+    metadata[key] = filename;
+}
+
+ChordLookup Node::find_successor(Hash key) {
+    ChordLookup result;
+    Node* n = this;
+    while (!chord_in_range(key, n->id, n->successor->id) && result.hops < CHORD_MAX_HOPS) {
+        Node* next = n->closest_preceding_node(key);
+        if (next == n) {
+            break;
+        }
+        n = next;
+        result.hops++;
+    }
+    result.owner = n->successor;
+    return result;
+}
+
+Node* Node::closest_preceding_node(Hash key) const {
+    for (int i = CHORD_BITS - 1; i >= 0; --i) {
+        Node* finger = fingers[i];
+        if (finger && finger->alive && in_open_range(finger->id, id, key)) {
+            return finger;
+        }
+    }
+    if (successor->alive && in_open_range(successor->id, id, key)) {
+        return successor;
+    }
+    return const_cast<Node*>(this);
+}
+
+void Node::create() {
+    predecessor = nullptr;
+    successor = this;
+    std::fill(fingers.begin(), fingers.end(), nullptr);
+}
+
+void Node::join(Node* known) {
+    predecessor = nullptr;
+    std::fill(fingers.begin(), fingers.end(), nullptr);
+    successor = known->find_successor(id).owner;
+    fingers[0] = successor;
+}
+
+void Node::stabilize() {
+    Node* x = successor->predecessor;
+    if (x && x->alive && in_open_range(x->id, id, successor->id)) {
+        successor = x;
+    }
+    fingers[0] = successor;
+    successor->notify(this);
+}
+
+void Node::notify(Node* n) {
+    if (!predecessor || !predecessor->alive || in_open_range(n->id, predecessor->id, id)) {
+        predecessor = n;
+    }
+}
+
+void Node::fix_fingers() {
+    next_finger = (next_finger + 1) % CHORD_BITS;
+    fingers[next_finger] = find_successor(id + (Hash(1) << next_finger)).owner;
+}
+
+void Node::check_predecessor() {
+    if (predecessor && !predecessor->alive) {
+        predecessor = nullptr;
+    }
+}
+
+static bool node_less(const Node* a, const Node* b) {
+    return a->id < b->id;
+}
+
+void DHTRing::add_node(Node* new_node) {
+    nodes.insert(std::upper_bound(nodes.begin(), nodes.end(), new_node, node_less), new_node);
+    update_neighbors();
+}
+
+void DHTRing::join_node(Node* new_node, Node* known) {
+    if (!known) {
+        new_node->create();
+    } else {
+        new_node->join(known);
+    }
+    nodes.insert(std::upper_bound(nodes.begin(), nodes.end(), new_node, node_less), new_node);
+}
+
+void DHTRing::maintenance_round() {
+    for (Node* node : nodes) {
+        if (node->alive) {
+            node->stabilize();
+            node->fix_fingers();
+            node->check_predecessor();
+        }
+    }
+}
+
+Node* DHTRing::owner_of(Hash key) const {
+    auto it = std::lower_bound(nodes.begin(), nodes.end(), key,
+                               [](const Node* node, Hash value) { return node->id < value; });
+    return it != nodes.end() ? *it : nodes.front();
+}
+
+void DHTRing::update_neighbors() {
+    int n = nodes.size();
+    for (int i = 0; i < n; ++i) {
+        nodes[i]->successor = nodes[(i + 1) % n];
+        nodes[i]->predecessor = nodes[(i - 1 + n) % n];
+        for (int k = 0; k < CHORD_BITS; ++k) {
+            nodes[i]->fingers[k] = owner_of(nodes[i]->id + (Hash(1) << k));
+        }
+    }
+}
+
+void DHTRing::print_ring() const {
+    std::cout << "=== DHT Ring ===\n";
+    for (auto node : nodes) {
+        std::cout << "Node: " << node->address << " ID: " << node->id
+                  << " Succ: " << node->successor->address << std::endl;
+    }
+}
+
+size_t DHTRing::join_router(const std::vector<Node*>& vnodes) {
+    changes.push_back(MembershipChange{});
+    size_t change = changes.size() - 1;
+    changes[change].address = vnodes.empty() ? "" : vnodes.front()->address;
+    changes[change].joined = true;
+    // Владельцы диапазонов до входа: у них ключи, которые перейдут новым узлам
+    std::vector<Node*> sources;
+    for (Node* vnode : vnodes) {
+        sources.push_back(nodes.empty() ? nullptr : owner_of(vnode->id));
+    }
+    for (Node* vnode : vnodes) {
+        nodes.insert(std::upper_bound(nodes.begin(), nodes.end(), vnode, node_less), vnode);
+    }
+    update_neighbors();
+    for (size_t i = 0; i < vnodes.size(); ++i) {
+        if (sources[i]) {
+            handoffs.push_back(Handoff{sources[i], vnodes[i], vnodes[i]->predecessor->id, vnodes[i]->id, change});
+            changes[change].handoffs_pending++;
+        }
+    }
+    return change;
+}
+
+size_t DHTRing::leave_router(const std::vector<Node*>& vnodes) {
+    changes.push_back(MembershipChange{});
+    size_t change = changes.size() - 1;
+    changes[change].address = vnodes.empty() ? "" : vnodes.front()->address;
+    changes[change].joined = false;
+    std::set<const Node*> leaving(vnodes.begin(), vnodes.end());
+    std::vector<Hash> starts;
+    for (Node* vnode : vnodes) {
+        starts.push_back(vnode->predecessor ? vnode->predecessor->id : vnode->id);
+    }
+    nodes.erase(std::remove_if(nodes.begin(), nodes.end(),
+                               [&leaving](const Node* node) { return leaving.count(node) > 0; }),
+                nodes.end());
+    if (nodes.empty()) {
+        return change;
+    }
+    update_neighbors();
+    // Диапазон каждого вышедшего узла целиком уходит его новому владельцу
+    for (size_t i = 0; i < vnodes.size(); ++i) {
+        handoffs.push_back(Handoff{vnodes[i], owner_of(vnodes[i]->id), starts[i], vnodes[i]->id, change});
+        changes[change].handoffs_pending++;
+    }
+    return change;
+}
+
+// Первый ключ узла в (start, end]
+static std::map<Hash, std::string>::iterator first_in_range(std::map<Hash, std::string>& metadata, Hash start,
+                                                              Hash end) {
+    auto it = metadata.upper_bound(start);
+    if (it != metadata.end() && chord_in_range(it->first, start, end)) {
+        return it;
+    }
+    if (start >= end) {
+        // Диапазон через 0: ключи от начала до end
+        it = metadata.begin();
+        if (it != metadata.end() && chord_in_range(it->first, start, end)) {
+            return it;
+        }
+    }
+    return metadata.end();
+}
+
+size_t DHTRing::handoff_step(size_t max_keys) {
+    size_t moved = 0;
+    while (moved < max_keys && !handoffs.empty()) {
+        Handoff& handoff = handoffs.front();
+        auto& source = handoff.from->metadata;
+        auto it = first_in_range(source, handoff.start, handoff.end);
+        if (it == source.end()) {
+            changes[handoff.change].handoffs_pending--;
+            handoffs.pop_front();
+            continue;
+        }
+        // Запись, пришедшая новому владельцу во время передачи, новее
+        handoff.to->metadata.insert(*it);
+        source.erase(it);
+        changes[handoff.change].keys_moved++;
+        moved++;
+    }
+    return moved;
+}
+
+bool DHTRing::handoff_pending(const Node* node) const {
+    for (const auto& handoff : handoffs) {
+        if (handoff.from == node || handoff.to == node) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DHTRing::put(Hash key, const std::string& filename) {
+    if (!nodes.empty()) {
+        owner_of(key)->store(key, filename);
+    }
+}
+
+const std::string* DHTRing::get(Hash key) const {
+    if (nodes.empty()) {
+        return nullptr;
+    }
+    const Node* node = owner_of(key);
+    // Не найден у владельца - ищется у того, кто еще не передал ему диапазон,
+    // и так далее по цепочке незавершенных передач
+    for (size_t step = 0; step <= handoffs.size(); ++step) {
+        auto found = node->metadata.find(key);
+        if (found != node->metadata.end()) {
+            return &found->second;
+        }
+        const Node* previous = nullptr;
+        for (auto it = handoffs.rbegin(); it != handoffs.rend(); ++it) {
+            if (it->to == node && chord_in_range(key, it->start, it->end)) {
+                previous = it->from;
+                break;
+            }
+        }
+        if (!previous) {
+            return nullptr;
+        }
+        node = previous;
+    }
+    return nullptr;
+}
@@ -0,0 +1,146 @@
+#ifndef CHORD_H
+#define CHORD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// Кольцо DHT маршрутизаторов по схеме Chord. Идентификаторы - 64-битные хеши,
+// у каждого узла таблица пальцев: fingers[i] = successor(id + 2^i). Поиск
+// владельца итеративный, каждый шаг приближает к ключу не меньше чем вдвое,
+// поэтому число переходов - O(log n), а не O(n), как при обходе по successor.
+// Таблицы поддерживаются периодическими stabilize и fix_fingers, так что
+// узлы могут входить в кольцо через любого известного участника
+
+using Hash = uint64_t;
+
+// Число разрядов идентификатора и размер таблицы пальцев
+const int CHORD_BITS = 64;
+
+// Хеш адреса или ключа на кольце
+Hash chord_hash(const std::string& key);
+
+// Лежит ли key в полуинтервале (start, end] по кольцу
+bool chord_in_range(Hash key, Hash start, Hash end);
+
+struct Node;
+
+// Итог поиска: владелец ключа и число переходов между узлами
+struct ChordLookup {
+    Node* owner = nullptr;
+    int hops = 0;
+};
+
+// Узел в кольце DHT
+struct Node {
+    std::string address;  // IP:PORT
+    int vnode = 0;        // Номер виртуального узла маршрутизатора
+    Hash id;              // Хеш от address (и vnode, если он не 0)
+    Node* successor = nullptr;
+    Node* predecessor = nullptr;
+    std::vector<Node*> fingers;  // CHORD_BITS пальцев, пустые - nullptr
+    int next_finger = 0;         // Палец, который обновит следующий fix_fingers
+    bool alive = true;
+    std::map<Hash, std::string> metadata;  // Хеш снимка -> имя файла
+
+    explicit Node(std::string addr);
+    Node(std::string addr, int vnode_index);
+
+    // Вставка снимка в DHT
+    void store(Hash key, const std::string& filename);
+
+    // Поиск владельца ключа: итеративный, с подсчетом переходов
+    ChordLookup find_successor(Hash key);
+
+    // Ближайший к key узел из таблицы пальцев, предшествующий ему на кольце
+    Node* closest_preceding_node(Hash key) const;
+
+    // Кольцо из одного узла
+    void create();
+
+    // Вход в кольцо через известный узел; остальные связи появятся после stabilize
+    void join(Node* known);
+
+    // Проверка преемника: если между нами появился узел, он становится преемником
+    void stabilize();
+
+    // n считает, что он может быть нашим предшественником
+    void notify(Node* n);
+
+    // Обновление очередного пальца
+    void fix_fingers();
+
+    // Сброс предшественника, если он перестал отвечать
+    void check_predecessor();
+};
+
+// Виртуальные узлы маршрутизатора: count точек на кольце вместо одной
+// выравнивают доли ключей и делят передачу при входе и выходе между многими
+// соседями. Узлы принадлежат вызывающему
+std::vector<Node*> make_virtual_nodes(const std::string& address, int count);
+
+// Передача ключей (start, end] от прежнего владельца новому
+struct Handoff {
+    Node* from;
+    Node* to;
+    Hash start;
+    Hash end;
+    size_t change;  // Индекс в DHTRing::changes
+};
+
+// Вход или выход маршрутизатора и число переданных из-за него ключей
+struct MembershipChange {
+    std::string address;
+    bool joined = true;
+    size_t keys_moved = 0;
+    size_t handoffs_pending = 0;
+};
+
+// Симуляция кольца
+struct DHTRing {
+    std::vector<Node*> nodes;  // Отсортированы по id; узлы принадлежат вызывающему
+
+    // Добавление узла с мгновенным пересчетом всех связей и пальцев
+    void add_node(Node* new_node);
+
+    // Добавление узла через протокол: join и затем раунды maintenance_round
+    void join_node(Node* new_node, Node* known);
+
+    // Один период обслуживания: stabilize, fix_fingers и check_predecessor на каждом узле
+    void maintenance_round();
+
+    // Точный владелец ключа по отсортированному списку узлов (для проверки)
+    Node* owner_of(Hash key) const;
+
+    void update_neighbors();
+    void print_ring() const;
+
+    // Вход и выход маршрутизатора со всеми его виртуальными узлами. Связи
+    // пересчитываются сразу, а ключи переходят только из затронутых
+    // диапазонов и только в handoff_step; до конца передачи чтение идет
+    // к прежнему владельцу. Возвращают индекс в changes
+    size_t join_router(const std::vector<Node*>& vnodes);
+    size_t leave_router(const std::vector<Node*>& vnodes);
+
+    // Передача не больше max_keys ключей: вызывается периодически, ограничивая
+    // скорость. Передачи идут по очереди, поэтому цепочки (ключи еще не дошли
+    // до узла, который уже отдает диапазон дальше) не теряют ключей.
+    // Возвращает число переданных ключей
+    size_t handoff_step(size_t max_keys);
+
+    // Узел еще отдает или принимает ключи (вышедший узел нельзя удалять)
+    bool handoff_pending(const Node* node) const;
+
+    // Запись - текущему владельцу; чтение - у владельца или, пока диапазон
+    // не передан, у прежнего. nullptr - ключа нет
+    void put(Hash key, const std::string& filename);
+    const std::string* get(Hash key) const;
+
+    std::deque<Handoff> handoffs;
+    std::vector<MembershipChange> changes;
+};
+
+#endif // CHORD_H
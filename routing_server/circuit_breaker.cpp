@@ -0,0 +1,195 @@
+#include "circuit_breaker.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Окно последних запросов для доли ошибок
+const size_t BREAKER_WINDOW = 50;
+// Минимум запросов в окне, чтобы судить о доле ошибок
+const size_t BREAKER_MIN_REQUESTS = 20;
+const double BREAKER_MAX_ERROR_RATE = 0.5;
+// Подряд идущие ошибки, после которых сервер исключается сразу
+const int BREAKER_CONSECUTIVE_FAILURES = 5;
+// Выброс по задержке: во столько раз медленнее медианы остальных серверов
+const double BREAKER_OUTLIER_FACTOR = 3.0;
+// и не быстрее этого порога (быстрые серверы выбросами не считаем)
+const double BREAKER_OUTLIER_MIN_MS = 200.0;
+// Серверов с историей задержки, нужных для поиска выбросов
+const size_t BREAKER_OUTLIER_MIN_SERVERS = 3;
+const double BREAKER_LATENCY_ALPHA = 0.2;
+// Интервал исключения: BASE * 2^(ejections - 1), не больше MAX
+const double BREAKER_BASE_EJECTION_MS = 1000.0;
+const double BREAKER_MAX_EJECTION_MS = 300000.0;
+// Не исключать больше этой доли известных серверов, чтобы не остаться без хранилища
+const double BREAKER_MAX_EJECTED_FRACTION = 0.5;
+
+typedef std::chrono::steady_clock clock_type;
+
+struct BreakerEntry {
+    breaker_state_t state = BREAKER_CLOSED;
+    std::deque<bool> outcomes;  // true - ошибка
+    size_t failures_in_window = 0;
+    int consecutive_failures = 0;
+    double latency_ms = 0;
+    size_t latency_samples = 0;
+    int ejections = 0;
+    bool probe_in_flight = false;
+    clock_type::time_point ejected_until;
+    uint64_t rejected = 0;
+};
+
+static std::mutex g_breaker_mtx;
+static std::map<std::string, BreakerEntry> g_breakers;
+
+static bool ejection_expired(const BreakerEntry& entry) {
+    return clock_type::now() >= entry.ejected_until;
+}
+
+static size_t ejected_count() {
+    size_t count = 0;
+    for (const auto& entry : g_breakers) {
+        if (entry.second.state != BREAKER_CLOSED) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static void eject(BreakerEntry& entry) {
+    entry.ejections++;
+    double interval = BREAKER_BASE_EJECTION_MS * (1 << std::min(entry.ejections - 1, 20));
+    interval = std::min(interval, BREAKER_MAX_EJECTION_MS);
+    entry.state = BREAKER_OPEN;
+    entry.probe_in_flight = false;
+    entry.ejected_until = clock_type::now() +
+        std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double, std::milli>(interval));
+}
+
+// Медиана сглаженной задержки остальных серверов или 0, если их мало
+static double peers_median_latency(const std::string& except) {
+    std::vector<double> latencies;
+    for (const auto& entry : g_breakers) {
+        if (entry.first != except && entry.second.latency_samples >= BREAKER_MIN_REQUESTS) {
+            latencies.push_back(entry.second.latency_ms);
+        }
+    }
+    if (latencies.size() + 1 < BREAKER_OUTLIER_MIN_SERVERS) {
+        return 0;
+    }
+    std::nth_element(latencies.begin(), latencies.begin() + latencies.size() / 2, latencies.end());
+    return latencies[latencies.size() / 2];
+}
+
+bool breaker_available(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_breaker_mtx);
+    auto it = g_breakers.find(location);
+    if (it == g_breakers.end() || it->second.state == BREAKER_CLOSED) {
+        return true;
+    }
+    return ejection_expired(it->second) && !it->second.probe_in_flight;
+}
+
+bool breaker_acquire(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_breaker_mtx);
+    BreakerEntry& entry = g_breakers[location];
+    if (entry.state == BREAKER_CLOSED) {
+        return true;
+    }
+    if (ejection_expired(entry) && !entry.probe_in_flight) {
+        entry.state = BREAKER_HALF_OPEN;
+        entry.probe_in_flight = true;
+        return true;
+    }
+    entry.rejected++;
+    return false;
+}
+
+void breaker_record(const std::string& location, bool success, double latency_ms) {
+    std::lock_guard<std::mutex> lock(g_breaker_mtx);
+    BreakerEntry& entry = g_breakers[location];
+
+    if (success) {
+        entry.latency_ms = entry.latency_samples == 0
+            ? latency_ms
+            : BREAKER_LATENCY_ALPHA * latency_ms + (1 - BREAKER_LATENCY_ALPHA) * entry.latency_ms;
+        entry.latency_samples++;
+    }
+
+    if (entry.state == BREAKER_HALF_OPEN) {
+        // Пробный запрос решает судьбу сервера: успех возвращает его, ошибка
+        // исключает снова на вдвое больший интервал
+        if (success) {
+            entry.state = BREAKER_CLOSED;
+            entry.probe_in_flight = false;
+            entry.ejections = 0;
+            entry.outcomes.clear();
+            entry.failures_in_window = 0;
+            entry.consecutive_failures = 0;
+            entry.latency_samples = 0;
+        } else {
+            eject(entry);
+        }
+        return;
+    }
+    if (entry.state == BREAKER_OPEN) {
+        // Запрос, начатый до исключения
+        return;
+    }
+
+    entry.outcomes.push_back(!success);
+    entry.failures_in_window += success ? 0 : 1;
+    if (entry.outcomes.size() > BREAKER_WINDOW) {
+        entry.failures_in_window -= entry.outcomes.front() ? 1 : 0;
+        entry.outcomes.pop_front();
+    }
+    entry.consecutive_failures = success ? 0 : entry.consecutive_failures + 1;
+
+    bool failing = entry.consecutive_failures >= BREAKER_CONSECUTIVE_FAILURES ||
+        (entry.outcomes.size() >= BREAKER_MIN_REQUESTS &&
+         static_cast<double>(entry.failures_in_window) / entry.outcomes.size() > BREAKER_MAX_ERROR_RATE);
+    bool slow = false;
+    if (!failing && entry.latency_samples >= BREAKER_MIN_REQUESTS && entry.latency_ms >= BREAKER_OUTLIER_MIN_MS) {
+        double median = peers_median_latency(location);
+        slow = median > 0 && entry.latency_ms > BREAKER_OUTLIER_FACTOR * median;
+    }
+    if ((failing || slow) &&
+        ejected_count() + 1 <= BREAKER_MAX_EJECTED_FRACTION * g_breakers.size()) {
+        eject(entry);
+    }
+}
+
+void breaker_cancel(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_breaker_mtx);
+    auto it = g_breakers.find(location);
+    if (it != g_breakers.end() && it->second.state == BREAKER_HALF_OPEN) {
+        it->second.probe_in_flight = false;
+    }
+}
+
+void breaker_remove(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_breaker_mtx);
+    g_breakers.erase(location);
+}
+
+std::map<std::string, BreakerInfo> breaker_snapshot() {
+    std::lock_guard<std::mutex> lock(g_breaker_mtx);
+    std::map<std::string, BreakerInfo> result;
+    auto now = clock_type::now();
+    for (const auto& entry : g_breakers) {
+        BreakerInfo info;
+        info.state = entry.second.state;
+        info.error_rate = entry.second.outcomes.empty() ? 0.0
+            : static_cast<double>(entry.second.failures_in_window) / entry.second.outcomes.size();
+        info.latency_ms = entry.second.latency_ms;
+        info.consecutive_failures = entry.second.consecutive_failures;
+        info.ejections = entry.second.ejections;
+        if (entry.second.state != BREAKER_CLOSED && entry.second.ejected_until > now) {
+            info.ejected_for_ms = std::chrono::duration<double, std::milli>(entry.second.ejected_until - now).count();
+        }
+        info.rejected = entry.second.rejected;
+        result[entry.first] = info;
+    }
+    return result;
+}
@@ -0,0 +1,47 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Состояние автомата защиты для одного storage-сервера
+typedef enum {
+    BREAKER_CLOSED,     // Запросы идут как обычно
+    BREAKER_OPEN,       // Сервер исключен до истечения интервала
+    BREAKER_HALF_OPEN   // Интервал истек, разрешен один пробный запрос
+} breaker_state_t;
+
+// Состояние сервера для метрик
+struct BreakerInfo {
+    breaker_state_t state = BREAKER_CLOSED;
+    double error_rate = 0;        // Доля ошибок в окне последних запросов
+    double latency_ms = 0;        // Сглаженная задержка
+    int consecutive_failures = 0;
+    int ejections = 0;            // Исключений подряд, определяет длину интервала
+    double ejected_for_ms = 0;    // Сколько осталось до пробного запроса
+    uint64_t rejected = 0;        // Запросы, не отправленные из-за исключения
+};
+
+// Серверы различаются по адресу (Servers.location), так что учет
+// ведется на уровне соединений и не требует server_id
+
+// Можно ли рассматривать сервер при выборе (без захвата пробного запроса)
+bool breaker_available(const std::string& location);
+
+// Разрешение на запрос. Для сервера с истекшим интервалом переводит
+// автомат в HALF_OPEN и выдает единственный пробный запрос
+bool breaker_acquire(const std::string& location);
+
+// Итог запроса: ошибка соединения или 5xx - неудача
+void breaker_record(const std::string& location, bool success, double latency_ms);
+
+// Запрос отменен без итога (проигравший хедж): освобождает пробный запрос
+void breaker_cancel(const std::string& location);
+
+// Забыть сервер (при /server/remove)
+void breaker_remove(const std::string& location);
+
+std::map<std::string, BreakerInfo> breaker_snapshot();
+
+#endif // CIRCUIT_BREAKER_H
@@ -0,0 +1,550 @@
+// Имитация кластера из сотен маршрутизаторов и серверов хранения в одном
+// процессе (sim_network.h): модельное время, задержки, потери и разделение
+// сети, повторяемость по seed. Узлы работают на настоящем коде маршрутизатора.
+//
+// Запуск:
+//   ./cluster_sim [маршрутизаторов] [серверов] [доля_потерь] [seed]
+// Печатаются:
+//   - gossip (gossip_node.h) при разных fanout и ttl: какая доля маршрутизаторов
+//     получила изменение, за сколько, сколько сообщений на изменение; отдельно -
+//     с разделением сети на время рассылки;
+//   - счетчики обращений (gcounter.h): за сколько все маршрутизаторы сходятся
+//     к одному состоянию по дельтам gossip и с забором полного состояния;
+//   - поиск в кольце DHT (chord.h): переходы и модельная задержка поиска,
+//     доля ключей на маршрутизатор при виртуальных узлах;
+//   - размещение загрузок: select_power_of_two (placement.h) по локальному
+//     виду маршрутизатора, он же со сводками нагрузки других маршрутизаторов
+//     (load_view.h) и hrw_owner (rendezvous.h) - загрузка серверов и задержка
+//     запросов.
+#include "chord.h"
+#include "gcounter.h"
+#include "gossip_node.h"
+#include "placement.h"
+#include "rendezvous.h"
+#include "sim_network.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+const double SIM_LATENCY_BASE_MS = 0.5;
+const double SIM_LATENCY_TAIL_MS = 1.0;
+
+static double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(values.size() * fraction))];
+}
+
+struct GossipResult {
+    double coverage = 0;        // Доля пар (изменение, маршрутизатор), где изменение применено
+    double complete = 0;        // Доля изменений, дошедших до всех
+    double p50_ms = 0;          // Задержка от источника до маршрутизатора
+    double p99_ms = 0;
+    double messages_per_update = 0;
+};
+
+// Рассылка updates изменений со случайных маршрутизаторов за первые 2 секунды.
+// partition_ms > 0 - первые 30% маршрутизаторов отделены на это время
+static GossipResult simulate_gossip(int routers, const GossipConfig& config, double loss, SimTime partition_ms,
+                                    uint64_t seed) {
+    const int updates = 100;
+    const SimTime inject_ms = 2000;
+    const SimTime run_ms = 15000;
+    SimNetwork net(seed);
+    net.set_latency(SIM_LATENCY_BASE_MS, SIM_LATENCY_TAIL_MS);
+    net.set_loss(loss);
+    std::mt19937 rng(static_cast<uint32_t>(seed));
+
+    std::vector<std::string> addresses;
+    std::map<std::string, int> index;
+    for (int i = 0; i < routers; ++i) {
+        addresses.push_back("10.2." + std::to_string(i / 256) + "." + std::to_string(i % 256) + ":8080");
+        index[addresses.back()] = i;
+    }
+    std::vector<std::unique_ptr<GossipNode>> nodes;
+    for (int i = 0; i < routers; ++i) {
+        nodes.emplace_back(new GossipNode());
+        nodes.back()->configure(addresses[i], config, addresses[i]);
+    }
+
+    // applied[u][r] - модельное время применения изменения u маршрутизатором r
+    std::vector<std::vector<SimTime>> applied(updates, std::vector<SimTime>(routers, -1));
+    std::vector<SimTime> injected(updates, 0);
+    std::vector<GossipApply> apply(routers);
+    for (int r = 0; r < routers; ++r) {
+        // Как обработчики /server/add и др.: применить и переслать дальше
+        apply[r] = [&, r](const std::string& method, const std::string& path, const std::string& body) {
+            int update = std::atoi(body.c_str());
+            if (applied[update][r] < 0) {
+                applied[update][r] = net.now();
+            }
+            nodes[r]->broadcast(method, path, body);
+        };
+    }
+
+    for (int r = 0; r < routers; ++r) {
+        // Поток отправки: раз в flush_ms все накопленное уходит пакетами
+        SimTime phase = std::uniform_real_distribution<double>(0, config.flush_ms)(net.rng());
+        net.every(phase, config.flush_ms, [&, r]() {
+            for (const auto& batch : nodes[r]->take_batches(addresses, rng)) {
+                int to = index[batch.peer];
+                std::string body = batch.body;
+                bool ok = net.send(r, to, [&, to, body]() {
+                    std::string response;
+                    nodes[to]->receive(body, apply[to], response);
+                });
+                nodes[r]->record_batch(batch, ok);
+            }
+        });
+    }
+    for (int u = 0; u < updates; ++u) {
+        SimTime at = std::uniform_real_distribution<double>(0, inject_ms)(net.rng());
+        int origin = net.rng()() % routers;
+        net.schedule(at, [&, u, origin]() {
+            injected[u] = net.now();
+            applied[u][origin] = net.now();
+            nodes[origin]->broadcast("POST", "/server/add", std::to_string(u));
+        });
+    }
+    if (partition_ms > 0) {
+        std::vector<int> side;
+        for (int r = 0; r < routers * 3 / 10; ++r) {
+            side.push_back(r);
+        }
+        net.partition(side);
+        net.schedule(partition_ms, [&net]() { net.heal(); });
+    }
+    net.run(run_ms);
+
+    GossipResult result;
+    std::vector<double> delays;
+    size_t reached = 0, complete = 0;
+    for (int u = 0; u < updates; ++u) {
+        size_t count = 0;
+        for (int r = 0; r < routers; ++r) {
+            if (applied[u][r] >= 0) {
+                count++;
+                delays.push_back(applied[u][r] - injected[u]);
+            }
+        }
+        reached += count;
+        complete += count == static_cast<size_t>(routers);
+    }
+    uint64_t messages = 0;
+    for (const auto& node : nodes) {
+        messages += node->stats().messages_sent;
+    }
+    result.coverage = static_cast<double>(reached) / (updates * routers);
+    result.complete = static_cast<double>(complete) / updates;
+    result.p50_ms = percentile(delays, 0.5);
+    result.p99_ms = percentile(delays, 0.99);
+    result.messages_per_update = static_cast<double>(messages) / updates;
+    return result;
+}
+
+static void report_gossip(int routers, double loss, uint64_t seed) {
+    printf("gossip: %d маршрутизаторов, 100 изменений, потери %.0f%%\n", routers, 100 * loss);
+    printf("%-7s %4s %10s %10s %9s %9s %14s\n", "fanout", "ttl", "разделение", "охват", "все", "p50 мс",
+           "p99 мс");
+    int log_ttl = static_cast<int>(std::ceil(std::log2(std::max(2, routers)))) + 2;
+    // Заданные fanout и ttl без подстройки и значения по умолчанию с подстройкой
+    // под число маршрутизаторов (scale_to_peers)
+    std::vector<std::pair<int, int>> configs = {{2, 4}, {3, 6}, {2, log_ttl}, {4, log_ttl}, {0, 0}};
+    for (const auto& fanout_ttl : configs) {
+        for (SimTime partition_ms : {0.0, 3000.0}) {
+            GossipConfig config;
+            bool scaled = fanout_ttl.first == 0;
+            if (!scaled) {
+                config.fanout = fanout_ttl.first;
+                config.ttl = fanout_ttl.second;
+                config.scale_to_peers = false;
+            }
+            GossipResult result = simulate_gossip(routers, config, loss, partition_ms, seed);
+            if (scaled) {
+                printf("%-11s %8s", "авто", "авто");  // Ширина printf - в байтах, а не в символах
+            } else {
+                printf("%-7d %4d", config.fanout, config.ttl);
+            }
+            printf(" %10s %9.1f%% %8.0f%% %9.1f %9.1f  (%.0f сообщ. на изменение)\n", partition_ms > 0 ? "3 с" : "-",
+                   100 * result.coverage, 100 * result.complete, result.p50_ms, result.p99_ms,
+                   result.messages_per_update);
+        }
+    }
+}
+
+// Обращения к 1000 ключам (распределение Ципфа) на случайных маршрутизаторах
+// в течение 5 секунд. Раз в секунду каждый рассылает дельту через gossip,
+// получатель сливает ее и пересылает, если что-то выросло (как
+// access_counter_merge); раз в sync_ms маршрутизатор забирает полное состояние
+// у случайного другого. Возвращает время схождения после последнего
+// обращения или -1, если за 60 секунд состояния не совпали
+static double simulate_counters(int routers, double loss, SimTime sync_ms, uint64_t seed, double& local_spread) {
+    const int keys = 1000;
+    const int accesses = 20000;
+    const SimTime access_ms = 5000;
+    const SimTime flush_ms = 1000;
+    SimNetwork net(seed);
+    net.set_latency(SIM_LATENCY_BASE_MS, SIM_LATENCY_TAIL_MS);
+    net.set_loss(loss);
+    std::mt19937 rng(static_cast<uint32_t>(seed));
+
+    std::vector<std::string> addresses;
+    std::map<std::string, int> index;
+    std::vector<std::unique_ptr<GossipNode>> gossip;
+    std::vector<std::unique_ptr<DecayingCounters>> counters;
+    for (int i = 0; i < routers; ++i) {
+        addresses.push_back("10.3." + std::to_string(i / 256) + "." + std::to_string(i % 256) + ":8080");
+        index[addresses.back()] = i;
+        gossip.emplace_back(new GossipNode());
+        gossip.back()->configure(addresses[i], GossipConfig(), addresses[i]);
+        counters.emplace_back(new DecayingCounters(addresses[i]));
+    }
+    std::vector<GossipApply> apply(routers);
+    for (int r = 0; r < routers; ++r) {
+        apply[r] = [&, r](const std::string& method, const std::string& path, const std::string& body) {
+            size_t changed = 0;
+            if (counters[r]->merge(body, changed) && changed > 0) {
+                gossip[r]->broadcast(method, path, body);
+            }
+        };
+    }
+
+    // Ципф: вероятность ключа k пропорциональна 1 / (k + 1)
+    std::vector<double> weights;
+    for (int k = 0; k < keys; ++k) weights.push_back(1.0 / (k + 1));
+    std::discrete_distribution<int> pick_key(weights.begin(), weights.end());
+    SimTime last_access = 0;
+    for (int a = 0; a < accesses; ++a) {
+        SimTime at = std::uniform_real_distribution<double>(0, access_ms)(net.rng());
+        int r = net.rng()() % routers;
+        std::string key = "k" + std::to_string(pick_key(net.rng()));
+        last_access = std::max(last_access, at);
+        net.schedule(at, [&, r, key]() { counters[r]->increment(key, 0); });
+    }
+
+    for (int r = 0; r < routers; ++r) {
+        SimTime phase = std::uniform_real_distribution<double>(0, flush_ms)(net.rng());
+        net.every(phase, flush_ms, [&, r]() {
+            std::string delta = counters[r]->take_delta();
+            if (!delta.empty()) {
+                gossip[r]->broadcast("POST", "/crdt/access", delta);
+            }
+        });
+        // Отправка пакетов gossip
+        net.every(phase, GossipConfig().flush_ms, [&, r]() {
+            for (const auto& batch : gossip[r]->take_batches(addresses, rng)) {
+                int to = index[batch.peer];
+                std::string body = batch.body;
+                gossip[r]->record_batch(batch, net.send(r, to, [&, to, body]() {
+                    std::string response;
+                    gossip[to]->receive(body, apply[to], response);
+                }));
+            }
+        });
+        if (sync_ms > 0) {
+            // Запрос GET /crdt/access и ответ с полным состоянием
+            net.every(std::uniform_real_distribution<double>(0, sync_ms)(net.rng()), sync_ms, [&, r]() {
+                int peer = (r + 1 + net.rng()() % (routers - 1)) % routers;
+                net.send(r, peer, [&, r, peer]() {
+                    std::string state = counters[peer]->state();
+                    net.send(peer, r, [&, r, state]() {
+                        size_t changed = 0;
+                        counters[r]->merge(state, changed);
+                    });
+                });
+            });
+        }
+    }
+
+    // Без обмена каждый знал бы только свои обращения, как прежде Spectrums.frequency
+    // у каждого узла: разброс своих счетчиков самого частого ключа
+    net.run(last_access);
+    double low = -1, high = 0;
+    for (int r = 0; r < routers; ++r) {
+        double own = static_cast<double>(counters[r]->per_node("k0")[addresses[r]]);
+        low = low < 0 ? own : std::min(low, own);
+        high = std::max(high, own);
+    }
+    local_spread = low > 0 ? high / low : 0;
+
+    SimTime converged = -1;
+    auto all_equal = [&]() {
+        std::string first = counters[0]->state();
+        for (int r = 1; r < routers; ++r) {
+            if (counters[r]->state() != first) return false;
+        }
+        return true;
+    };
+    for (SimTime t = last_access + 500; t <= last_access + 60000 && converged < 0; t += 500) {
+        net.run(t);
+        if (all_equal()) {
+            converged = t - last_access;
+        }
+    }
+    return converged;
+}
+
+static void report_counters(int routers, double loss, uint64_t seed) {
+    // Состояние - ключи * узлы ячеек, полный обмен на сотнях узлов долог и в модели
+    routers = std::min(routers, 100);
+    printf("\nсчетчики обращений: %d маршрутизаторов, 20000 обращений к 1000 ключам за 5 с\n", routers);
+    printf("%-28s %14s %20s\n", "обмен", "схождение, мс", "свои k0 max/min");
+    for (SimTime sync_ms : {0.0, 5000.0}) {
+        double spread = 0;
+        double converged = simulate_counters(routers, loss, sync_ms, seed, spread);
+        std::string mode = sync_ms > 0 ? "gossip + состояние раз в 5 с" : "только дельты gossip";
+        if (converged < 0) {
+            printf("%-28s %14s %20.2f\n", mode.c_str(), "> 60000", spread);
+        } else {
+            printf("%-28s %14.0f %20.2f\n", mode.c_str(), converged, spread);
+        }
+    }
+}
+
+// Итеративный поиск: каждый переход - запрос и ответ по модельной сети,
+// потерянный запрос повторяется после таймаута
+static void report_dht(int routers, double loss, uint64_t seed) {
+    const int lookups = 20000;
+    const SimTime timeout_ms = 200;
+    SimNetwork net(seed);
+    net.set_latency(SIM_LATENCY_BASE_MS, SIM_LATENCY_TAIL_MS);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    printf("\nпоиск в DHT: %d маршрутизаторов, %d поисков\n", routers, lookups);
+    printf("%-7s %9s %5s %12s %12s %12s\n", "vnodes", "переходов", "p99", "p50 мс", "p99 мс", "ключи max/ср");
+    for (int vnodes_per_router : {1, 8}) {
+        DHTRing ring;
+        std::vector<std::vector<Node*>> owned;
+        for (int r = 0; r < routers; ++r) {
+            owned.push_back(make_virtual_nodes("10.2." + std::to_string(r / 256) + "." + std::to_string(r % 256) +
+                                               ":8080", vnodes_per_router));
+            ring.join_router(owned.back());
+        }
+        std::vector<double> hops, latencies;
+        std::map<std::string, size_t> keys_per_router;
+        for (int i = 0; i < lookups; ++i) {
+            Hash key = net.rng()();
+            Node* start = ring.nodes[net.rng()() % ring.nodes.size()];
+            ChordLookup lookup = start->find_successor(key);
+            keys_per_router[lookup.owner->address]++;
+            double latency = 0;
+            for (int hop = 0; hop < lookup.hops; ++hop) {
+                while (uniform(net.rng()) < 1 - (1 - loss) * (1 - loss)) {
+                    latency += timeout_ms;
+                }
+                latency += net.sample_latency() + net.sample_latency();
+            }
+            hops.push_back(lookup.hops);
+            latencies.push_back(latency);
+        }
+        double total_hops = 0;
+        for (double h : hops) total_hops += h;
+        size_t peak = 0;
+        for (const auto& entry : keys_per_router) peak = std::max(peak, entry.second);
+        printf("%-7d %9.2f %5.0f %12.1f %12.1f %12.2f\n", vnodes_per_router, total_hops / lookups,
+               percentile(hops, 0.99), percentile(latencies, 0.5), percentile(latencies, 0.99),
+               peak / (static_cast<double>(lookups) / routers));
+        for (const auto& router : owned) {
+            for (Node* node : router) {
+                delete node;
+            }
+        }
+    }
+}
+
+struct SimServer {
+    double free_bytes;
+    double bytes_per_ms;      // Скорость записи
+    SimTime busy_until = 0;
+    size_t queued = 0;        // Запросы на сервере, еще не записанные
+    double busy_ms = 0;
+};
+
+// Вид сервера с одного маршрутизатора
+struct RouterView {
+    std::vector<size_t> in_flight;
+    std::vector<double> latency_ms;
+    std::vector<size_t> heartbeat_queue;  // Очередь по последнему heartbeat
+    std::vector<size_t> remote_in_flight;  // Запросы других маршрутизаторов по сводкам нагрузки
+    std::vector<bool> has_heartbeat;       // Сервер шлет heartbeat этому маршрутизатору
+};
+
+typedef enum {
+    PLACE_P2C_LOCAL,    // select_power_of_two по локальному виду
+    PLACE_P2C_CLUSTER,  // select_power_of_two со сводками нагрузки через gossip
+    PLACE_HRW           // hrw_owner по ключу
+} place_mode_t;
+
+// Загрузки со всех маршрутизаторов на серверы хранения
+static void simulate_placement(int routers, int servers, place_mode_t mode, uint64_t seed,
+                               double& utilization_ratio, double& p50_ms, double& p99_ms) {
+    const SimTime run_ms = 60000;
+    const SimTime heartbeat_ms = 1000;
+    const int heartbeat_routers = 3;
+    // Сводки приходят раз в load_interval_ms (GossipConfig::piggyback_idle_ms)
+    // и проходят несколько шагов gossip
+    const SimTime load_interval_ms = 1000;
+    const SimTime load_propagation_ms = 4 * (SIM_LATENCY_BASE_MS + SIM_LATENCY_TAIL_MS) + 50;
+    const double mean_size = 50.0 * 1024 * 1024;
+    SimNetwork net(seed);
+    net.set_latency(SIM_LATENCY_BASE_MS, SIM_LATENCY_TAIL_MS);
+    std::mt19937_64& rng = net.rng();
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    std::vector<SimServer> cluster;
+    std::vector<HrwNode> hrw_nodes;
+    double total_rate = 0;
+    for (int s = 0; s < servers; ++s) {
+        SimServer server;
+        server.free_bytes = (1 + 9 * uniform(rng)) * 1e12;
+        server.bytes_per_ms = (100 + 300 * uniform(rng)) * 1024 * 1024 / 1000;
+        total_rate += server.bytes_per_ms;
+        cluster.push_back(server);
+        HrwNode node;
+        node.location = "10.1." + std::to_string(s / 256) + "." + std::to_string(s % 256) + ":9000";
+        node.weight = server.free_bytes;
+        hrw_nodes.push_back(node);
+    }
+    std::vector<RouterView> views(routers);
+    for (auto& view : views) {
+        view.in_flight.assign(servers, 0);
+        view.latency_ms.assign(servers, 0);
+        view.heartbeat_queue.assign(servers, 0);
+        view.remote_in_flight.assign(servers, 0);
+        view.has_heartbeat.assign(servers, false);
+    }
+    std::vector<size_t> cluster_in_flight(servers, 0);
+    // Heartbeat: как StorageServerOptions::routers, сервер раз в секунду
+    // сообщает очередь нескольким маршрутизаторам из своего списка
+    std::vector<size_t> reported_queue(servers, 0);
+    for (int s = 0; s < servers; ++s) {
+        std::vector<int> targets;
+        for (int j = 0; j < std::min(heartbeat_routers, routers); ++j) {
+            targets.push_back((s + j * (routers / heartbeat_routers + 1)) % routers);
+        }
+        net.every(heartbeat_ms * uniform(rng), heartbeat_ms, [&, s, targets]() {
+            reported_queue[s] = cluster[s].queued;
+            for (int r : targets) {
+                views[r].heartbeat_queue[s] = cluster[s].queued;
+                views[r].has_heartbeat[s] = true;
+            }
+        });
+    }
+    if (mode == PLACE_P2C_CLUSTER) {
+        // Сводки других маршрутизаторов отстают на время распространения
+        for (int r = 0; r < routers; ++r) {
+            net.every(load_interval_ms * uniform(rng), load_interval_ms, [&, r]() {
+                std::vector<size_t> remote(servers), queue(servers);
+                for (int s = 0; s < servers; ++s) {
+                    remote[s] = cluster_in_flight[s] - views[r].in_flight[s];
+                    queue[s] = reported_queue[s];
+                }
+                net.schedule(load_propagation_ms, [&, r, remote, queue]() {
+                    views[r].remote_in_flight = remote;
+                    for (int s = 0; s < servers; ++s) {
+                        if (!views[r].has_heartbeat[s]) {
+                            views[r].heartbeat_queue[s] = queue[s];
+                        }
+                    }
+                });
+            });
+        }
+    }
+
+    // Поток загрузок - 70% суммарной скорости записи
+    double rate_per_ms = 0.7 * total_rate / mean_size;
+    std::vector<double> latencies;
+    std::vector<PlacementCandidate> candidates(servers);
+    std::function<void()> arrival = [&]() {
+        int r = rng() % routers;
+        double size = std::exponential_distribution<double>(1 / mean_size)(rng);
+        int target;
+        if (mode != PLACE_HRW) {
+            for (int s = 0; s < servers; ++s) {
+                candidates[s].server_id = s;
+                candidates[s].free_bytes = cluster[s].free_bytes;
+                candidates[s].in_flight = views[r].in_flight[s] + views[r].remote_in_flight[s];
+                candidates[s].queue_depth = views[r].heartbeat_queue[s];
+                candidates[s].latency_ms = views[r].latency_ms[s];
+            }
+            target = select_power_of_two(candidates, static_cast<size_t>(size), rng);
+        } else {
+            target = hrw_owner(tile_placement_key(rng() % 1000000, "B04", rng() % 64, rng() % 64), hrw_nodes);
+        }
+        if (target >= 0) {
+            SimTime started = net.now();
+            views[r].in_flight[target]++;
+            cluster_in_flight[target]++;
+            net.schedule(net.sample_latency(), [&, r, target, size, started]() {
+                SimServer& server = cluster[target];
+                SimTime begin = std::max(net.now(), server.busy_until);
+                double service = size / server.bytes_per_ms;
+                server.busy_until = begin + service;
+                server.busy_ms += service;
+                server.free_bytes -= size;
+                server.queued++;
+                net.schedule(server.busy_until - net.now(), [&, r, target, started]() {
+                    cluster[target].queued--;
+                    net.schedule(net.sample_latency(), [&, r, target, started]() {
+                        double latency = net.now() - started;
+                        views[r].in_flight[target]--;
+                        cluster_in_flight[target]--;
+                        double& observed = views[r].latency_ms[target];
+                        observed = observed == 0 ? latency : 0.8 * observed + 0.2 * latency;
+                        latencies.push_back(latency);
+                    });
+                });
+            });
+        }
+        net.schedule(std::exponential_distribution<double>(rate_per_ms)(rng), arrival);
+    };
+    net.schedule(0, arrival);
+    net.run(run_ms);
+
+    // Загрузка относительно скорости: доля времени записи
+    double peak = 0, total = 0;
+    for (const auto& server : cluster) {
+        double utilization = server.busy_ms / run_ms;
+        peak = std::max(peak, utilization);
+        total += utilization;
+    }
+    utilization_ratio = peak / (total / servers);
+    p50_ms = percentile(latencies, 0.5);
+    p99_ms = percentile(latencies, 0.99);
+}
+
+static void report_placement(int routers, int servers, uint64_t seed) {
+    printf("\nразмещение: %d маршрутизаторов, %d серверов, поток загрузок 70%% суммарной скорости записи\n",
+           routers, servers);
+    printf("%-22s %16s %12s %12s\n", "выбор", "загрузка max/ср", "p50 мс", "p99 мс");
+    const char* names[] = {"select_power_of_two", "p2c + сводки нагрузки", "hrw_owner"};
+    for (place_mode_t mode : {PLACE_P2C_LOCAL, PLACE_P2C_CLUSTER, PLACE_HRW}) {
+        double ratio, p50, p99;
+        simulate_placement(routers, servers, mode, seed, ratio, p50, p99);
+        printf("%-22s %16.2f %12.0f %12.0f\n", names[mode], ratio, p50, p99);
+    }
+}
+
+int main(int argc, char** argv) {
+    int routers = argc > 1 ? std::atoi(argv[1]) : 200;
+    int servers = argc > 2 ? std::atoi(argv[2]) : 500;
+    double loss = argc > 3 ? std::atof(argv[3]) : 0.01;
+    uint64_t seed = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1;
+    if (routers < 2 || servers < 2) {
+        fprintf(stderr, "usage: %s [routers>=2] [servers>=2] [loss] [seed]\n", argv[0]);
+        return 1;
+    }
+    report_gossip(routers, loss, seed);
+    report_counters(routers, loss, seed);
+    report_dht(routers, loss, seed);
+    report_placement(routers, servers, seed);
+    return 0;
+}
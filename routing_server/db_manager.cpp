@@ -90,6 +90,37 @@ int DBManager::insert_image(const ImageInsertData& data) {
     return image_id;
 }
 
+// Вставка снимка, пришедшего при сверке каталогов: geohash уже посчитан, id - как
+// у маршрутизатора-источника. Занятый id не перезаписывается; последовательность
+// продвигается за вставленный id, чтобы локальные вставки его не повторили
+int DBManager::insert_image_record(const ImageInfo& info) {
+    if (!conn) {
+        logger.error("Нет соединения с базой данных");
+        return -1;
+    }
+
+    std::string query = "WITH inserted AS ("
+                       "INSERT INTO Images (image_id, filename, source, timestamp, geohash) "
+                       "VALUES ($1, $2, $3, $4, $5) ON CONFLICT (image_id) DO NOTHING RETURNING image_id) "
+                       "SELECT image_id, setval(pg_get_serial_sequence('images', 'image_id'), "
+                       "GREATEST(image_id, (SELECT last_value FROM images_image_id_seq))) FROM inserted;";
+
+    std::string image_id = std::to_string(info.image_id);
+    const char* paramValues[5] = {image_id.c_str(), info.filename.c_str(), info.source.c_str(),
+                                  info.timestamp.c_str(), info.geohash.c_str()};
+    PGresult* res = PQexecParams(conn, query.c_str(), 5, NULL, paramValues, NULL, NULL, 0);
+
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        logger.error("Ошибка выполнения запроса: " + std::string(PQerrorMessage(conn)));
+        PQclear(res);
+        return -1;
+    }
+
+    int inserted_id = PQntuples(res) > 0 ? std::stoi(PQgetvalue(res, 0, 0)) : 0;
+    PQclear(res);
+    return inserted_id;
+}
+
 // Валидация координат для проверки корректности перед вставкой
 // Проверяет, что северная широта больше южной, а восточная долгота больше западной
 bool DBManager::validate_coordinates(float north, float south, float east, float west) {
@@ -234,6 +265,134 @@ std::vector<ImageInfo> DBManager::get_all_images() {
     return results;
 }
 
+// Поиск снимков по списку префиксов geohash с ограничением количества.
+// Префиксы передаются массивом text[], поэтому экранируются кавычки и обратная косая черта
+std::vector<ImageInfo> DBManager::search_images_by_prefixes(const std::vector<std::string>& prefixes, int limit) {
+    std::vector<ImageInfo> results;
+    
+    if (!conn) {
+        logger.error("Нет соединения с базой данных");
+        return results;
+    }
+    if (prefixes.empty() || limit <= 0) {
+        return results;
+    }
+    
+    std::string array_literal = "{";
+    for (size_t i = 0; i < prefixes.size(); ++i) {
+        if (i > 0) array_literal += ",";
+        array_literal += "\"";
+        for (char c : prefixes[i]) {
+            if (c == '"' || c == '\\') array_literal += '\\';
+            array_literal += c;
+        }
+        array_literal += "\"";
+    }
+    array_literal += "}";
+    std::string limit_str = std::to_string(limit);
+    
+    std::string query = "SELECT image_id, filename, timestamp, source, geohash "
+                       "FROM Images WHERE geohash LIKE ANY ("
+                       "SELECT prefix || '%' FROM UNNEST($1::text[]) AS prefix) "
+                       "ORDER BY timestamp DESC, image_id DESC LIMIT $2;";
+    
+    const char* paramValues[2] = {array_literal.c_str(), limit_str.c_str()};
+    PGresult* res = PQexecParams(conn, query.c_str(), 2, NULL, paramValues, NULL, NULL, 0);
+    
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        logger.error("Ошибка выполнения запроса: " + std::string(PQerrorMessage(conn)));
+        PQclear(res);
+        return results;
+    }
+    
+    int rows = PQntuples(res);
+    for (int i = 0; i < rows; i++) {
+        ImageInfo info;
+        info.image_id = std::stoi(PQgetvalue(res, i, 0));
+        info.filename = PQgetvalue(res, i, 1);
+        info.timestamp = PQgetvalue(res, i, 2);
+        info.source = PQgetvalue(res, i, 3);
+        info.geohash = PQgetvalue(res, i, 4);
+        results.push_back(info);
+    }
+    
+    PQclear(res);
+    return results;
+}
+
+// Получение списка всех маршрутизаторов
+std::vector<RoutingServerInfo> DBManager::get_all_routing_servers() {
+    std::vector<RoutingServerInfo> routers;
+    
+    if (!conn) {
+        logger.error("Нет соединения с базой данных");
+        return routers;
+    }
+    
+    std::string query = "SELECT server_id, adress, priority, geohash_prefix "
+                       "FROM Routing_Servers ORDER BY priority DESC, server_id;";
+    
+    PGresult* res = PQexec(conn, query.c_str());
+    
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        logger.error("Ошибка выполнения запроса: " + std::string(PQerrorMessage(conn)));
+        PQclear(res);
+        return routers;
+    }
+    
+    int rows = PQntuples(res);
+    for (int i = 0; i < rows; i++) {
+        RoutingServerInfo router;
+        router.server_id = std::stoi(PQgetvalue(res, i, 0));
+        router.adress = PQgetvalue(res, i, 1);
+        router.priority = std::stoi(PQgetvalue(res, i, 2));
+        router.geohash_prefix = PQgetvalue(res, i, 3);
+        routers.push_back(router);
+    }
+    
+    PQclear(res);
+    return routers;
+}
+
+// Признаки спектров для политики уровней хранения
+std::vector<SpectrumTieringInfo> DBManager::get_spectrum_tiering(int image_id) {
+    std::vector<SpectrumTieringInfo> results;
+
+    if (!conn) {
+        logger.error("Нет соединения с базой данных");
+        return results;
+    }
+
+    std::string query = "SELECT i.image_id, s.spectrum_name, EXTRACT(EPOCH FROM i.timestamp), "
+                       "i.geohash, COALESCE(s.frequency, 0) "
+                       "FROM Spectrums s JOIN Images i ON s.img_id = i.image_id "
+                       "WHERE $1::int < 0 OR i.image_id = $1::int;";
+
+    std::string image_id_str = std::to_string(image_id);
+    const char* paramValues[1] = {image_id_str.c_str()};
+    PGresult* res = PQexecParams(conn, query.c_str(), 1, NULL, paramValues, NULL, NULL, 0);
+
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        logger.error("Ошибка выполнения запроса: " + std::string(PQerrorMessage(conn)));
+        PQclear(res);
+        return results;
+    }
+
+    int rows = PQntuples(res);
+    for (int i = 0; i < rows; i++) {
+        SpectrumTieringInfo info;
+        info.image_id = std::stoi(PQgetvalue(res, i, 0));
+        info.spectrum_name = PQgetvalue(res, i, 1);
+        info.timestamp = std::stod(PQgetvalue(res, i, 2));
+        info.geohash = PQgetvalue(res, i, 3);
+        info.frequency = std::stoll(PQgetvalue(res, i, 4));
+        results.push_back(info);
+    }
+
+    PQclear(res);
+    return results;
+}
+
 // Добавление нового спектра для изображения
 // SQL: INSERT INTO Spectrums (image_id, spectrum_name, frequency, bandwidth)
 //      VALUES (image_id, 'имя_спектра', частота, ширина_полосы)
@@ -338,6 +497,43 @@ int DBManager::insert_server(const ServerInsert& data) {
     return server_id;
 }
 
+// Вставка сервера, пришедшего при сверке каталогов, с server_id источника;
+// занятый id не перезаписывается (как у insert_image_record)
+int DBManager::insert_server_record(const ServerInfo& info) {
+    if (!conn) {
+        logger.error("Нет соединения с базой данных");
+        return -1;
+    }
+
+    std::string query = "WITH inserted AS ("
+                       "INSERT INTO Servers (server_id, ssd_fullness, ssd_volume, hdd_volume, "
+                       "hdd_fullness, location, class) "
+                       "VALUES ($1, $2, $3, $4, $5, $6, $7) ON CONFLICT (server_id) DO NOTHING "
+                       "RETURNING server_id) "
+                       "SELECT server_id, setval(pg_get_serial_sequence('servers', 'server_id'), "
+                       "GREATEST(server_id, (SELECT last_value FROM servers_server_id_seq))) FROM inserted;";
+
+    std::string server_id = std::to_string(info.server_id);
+    std::string ssd_fullness = std::to_string(info.ssd_fullness);
+    std::string ssd_volume = std::to_string(info.ssd_volume);
+    std::string hdd_volume = std::to_string(info.hdd_volume);
+    std::string hdd_fullness = std::to_string(info.hdd_fullness);
+    const char* paramValues[7] = {server_id.c_str(), ssd_fullness.c_str(), ssd_volume.c_str(),
+                                  hdd_volume.c_str(), hdd_fullness.c_str(), info.location.c_str(),
+                                  info.class_type.c_str()};
+    PGresult* res = PQexecParams(conn, query.c_str(), 7, NULL, paramValues, NULL, NULL, 0);
+
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        logger.error("Ошибка выполнения запроса: " + std::string(PQerrorMessage(conn)));
+        PQclear(res);
+        return -1;
+    }
+
+    int inserted_id = PQntuples(res) > 0 ? std::stoi(PQgetvalue(res, 0, 0)) : 0;
+    PQclear(res);
+    return inserted_id;
+}
+
 // Добавление нового маршрутизатора
 int DBManager::insert_routing_server(const RoutingServerInsert& data) {
     if (!conn) {
@@ -466,4 +662,119 @@ bool DBManager::increment_tile_frequency(int tile_row, int tile_column) {
     return true;
 }
 
+// Запрос в текущей транзакции, результат которого не нужен
+static bool exec_command(PGconn* conn, const std::string& query, ExecStatusType expected = PGRES_COMMAND_OK) {
+    PGresult* res = PQexec(conn, query.c_str());
+    bool ok = PQresultStatus(res) == expected;
+    PQclear(res);
+    return ok;
+}
+
+// Выгрузка таблиц для снимка каталога нового маршрутизатора
+bool DBManager::export_tables(std::vector<CatalogTableCopy>& tables, std::string& wal_position) {
+    if (!conn) {
+        logger.error("Нет соединения с базой данных");
+        return false;
+    }
+
+    // Все таблицы и позиция WAL - на один момент
+    if (!exec_command(conn, "BEGIN ISOLATION LEVEL REPEATABLE READ READ ONLY;")) {
+        logger.error("Ошибка начала транзакции: " + std::string(PQerrorMessage(conn)));
+        return false;
+    }
+    PGresult* res = PQexec(conn, "SELECT CASE WHEN pg_is_in_recovery() THEN pg_last_wal_replay_lsn() "
+                                 "ELSE pg_current_wal_lsn() END::text;");
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        logger.error("Ошибка выполнения запроса: " + std::string(PQerrorMessage(conn)));
+        PQclear(res);
+        exec_command(conn, "ROLLBACK;");
+        return false;
+    }
+    wal_position = PQgetvalue(res, 0, 0);
+    PQclear(res);
+
+    for (auto& table : tables) {
+        table.data.clear();
+        res = PQexec(conn, ("COPY " + table.table + " TO STDOUT;").c_str());
+        if (PQresultStatus(res) != PGRES_COPY_OUT) {
+            logger.error("Ошибка выгрузки " + table.table + ": " + std::string(PQerrorMessage(conn)));
+            PQclear(res);
+            exec_command(conn, "ROLLBACK;");
+            return false;
+        }
+        PQclear(res);
+        char* buffer = NULL;
+        int length;
+        while ((length = PQgetCopyData(conn, &buffer, 0)) > 0) {
+            table.data.append(buffer, length);
+            PQfreemem(buffer);
+        }
+        res = PQgetResult(conn);
+        bool ok = length == -1 && PQresultStatus(res) == PGRES_COMMAND_OK;
+        PQclear(res);
+        if (!ok) {
+            logger.error("Ошибка выгрузки " + table.table + ": " + std::string(PQerrorMessage(conn)));
+            exec_command(conn, "ROLLBACK;");
+            return false;
+        }
+    }
+    exec_command(conn, "COMMIT;");
+    return true;
+}
+
+// Загрузка снимка каталога: прежнее содержимое таблиц заменяется целиком
+bool DBManager::import_tables(const std::vector<CatalogTableCopy>& tables) {
+    if (!conn) {
+        logger.error("Нет соединения с базой данных");
+        return false;
+    }
+    if (tables.empty()) {
+        return true;
+    }
 
+    std::string truncate = "TRUNCATE ";
+    for (size_t i = 0; i < tables.size(); ++i) {
+        truncate += (i ? ", " : "") + tables[i].table;
+    }
+    truncate += " CASCADE;";
+    if (!exec_command(conn, "BEGIN;") || !exec_command(conn, truncate)) {
+        logger.error("Ошибка очистки каталога: " + std::string(PQerrorMessage(conn)));
+        exec_command(conn, "ROLLBACK;");
+        return false;
+    }
+
+    // Данные уходят частями: выгрузка каталога может занимать сотни мегабайт
+    const size_t COPY_CHUNK = 1024 * 1024;
+    for (const auto& table : tables) {
+        PGresult* res = PQexec(conn, ("COPY " + table.table + " FROM STDIN;").c_str());
+        bool ok = PQresultStatus(res) == PGRES_COPY_IN;
+        PQclear(res);
+        for (size_t pos = 0; ok && pos < table.data.size(); pos += COPY_CHUNK) {
+            size_t length = std::min(COPY_CHUNK, table.data.size() - pos);
+            ok = PQputCopyData(conn, table.data.data() + pos, static_cast<int>(length)) == 1;
+        }
+        if (PQputCopyEnd(conn, ok ? NULL : "snapshot load aborted") != 1) {
+            ok = false;
+        }
+        res = PQgetResult(conn);
+        ok = ok && PQresultStatus(res) == PGRES_COMMAND_OK;
+        PQclear(res);
+        if (ok && !table.serial_column.empty()) {
+            // Новые строки этого маршрутизатора не должны получить уже занятые id
+            ok = exec_command(conn, "SELECT setval(pg_get_serial_sequence('" + table.table + "', '" +
+                                        table.serial_column + "'), COALESCE(MAX(" + table.serial_column +
+                                        "), 0) + 1, false) FROM " + table.table + ";",
+                              PGRES_TUPLES_OK);
+        }
+        if (!ok) {
+            logger.error("Ошибка загрузки " + table.table + ": " + std::string(PQerrorMessage(conn)));
+            exec_command(conn, "ROLLBACK;");
+            return false;
+        }
+    }
+    if (!exec_command(conn, "COMMIT;")) {
+        logger.error("Ошибка фиксации каталога: " + std::string(PQerrorMessage(conn)));
+        return false;
+    }
+    return true;
+}
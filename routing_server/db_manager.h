@@ -1,3 +1,9 @@
+#ifndef DB_MANAGER_H
+#define DB_MANAGER_H
+
+#include <string>
+#include <vector>
+
 // Структура для хранения информации о сервере
 struct ServerInfo {
     int server_id;
@@ -9,8 +15,68 @@ struct ServerInfo {
     std::string class_type;
 };
 
+// Снимок в результатах поиска
+struct ImageInfo {
+    int image_id;
+    std::string filename;
+    std::string timestamp;
+    std::string source;
+    std::string geohash;
+};
+
+// Маршрутизатор из таблицы Routing_Servers
+struct RoutingServerInfo {
+    int server_id;
+    std::string adress;          // "ip" или "ip:port"
+    int priority;
+    std::string geohash_prefix;  // Область, за снимки которой отвечает маршрутизатор
+};
+
+// Признаки спектра снимка для политики уровней хранения
+struct SpectrumTieringInfo {
+    int image_id;
+    std::string spectrum_name;
+    double timestamp;  // Images.timestamp в секундах Unix
+    std::string geohash;
+    long long frequency;
+};
+
+// Таблица каталога в текстовом формате COPY (строка на строку таблицы)
+struct CatalogTableCopy {
+    std::string table;
+    std::string serial_column;  // Столбец SERIAL: после загрузки его последовательность продолжается с максимума
+    std::string data;
+};
+
 class DBManager {
 public:
     // Получение списка серверов определенного типа
     std::vector<ServerInfo> get_servers_by_type(const std::string& storage_type);
-}; 
\ No newline at end of file
+
+    // Все снимки, от новых к старым
+    std::vector<ImageInfo> get_all_images();
+
+    // Вставка строк, полученных при сверке каталогов маршрутизаторов, с id из строки
+    // (последовательность SERIAL продвигается за него). id, 0 - id уже занят, -1 - ошибка
+    int insert_image_record(const ImageInfo& info);
+    int insert_server_record(const ServerInfo& info);
+
+    // Все маршрутизаторы
+    std::vector<RoutingServerInfo> get_all_routing_servers();
+
+    // Снимки с geohash, начинающимся с одного из префиксов, от новых к старым, не больше limit
+    std::vector<ImageInfo> search_images_by_prefixes(const std::vector<std::string>& prefixes, int limit);
+
+    // Признаки спектров снимка; при image_id < 0 - всех снимков
+    std::vector<SpectrumTieringInfo> get_spectrum_tiering(int image_id);
+
+    // Согласованная выгрузка таблиц (COPY TO STDOUT в одной транзакции REPEATABLE READ)
+    // и позиция WAL на ее момент. У tables заполнены table и serial_column
+    bool export_tables(std::vector<CatalogTableCopy>& tables, std::string& wal_position);
+
+    // Замена содержимого таблиц выгрузкой (TRUNCATE и COPY FROM STDIN в одной
+    // транзакции); таблицы идут в порядке внешних ключей. false - ничего не изменено
+    bool import_tables(const std::vector<CatalogTableCopy>& tables);
+};
+
+#endif // DB_MANAGER_H
@@ -0,0 +1,151 @@
+#include "gcounter.h"
+#include <cmath>
+#include <nlohmann/json.hpp>
+
+DecayingCounters::DecayingCounters(const std::string& node, const DecayConfig& config)
+    : node_(node), config_(config) {
+    if (config_.epoch_sec <= 0) {
+        config_.epoch_sec = 1;
+    }
+}
+
+int64_t DecayingCounters::epoch_of(int64_t unix_time) const {
+    return unix_time / config_.epoch_sec;
+}
+
+void DecayingCounters::increment(const std::string& key, int64_t epoch, uint64_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (epoch < horizon_) {
+        return;
+    }
+    cells_[key][{node_, epoch}] += count;
+    dirty_.insert({key, epoch});
+}
+
+bool DecayingCounters::merge(const std::string& json, size_t& changed) {
+    changed = 0;
+    nlohmann::json parsed;
+    try {
+        parsed = nlohmann::json::parse(json);
+        if (!parsed.at("cells").is_array()) {
+            return false;
+        }
+    } catch (...) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& cell : parsed["cells"]) {
+        try {
+            std::string key = cell.at(0).get<std::string>();
+            std::string node = cell.at(1).get<std::string>();
+            int64_t epoch = cell.at(2).get<int64_t>();
+            uint64_t value = cell.at(3).get<uint64_t>();
+            if (epoch < horizon_) {
+                continue;
+            }
+            uint64_t& current = cells_[key][{node, epoch}];
+            if (value > current) {
+                current = value;
+                changed++;
+            }
+        } catch (...) {
+        }
+    }
+    return true;
+}
+
+// Ячейки в JSON: все или только свои из only (под mutex_)
+std::string DecayingCounters::cells_json(const std::set<std::pair<std::string, int64_t>>* only) const {
+    nlohmann::json out;
+    out["cells"] = nlohmann::json::array();
+    if (only) {
+        for (const auto& key_epoch : *only) {
+            auto key = cells_.find(key_epoch.first);
+            if (key == cells_.end()) {
+                continue;
+            }
+            auto value = key->second.find({node_, key_epoch.second});
+            if (value != key->second.end()) {
+                out["cells"].push_back({key_epoch.first, node_, key_epoch.second, value->second});
+            }
+        }
+    } else {
+        for (const auto& key : cells_) {
+            for (const auto& value : key.second) {
+                out["cells"].push_back({key.first, value.first.first, value.first.second, value.second});
+            }
+        }
+    }
+    return out.dump();
+}
+
+std::string DecayingCounters::take_delta() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dirty_.empty()) {
+        return "";
+    }
+    std::string delta = cells_json(&dirty_);
+    dirty_.clear();
+    return delta;
+}
+
+std::string DecayingCounters::state() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cells_json(nullptr);
+}
+
+double DecayingCounters::hotness(const std::string& key, int64_t now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cells_.find(key);
+    if (it == cells_.end() || it->second.empty()) {
+        return -1;
+    }
+    double total = 0;
+    for (const auto& value : it->second) {
+        double age = static_cast<double>(std::max<int64_t>(0, now - value.first.second));
+        total += value.second * std::exp2(-age / config_.half_life_epochs);
+    }
+    return total;
+}
+
+std::map<std::string, uint64_t> DecayingCounters::per_node(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, uint64_t> result;
+    auto it = cells_.find(key);
+    if (it != cells_.end()) {
+        for (const auto& value : it->second) {
+            result[value.first.first] += value.second;
+        }
+    }
+    return result;
+}
+
+void DecayingCounters::expire(int64_t now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    horizon_ = std::max(horizon_, now - config_.window_epochs);
+    for (auto key = cells_.begin(); key != cells_.end();) {
+        for (auto value = key->second.begin(); value != key->second.end();) {
+            if (value->first.second < horizon_) {
+                dirty_.erase({key->first, value->first.second});
+                value = key->second.erase(value);
+            } else {
+                ++value;
+            }
+        }
+        key = key->second.empty() ? cells_.erase(key) : std::next(key);
+    }
+}
+
+size_t DecayingCounters::keys() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cells_.size();
+}
+
+size_t DecayingCounters::cells() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto& key : cells_) {
+        count += key.second.size();
+    }
+    return count;
+}
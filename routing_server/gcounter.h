@@ -0,0 +1,70 @@
+#ifndef GCOUNTER_H
+#define GCOUNTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+
+// Счетчики обращений как CRDT. У каждого узла свои G-счетчики, разбитые по
+// эпохам времени: узел увеличивает только свои ячейки, а слияние берет
+// максимум по (ключ, узел, эпоха). Поэтому порядок, повторы и потери дельт
+// не мешают: после обмена ячейками у всех узлов одно и то же состояние.
+// Затухание считается по номеру эпохи, а не по времени получения, так что
+// и горячесть ключа у всех узлов одна; ячейки старше окна отбрасываются
+// всеми узлами одинаково
+
+struct DecayConfig {
+    int64_t epoch_sec = 3600;       // Длина эпохи
+    double half_life_epochs = 24;   // Вклад эпохи уменьшается вдвое за столько эпох
+    int64_t window_epochs = 24 * 14;  // Эпохи старше не хранятся
+};
+
+class DecayingCounters {
+public:
+    explicit DecayingCounters(const std::string& node, const DecayConfig& config = DecayConfig());
+
+    int64_t epoch_of(int64_t unix_time) const;
+
+    // Обращения к ключу на этом узле
+    void increment(const std::string& key, int64_t epoch, uint64_t count = 1);
+
+    // Слияние ячеек другого узла - дельты или полного состояния в формате
+    // {"cells": [[ключ, узел, эпоха, значение], ...]}. changed - сколько ячеек
+    // выросло; false - неверный JSON
+    bool merge(const std::string& json, size_t& changed);
+
+    // Свои ячейки, изменившиеся с прошлого вызова; "" - изменений нет
+    std::string take_delta();
+
+    // Все ячейки, упорядоченно: у сошедшихся узлов строки совпадают
+    std::string state() const;
+
+    // Сумма по узлам и эпохам с затуханием к эпохе now; -1 - обращений не было
+    double hotness(const std::string& key, int64_t now) const;
+
+    // Вклад каждого узла без затухания
+    std::map<std::string, uint64_t> per_node(const std::string& key) const;
+
+    // Отбрасывание эпох старше окна относительно now
+    void expire(int64_t now);
+
+    size_t keys() const;
+    size_t cells() const;
+
+private:
+    std::string cells_json(const std::set<std::pair<std::string, int64_t>>* only) const;
+
+    mutable std::mutex mutex_;
+    std::string node_;
+    DecayConfig config_;
+    int64_t horizon_ = INT64_MIN;  // Эпохи до нее отброшены и не принимаются
+    // Ключ -> (узел, эпоха) -> значение
+    std::map<std::string, std::map<std::pair<std::string, int64_t>, uint64_t>> cells_;
+    std::set<std::pair<std::string, int64_t>> dirty_;  // Свои (ключ, эпоха) для следующей дельты
+};
+
+#endif // GCOUNTER_H
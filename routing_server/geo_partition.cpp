@@ -0,0 +1,174 @@
+#include "geo_partition.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+static const char GEO_ALPHABET[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+// В 64-битный ключ помещаются 12 символов geohash, остальные отбрасываются
+const size_t GEO_KEY_CHARS = 12;
+const GeoKey GEO_KEY_MAX = std::numeric_limits<GeoKey>::max();
+
+bool geo_key(const std::string& geohash, GeoKey& key) {
+    key = 0;
+    for (size_t i = 0; i < geohash.size() && i < GEO_KEY_CHARS; ++i) {
+        const char* pos = std::strchr(GEO_ALPHABET, geohash[i]);
+        if (geohash[i] == '\0' || pos == nullptr) {
+            return false;
+        }
+        key |= static_cast<GeoKey>(pos - GEO_ALPHABET) << (59 - 5 * i);
+    }
+    return true;
+}
+
+bool geo_key_range(const std::string& prefix, GeoKey& lo, GeoKey& hi) {
+    if (!geo_key(prefix, lo)) {
+        return false;
+    }
+    size_t chars = std::min(prefix.size(), GEO_KEY_CHARS);
+    hi = chars == 0 ? GEO_KEY_MAX : lo | ((GeoKey(1) << (64 - 5 * chars)) - 1);
+    return true;
+}
+
+GeoPartitioner::GeoPartitioner(const std::vector<std::string>& routers, const std::vector<GeoKey>& sample,
+                               const GeoPartitionConfig& config)
+    : routers_(routers), config_(config) {
+    size_t count = std::max<size_t>(1, routers_.size() * std::max(1, config_.virtual_ranges));
+    std::vector<GeoKey> sorted(sample);
+    std::sort(sorted.begin(), sorted.end());
+    ranges_.push_back(GeoRange{0, 0, 0, 0});
+    for (size_t i = 1; i < count; ++i) {
+        // Границы - квантили выборки; без выборки - равные отрезки кривой
+        GeoKey start = sorted.empty() ? GEO_KEY_MAX / count * i : sorted[sorted.size() * i / count];
+        if (start > ranges_.back().start) {
+            ranges_.push_back(GeoRange{start, 0, 0, 0});
+        }
+    }
+    for (GeoKey key : sorted) {
+        record(key);
+    }
+    assign_owners();
+}
+
+size_t GeoPartitioner::range_index(GeoKey key) const {
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), key,
+                               [](GeoKey value, const GeoRange& range) { return value < range.start; });
+    return it - ranges_.begin() - 1;
+}
+
+GeoKey GeoPartitioner::range_end(size_t index) const {
+    return index + 1 < ranges_.size() ? ranges_[index + 1].start - 1 : GEO_KEY_MAX;
+}
+
+int GeoPartitioner::owner_of(GeoKey key) const {
+    return ranges_[range_index(key)].owner;
+}
+
+std::vector<int> GeoPartitioner::owners_of_cells(const std::vector<std::string>& cells) const {
+    std::vector<int> owners;
+    for (const auto& cell : cells) {
+        GeoKey lo, hi;
+        if (!geo_key_range(cell, lo, hi)) {
+            continue;
+        }
+        for (size_t i = range_index(lo); i < ranges_.size() && ranges_[i].start <= hi; ++i) {
+            owners.push_back(ranges_[i].owner);
+        }
+    }
+    std::sort(owners.begin(), owners.end());
+    owners.erase(std::unique(owners.begin(), owners.end()), owners.end());
+    return owners;
+}
+
+void GeoPartitioner::record(GeoKey key, double weight) {
+    size_t index = range_index(key);
+    GeoRange& range = ranges_[index];
+    range.load += weight;
+    // Половина нагрузки в нижней половине диапазона: по ней выбирается точка деления
+    if (key <= range.start + (range_end(index) - range.start) / 2) {
+        range.low_load += weight;
+    }
+}
+
+// Каждому маршрутизатору - непрерывный отрезок диапазонов с примерно равной
+// долей нагрузки. Порядок владельцев вдоль кривой не меняется, поэтому при
+// сдвиге нагрузки переходят только диапазоны у границ отрезков
+size_t GeoPartitioner::assign_owners() {
+    if (routers_.empty()) {
+        return 0;
+    }
+    double total = 0;
+    for (const auto& range : ranges_) {
+        total += range.load;
+    }
+    // Небольшая равномерная добавка: диапазоны без нагрузки тоже распределяются
+    double floor_load = (total > 0 ? total : 1) / ranges_.size() * 0.01;
+    double share = (total + floor_load * ranges_.size()) / routers_.size();
+    double cumulative = 0;
+    size_t moved = 0;
+    for (auto& range : ranges_) {
+        double weight = range.load + floor_load;
+        int owner = std::min<int>(routers_.size() - 1, static_cast<int>((cumulative + weight / 2) / share));
+        if (owner != range.owner) {
+            moved++;
+            range.owner = owner;
+        }
+        cumulative += weight;
+    }
+    return moved;
+}
+
+GeoRebalanceResult GeoPartitioner::rebalance() {
+    GeoRebalanceResult result;
+    double total = 0;
+    for (const auto& range : ranges_) {
+        total += range.load;
+    }
+    double mean = total / ranges_.size();
+
+    std::vector<GeoRange> split;
+    split.reserve(ranges_.size() * 2);
+    for (size_t i = 0; i < ranges_.size(); ++i) {
+        const GeoRange& range = ranges_[i];
+        GeoKey end = range_end(i);
+        if (range.load > config_.split_factor * mean && end > range.start &&
+            ranges_.size() + result.splits < config_.max_ranges) {
+            GeoKey middle = range.start + (end - range.start) / 2;
+            double high_load = range.load - range.low_load;
+            split.push_back(GeoRange{range.start, range.owner, range.low_load, range.low_load / 2});
+            split.push_back(GeoRange{middle + 1, range.owner, high_load, high_load / 2});
+            result.splits++;
+        } else {
+            split.push_back(range);
+        }
+    }
+
+    std::vector<GeoRange> merged;
+    merged.reserve(split.size());
+    for (const auto& range : split) {
+        if (!merged.empty() && merged.back().owner == range.owner &&
+            merged.back().load + range.load < config_.merge_factor * mean) {
+            // Нижняя половина объединенного диапазона неизвестна - считается пропорционально
+            merged.back().load += range.load;
+            merged.back().low_load = merged.back().load / 2;
+            result.merges++;
+        } else {
+            merged.push_back(range);
+        }
+    }
+    ranges_.swap(merged);
+
+    result.moved = assign_owners();
+    for (auto& range : ranges_) {
+        range.load *= config_.decay;
+        range.low_load *= config_.decay;
+    }
+    return result;
+}
+
+std::vector<double> GeoPartitioner::router_loads() const {
+    std::vector<double> loads(routers_.size(), 0);
+    for (const auto& range : ranges_) {
+        loads[range.owner] += range.load;
+    }
+    return loads;
+}
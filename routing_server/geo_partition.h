@@ -0,0 +1,85 @@
+#ifndef GEO_PARTITION_H
+#define GEO_PARTITION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Разбиение пространства ключей по диапазонам geohash вместо hash_key
+// (gossip.cpp). Geohash - это Z-кривая: биты долготы и широты чередуются,
+// поэтому соседние на карте снимки почти всегда попадают в один непрерывный
+// отрезок ключей, и запрос по области затрагивает несколько маршрутизаторов,
+// а не все. Отрезок кривой каждого маршрутизатора состоит из нескольких
+// виртуальных диапазонов; горячие диапазоны делятся пополам, холодные
+// соседние - сливаются, а границы между маршрутизаторами сдвигаются так,
+// чтобы нагрузка была примерно равной
+
+// Позиция geohash на Z-кривой: 5 бит на символ, выровнено к старшим битам
+typedef uint64_t GeoKey;
+
+// Ключ geohash; false - символ не из алфавита geohash
+bool geo_key(const std::string& geohash, GeoKey& key);
+
+// Все ключи, начинающиеся с prefix: [lo, hi] включительно
+bool geo_key_range(const std::string& prefix, GeoKey& lo, GeoKey& hi);
+
+struct GeoRange {
+    GeoKey start;      // Диапазон - до start следующего
+    int owner;         // Индекс в routers()
+    double load;       // Нагрузка с последней перебалансировки
+    double low_load;   // Из нее - на ключи нижней половины диапазона
+};
+
+struct GeoPartitionConfig {
+    int virtual_ranges = 8;       // Диапазонов на маршрутизатор при создании
+    double split_factor = 2.0;    // Делится диапазон с нагрузкой > split_factor * средняя
+    double merge_factor = 0.25;   // Сливаются соседи одного владельца с суммой < merge_factor * средняя
+    size_t max_ranges = 4096;
+    double decay = 0.5;           // Доля нагрузки, остающаяся после перебалансировки
+};
+
+struct GeoRebalanceResult {
+    size_t splits = 0;
+    size_t merges = 0;
+    size_t moved = 0;   // Диапазонов, сменивших владельца
+};
+
+class GeoPartitioner {
+public:
+    // sample - ключи существующих снимков: начальные границы делят их поровну.
+    // Пустая выборка - равные отрезки кривой
+    GeoPartitioner(const std::vector<std::string>& routers, const std::vector<GeoKey>& sample,
+                   const GeoPartitionConfig& config = GeoPartitionConfig());
+
+    const std::vector<std::string>& routers() const { return routers_; }
+    const std::vector<GeoRange>& ranges() const { return ranges_; }
+
+    // Индекс маршрутизатора, владеющего ключом
+    int owner_of(GeoKey key) const;
+
+    // Маршрутизаторы, которые нужно опросить для покрытия области ячейками
+    // geohash (geohash_cover): упорядоченные индексы без повторов
+    std::vector<int> owners_of_cells(const std::vector<std::string>& cells) const;
+
+    // Учет обращения к ключу (запись или чтение снимка)
+    void record(GeoKey key, double weight = 1);
+
+    // Деление горячих и слияние холодных диапазонов, затем сдвиг границ
+    // между маршрутизаторами по накопленной нагрузке
+    GeoRebalanceResult rebalance();
+
+    // Нагрузка по маршрутизаторам
+    std::vector<double> router_loads() const;
+
+private:
+    size_t range_index(GeoKey key) const;
+    GeoKey range_end(size_t index) const;  // Последний ключ диапазона
+    size_t assign_owners();
+
+    std::vector<std::string> routers_;
+    std::vector<GeoRange> ranges_;
+    GeoPartitionConfig config_;
+};
+
+#endif // GEO_PARTITION_H
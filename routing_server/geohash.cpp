@@ -0,0 +1,132 @@
+#include "geohash.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+static const char GEOHASH_ALPHABET[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+// Наибольшая длина geohash при покрытии области
+const int GEOHASH_MAX_PRECISION = 9;
+// Ячеек в покрытии для поиска по БД
+const size_t GEOHASH_SEARCH_CELLS = 32;
+
+std::string geohash_encode(double lat, double lon, int precision) {
+    double lat_min = -90, lat_max = 90;
+    double lon_min = -180, lon_max = 180;
+    std::string hash;
+    bool even = true;  // Биты чередуются начиная с долготы
+    int bit = 0;
+    int ch = 0;
+    while (static_cast<int>(hash.size()) < precision) {
+        if (even) {
+            double mid = (lon_min + lon_max) / 2;
+            if (lon >= mid) {
+                ch = (ch << 1) | 1;
+                lon_min = mid;
+            } else {
+                ch <<= 1;
+                lon_max = mid;
+            }
+        } else {
+            double mid = (lat_min + lat_max) / 2;
+            if (lat >= mid) {
+                ch = (ch << 1) | 1;
+                lat_min = mid;
+            } else {
+                ch <<= 1;
+                lat_max = mid;
+            }
+        }
+        even = !even;
+        if (++bit == 5) {
+            hash += GEOHASH_ALPHABET[ch];
+            bit = 0;
+            ch = 0;
+        }
+    }
+    return hash;
+}
+
+bool geohash_decode(const std::string& hash, GeohashCell& cell) {
+    double lat_min = -90, lat_max = 90;
+    double lon_min = -180, lon_max = 180;
+    bool even = true;
+    for (char c : hash) {
+        const char* pos = std::find(GEOHASH_ALPHABET, GEOHASH_ALPHABET + 32, c);
+        if (pos == GEOHASH_ALPHABET + 32) {
+            return false;
+        }
+        int value = pos - GEOHASH_ALPHABET;
+        for (int b = 4; b >= 0; --b) {
+            bool bit = (value >> b) & 1;
+            if (even) {
+                (bit ? lon_min : lon_max) = (lon_min + lon_max) / 2;
+            } else {
+                (bit ? lat_min : lat_max) = (lat_min + lat_max) / 2;
+            }
+            even = !even;
+        }
+    }
+    cell.north = lat_max;
+    cell.south = lat_min;
+    cell.east = lon_max;
+    cell.west = lon_min;
+    return true;
+}
+
+// Ячейки точности precision, покрывающие прямоугольник; пусто, если больше limit
+static std::vector<std::string> cover_at(double north, double south, double east, double west,
+                                         int precision, size_t limit) {
+    int lon_bits = (5 * precision + 1) / 2;
+    int lat_bits = 5 * precision / 2;
+    double cell_width = 360.0 / std::pow(2.0, lon_bits);
+    double cell_height = 180.0 / std::pow(2.0, lat_bits);
+
+    double first_lat = std::floor((south + 90) / cell_height) * cell_height - 90;
+    double first_lon = std::floor((west + 180) / cell_width) * cell_width - 180;
+    size_t rows = static_cast<size_t>(std::ceil((north - first_lat) / cell_height));
+    size_t cols = static_cast<size_t>(std::ceil((east - first_lon) / cell_width));
+    if (rows * cols > limit) {
+        return {};
+    }
+
+    std::set<std::string> cells;
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t c = 0; c < cols; ++c) {
+            // Центр ячейки исключает неоднозначность на границах
+            double lat = std::min(89.999999, first_lat + (r + 0.5) * cell_height);
+            double lon = std::min(179.999999, first_lon + (c + 0.5) * cell_width);
+            cells.insert(geohash_encode(lat, lon, precision));
+        }
+    }
+    return std::vector<std::string>(cells.begin(), cells.end());
+}
+
+std::vector<std::string> geohash_cover(double north, double south, double east, double west,
+                                       size_t max_cells) {
+    north = std::min(north, 90.0);
+    south = std::max(south, -90.0);
+    east = std::min(east, 180.0);
+    west = std::max(west, -180.0);
+    if (north <= south || east <= west) {
+        return {};
+    }
+
+    std::vector<std::string> best = cover_at(north, south, east, west, 1, SIZE_MAX);
+    for (int precision = 2; precision <= GEOHASH_MAX_PRECISION; ++precision) {
+        std::vector<std::string> cells = cover_at(north, south, east, west, precision, max_cells);
+        if (cells.empty()) {
+            break;
+        }
+        best.swap(cells);
+    }
+    return best;
+}
+
+std::vector<std::string> get_geohash_prefixes(float north, float south, float east, float west) {
+    return geohash_cover(north, south, east, west, GEOHASH_SEARCH_CELLS);
+}
+
+bool geohash_overlaps(const std::string& a, const std::string& b) {
+    size_t n = std::min(a.size(), b.size());
+    return a.compare(0, n, b, 0, n) == 0;
+}
@@ -0,0 +1,30 @@
+#ifndef GEOHASH_H
+#define GEOHASH_H
+
+#include <string>
+#include <vector>
+
+// Geohash точки с заданным числом символов
+std::string geohash_encode(double lat, double lon, int precision);
+
+// Границы ячейки geohash
+struct GeohashCell {
+    double north = 0;
+    double south = 0;
+    double east = 0;
+    double west = 0;
+};
+bool geohash_decode(const std::string& hash, GeohashCell& cell);
+
+// Ячейки одинаковой длины, покрывающие прямоугольник. Выбирается самая
+// длинная точность, при которой ячеек не больше max_cells
+std::vector<std::string> geohash_cover(double north, double south, double east, double west,
+                                       size_t max_cells);
+
+// Префиксы geohash для поиска снимков в области (используется в DBManager::search_images)
+std::vector<std::string> get_geohash_prefixes(float north, float south, float east, float west);
+
+// Пересекаются ли области двух префиксов (один является началом другого)
+bool geohash_overlaps(const std::string& a, const std::string& b);
+
+#endif // GEOHASH_H
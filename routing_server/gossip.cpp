@@ -1,55 +1,207 @@
+#include "gossip.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "db_manager.h"
+#include "gossip_node.h"
+#include "image_search.h"
+#include "routing_server.h"
+#include "upload_proxy.h"
+
+// Таймаут соединения, отправки и ответа маршрутизатора
+const int GOSSIP_IO_TIMEOUT_MS = 2000;
+// Как часто перечитывается список маршрутизаторов
+const int GOSSIP_PEERS_REFRESH_SEC = 5;
+// Наибольший ответ на /gossip/batch
+const size_t GOSSIP_MAX_RESPONSE = 64 * 1024;
+
+static GossipNode g_node;
+static std::mutex g_mutex;  // g_sender и g_self_address
+static std::string g_self_address;
+static std::thread g_sender;
 
-#include <random>  
-
+void gossip_broadcast(const std::string& method, const std::string& path, const std::string& body) {
+    g_node.broadcast(method, path, body);
+}
 
-struct RouterInfo {
-    std::string ip;
-    int port;
-    uint64_t hash_start;
-    uint64_t hash_end;
-    std::vector<std::string> neighbors;  // ip:port
-};
+// Соединение с маршрутизатором "ip:port" с таймаутами на connect, send и recv
+static int open_connection(const std::string& address) {
+    size_t colon = address.rfind(':');
+    std::string host = address.substr(0, colon);
+    std::string port = colon == std::string::npos ? "8080" : address.substr(colon + 1);
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addr = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addr) != 0) {
+        return -1;
+    }
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock >= 0) {
+        timeval tv = {GOSSIP_IO_TIMEOUT_MS / 1000, (GOSSIP_IO_TIMEOUT_MS % 1000) * 1000};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(sock, addr->ai_addr, addr->ai_addrlen) != 0) {
+            close(sock);
+            sock = -1;
+        }
+    }
+    freeaddrinfo(addr);
+    return sock;
+}
 
-void gossip_broadcast(const std::string& method, const std::string& path, const std::string& body = "");
+// Ответ по Content-Length, соединение остается открытым. Код ответа или -1;
+// keep_alive = false, если сервер закрывает соединение
+static int read_response(int sock, bool& keep_alive) {
+    std::string response;
+    char buf[4096];
+    size_t header_end = std::string::npos;
+    size_t content_length = 0;
+    while (true) {
+        if (header_end == std::string::npos) {
+            header_end = response.find("\r\n\r\n");
+            if (header_end != std::string::npos) {
+                std::string head = response.substr(0, header_end);
+                std::transform(head.begin(), head.end(), head.begin(), ::tolower);
+                size_t length_pos = head.find("content-length:");
+                if (length_pos == std::string::npos) {
+                    return -1;
+                }
+                content_length = std::strtoul(head.c_str() + length_pos + 15, nullptr, 10);
+                keep_alive = head.find("connection: close") == std::string::npos;
+            }
+        }
+        if (header_end != std::string::npos && response.size() >= header_end + 4 + content_length) {
+            break;
+        }
+        if (response.size() > GOSSIP_MAX_RESPONSE) {
+            return -1;
+        }
+        ssize_t n = recv(sock, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            return -1;
+        }
+        response.append(buf, n);
+    }
+    if (response.compare(0, 9, "HTTP/1.1 ") != 0) {
+        return -1;
+    }
+    return std::atoi(response.c_str() + 9);
+}
 
-// Вспомогательная функция для получения случайных соседей
-std::vector<RoutingServerInfo> select_random_neighbors(DBManager& db_manager, int count = 2) {
-    std::vector<RoutingServerInfo> all = db_manager.get_all_routing_servers();
-    std::shuffle(all.begin(), all.end(), std::mt19937(std::random_device()()));
-    return std::vector<RoutingServerInfo>(all.begin(), std::min(all.begin() + count, all.end()));
+// Отправка пакета по постоянному соединению. Если старое соединение
+// закрыто другой стороной, одна попытка повторяется через новое
+static bool send_batch(std::map<std::string, int>& connections, const std::string& peer,
+                       const std::string& body) {
+    std::string request = "POST /gossip/batch HTTP/1.1\r\n";
+    request += "Host: " + peer + "\r\n";
+    request += "Content-Type: application/json\r\n";
+    request += "Connection: keep-alive\r\n";
+    request += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool fresh = false;
+        auto it = connections.find(peer);
+        if (it == connections.end()) {
+            int sock = open_connection(peer);
+            if (sock < 0) {
+                return false;
+            }
+            fresh = true;
+            it = connections.emplace(peer, sock).first;
+            g_node.record_connection();
+        }
+        bool keep_alive = false;
+        int status = -1;
+        if (send_all(it->second, request.data(), request.size(), GOSSIP_IO_TIMEOUT_MS)) {
+            status = read_response(it->second, keep_alive);
+        }
+        if (status < 0 || !keep_alive) {
+            close(it->second);
+            connections.erase(it);
+        }
+        if (status >= 0) {
+            g_node.record_bytes(request.size());
+            return status == 200;
+        }
+        if (fresh) {
+            return false;
+        }
+    }
+    return false;
 }
 
-// Функция отправки запроса другим маршрутизаторам
-void gossip_broadcast(const std::string& method, const std::string& path, const std::string& body) {
-    DBManager db_manager;
-    auto neighbors = select_random_neighbors(db_manager);
-
-    for (const auto& neighbor : neighbors) {
-        std::string full_path = path;
-        std::string host = neighbor.adress;
-        int port = 8080;
-
-        std::string request = method + " " + full_path + " HTTP/1.1\r\n";
-        request += "Host: " + host + "\r\n";
-        request += "Content-Type: application/json\r\n";
-        request += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
-
-        // отправка запроса как TCP-соединение
-        int sock = socket(AF_INET, SOCK_STREAM, 0);
-        if (sock < 0) continue;
-
-        sockaddr_in addr;
-        addr.sin_family = AF_INET;
-        addr.sin_port = htons(port);
-        inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
-
-        if (connect(sock, (sockaddr*)&addr, sizeof(addr)) == 0) {
-            send(sock, request.c_str(), request.size(), 0);
+static void sender_main() {
+    std::map<std::string, int> connections;
+    std::vector<std::string> peers;
+    auto peers_loaded = std::chrono::steady_clock::time_point();
+    std::mt19937 rng(std::random_device{}());
+
+    while (g_node.wait_for_batch()) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - peers_loaded > std::chrono::seconds(GOSSIP_PEERS_REFRESH_SEC)) {
+            DBManager db_manager;
+            peers.clear();
+            for (const auto& router : db_manager.get_all_routing_servers()) {
+                std::string address = normalize_router_address(router.adress);
+                if (address != g_self_address &&
+                    std::find(peers.begin(), peers.end(), address) == peers.end()) {
+                    peers.push_back(address);
+                }
+            }
+            peers_loaded = now;
+        }
+
+        for (const auto& batch : g_node.take_batches(peers, rng)) {
+            g_node.record_batch(batch, send_batch(connections, batch.peer, batch.body));
         }
-        close(sock);
+    }
+    for (const auto& entry : connections) {
+        close(entry.second);
     }
 }
 
+void gossip_start(const std::string& self_address, const GossipConfig& config) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_sender.joinable()) {
+        return;
+    }
+    g_self_address = self_address;
+    g_node.configure(self_address, config);
+    g_sender = std::thread(sender_main);
+}
+
+void gossip_stop() {
+    g_node.stop();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_sender.joinable()) {
+        g_sender.join();
+    }
+}
+
+bool gossip_receive_batch(const std::string& body, const GossipApply& apply, std::string& response) {
+    return g_node.receive(body, apply, response);
+}
+
+void gossip_set_piggyback(const GossipPiggybackProduce& produce, const GossipPiggybackConsume& consume) {
+    g_node.set_piggyback(produce, consume);
+}
+
+GossipStats gossip_get_stats() {
+    return g_node.stats();
+}
 
 std::vector<RouterInfo> dht_table;  // локальный фрагмент DHT (обновляется через gossip)
 
@@ -59,17 +211,19 @@ uint64_t hash_key(const std::string& key) {
     return hasher(key);
 }
 
-// Поиск маршрутизатора, ответственного за ключ
+// Поиск маршрутизатора, ответственного за ключ. dht_table упорядочена
+// по hash_start, поэтому нужен бинарный поиск, а не просмотр всей таблицы:
+// владелец - последний маршрутизатор с hash_start <= h, а для h меньше
+// всех начал - последний в таблице (интервал через 0)
 RouterInfo find_responsible_router(const std::string& key) {
-    uint64_t h = hash_key(key);
-    for (const auto& r : dht_table) {  // нет, здесь нужно по соседям искать, мы не знаем всю топологию
-        if (r.hash_start <= h && h <= r.hash_end)
-            return r;
+    if (dht_table.empty()) {
+        return RouterInfo{};
     }
-    // fallback: вернуть соседа с ближайшим hash_start
-    return *std::min_element(dht_table.begin(), dht_table.end(), [h](auto& a, auto& b) {
-        return std::abs((int64_t)(a.hash_start - h)) < std::abs((int64_t)(b.hash_start - h));
+    uint64_t h = hash_key(key);
+    auto it = std::upper_bound(dht_table.begin(), dht_table.end(), h, [](uint64_t value, const RouterInfo& r) {
+        return value < r.hash_start;
     });
+    return it == dht_table.begin() ? dht_table.back() : *std::prev(it);
 }
 
 // Gossip-обновление от соседа
@@ -84,69 +238,10 @@ void receive_gossip_update(const std::vector<RouterInfo>& updated) {
             *it = r;  // обновляем информацию
         }
     }
+    std::sort(dht_table.begin(), dht_table.end(), [](const RouterInfo& a, const RouterInfo& b) {
+        return a.hash_start < b.hash_start;
+    });
 }
 
 
-// кольцо DHT с перерасчетом границ хешей при добавлении/удалении маршрутизаторов
-using namespace std;
-
-using Hash = size_t;
-
-// Узел в кольце DHT
-struct Node {
-    string address;          // IP:PORT
-    Hash id;                 // Хэш от address
-    Node* successor = nullptr;
-    Node* predecessor = nullptr;
-    map<Hash, string> metadata; // Хэш снимка -> имя файла
-
-    explicit Node(string addr) : address(std::move(addr)) {
-        id = hash<string>{}(address);
-    }
-
-    // Вставка снимка в DHT
-    void store(Hash key, const string& filename) {
-        metadata[key] = filename;
-    }
-
-    // Поиск владельца ключа в кольце
-    Node* find_successor(Hash key) {
-        if (in_range(key, id, successor->id)) {
-            return successor;
-        } else {
-            return successor->find_successor(key); // Простой hop-by-hop
-        }
-    }
-
-    static bool in_range(Hash key, Hash start, Hash end) {
-        if (start < end) return key > start && key <= end;
-        else return key > start || key <= end; // Обход через 0
-    }
-};
-
-// Симуляция кольца
-struct DHTRing {
-    vector<Node*> nodes;
-
-    void add_node(Node* new_node) {
-        nodes.push_back(new_node);
-        sort(nodes.begin(), nodes.end(), [](Node* a, Node* b) { return a->id < b->id; });
-        update_neighbors();
-    }
-
-    void update_neighbors() {
-        int n = nodes.size();
-        for (int i = 0; i < n; ++i) {
-            nodes[i]->successor = nodes[(i + 1) % n];
-            nodes[i]->predecessor = nodes[(i - 1 + n) % n];
-        }
-    }
-
-    void print_ring() {
-        cout << "=== DHT Ring ===\n";
-        for (auto node : nodes) {
-            cout << "Node: " << node->address << " ID: " << node->id
-                 << " Succ: " << node->successor->address << endl;
-        }
-    }
-};
+// Кольцо DHT с таблицами пальцев (Node, DHTRing) - в chord.h
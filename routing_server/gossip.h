@@ -0,0 +1,91 @@
+#ifndef GOSSIP_H
+#define GOSSIP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Распространение изменений каталога между маршрутизаторами (gossip).
+// gossip_broadcast только ставит сообщение в очередь и сразу возвращается;
+// отдельный поток раз в flush_ms разбирает очередь, выбирает для каждого
+// сообщения fanout случайных маршрутизаторов и отправляет каждому одним
+// запросом POST /gossip/batch все сообщения для него, по постоянному
+// соединению. Получатель применяет сообщение один раз (по id) и пересылает
+// его дальше, пока не кончится ttl
+
+// Нижняя граница fanout при scale_to_peers
+const int GOSSIP_MIN_FANOUT = 4;
+
+struct GossipConfig {
+    int fanout = 2;            // Маршрутизаторов на сообщение на каждом шаге
+    int ttl = 4;               // Шагов пересылки от источника
+    int flush_ms = 50;         // Ожидание следующих сообщений перед отправкой пакета
+    size_t max_batch = 64;     // Сообщений в одном запросе
+    size_t queue_limit = 10000;  // При переполнении вытесняются самые старые
+    size_t seen_limit = 100000;  // Сколько последних id помнится для отбрасывания повторов
+    int piggyback_idle_ms = 1000;  // Без сообщений попутные данные уходят раз в столько мс (0 - только с ними)
+    // fanout и ttl - нижние границы: с ростом числа маршрутизаторов n fanout не меньше
+    // GOSSIP_MIN_FANOUT, а ttl своих сообщений не меньше ceil(log2(n + 1)) + 2,
+    // иначе изменение доходит лишь до части кластера. false - ровно заданные значения
+    bool scale_to_peers = true;
+};
+
+struct GossipStats {
+    uint64_t enqueued = 0;
+    uint64_t queue_dropped = 0;
+    uint64_t batches_sent = 0;
+    uint64_t messages_sent = 0;   // С учетом fanout
+    uint64_t send_failures = 0;
+    uint64_t connections_opened = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t received = 0;
+    uint64_t duplicates = 0;
+    uint64_t ttl_expired = 0;     // Не пересланы дальше: ttl исчерпан
+};
+
+// Постановка изменения в очередь рассылки. Внутри применения пришедшего
+// сообщения (gossip_receive_batch) пересылает его с тем же id и ttl - 1
+void gossip_broadcast(const std::string& method, const std::string& path, const std::string& body = "");
+
+// Запуск потока рассылки; self_address ("ip:port") исключается из получателей
+void gossip_start(const std::string& self_address, const GossipConfig& config = GossipConfig());
+
+// Отправка оставшейся очереди и остановка потока
+void gossip_stop();
+
+// Применение сообщения из пакета: method, path и body исходного запроса
+typedef std::function<void(const std::string& method, const std::string& path, const std::string& body)>
+    GossipApply;
+
+// Прием POST /gossip/batch: новые сообщения применяются через apply, повторы
+// отбрасываются. В response - JSON {"accepted", "duplicates"}; false - неверное тело
+bool gossip_receive_batch(const std::string& body, const GossipApply& apply, std::string& response);
+
+GossipStats gossip_get_stats();
+
+// Попутные данные пакетов (сводки нагрузки, load_view.h): produce дает JSON,
+// который кладется в поле "load" каждого пакета, consume получает такое поле
+// из пришедшего пакета. Пока сообщений нет, пакет с одними попутными данными
+// уходит fanout маршрутизаторам раз в piggyback_idle_ms
+typedef std::function<std::string()> GossipPiggybackProduce;
+typedef std::function<void(const std::string& json)> GossipPiggybackConsume;
+void gossip_set_piggyback(const GossipPiggybackProduce& produce, const GossipPiggybackConsume& consume);
+
+// Маршрутизатор в локальном фрагменте DHT
+struct RouterInfo {
+    std::string ip;
+    int port;
+    uint64_t hash_start;
+    uint64_t hash_end;
+    std::vector<std::string> neighbors;  // ip:port
+};
+
+// Маршрутизатор, ответственный за ключ
+RouterInfo find_responsible_router(const std::string& key);
+
+// Gossip-обновление фрагмента DHT от соседа
+void receive_gossip_update(const std::vector<RouterInfo>& updated);
+
+#endif // GOSSIP_H
@@ -0,0 +1,284 @@
+#include "gossip_node.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <nlohmann/json.hpp>
+
+// Сообщение, которое сейчас применяется из пакета: broadcast того же узла
+// в обработчике пересылает его дальше с тем же id
+struct GossipContext {
+    const GossipNode* node;
+    std::string id;
+    int ttl;
+    std::string from;
+};
+static thread_local const GossipContext* t_context = nullptr;
+
+void GossipNode::configure(const std::string& self_address, const GossipConfig& config, const std::string& origin) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    self_address_ = self_address;
+    config_ = config;
+    config_.max_batch = std::max<size_t>(1, config_.max_batch);
+    // Случайная часть отличает id после перезапуска маршрутизатора
+    origin_ = origin.empty() ? self_address + "/" + std::to_string(std::random_device{}()) : origin;
+    stopping_ = false;
+}
+
+// Запоминание id (под mutex_); false, если он уже встречался
+bool GossipNode::remember_id(const std::string& id) {
+    if (!seen_.insert(id).second) {
+        return false;
+    }
+    seen_order_.push_back(id);
+    while (seen_order_.size() > config_.seen_limit) {
+        seen_.erase(seen_order_.front());
+        seen_order_.pop_front();
+    }
+    return true;
+}
+
+void GossipNode::broadcast(const std::string& method, const std::string& path, const std::string& body) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    GossipMessage message;
+    message.method = method;
+    message.path = path;
+    message.body = body;
+    if (t_context && t_context->node == this) {
+        message.id = t_context->id;
+        message.ttl = t_context->ttl - 1;
+        message.from = t_context->from;
+        if (message.ttl <= 0) {
+            stats_.ttl_expired++;
+            return;
+        }
+    } else {
+        if (origin_.empty()) {
+            origin_ = std::to_string(std::random_device{}());
+        }
+        message.id = origin_ + "-" + std::to_string(++next_id_);
+        message.ttl = config_.ttl;
+        message.own = true;
+        remember_id(message.id);
+    }
+    if (queue_.size() >= config_.queue_limit) {
+        queue_.pop_front();
+        stats_.queue_dropped++;
+    }
+    queue_.push_back(message);
+    stats_.enqueued++;
+    cv_.notify_one();
+}
+
+void GossipNode::set_piggyback(const GossipPiggybackProduce& produce, const GossipPiggybackConsume& consume) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    produce_ = produce;
+    consume_ = consume;
+}
+
+bool GossipNode::wait_for_batch() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto ready = [this]() { return !queue_.empty() || stopping_; };
+    if (produce_ && config_.piggyback_idle_ms > 0) {
+        if (!cv_.wait_for(lock, std::chrono::milliseconds(config_.piggyback_idle_ms), ready)) {
+            return true;  // Сообщений не было: уйдут одни попутные данные
+        }
+    } else {
+        cv_.wait(lock, ready);
+    }
+    if (queue_.empty()) {
+        return false;
+    }
+    // Небольшая задержка собирает в пакет сообщения, поставленные следом
+    if (!stopping_) {
+        cv_.wait_for(lock, std::chrono::milliseconds(config_.flush_ms),
+                     [this]() { return queue_.size() >= config_.max_batch || stopping_; });
+    }
+    return true;
+}
+
+void GossipNode::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    cv_.notify_all();
+}
+
+std::vector<GossipBatch> GossipNode::take_batches(const std::vector<std::string>& peers, std::mt19937& rng) {
+    std::vector<GossipMessage> messages;
+    GossipConfig config;
+    std::string self_address;
+    GossipPiggybackProduce produce;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        messages.assign(queue_.begin(), queue_.end());
+        queue_.clear();
+        config = config_;
+        self_address = self_address_;
+        produce = produce_;
+    }
+    nlohmann::json load;
+    if (produce) {
+        try {
+            load = nlohmann::json::parse(produce());
+        } catch (...) {
+        }
+    }
+
+    // Охват всего кластера: fanout и ttl своих сообщений растут с числом маршрутизаторов
+    if (config.scale_to_peers) {
+        size_t others = std::count_if(peers.begin(), peers.end(),
+                                      [&self_address](const std::string& peer) { return peer != self_address; });
+        int min_ttl = static_cast<int>(std::ceil(std::log2(static_cast<double>(others) + 1))) + 2;
+        config.fanout = std::max(config.fanout, GOSSIP_MIN_FANOUT);
+        for (auto& message : messages) {
+            if (message.own) {
+                message.ttl = std::max(message.ttl, min_ttl);
+            }
+        }
+    }
+
+    // Каждому сообщению - fanout случайных получателей, кроме приславшего
+    std::map<std::string, std::vector<const GossipMessage*>> per_peer;
+    for (const auto& message : messages) {
+        std::vector<std::string> candidates;
+        for (const auto& peer : peers) {
+            if (peer != message.from && peer != self_address) {
+                candidates.push_back(peer);
+            }
+        }
+        std::shuffle(candidates.begin(), candidates.end(), rng);
+        candidates.resize(std::min<size_t>(candidates.size(), std::max(0, config.fanout)));
+        for (const auto& peer : candidates) {
+            per_peer[peer].push_back(&message);
+        }
+    }
+
+    // Без сообщений попутные данные уходят fanout случайным маршрутизаторам
+    if (messages.empty() && !load.is_null()) {
+        std::vector<std::string> candidates;
+        for (const auto& peer : peers) {
+            if (peer != self_address) {
+                candidates.push_back(peer);
+            }
+        }
+        std::shuffle(candidates.begin(), candidates.end(), rng);
+        candidates.resize(std::min<size_t>(candidates.size(), std::max(0, config.fanout)));
+        for (const auto& peer : candidates) {
+            per_peer[peer];
+        }
+    }
+
+    std::vector<GossipBatch> batches;
+    for (const auto& entry : per_peer) {
+        const std::vector<const GossipMessage*>& peer_messages = entry.second;
+        size_t start = 0;
+        do {
+            size_t end = std::min(peer_messages.size(), start + config.max_batch);
+            nlohmann::json body;
+            body["from"] = self_address;
+            body["messages"] = nlohmann::json::array();
+            if (!load.is_null()) {
+                body["load"] = load;
+            }
+            for (size_t i = start; i < end; ++i) {
+                body["messages"].push_back({{"id", peer_messages[i]->id}, {"method", peer_messages[i]->method},
+                                            {"path", peer_messages[i]->path}, {"body", peer_messages[i]->body},
+                                            {"ttl", peer_messages[i]->ttl}});
+            }
+            GossipBatch batch;
+            batch.peer = entry.first;
+            batch.body = body.dump();
+            batch.messages = end - start;
+            batches.push_back(std::move(batch));
+            start = end;
+        } while (start < peer_messages.size());
+    }
+    return batches;
+}
+
+bool GossipNode::receive(const std::string& body, const GossipApply& apply, std::string& response) {
+    nlohmann::json batch;
+    try {
+        batch = nlohmann::json::parse(body);
+        if (!batch.at("messages").is_array()) {
+            return false;
+        }
+    } catch (...) {
+        return false;
+    }
+    std::string from = batch.value("from", "");
+    GossipPiggybackConsume consume;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        consume = consume_;
+    }
+    if (consume && batch.contains("load")) {
+        consume(batch["load"].dump());
+    }
+    size_t accepted = 0;
+    size_t duplicates = 0;
+    for (const auto& item : batch["messages"]) {
+        GossipContext context;
+        context.node = this;
+        std::string method, path, message_body;
+        try {
+            context.id = item.at("id").get<std::string>();
+            context.ttl = item.at("ttl").get<int>();
+            context.from = from;
+            method = item.at("method").get<std::string>();
+            path = item.at("path").get<std::string>();
+            message_body = item.value("body", "");
+        } catch (...) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!remember_id(context.id)) {
+                stats_.duplicates++;
+                duplicates++;
+                continue;
+            }
+            stats_.received++;
+        }
+        accepted++;
+        const GossipContext* outer = t_context;
+        t_context = &context;
+        try {
+            apply(method, path, message_body);
+        } catch (...) {
+        }
+        t_context = outer;
+    }
+    response = "{\"accepted\":" + std::to_string(accepted) + ",\"duplicates\":" + std::to_string(duplicates) + "}";
+    return true;
+}
+
+void GossipNode::record_batch(const GossipBatch& batch, bool ok) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ok) {
+        stats_.batches_sent++;
+        stats_.messages_sent += batch.messages;
+    } else {
+        stats_.send_failures++;
+    }
+}
+
+void GossipNode::record_connection() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.connections_opened++;
+}
+
+void GossipNode::record_bytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.bytes_sent += bytes;
+}
+
+GossipStats GossipNode::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+size_t GossipNode::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
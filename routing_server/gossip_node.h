@@ -0,0 +1,87 @@
+#ifndef GOSSIP_NODE_H
+#define GOSSIP_NODE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "gossip.h"
+
+// Протокол gossip одного маршрутизатора без сети: очередь, id и ttl
+// сообщений, отбрасывание повторов, выбор получателей и сборка пакетов
+// /gossip/batch. gossip.cpp отправляет пакеты по HTTP, имитатор кластера
+// (sim_network.h) - через модель сети
+
+struct GossipMessage {
+    std::string id;
+    std::string method;
+    std::string path;
+    std::string body;
+    int ttl;
+    std::string from;  // Маршрутизатор, приславший сообщение: ему не пересылается
+    bool own = false;  // Изменение этого маршрутизатора, а не пересылка
+};
+
+// Тело запроса POST /gossip/batch для одного получателя
+struct GossipBatch {
+    std::string peer;
+    std::string body;
+    size_t messages = 0;
+};
+
+class GossipNode {
+public:
+    // origin - начало id сообщений этого узла; пустой - случайный
+    void configure(const std::string& self_address, const GossipConfig& config, const std::string& origin = "");
+
+    // См. gossip_broadcast: внутри receive пересылает применяемое сообщение
+    void broadcast(const std::string& method, const std::string& path, const std::string& body);
+
+    // См. gossip_set_piggyback
+    void set_piggyback(const GossipPiggybackProduce& produce, const GossipPiggybackConsume& consume);
+
+    // Ожидание очереди для потока отправки: после первого сообщения еще
+    // flush_ms на сбор пакета. При попутных данных возвращает true и с пустой
+    // очередью через piggyback_idle_ms. false - остановка и очередь пуста
+    bool wait_for_batch();
+    void stop();
+
+    // Разбор очереди: fanout случайных получателей из peers на сообщение,
+    // не больше max_batch сообщений в пакете. При попутных данных и пустой
+    // очереди - пакеты без сообщений fanout получателям
+    std::vector<GossipBatch> take_batches(const std::vector<std::string>& peers, std::mt19937& rng);
+
+    // См. gossip_receive_batch
+    bool receive(const std::string& body, const GossipApply& apply, std::string& response);
+
+    // Итог отправки пакета и счетчики соединений
+    void record_batch(const GossipBatch& batch, bool ok);
+    void record_connection();
+    void record_bytes(size_t bytes);
+
+    GossipStats stats() const;
+    size_t queued() const;
+
+private:
+    bool remember_id(const std::string& id);
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<GossipMessage> queue_;
+    GossipConfig config_;
+    std::string self_address_;
+    std::string origin_;
+    uint64_t next_id_ = 0;
+    bool stopping_ = false;
+    GossipStats stats_;
+    GossipPiggybackProduce produce_;
+    GossipPiggybackConsume consume_;
+    std::unordered_set<std::string> seen_;
+    std::deque<std::string> seen_order_;
+};
+
+#endif // GOSSIP_NODE_H
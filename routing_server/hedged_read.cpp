@@ -0,0 +1,293 @@
+#include "hedged_read.h"
+#include "routing_server.h"
+#include "circuit_breaker.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Число последних измерений задержки на сервер
+const size_t HEDGE_WINDOW = 256;
+// Пока измерений меньше, используется задержка по умолчанию
+const size_t HEDGE_MIN_SAMPLES = 20;
+const double HEDGE_DEFAULT_DELAY_MS = 50.0;
+const double HEDGE_MIN_DELAY_MS = 2.0;
+const double HEDGE_MAX_DELAY_MS = 1000.0;
+// Общий срок чтения
+const int HEDGE_TIMEOUT_MS = 10000;
+// Счетчики бюджета периодически делятся пополам, чтобы бюджет отражал недавний трафик
+const uint64_t HEDGE_BUDGET_WINDOW = 10000;
+
+struct LatencyWindow {
+    std::vector<double> samples;
+    size_t next = 0;
+};
+
+static std::mutex g_hedge_mtx;
+static std::map<int, LatencyWindow> g_hedge_latency;
+static HedgeStats g_hedge_stats;
+// Счетчики для проверки бюджета (с затуханием, в отличие от g_hedge_stats)
+static uint64_t g_budget_requests = 0;
+static uint64_t g_budget_hedges = 0;
+
+void hedge_configure(double budget_percent) {
+    std::lock_guard<std::mutex> lock(g_hedge_mtx);
+    g_hedge_stats.budget_percent = budget_percent;
+}
+
+void hedge_record_latency(int server_id, double latency_ms) {
+    std::lock_guard<std::mutex> lock(g_hedge_mtx);
+    LatencyWindow& window = g_hedge_latency[server_id];
+    if (window.samples.size() < HEDGE_WINDOW) {
+        window.samples.push_back(latency_ms);
+    } else {
+        window.samples[window.next] = latency_ms;
+        window.next = (window.next + 1) % HEDGE_WINDOW;
+    }
+}
+
+static double window_p95(const LatencyWindow& window) {
+    std::vector<double> sorted = window.samples;
+    size_t idx = sorted.size() * 95 / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+    return sorted[idx];
+}
+
+double hedge_delay_ms(int server_id) {
+    std::lock_guard<std::mutex> lock(g_hedge_mtx);
+    auto it = g_hedge_latency.find(server_id);
+    if (it == g_hedge_latency.end() || it->second.samples.size() < HEDGE_MIN_SAMPLES) {
+        return HEDGE_DEFAULT_DELAY_MS;
+    }
+    return std::min(HEDGE_MAX_DELAY_MS, std::max(HEDGE_MIN_DELAY_MS, window_p95(it->second)));
+}
+
+std::map<int, double> hedge_delays_snapshot() {
+    std::lock_guard<std::mutex> lock(g_hedge_mtx);
+    std::map<int, double> result;
+    for (const auto& entry : g_hedge_latency) {
+        if (!entry.second.samples.empty()) {
+            result[entry.first] = window_p95(entry.second);
+        }
+    }
+    return result;
+}
+
+HedgeStats hedge_get_stats() {
+    std::lock_guard<std::mutex> lock(g_hedge_mtx);
+    return g_hedge_stats;
+}
+
+// Разрешение на хедж: доля хеджей не должна превысить бюджет
+static bool hedge_budget_allows() {
+    std::lock_guard<std::mutex> lock(g_hedge_mtx);
+    if ((g_budget_hedges + 1) * 100.0 > g_hedge_stats.budget_percent * g_budget_requests) {
+        g_hedge_stats.budget_denied++;
+        return false;
+    }
+    g_budget_hedges++;
+    g_hedge_stats.hedges_sent++;
+    return true;
+}
+
+static void hedge_count(uint64_t HedgeStats::*counter) {
+    std::lock_guard<std::mutex> lock(g_hedge_mtx);
+    g_hedge_stats.*counter += 1;
+}
+
+// Один запрос к реплике на неблокирующем сокете
+struct HedgeAttempt {
+    int server_id = 0;
+    std::string location;
+    bool issued = false;    // Соединение открыто (не отклонено автоматом защиты)
+    int fd = -1;
+    std::string out;
+    size_t sent = 0;
+    std::string in;
+    bool finished = false;  // Соединение закрыто, ответ получен или ошибка
+    std::chrono::steady_clock::time_point started;
+};
+
+static bool start_attempt(HedgeAttempt& attempt, const ServerInfo& server, const std::string& path) {
+    std::string host_header;
+    attempt.server_id = server.server_id;
+    attempt.location = server.location;
+    attempt.started = std::chrono::steady_clock::now();
+    attempt.fd = connect_to_server(server.location, host_header, true);
+    if (attempt.fd < 0) {
+        attempt.finished = true;
+        return false;
+    }
+    attempt.issued = true;
+    attempt.out = "GET " + path + " HTTP/1.1\r\nHost: " + host_header + "\r\n\r\n";
+    return true;
+}
+
+// Продвижение обмена по событиям poll
+static void advance_attempt(HedgeAttempt& attempt, short revents) {
+    if (revents & POLLOUT && attempt.sent < attempt.out.size()) {
+        ssize_t n = send(attempt.fd, attempt.out.data() + attempt.sent,
+                         attempt.out.size() - attempt.sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            attempt.sent += n;
+        } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            attempt.finished = true;
+        }
+    }
+    if (revents & (POLLIN | POLLHUP | POLLERR)) {
+        char buf[65536];
+        ssize_t n;
+        while ((n = recv(attempt.fd, buf, sizeof(buf), 0)) > 0) {
+            attempt.in.append(buf, n);
+        }
+        // storage_server закрывает соединение после ответа
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            attempt.finished = true;
+        }
+    }
+}
+
+// Ответ, который можно вернуть клиенту: полный и без ошибки сервера
+static bool attempt_succeeded(const HedgeAttempt& attempt) {
+    if (!attempt.finished || attempt.in.compare(0, 9, "HTTP/1.1 ") != 0) {
+        return false;
+    }
+    return std::atoi(attempt.in.c_str() + 9) < 500;
+}
+
+static void close_attempt(HedgeAttempt& attempt) {
+    if (attempt.fd >= 0) {
+        close(attempt.fd);
+        attempt.fd = -1;
+    }
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+std::string hedged_get(const std::vector<ServerInfo>& replicas, const std::string& path) {
+    if (replicas.empty()) {
+        return "";
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_hedge_mtx);
+        g_hedge_stats.requests++;
+        if (++g_budget_requests > HEDGE_BUDGET_WINDOW) {
+            g_budget_requests /= 2;
+            g_budget_hedges /= 2;
+        }
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    double hedge_after_ms = hedge_delay_ms(replicas[0].server_id);
+    HedgeAttempt attempts[2];
+    size_t launched = 1;
+    bool hedged = false;
+    bool hedge_declined = replicas.size() < 2;
+    start_attempt(attempts[0], replicas[0], path);
+
+    int winner = -1;
+    while (winner < 0) {
+        // Первая реплика не ответила - сразу вторая, вне бюджета хеджей
+        if (launched == 1 && attempts[0].finished && replicas.size() > 1) {
+            if (!attempt_succeeded(attempts[0])) {
+                hedge_count(&HedgeStats::failovers);
+                close_attempt(attempts[0]);
+                start_attempt(attempts[1], replicas[1], path);
+                launched = 2;
+                continue;
+            }
+        }
+
+        double now_ms = elapsed_ms(started);
+        if (launched == 1 && !hedge_declined && now_ms >= hedge_after_ms) {
+            if (hedge_budget_allows()) {
+                start_attempt(attempts[1], replicas[1], path);
+                launched = 2;
+                hedged = true;
+            } else {
+                hedge_declined = true;
+            }
+        }
+
+        pollfd pfds[2];
+        int owner[2];
+        int nfds = 0;
+        for (size_t i = 0; i < launched; ++i) {
+            if (attempts[i].finished) {
+                continue;
+            }
+            short events = POLLIN;
+            if (attempts[i].sent < attempts[i].out.size()) {
+                events |= POLLOUT;
+            }
+            pfds[nfds] = {attempts[i].fd, events, 0};
+            owner[nfds++] = i;
+        }
+        if (nfds == 0) {
+            // Все запросы завершились: берем успешный, если есть
+            for (size_t i = 0; i < launched; ++i) {
+                if (attempt_succeeded(attempts[i])) {
+                    winner = i;
+                }
+            }
+            break;
+        }
+
+        int timeout = static_cast<int>(HEDGE_TIMEOUT_MS - now_ms);
+        if (launched == 1 && !hedge_declined) {
+            timeout = std::min(timeout, static_cast<int>(hedge_after_ms - now_ms) + 1);
+        }
+        if (timeout <= 0 || (poll(pfds, nfds, timeout) < 0 && errno != EINTR)) {
+            if (elapsed_ms(started) >= HEDGE_TIMEOUT_MS) {
+                break;
+            }
+            continue;
+        }
+        for (int j = 0; j < nfds; ++j) {
+            if (pfds[j].revents) {
+                advance_attempt(attempts[owner[j]], pfds[j].revents);
+                if (attempt_succeeded(attempts[owner[j]])) {
+                    winner = owner[j];
+                    break;
+                }
+            }
+        }
+    }
+
+    // Отмена проигравшего: соединение закрывается. Его задержка учитывается
+    // как нижняя оценка, чтобы p95 медленного сервера рос
+    for (size_t i = 0; i < launched; ++i) {
+        if (static_cast<int>(i) != winner && attempts[i].fd >= 0) {
+            hedge_record_latency(attempts[i].server_id, elapsed_ms(attempts[i].started));
+        }
+        close_attempt(attempts[i]);
+        // Автомату защиты сообщается итог завершенных запросов; отмененный
+        // запрос итога не имеет и только освобождает пробный слот
+        if (!attempts[i].issued) {
+            continue;
+        }
+        if (attempts[i].finished) {
+            breaker_record(attempts[i].location, attempt_succeeded(attempts[i]), elapsed_ms(attempts[i].started));
+        } else {
+            breaker_cancel(attempts[i].location);
+        }
+    }
+
+    if (winner < 0) {
+        hedge_count(&HedgeStats::failures);
+        return "";
+    }
+    hedge_record_latency(attempts[winner].server_id, elapsed_ms(attempts[winner].started));
+    if (hedged) {
+        hedge_count(winner == 1 ? &HedgeStats::hedge_wins : &HedgeStats::primary_wins);
+    } else {
+        hedge_count(&HedgeStats::primary_wins);
+    }
+    return attempts[winner].in;
+}
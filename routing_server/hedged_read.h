@@ -0,0 +1,44 @@
+#ifndef HEDGED_READ_H
+#define HEDGED_READ_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+struct ServerInfo;
+
+// Счетчики хеджированных чтений
+struct HedgeStats {
+    uint64_t requests = 0;       // Чтения через hedged_get
+    uint64_t hedges_sent = 0;    // Отправленные повторные запросы ко второй реплике
+    uint64_t hedge_wins = 0;     // Ответ второй реплики пришел первым
+    uint64_t primary_wins = 0;   // Ответ первой реплики пришел первым
+    uint64_t budget_denied = 0;  // Хедж не отправлен из-за бюджета
+    uint64_t failovers = 0;      // Первая реплика ответила ошибкой, запрос ушел ко второй
+    uint64_t failures = 0;       // Ни одна реплика не ответила
+    double budget_percent = 0;
+};
+
+// Доля хеджей от числа чтений, которую нельзя превышать (в процентах)
+void hedge_configure(double budget_percent);
+
+// Учет задержки ответа сервера; по последним измерениям считается p95
+void hedge_record_latency(int server_id, double latency_ms);
+
+// Задержка перед хеджем для сервера: наблюдаемый p95 в заданных пределах
+double hedge_delay_ms(int server_id);
+
+// GET-запрос к первой реплике; если ответа нет дольше hedge_delay_ms,
+// а бюджет позволяет, тот же запрос уходит второй реплике. Берется первый
+// полученный ответ, второй запрос отменяется закрытием соединения.
+// Ошибка соединения или 5xx первой реплики сразу переводит запрос на вторую.
+// path - путь с query-параметрами. Возвращает сырой HTTP-ответ или ""
+std::string hedged_get(const std::vector<ServerInfo>& replicas, const std::string& path);
+
+HedgeStats hedge_get_stats();
+
+// p95 по серверам, для которых есть измерения
+std::map<int, double> hedge_delays_snapshot();
+
+#endif // HEDGED_READ_H
@@ -0,0 +1,127 @@
+// Оценка перемещения данных при изменении состава storage-серверов
+// для взвешенного rendezvous-хеширования.
+//
+// Запуск:
+//   ./hrw_movement <серверы> <изменение> [число_ключей]
+//   серверы:   список адрес:вес через запятую, например 1:4,2:4,3:8
+//              или 10.0.0.1:9000:4,10.0.0.2:9000:8 (вес - после последнего ':')
+//   изменение: +адрес:вес (добавление), -адрес (удаление) или =адрес:вес (смена веса)
+// Пример:
+//   ./hrw_movement 1:4,2:4,3:8 +4:8
+// Печатает долю ключей, сменивших владельца, ожидаемую долю и распределение
+// ключей по серверам до и после изменения.
+#include "rendezvous.h"
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static bool parse_node(const std::string& token, HrwNode& node) {
+    size_t colon = token.rfind(':');
+    try {
+        node.location = token.substr(0, colon);
+        node.weight = colon == std::string::npos ? 1.0 : std::stod(token.substr(colon + 1));
+    } catch (...) {
+        return false;
+    }
+    return !node.location.empty();
+}
+
+static std::map<std::string, double> shares(const std::vector<HrwNode>& nodes, const std::vector<int>& owners) {
+    std::map<std::string, double> result;
+    for (int owner : owners) {
+        result[nodes[owner].location] += 1.0 / owners.size();
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Использование: %s адрес:вес,адрес:вес,... (+адрес:вес | -адрес | =адрес:вес) [ключей]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<HrwNode> before;
+    std::stringstream list(argv[1]);
+    std::string token;
+    while (std::getline(list, token, ',')) {
+        HrwNode node;
+        if (!parse_node(token, node)) {
+            fprintf(stderr, "Некорректный сервер: %s\n", token.c_str());
+            return 1;
+        }
+        before.push_back(node);
+    }
+
+    std::string change = argv[2];
+    HrwNode changed;
+    if (change.size() < 2 || !parse_node(change.substr(1), changed)) {
+        fprintf(stderr, "Некорректное изменение: %s\n", change.c_str());
+        return 1;
+    }
+    if (change[0] == '-') {
+        changed.location = change.substr(1);  // Удаление - без веса
+    }
+
+    std::vector<HrwNode> after;
+    double total_before = 0;
+    double changed_weight_before = 0;
+    for (const auto& node : before) {
+        total_before += node.weight;
+        if (node.location == changed.location) {
+            changed_weight_before = node.weight;
+            if (change[0] == '-') {
+                continue;
+            }
+            if (change[0] == '=') {
+                after.push_back(changed);
+                continue;
+            }
+        }
+        after.push_back(node);
+    }
+    if (change[0] == '+') {
+        after.push_back(changed);
+    }
+
+    // Ожидаемая доля перемещаемых ключей - изменение доли веса затронутого сервера
+    double total_after = 0;
+    for (const auto& node : after) {
+        total_after += node.weight;
+    }
+    double changed_weight_after = change[0] == '-' ? 0 : changed.weight;
+    double expected = std::abs(changed_weight_after / total_after - changed_weight_before / total_before);
+
+    int keys_count = argc > 3 ? std::atoi(argv[3]) : 200000;
+    std::vector<int> owners_before;
+    std::vector<int> owners_after;
+    int moved = 0;
+    for (int i = 0; i < keys_count; ++i) {
+        // Ключи в формате тайлов: снимок / спектр / строка / столбец
+        std::string key = tile_placement_key(i / 1000, "B04", (i / 30) % 30, i % 30);
+        int owner_before = hrw_owner(key, before);
+        int owner_after = hrw_owner(key, after);
+        owners_before.push_back(owner_before);
+        owners_after.push_back(owner_after);
+        if (before[owner_before].location != after[owner_after].location) {
+            moved++;
+        }
+    }
+
+    printf("Ключей: %d\n", keys_count);
+    printf("Перемещено: %d (%.2f%%), ожидается %.2f%%\n", moved, 100.0 * moved / keys_count, 100.0 * expected);
+
+    std::map<std::string, double> share_before = shares(before, owners_before);
+    std::map<std::string, double> share_after = shares(after, owners_after);
+    printf("%-20s %12s %12s\n", "сервер", "до, %", "после, %");
+    std::map<std::string, bool> ids;
+    for (const auto& node : before) ids[node.location] = true;
+    for (const auto& node : after) ids[node.location] = true;
+    for (const auto& entry : ids) {
+        printf("%-20s %12.2f %12.2f\n", entry.first.c_str(),
+               100.0 * share_before[entry.first], 100.0 * share_after[entry.first]);
+    }
+    return 0;
+}
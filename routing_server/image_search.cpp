@@ -0,0 +1,196 @@
+#include "image_search.h"
+#include "geohash.h"
+#include "routing_server.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+// Ячеек в покрытии области запроса
+const size_t SEARCH_COVER_CELLS = 64;
+
+std::string normalize_router_address(const std::string& adress) {
+    return adress.find(':') == std::string::npos ? adress + ":8080" : adress;
+}
+
+std::map<std::string, std::vector<std::string>> assign_prefix_owners(
+    const std::vector<std::string>& cells, const std::vector<RoutingServerInfo>& routers,
+    const std::string& self_address) {
+    std::map<std::string, std::set<std::string>> owners;
+    for (const auto& cell : cells) {
+        const RoutingServerInfo* cover = nullptr;
+        for (const auto& router : routers) {
+            if (!geohash_overlaps(cell, router.geohash_prefix)) {
+                continue;
+            }
+            if (router.geohash_prefix.size() > cell.size()) {
+                // Маршрутизатор отвечает за часть ячейки
+                owners[normalize_router_address(router.adress)].insert(router.geohash_prefix);
+            } else if (!cover || router.geohash_prefix.size() > cover->geohash_prefix.size()) {
+                // Список упорядочен по приоритету, при равной длине остается первый
+                cover = &router;
+            }
+        }
+        owners[cover ? normalize_router_address(cover->adress) : self_address].insert(cell);
+    }
+
+    std::map<std::string, std::vector<std::string>> result;
+    for (const auto& entry : owners) {
+        result[entry.first].assign(entry.second.begin(), entry.second.end());
+    }
+    return result;
+}
+
+std::vector<ImageInfo> merge_by_timestamp(const std::vector<std::vector<ImageInfo>>& lists, size_t limit) {
+    // Куча по (timestamp, номер списка): сверху самый новый из текущих голов списков
+    typedef std::pair<size_t, size_t> Cursor;  // список, позиция
+    auto older = [&lists](const Cursor& a, const Cursor& b) {
+        return lists[a.first][a.second].timestamp < lists[b.first][b.second].timestamp;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(older)> heap(older);
+    for (size_t i = 0; i < lists.size(); ++i) {
+        if (!lists[i].empty()) {
+            heap.emplace(i, 0);
+        }
+    }
+
+    std::vector<ImageInfo> merged;
+    std::set<std::string> seen;
+    while (!heap.empty() && merged.size() < limit) {
+        Cursor top = heap.top();
+        heap.pop();
+        const ImageInfo& image = lists[top.first][top.second];
+        if (seen.insert(image.filename + "|" + image.timestamp).second) {
+            merged.push_back(image);
+        }
+        if (top.second + 1 < lists[top.first].size()) {
+            heap.emplace(top.first, top.second + 1);
+        }
+    }
+    return merged;
+}
+
+std::string images_to_json(const std::vector<ImageInfo>& images) {
+    nlohmann::json array = nlohmann::json::array();
+    for (const auto& image : images) {
+        array.push_back({{"image_id", image.image_id}, {"filename", image.filename},
+                         {"timestamp", image.timestamp}, {"source", image.source},
+                         {"geohash", image.geohash}});
+    }
+    return array.dump();
+}
+
+bool parse_images_json(const std::string& json, std::vector<ImageInfo>& images) {
+    try {
+        nlohmann::json data = nlohmann::json::parse(json);
+        for (const auto& item : data.at("images")) {
+            ImageInfo image;
+            image.image_id = item.value("image_id", 0);
+            image.filename = item.at("filename");
+            image.timestamp = item.at("timestamp");
+            image.source = item.value("source", "");
+            image.geohash = item.value("geohash", "");
+            images.push_back(image);
+        }
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+// Общее состояние подзапросов: поток, не успевший к сроку, продолжает
+// работать с ним после возврата из scatter_search_images
+struct ScatterState {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<std::vector<ImageInfo>> results;
+    std::vector<bool> done;
+    std::vector<bool> ok;
+    size_t remaining = 0;
+};
+
+// Подзапрос к маршрутизатору-владельцу
+static bool fetch_router_images(const std::string& address, const std::vector<std::string>& prefixes,
+                                size_t limit, std::vector<ImageInfo>& images) {
+    std::string prefix_list;
+    for (const auto& prefix : prefixes) {
+        if (!prefix_list.empty()) prefix_list += ",";
+        prefix_list += prefix;
+    }
+    std::map<std::string, std::string> params;
+    params["prefixes"] = prefix_list;
+    params["limit"] = std::to_string(limit);
+
+    std::string response = send_request_to_server(address, "GET", "/images/local", "", params, false);
+    size_t body_pos = response.find("\r\n\r\n");
+    if (response.compare(0, 12, "HTTP/1.1 200") != 0 || body_pos == std::string::npos) {
+        return false;
+    }
+    return parse_images_json(response.substr(body_pos + 4), images);
+}
+
+ImageSearchResult scatter_search_images(DBManager& db_manager, double north, double south,
+                                        double east, double west, size_t limit,
+                                        const std::string& self_address, int timeout_ms,
+                                        const std::set<std::string>& dead_routers) {
+    ImageSearchResult result;
+    std::vector<std::string> cells = geohash_cover(north, south, east, west, SEARCH_COVER_CELLS);
+    std::map<std::string, std::vector<std::string>> owners =
+        assign_prefix_owners(cells, db_manager.get_all_routing_servers(), self_address);
+
+    std::vector<std::string> addresses;
+    std::vector<std::string> local_prefixes;
+    for (const auto& entry : owners) {
+        if (entry.first == self_address) {
+            local_prefixes = entry.second;
+        } else if (dead_routers.count(entry.first)) {
+            result.partial = true;
+            result.missing_routers.push_back(entry.first);
+        } else {
+            addresses.push_back(entry.first);
+        }
+    }
+
+    auto state = std::make_shared<ScatterState>();
+    state->results.resize(addresses.size());
+    state->done.assign(addresses.size(), false);
+    state->ok.assign(addresses.size(), false);
+    state->remaining = addresses.size();
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        std::vector<std::string> prefixes = owners[addresses[i]];
+        std::thread([state, i, address = addresses[i], prefixes, limit]() {
+            std::vector<ImageInfo> images;
+            bool ok = fetch_router_images(address, prefixes, limit, images);
+            std::lock_guard<std::mutex> lock(state->mtx);
+            state->results[i].swap(images);
+            state->ok[i] = ok;
+            state->done[i] = true;
+            state->remaining--;
+            state->cv.notify_all();
+        }).detach();
+    }
+
+    // Своя часть ищется, пока идут подзапросы
+    std::vector<std::vector<ImageInfo>> lists;
+    lists.push_back(db_manager.search_images_by_prefixes(local_prefixes, static_cast<int>(limit)));
+
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&state]() { return state->remaining == 0; });
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        if (state->done[i] && state->ok[i]) {
+            lists.push_back(std::move(state->results[i]));
+        } else {
+            result.partial = true;
+            result.missing_routers.push_back(addresses[i]);
+        }
+    }
+    lock.unlock();
+
+    result.images = merge_by_timestamp(lists, limit);
+    return result;
+}
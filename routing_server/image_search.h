@@ -0,0 +1,47 @@
+#ifndef IMAGE_SEARCH_H
+#define IMAGE_SEARCH_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "db_manager.h"
+
+// Результат распределенного поиска снимков
+struct ImageSearchResult {
+    std::vector<ImageInfo> images;               // От новых к старым, не больше limit
+    bool partial = false;                        // Ответили не все маршрутизаторы
+    std::vector<std::string> missing_routers;    // Кто не ответил вовремя
+};
+
+// Адрес маршрутизатора в виде "ip:port" (порт по умолчанию 8080)
+std::string normalize_router_address(const std::string& adress);
+
+// Распределение ячеек покрытия по владельцам: для каждой ячейки - маршрутизатор
+// с самым длинным geohash_prefix, который является началом ячейки, и маршрутизаторы
+// с более длинными префиксами внутри ячейки (им уходит их собственный префикс).
+// Ячейки без владельца остаются за self_address. Результат: адрес -> префиксы запроса
+std::map<std::string, std::vector<std::string>> assign_prefix_owners(
+    const std::vector<std::string>& cells, const std::vector<RoutingServerInfo>& routers,
+    const std::string& self_address);
+
+// Слияние списков, упорядоченных по timestamp (от новых к старым), с ограничением limit.
+// Снимок, пришедший от нескольких маршрутизаторов, попадает в результат один раз
+std::vector<ImageInfo> merge_by_timestamp(const std::vector<std::vector<ImageInfo>>& lists, size_t limit);
+
+// Поиск снимков в прямоугольнике по всем маршрутизаторам-владельцам: подзапросы
+// GET /images/local уходят параллельно, собственная часть ищется в локальной БД.
+// Маршрутизаторы, не ответившие за timeout_ms, перечисляются в missing_routers;
+// туда же сразу, без подзапроса, попадают адреса из dead_routers
+ImageSearchResult scatter_search_images(DBManager& db_manager, double north, double south,
+                                        double east, double west, size_t limit,
+                                        const std::string& self_address, int timeout_ms,
+                                        const std::set<std::string>& dead_routers = {});
+
+// JSON-массив снимков для ответа
+std::string images_to_json(const std::vector<ImageInfo>& images);
+
+// Разбор ответа /images/local
+bool parse_images_json(const std::string& json, std::vector<ImageInfo>& images);
+
+#endif // IMAGE_SEARCH_H
@@ -0,0 +1,40 @@
+#include "live_view.h"
+
+// Период по умолчанию, если сервер не сообщил свой
+const int LIVE_DEFAULT_INTERVAL_MS = 5000;
+
+static std::mutex g_live_view_mtx;
+static std::map<std::string, LiveServerStats> g_live_view;
+
+void live_view_update(const LiveServerStats& stats) {
+    std::lock_guard<std::mutex> lock(g_live_view_mtx);
+    LiveServerStats& entry = g_live_view[stats.location];
+    entry = stats;
+    entry.last_seen = std::chrono::steady_clock::now();
+}
+
+live_state_t live_view_lookup(const std::string& location, LiveServerStats& stats) {
+    std::lock_guard<std::mutex> lock(g_live_view_mtx);
+    auto it = g_live_view.find(location);
+    if (it == g_live_view.end()) {
+        return LIVE_UNKNOWN;
+    }
+    stats = it->second;
+
+    int interval_ms = stats.interval_ms > 0 ? stats.interval_ms : LIVE_DEFAULT_INTERVAL_MS;
+    auto age = std::chrono::steady_clock::now() - stats.last_seen;
+    if (age > std::chrono::milliseconds(interval_ms * LIVE_MISSED_HEARTBEATS)) {
+        return LIVE_STALE;
+    }
+    return LIVE_FRESH;
+}
+
+void live_view_remove(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_live_view_mtx);
+    g_live_view.erase(location);
+}
+
+std::map<std::string, LiveServerStats> live_view_snapshot() {
+    std::lock_guard<std::mutex> lock(g_live_view_mtx);
+    return g_live_view;
+}
@@ -0,0 +1,46 @@
+#ifndef LIVE_VIEW_H
+#define LIVE_VIEW_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Актуальное состояние storage-сервера по последнему heartbeat. Сервер
+// обозначается location из таблицы Servers: server_id у маршрутизаторов разный
+struct LiveServerStats {
+    std::string location;  // "ip:port"
+    uint64_t ssd_free_bytes = 0;
+    uint64_t ssd_total_bytes = 0;
+    uint64_t hdd_free_bytes = 0;
+    uint64_t hdd_total_bytes = 0;
+    size_t queue_depth = 0;
+    double latency_ms = 0;
+    int interval_ms = 0;  // Период heartbeat, объявленный сервером
+    std::chrono::steady_clock::time_point last_seen;
+};
+
+// Состояние сервера в живом представлении
+typedef enum {
+    LIVE_UNKNOWN,  // Heartbeat еще не приходил, используются данные БД
+    LIVE_FRESH,
+    LIVE_STALE     // Пропущено несколько heartbeat подряд
+} live_state_t;
+
+// Сколько периодов heartbeat можно пропустить, прежде чем сервер станет устаревшим
+const int LIVE_MISSED_HEARTBEATS = 3;
+
+// Обновить состояние по пришедшему heartbeat
+void live_view_update(const LiveServerStats& stats);
+
+// Получить состояние сервера; stats заполняется для FRESH и STALE
+live_state_t live_view_lookup(const std::string& location, LiveServerStats& stats);
+
+// Забыть сервер (при /server/remove)
+void live_view_remove(const std::string& location);
+
+// Все известные серверы (для метрик)
+std::map<std::string, LiveServerStats> live_view_snapshot();
+
+#endif // LIVE_VIEW_H
@@ -0,0 +1,264 @@
+#include "load_view.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "live_view.h"
+#include "placement.h"
+
+struct LoadEntry {
+    LoadSummary summary;
+    std::chrono::steady_clock::time_point received;
+};
+
+static std::mutex g_load_view_mtx;
+static std::map<std::pair<std::string, std::string>, LoadEntry> g_load_view;
+static std::string g_self_address;
+static int g_stale_ms = 5000;
+static size_t g_max_entries = 256;
+
+void load_view_configure(const std::string& self_address, int stale_ms, size_t max_entries) {
+    std::lock_guard<std::mutex> lock(g_load_view_mtx);
+    g_self_address = self_address;
+    g_stale_ms = stale_ms;
+    g_max_entries = std::max<size_t>(1, max_entries);
+}
+
+static uint32_t elapsed_ms(std::chrono::steady_clock::time_point since, std::chrono::steady_clock::time_point now) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - since).count();
+    return static_cast<uint32_t>(std::min<long long>(std::max<long long>(ms, 0), UINT32_MAX - 1));
+}
+
+// Возраст сводки с учетом времени, прошедшего после ее получения
+static uint32_t effective_age(const LoadEntry& entry, std::chrono::steady_clock::time_point now) {
+    uint64_t age = static_cast<uint64_t>(entry.summary.age_ms) + elapsed_ms(entry.received, now);
+    return static_cast<uint32_t>(std::min<uint64_t>(age, UINT32_MAX - 1));
+}
+
+// Удаление устаревших сводок (под g_load_view_mtx)
+static void expire_entries(std::chrono::steady_clock::time_point now) {
+    for (auto it = g_load_view.begin(); it != g_load_view.end();) {
+        if (effective_age(it->second, now) > static_cast<uint32_t>(g_stale_ms)) {
+            it = g_load_view.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Задержки округляются до 0.1 мс: точнее для выбора сервера не нужно
+static double round_ms(double value) {
+    return std::round(value * 10) / 10;
+}
+
+static nlohmann::json summary_json(const LoadSummary& summary) {
+    return nlohmann::json::array({summary.location, summary.origin, summary.in_flight, summary.queue_depth,
+                                  round_ms(summary.p50_ms), round_ms(summary.p99_ms), summary.ssd_free_bytes,
+                                  summary.hdd_free_bytes, summary.age_ms,
+                                  summary.heartbeat_age_ms == UINT32_MAX ? -1 : (long long)summary.heartbeat_age_ms});
+}
+
+// Свои сводки: серверы, к которым были запросы, и серверы с heartbeat
+static std::vector<LoadSummary> own_summaries(const std::string& self_address) {
+    auto now = std::chrono::steady_clock::now();
+    std::map<std::string, LiveServerStats> live = live_view_snapshot();
+    std::set<std::string> servers;
+    for (const auto& location : placement_servers()) {
+        servers.insert(location);
+    }
+    for (const auto& entry : live) {
+        servers.insert(entry.first);
+    }
+
+    std::vector<LoadSummary> summaries;
+    for (const auto& location : servers) {
+        LoadSummary summary;
+        summary.location = location;
+        summary.origin = self_address;
+        summary.in_flight = placement_in_flight(location);
+        placement_latency_quantiles(location, summary.p50_ms, summary.p99_ms);
+        auto it = live.find(location);
+        if (it != live.end()) {
+            summary.queue_depth = it->second.queue_depth;
+            summary.ssd_free_bytes = it->second.ssd_free_bytes;
+            summary.hdd_free_bytes = it->second.hdd_free_bytes;
+            summary.heartbeat_age_ms = elapsed_ms(it->second.last_seen, now);
+        }
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
+
+std::string load_view_piggyback() {
+    std::string self_address;
+    size_t max_entries;
+    {
+        std::lock_guard<std::mutex> lock(g_load_view_mtx);
+        self_address = g_self_address;
+        max_entries = g_max_entries;
+    }
+    nlohmann::json servers = nlohmann::json::array();
+    for (const auto& summary : own_summaries(self_address)) {
+        if (servers.size() >= max_entries) {
+            break;
+        }
+        servers.push_back(summary_json(summary));
+    }
+
+    // Чужие сводки пересылаются дальше, самые свежие первыми
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(g_load_view_mtx);
+    expire_entries(now);
+    std::vector<std::pair<uint32_t, const LoadEntry*>> others;
+    for (const auto& entry : g_load_view) {
+        others.emplace_back(effective_age(entry.second, now), &entry.second);
+    }
+    std::sort(others.begin(), others.end(),
+              [](const std::pair<uint32_t, const LoadEntry*>& a, const std::pair<uint32_t, const LoadEntry*>& b) {
+                  return a.first < b.first;
+              });
+    for (const auto& other : others) {
+        if (servers.size() >= max_entries) {
+            break;
+        }
+        LoadSummary summary = other.second->summary;
+        summary.age_ms = other.first;
+        servers.push_back(summary_json(summary));
+    }
+    nlohmann::json json_data;
+    json_data["servers"] = servers;
+    return json_data.dump();
+}
+
+bool load_view_merge(const std::string& json) {
+    nlohmann::json json_data;
+    std::vector<LoadSummary> summaries;
+    try {
+        json_data = nlohmann::json::parse(json);
+        for (const auto& item : json_data.at("servers")) {
+            LoadSummary summary;
+            summary.location = item.at(0).get<std::string>();
+            summary.origin = item.at(1).get<std::string>();
+            summary.in_flight = item.at(2).get<size_t>();
+            summary.queue_depth = item.at(3).get<size_t>();
+            summary.p50_ms = item.at(4).get<double>();
+            summary.p99_ms = item.at(5).get<double>();
+            summary.ssd_free_bytes = item.at(6).get<uint64_t>();
+            summary.hdd_free_bytes = item.at(7).get<uint64_t>();
+            summary.age_ms = item.at(8).get<uint32_t>();
+            long long heartbeat_age = item.at(9).get<long long>();
+            summary.heartbeat_age_ms = heartbeat_age < 0 ? UINT32_MAX : static_cast<uint32_t>(heartbeat_age);
+            summaries.push_back(summary);
+        }
+    } catch (...) {
+        return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(g_load_view_mtx);
+    for (const auto& summary : summaries) {
+        // Свои сводки маршрутизатор знает точнее, чем их пересказ
+        if (summary.origin == g_self_address || summary.age_ms > static_cast<uint32_t>(g_stale_ms)) {
+            continue;
+        }
+        auto key = std::make_pair(summary.location, summary.origin);
+        auto it = g_load_view.find(key);
+        if (it != g_load_view.end() && effective_age(it->second, now) <= summary.age_ms) {
+            continue;
+        }
+        LoadEntry& entry = g_load_view[key];
+        entry.summary = summary;
+        entry.received = now;
+    }
+    return true;
+}
+
+bool load_view_lookup(const std::string& location, LoadAggregate& aggregate) {
+    aggregate = LoadAggregate();
+    auto now = std::chrono::steady_clock::now();
+    uint32_t stale_ms;
+    std::vector<std::pair<uint32_t, LoadSummary>> fresh;
+    {
+        std::lock_guard<std::mutex> lock(g_load_view_mtx);
+        stale_ms = static_cast<uint32_t>(g_stale_ms);
+        auto it = g_load_view.lower_bound(std::make_pair(location, std::string()));
+        for (; it != g_load_view.end() && it->first.first == location; ++it) {
+            uint32_t age = effective_age(it->second, now);
+            if (age <= stale_ms) {
+                fresh.emplace_back(age, it->second.summary);
+            }
+        }
+    }
+    if (fresh.empty()) {
+        return false;
+    }
+
+    size_t with_latency = 0;
+    uint64_t freshest_heartbeat = UINT64_MAX;
+    for (const auto& item : fresh) {
+        const LoadSummary& summary = item.second;
+        aggregate.in_flight += summary.in_flight;
+        aggregate.age_ms = std::max(aggregate.age_ms, item.first);
+        if (summary.p99_ms > 0) {
+            aggregate.p50_ms += summary.p50_ms;
+            aggregate.p99_ms = std::max(aggregate.p99_ms, summary.p99_ms);
+            with_latency++;
+        }
+        if (summary.heartbeat_age_ms != UINT32_MAX) {
+            uint64_t heartbeat_age = static_cast<uint64_t>(summary.heartbeat_age_ms) + item.first;
+            if (heartbeat_age <= stale_ms && heartbeat_age < freshest_heartbeat) {
+                freshest_heartbeat = heartbeat_age;
+                aggregate.has_heartbeat = true;
+                aggregate.queue_depth = summary.queue_depth;
+                aggregate.ssd_free_bytes = summary.ssd_free_bytes;
+                aggregate.hdd_free_bytes = summary.hdd_free_bytes;
+            }
+        }
+    }
+    if (with_latency > 0) {
+        aggregate.p50_ms /= with_latency;
+        aggregate.has_latency = true;
+    }
+    aggregate.reporters = fresh.size();
+    return true;
+}
+
+std::string load_view_json() {
+    auto now = std::chrono::steady_clock::now();
+    std::set<std::string> servers;
+    {
+        std::lock_guard<std::mutex> lock(g_load_view_mtx);
+        expire_entries(now);
+        for (const auto& entry : g_load_view) {
+            servers.insert(entry.first.first);
+        }
+    }
+
+    nlohmann::json json_data = nlohmann::json::array();
+    for (const auto& location : servers) {
+        LoadAggregate aggregate;
+        if (!load_view_lookup(location, aggregate)) {
+            continue;
+        }
+        nlohmann::json server;
+        server["location"] = location;
+        server["in_flight"] = aggregate.in_flight + placement_in_flight(location);
+        server["reporters"] = aggregate.reporters;
+        server["age_ms"] = aggregate.age_ms;
+        if (aggregate.has_latency) {
+            server["p50_ms"] = round_ms(aggregate.p50_ms);
+            server["p99_ms"] = round_ms(aggregate.p99_ms);
+        }
+        if (aggregate.has_heartbeat) {
+            server["queue_depth"] = aggregate.queue_depth;
+            server["ssd_free_bytes"] = aggregate.ssd_free_bytes;
+            server["hdd_free_bytes"] = aggregate.hdd_free_bytes;
+        }
+        json_data.push_back(server);
+    }
+    return json_data.dump();
+}
@@ -0,0 +1,63 @@
+#ifndef LOAD_VIEW_H
+#define LOAD_VIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Нагрузка storage-серверов глазами всего кластера. Каждый маршрутизатор
+// знает только свои запросы в полете и задержки (placement.h) и heartbeat
+// тех серверов, что шлют их ему (live_view.h). Краткие сводки этих данных
+// уходят попутно с пакетами gossip (gossip_set_piggyback) и собираются здесь:
+// по одной записи на пару (сервер, маршрутизатор-источник) с возрастом.
+// Сервер обозначается location из таблицы Servers: server_id у каждого
+// маршрутизатора свой (SERIAL), а адрес сервера одинаков на всех.
+// Возраст растет и при пересылке, поэтому устаревшие сводки отбрасываются,
+// сколько бы раз их ни пересылали
+
+// Сводка одного маршрутизатора о сервере
+struct LoadSummary {
+    std::string location;          // Сервер, "ip:port"
+    std::string origin;            // Маршрутизатор, измеривший нагрузку
+    size_t in_flight = 0;          // Его запросы к серверу в полете
+    size_t queue_depth = 0;        // Очередь сервера по heartbeat
+    double p50_ms = 0;             // Задержки его запросов к серверу
+    double p99_ms = 0;
+    uint64_t ssd_free_bytes = 0;   // По heartbeat
+    uint64_t hdd_free_bytes = 0;
+    uint32_t age_ms = 0;           // Сколько прошло с измерения
+    uint32_t heartbeat_age_ms = UINT32_MAX;  // Возраст heartbeat на момент измерения; UINT32_MAX - не было
+};
+
+// Сводка по всем маршрутизаторам, кроме этого
+struct LoadAggregate {
+    size_t in_flight = 0;          // Сумма запросов в полете
+    double p50_ms = 0;             // Среднее p50
+    double p99_ms = 0;             // Наибольшее p99
+    bool has_latency = false;
+    bool has_heartbeat = false;    // queue_depth и свободное место - по самому свежему heartbeat
+    size_t queue_depth = 0;
+    uint64_t ssd_free_bytes = 0;
+    uint64_t hdd_free_bytes = 0;
+    uint32_t age_ms = 0;           // Возраст самой старой из учтенных сводок
+    size_t reporters = 0;
+};
+
+// self_address - источник своих сводок; сводки старше stale_ms не учитываются
+// и не пересылаются; в одном пакете не больше max_entries сводок
+void load_view_configure(const std::string& self_address, int stale_ms, size_t max_entries);
+
+// Попутные данные пакета gossip: свои сводки, затем самые свежие чужие
+std::string load_view_piggyback();
+
+// Слияние попутных данных: запись заменяется более свежей. false - неверное тело
+bool load_view_merge(const std::string& json);
+
+// false - свежих сводок о сервере нет
+bool load_view_lookup(const std::string& location, LoadAggregate& aggregate);
+
+// GET /cluster/load: сводка по каждому серверу, in_flight - вместе со своими запросами
+std::string load_view_json();
+
+#endif // LOAD_VIEW_H
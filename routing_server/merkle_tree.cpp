@@ -0,0 +1,346 @@
+#include "merkle_tree.h"
+#include <algorithm>
+#include <nlohmann/json.hpp>
+
+// Запросов за раз: корзин в /sync/bucket и строк в /sync/rows и /sync/apply
+const size_t SYNC_BUCKETS_PER_REQUEST = 256;
+const size_t SYNC_ROWS_PER_REQUEST = 500;
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// FNV-1a по полям, разделенным нулевым байтом
+static uint64_t fields_hash(const std::vector<std::string>& fields) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const auto& field : fields) {
+        for (unsigned char c : field) {
+            h = (h ^ c) * 0x100000001b3ULL;
+        }
+        h = (h ^ 0) * 0x100000001b3ULL;
+    }
+    return mix64(h);
+}
+
+static std::string pad_bucket(std::string bucket) {
+    bucket.resize(MERKLE_BUCKET_DEPTH, '_');
+    return bucket;
+}
+
+CatalogRow catalog_image_row(const ImageInfo& image) {
+    CatalogRow row;
+    row.key = "image/" + image.filename + "/" + image.timestamp;
+    row.bucket = pad_bucket(image.geohash.substr(0, MERKLE_BUCKET_DEPTH));
+    // id входит в отпечаток: тот же снимок под разными id - конфликт, а не совпадение
+    row.digest = fields_hash({std::to_string(image.image_id), image.filename, image.source, image.timestamp,
+                              image.geohash});
+    nlohmann::json json_row;
+    json_row["table"] = "images";
+    json_row["image_id"] = image.image_id;
+    json_row["filename"] = image.filename;
+    json_row["source"] = image.source;
+    json_row["timestamp"] = image.timestamp;
+    json_row["geohash"] = image.geohash;
+    row.json = json_row.dump();
+    return row;
+}
+
+CatalogRow catalog_server_row(const ServerInfo& server) {
+    static const char HEX[] = "0123456789abcdef";
+    CatalogRow row;
+    row.key = "server/" + server.location;
+    row.bucket = pad_bucket(std::string("~") + HEX[fields_hash({server.location}) & 15]);
+    row.digest = fields_hash({std::to_string(server.server_id), server.location, server.class_type,
+                              std::to_string(server.ssd_volume), std::to_string(server.hdd_volume)});
+    nlohmann::json json_row;
+    json_row["table"] = "servers";
+    json_row["server_id"] = server.server_id;
+    json_row["location"] = server.location;
+    json_row["class"] = server.class_type;
+    json_row["ssd_volume"] = server.ssd_volume;
+    json_row["hdd_volume"] = server.hdd_volume;
+    json_row["ssd_fullness"] = server.ssd_fullness;
+    json_row["hdd_fullness"] = server.hdd_fullness;
+    row.json = json_row.dump();
+    return row;
+}
+
+MerkleTree::MerkleTree(const std::vector<CatalogRow>& catalog) {
+    for (const auto& row : catalog) {
+        if (rows.emplace(row.key, row).second) {
+            buckets[row.bucket][row.key] = row.digest;
+        }
+    }
+
+    // Листья - корзины, хеш по ключам и хешам строк в порядке ключей
+    std::map<std::string, MerkleNode> level;
+    for (const auto& bucket : buckets) {
+        uint64_t h = mix64(bucket.second.size());
+        for (const auto& entry : bucket.second) {
+            h = mix64(h ^ fields_hash({entry.first}));
+            h = mix64(h ^ entry.second);
+        }
+        level[bucket.first].hash = h;
+    }
+    // Внутренние узлы - по хешам детей, уровень за уровнем до корня
+    for (size_t depth = MERKLE_BUCKET_DEPTH; depth > 0; --depth) {
+        std::map<std::string, MerkleNode> parents;
+        for (const auto& entry : level) {
+            parents[entry.first.substr(0, depth - 1)].children[entry.first.back()] = entry.second.hash;
+        }
+        for (auto& entry : parents) {
+            uint64_t h = mix64(depth);
+            for (const auto& child : entry.second.children) {
+                h = mix64(h ^ static_cast<unsigned char>(child.first));
+                h = mix64(h ^ child.second);
+            }
+            entry.second.hash = h;
+        }
+        nodes.insert(level.begin(), level.end());
+        level.swap(parents);
+    }
+    nodes.insert(level.begin(), level.end());
+}
+
+uint64_t MerkleTree::root() const {
+    auto it = nodes.find("");
+    return it != nodes.end() ? it->second.hash : 0;
+}
+
+bool MerkleTree::node(const std::string& path, MerkleNode& out) const {
+    auto it = nodes.find(path);
+    if (it == nodes.end()) {
+        // Пустой каталог - пустой корень, а не отсутствие дерева
+        out = MerkleNode();
+        return path.empty();
+    }
+    out = it->second;
+    return true;
+}
+
+const std::map<std::string, uint64_t>* MerkleTree::bucket(const std::string& name) const {
+    auto it = buckets.find(name);
+    return it != buckets.end() ? &it->second : nullptr;
+}
+
+const CatalogRow* MerkleTree::row(const std::string& key) const {
+    auto it = rows.find(key);
+    return it != rows.end() ? &it->second : nullptr;
+}
+
+std::vector<std::string> MerkleTree::buckets_under(const std::string& path) const {
+    std::vector<std::string> result;
+    for (auto it = buckets.lower_bound(path); it != buckets.end() && it->first.compare(0, path.size(), path) == 0;
+         ++it) {
+        result.push_back(it->first);
+    }
+    return result;
+}
+
+bool merkle_serve(const MerkleTree& tree, const std::string& path, const std::string& body,
+                  std::string& response) {
+    try {
+        nlohmann::json request = nlohmann::json::parse(body);
+        if (path == "/sync/tree") {
+            nlohmann::json nodes = nlohmann::json::object();
+            for (const auto& item : request.at("paths")) {
+                std::string node_path = item.get<std::string>();
+                MerkleNode node;
+                if (!tree.node(node_path, node)) {
+                    continue;
+                }
+                nlohmann::json children = nlohmann::json::object();
+                for (const auto& child : node.children) {
+                    children[std::string(1, child.first)] = child.second;
+                }
+                nodes[node_path] = {{"hash", node.hash}, {"children", children}};
+            }
+            response = nlohmann::json({{"nodes", nodes}}).dump();
+            return true;
+        }
+        if (path == "/sync/bucket") {
+            nlohmann::json buckets = nlohmann::json::object();
+            for (const auto& item : request.at("buckets")) {
+                std::string name = item.get<std::string>();
+                const std::map<std::string, uint64_t>* bucket = tree.bucket(name);
+                if (bucket) {
+                    buckets[name] = *bucket;
+                }
+            }
+            response = nlohmann::json({{"buckets", buckets}}).dump();
+            return true;
+        }
+        if (path == "/sync/rows") {
+            response = "{\"rows\":[";
+            bool first = true;
+            for (const auto& item : request.at("keys")) {
+                const CatalogRow* row = tree.row(item.get<std::string>());
+                if (row) {
+                    response += (first ? "" : ",") + row->json;
+                    first = false;
+                }
+            }
+            response += "]}";
+            return true;
+        }
+    } catch (...) {
+    }
+    return false;
+}
+
+// Ключи всех строк под префиксом - другой стороне их отправляют без спуска
+static void collect_keys(const MerkleTree& tree, const std::string& path, std::vector<std::string>& keys) {
+    for (const auto& name : tree.buckets_under(path)) {
+        for (const auto& entry : *tree.bucket(name)) {
+            keys.push_back(entry.first);
+        }
+    }
+}
+
+AntiEntropyRound merkle_sync(const MerkleTree& local, const SyncTransport& transport,
+                             std::vector<std::string>& pulled) {
+    AntiEntropyRound round;
+    auto exchange = [&](const std::string& path, const std::string& body, nlohmann::json& reply) {
+        std::string response;
+        round.requests++;
+        round.bytes += body.size();
+        if (!transport(path, body, response)) {
+            return false;
+        }
+        round.bytes += response.size();
+        try {
+            reply = nlohmann::json::parse(response);
+        } catch (...) {
+            return false;
+        }
+        return reply.is_object();
+    };
+
+    // Спуск по дереву: за запрос - весь уровень различающихся узлов
+    std::vector<std::string> level = {""};
+    std::vector<std::string> differing;
+    std::vector<std::string> push_keys;
+    try {
+        while (!level.empty()) {
+            nlohmann::json reply;
+            if (!exchange("/sync/tree", nlohmann::json({{"paths", level}}).dump(), reply)) {
+                return round;
+            }
+            const nlohmann::json& remote_nodes = reply.at("nodes");
+            std::vector<std::string> next;
+            for (const auto& path : level) {
+                round.nodes_compared++;
+                MerkleNode mine;
+                bool have = local.node(path, mine);
+                auto remote = remote_nodes.find(path);
+                if (remote == remote_nodes.end()) {
+                    if (have) {
+                        collect_keys(local, path, push_keys);
+                    }
+                    continue;
+                }
+                if (have && mine.hash == remote->at("hash").get<uint64_t>()) {
+                    continue;
+                }
+                if (path.size() == MERKLE_BUCKET_DEPTH) {
+                    differing.push_back(path);
+                    continue;
+                }
+                std::map<char, uint64_t> remote_children;
+                for (const auto& child : remote->at("children").items()) {
+                    if (child.key().size() == 1) {
+                        remote_children[child.key()[0]] = child.value().get<uint64_t>();
+                    }
+                }
+                for (const auto& child : mine.children) {
+                    auto other = remote_children.find(child.first);
+                    if (other == remote_children.end()) {
+                        collect_keys(local, path + child.first, push_keys);
+                    } else if (other->second != child.second) {
+                        next.push_back(path + child.first);
+                    }
+                }
+                for (const auto& child : remote_children) {
+                    if (!mine.children.count(child.first)) {
+                        next.push_back(path + child.first);
+                    }
+                }
+            }
+            level.swap(next);
+        }
+        round.buckets_differing = differing.size();
+
+        // Различающиеся корзины: сравнение ключей и хешей строк
+        std::vector<std::string> pull_keys;
+        for (size_t start = 0; start < differing.size(); start += SYNC_BUCKETS_PER_REQUEST) {
+            std::vector<std::string> chunk(differing.begin() + start,
+                differing.begin() + std::min(differing.size(), start + SYNC_BUCKETS_PER_REQUEST));
+            nlohmann::json reply;
+            if (!exchange("/sync/bucket", nlohmann::json({{"buckets", chunk}}).dump(), reply)) {
+                return round;
+            }
+            const nlohmann::json& remote_buckets = reply.at("buckets");
+            for (const auto& name : chunk) {
+                std::map<std::string, uint64_t> remote;
+                auto found = remote_buckets.find(name);
+                if (found != remote_buckets.end()) {
+                    remote = found->get<std::map<std::string, uint64_t>>();
+                }
+                const std::map<std::string, uint64_t>* mine = local.bucket(name);
+                static const std::map<std::string, uint64_t> empty;
+                if (!mine) {
+                    mine = &empty;
+                }
+                for (const auto& entry : remote) {
+                    auto own = mine->find(entry.first);
+                    if (own == mine->end()) {
+                        pull_keys.push_back(entry.first);
+                    } else if (own->second != entry.second) {
+                        round.conflicts++;
+                    }
+                }
+                for (const auto& entry : *mine) {
+                    if (!remote.count(entry.first)) {
+                        push_keys.push_back(entry.first);
+                    }
+                }
+            }
+        }
+
+        for (size_t start = 0; start < pull_keys.size(); start += SYNC_ROWS_PER_REQUEST) {
+            std::vector<std::string> chunk(pull_keys.begin() + start,
+                pull_keys.begin() + std::min(pull_keys.size(), start + SYNC_ROWS_PER_REQUEST));
+            nlohmann::json reply;
+            if (!exchange("/sync/rows", nlohmann::json({{"keys", chunk}}).dump(), reply)) {
+                return round;
+            }
+            for (const auto& row : reply.at("rows")) {
+                pulled.push_back(row.dump());
+                round.rows_pulled++;
+            }
+        }
+
+        for (size_t start = 0; start < push_keys.size(); start += SYNC_ROWS_PER_REQUEST) {
+            std::string body = "{\"rows\":[";
+            size_t end = std::min(push_keys.size(), start + SYNC_ROWS_PER_REQUEST);
+            for (size_t i = start; i < end; ++i) {
+                body += (i > start ? "," : "") + local.row(push_keys[i])->json;
+            }
+            body += "]}";
+            nlohmann::json reply;
+            if (!exchange("/sync/apply", body, reply)) {
+                return round;
+            }
+            round.rows_pushed += end - start;
+        }
+    } catch (...) {
+        return round;
+    }
+    round.ok = true;
+    return round;
+}
@@ -0,0 +1,95 @@
+#ifndef MERKLE_TREE_H
+#define MERKLE_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "db_manager.h"
+
+// Сверка каталогов маршрутизаторов (anti-entropy). Строки Images и Servers
+// раскладываются по корзинам - префиксам geohash длины MERKLE_BUCKET_DEPTH,
+// над корзинами строится дерево Меркла по символам префикса. Маршрутизаторы
+// сравнивают хеши сверху вниз, спускаются только в различающиеся поддеревья
+// и передают только недостающие строки, так что объем обмена пропорционален
+// расхождению, а не размеру каталога. Строки сопоставляются по естественному
+// ключу, но image_id и server_id передаются вместе со строкой и входят в хеш:
+// на них ссылаются тайлы, счетчики и рассылки, поэтому id строки на всех
+// маршрутизаторах один и тот же
+
+// Длина префикса корзины; короткие geohash дополняются '_'
+const size_t MERKLE_BUCKET_DEPTH = 3;
+
+// Строка каталога для сверки
+struct CatalogRow {
+    std::string key;     // "image/<filename>/<timestamp>" или "server/<location>"
+    std::string bucket;  // Префикс geohash снимка; у серверов "~" и символ хеша location
+    uint64_t digest;     // Хеш сверяемых полей
+    std::string json;    // Строка в виде JSON-объекта для передачи
+};
+
+CatalogRow catalog_image_row(const ImageInfo& image);
+
+// Заполненность дисков меняется постоянно и в хеш сервера не входит
+CatalogRow catalog_server_row(const ServerInfo& server);
+
+// Узел дерева: его хеш и хеши детей по следующему символу префикса
+struct MerkleNode {
+    uint64_t hash = 0;
+    std::map<char, uint64_t> children;
+};
+
+class MerkleTree {
+public:
+    explicit MerkleTree(const std::vector<CatalogRow>& rows);
+
+    uint64_t root() const;
+    size_t size() const { return rows.size(); }
+
+    // Узел по префиксу ("" - корень); false, если под префиксом нет строк
+    bool node(const std::string& path, MerkleNode& out) const;
+
+    // Ключи и хеши строк корзины; nullptr для пустой корзины
+    const std::map<std::string, uint64_t>* bucket(const std::string& name) const;
+
+    const CatalogRow* row(const std::string& key) const;
+
+    // Ключи корзин под префиксом
+    std::vector<std::string> buckets_under(const std::string& path) const;
+
+private:
+    std::map<std::string, MerkleNode> nodes;
+    std::map<std::string, std::map<std::string, uint64_t>> buckets;
+    std::map<std::string, CatalogRow> rows;
+};
+
+// Обмен с другим маршрутизатором: POST path с телом body, в response - тело ответа
+typedef std::function<bool(const std::string& path, const std::string& body, std::string& response)> SyncTransport;
+
+// Ответ на запрос сверки к дереву: /sync/tree, /sync/bucket, /sync/rows.
+// false - неизвестный путь или неверное тело
+bool merkle_serve(const MerkleTree& tree, const std::string& path, const std::string& body,
+                  std::string& response);
+
+// Итог одного раунда сверки
+struct AntiEntropyRound {
+    std::string peer;
+    bool ok = false;
+    size_t requests = 0;
+    size_t nodes_compared = 0;
+    size_t buckets_differing = 0;
+    size_t rows_pulled = 0;
+    size_t rows_pushed = 0;
+    size_t conflicts = 0;  // Ключ есть у обоих, но содержимое разное
+    size_t bytes = 0;      // Тела запросов и ответов
+};
+
+// Сверка local с деревом на другой стороне transport. Строки, которых нет
+// у другой стороны, отправляются ей через /sync/apply; полученные строки,
+// которых нет локально, возвращаются в pulled для вставки
+AntiEntropyRound merkle_sync(const MerkleTree& local, const SyncTransport& transport,
+                             std::vector<std::string>& pulled);
+
+#endif // MERKLE_TREE_H
@@ -0,0 +1,137 @@
+#include "placement.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+// Вес нового измерения в скользящем среднем задержки
+const double PLACEMENT_LATENCY_ALPHA = 0.2;
+// Нижняя граница задержки, чтобы пустой сервер без истории не имел нулевой оценки
+const double PLACEMENT_MIN_LATENCY_MS = 1.0;
+// Последних задержек на сервер для p50/p99
+const size_t PLACEMENT_LATENCY_SAMPLES = 128;
+
+struct ServerLoad {
+    size_t in_flight = 0;
+    double latency_ms = 0;
+    std::vector<double> samples;  // Кольцевой буфер последних задержек
+    size_t next_sample = 0;
+};
+
+static std::mutex g_placement_mtx;
+static std::map<std::string, ServerLoad> g_placement_load;
+
+double placement_load(const PlacementCandidate& candidate) {
+    double latency = std::max(candidate.latency_ms, PLACEMENT_MIN_LATENCY_MS);
+    return (candidate.in_flight + candidate.queue_depth + 1) * latency;
+}
+
+// Выбор индекса с вероятностью, пропорциональной свободному месту;
+// exclude - уже выбранный индекс
+static int weighted_pick(const std::vector<PlacementCandidate>& candidates,
+                         const std::vector<int>& eligible, double total_weight, int exclude,
+                         std::mt19937_64& rng) {
+    if (exclude >= 0) {
+        total_weight -= candidates[exclude].free_bytes;
+    }
+    if (total_weight <= 0) {
+        return -1;
+    }
+    std::uniform_real_distribution<double> uniform(0, total_weight);
+    double point = uniform(rng);
+    int last = -1;
+    for (int idx : eligible) {
+        if (idx == exclude) {
+            continue;
+        }
+        last = idx;
+        point -= candidates[idx].free_bytes;
+        if (point <= 0) {
+            return idx;
+        }
+    }
+    return last;  // Погрешность округления - последний подходящий
+}
+
+int select_power_of_two(const std::vector<PlacementCandidate>& candidates, size_t data_size,
+                        std::mt19937_64& rng) {
+    std::vector<int> eligible;
+    double total_weight = 0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (candidates[i].free_bytes >= static_cast<double>(data_size) && candidates[i].free_bytes > 0) {
+            eligible.push_back(static_cast<int>(i));
+            total_weight += candidates[i].free_bytes;
+        }
+    }
+    if (eligible.empty()) {
+        return -1;
+    }
+    if (eligible.size() == 1) {
+        return eligible[0];
+    }
+
+    int first = weighted_pick(candidates, eligible, total_weight, -1, rng);
+    int second = weighted_pick(candidates, eligible, total_weight, first, rng);
+    if (second < 0) {
+        return first;
+    }
+    return placement_load(candidates[second]) < placement_load(candidates[first]) ? second : first;
+}
+
+void placement_begin(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_placement_mtx);
+    g_placement_load[location].in_flight++;
+}
+
+void placement_end(const std::string& location, double latency_ms) {
+    std::lock_guard<std::mutex> lock(g_placement_mtx);
+    ServerLoad& load = g_placement_load[location];
+    if (load.in_flight > 0) {
+        load.in_flight--;
+    }
+    load.latency_ms = load.latency_ms == 0
+        ? latency_ms
+        : PLACEMENT_LATENCY_ALPHA * latency_ms + (1 - PLACEMENT_LATENCY_ALPHA) * load.latency_ms;
+    if (load.samples.size() < PLACEMENT_LATENCY_SAMPLES) {
+        load.samples.push_back(latency_ms);
+    } else {
+        load.samples[load.next_sample] = latency_ms;
+        load.next_sample = (load.next_sample + 1) % PLACEMENT_LATENCY_SAMPLES;
+    }
+}
+
+size_t placement_in_flight(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_placement_mtx);
+    auto it = g_placement_load.find(location);
+    return it == g_placement_load.end() ? 0 : it->second.in_flight;
+}
+
+double placement_latency_ms(const std::string& location) {
+    std::lock_guard<std::mutex> lock(g_placement_mtx);
+    auto it = g_placement_load.find(location);
+    return it == g_placement_load.end() ? 0 : it->second.latency_ms;
+}
+
+bool placement_latency_quantiles(const std::string& location, double& p50_ms, double& p99_ms) {
+    std::vector<double> samples;
+    {
+        std::lock_guard<std::mutex> lock(g_placement_mtx);
+        auto it = g_placement_load.find(location);
+        if (it == g_placement_load.end() || it->second.samples.empty()) {
+            return false;
+        }
+        samples = it->second.samples;
+    }
+    std::sort(samples.begin(), samples.end());
+    p50_ms = samples[samples.size() / 2];
+    p99_ms = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    return true;
+}
+
+std::vector<std::string> placement_servers() {
+    std::lock_guard<std::mutex> lock(g_placement_mtx);
+    std::vector<std::string> servers;
+    for (const auto& entry : g_placement_load) {
+        servers.push_back(entry.first);
+    }
+    return servers;
+}
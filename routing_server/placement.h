@@ -0,0 +1,44 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Кандидат для размещения данных
+struct PlacementCandidate {
+    int server_id = 0;
+    double free_bytes = 0;    // Свободное место (по heartbeat или по БД)
+    size_t in_flight = 0;     // Незавершенные запросы этого и (по сводкам нагрузки) других маршрутизаторов
+    size_t queue_depth = 0;   // Очередь на самом сервере по последнему heartbeat
+    double latency_ms = 0;    // Сглаженная задержка ответа
+};
+
+// Оценка нагрузки: ожидаемое время ожидания нового запроса
+double placement_load(const PlacementCandidate& candidate);
+
+// Выбор "из двух случайных": два разных кандидата выбираются случайно
+// с весом, пропорциональным свободному месту, из них берется менее
+// нагруженный. Кандидаты, у которых нет места под data_size, не участвуют.
+// Возвращает индекс в candidates или -1
+int select_power_of_two(const std::vector<PlacementCandidate>& candidates, size_t data_size,
+                        std::mt19937_64& rng);
+
+// Учет запросов в полете на стороне маршрутизатора. Сервер - его location
+// ("ip:port"): по нему же сводки нагрузки сопоставляются между маршрутизаторами
+void placement_begin(const std::string& location);
+void placement_end(const std::string& location, double latency_ms);
+
+// Текущее число запросов в полете и наблюдаемая задержка сервера
+size_t placement_in_flight(const std::string& location);
+double placement_latency_ms(const std::string& location);
+
+// p50 и p99 последних задержек сервера; false - запросов к нему не было
+bool placement_latency_quantiles(const std::string& location, double& p50_ms, double& p99_ms);
+
+// Серверы, к которым этот маршрутизатор обращался
+std::vector<std::string> placement_servers();
+
+#endif // PLACEMENT_H
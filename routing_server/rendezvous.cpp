@@ -0,0 +1,72 @@
+#include "rendezvous.h"
+#include <algorithm>
+#include <cmath>
+
+// FNV-1a по ключу и адресу сервера и последующее перемешивание
+static uint64_t fnv1a(const std::string& data) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+std::string tile_placement_key(int image_id, const std::string& spectrum, int tile_row, int tile_column) {
+    return std::to_string(image_id) + "/" + spectrum + "/" +
+           std::to_string(tile_row) + "/" + std::to_string(tile_column);
+}
+
+uint64_t hrw_hash(const std::string& key, const std::string& location) {
+    return mix64(fnv1a(key) ^ mix64(fnv1a(location)));
+}
+
+double hrw_score(const std::string& key, const HrwNode& node) {
+    // 53 старших бита дают равномерное u в (0, 1)
+    double u = (static_cast<double>(hrw_hash(key, node.location) >> 11) + 0.5) / 9007199254740992.0;
+    return node.weight / -std::log(u);
+}
+
+std::vector<size_t> hrw_rank(const std::string& key, const std::vector<HrwNode>& nodes, size_t count) {
+    std::vector<std::pair<double, size_t>> scored;
+    scored.reserve(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].weight > 0) {
+            scored.emplace_back(hrw_score(key, nodes[i]), i);
+        }
+    }
+    count = std::min(count, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + count, scored.end(),
+                      [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) {
+                          return a.first > b.first;
+                      });
+
+    std::vector<size_t> result;
+    for (size_t i = 0; i < count; ++i) {
+        result.push_back(scored[i].second);
+    }
+    return result;
+}
+
+int hrw_owner(const std::string& key, const std::vector<HrwNode>& nodes) {
+    int best = -1;
+    double best_score = -1;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].weight <= 0) {
+            continue;
+        }
+        double score = hrw_score(key, nodes[i]);
+        if (score > best_score) {
+            best_score = score;
+            best = static_cast<int>(i);
+        }
+    }
+    return best;
+}
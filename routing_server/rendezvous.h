@@ -0,0 +1,33 @@
+#ifndef RENDEZVOUS_H
+#define RENDEZVOUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Узел для взвешенного rendezvous-хеширования (HRW)
+struct HrwNode {
+    std::string location;  // Адрес из таблицы Servers: в отличие от server_id одинаков на всех маршрутизаторах
+    double weight = 1.0;  // Пропорционально объему сервера
+};
+
+// Ключ размещения тайла: снимок, спектр и позиция
+std::string tile_placement_key(int image_id, const std::string& spectrum, int tile_row, int tile_column);
+
+// Хеш пары (ключ, сервер), равномерный по 64 битам
+uint64_t hrw_hash(const std::string& key, const std::string& location);
+
+// Взвешенная оценка узла для ключа: weight / -ln(u), u - хеш в (0, 1).
+// Доля ключей, достающихся узлу, пропорциональна его весу
+double hrw_score(const std::string& key, const HrwNode& node);
+
+// Индексы count узлов с наибольшей оценкой (первый - основной владелец,
+// остальные - реплики). Любой маршрутизатор с тем же списком серверов
+// получает тот же результат без обращения к БД размещения
+std::vector<size_t> hrw_rank(const std::string& key, const std::vector<HrwNode>& nodes, size_t count);
+
+// Индекс основного владельца ключа или -1 для пустого списка
+int hrw_owner(const std::string& key, const std::vector<HrwNode>& nodes);
+
+#endif // RENDEZVOUS_H
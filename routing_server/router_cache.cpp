@@ -0,0 +1,141 @@
+#include "router_cache.h"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+// Служебный объем записи сверх ключа и значения (узел списка и индекса)
+const size_t ENTRY_OVERHEAD_BYTES = 128;
+// Полос поколений на шард; общая полоса лишь изредка отменяет чужое заполнение
+const size_t GENERATION_STRIPES = 256;
+
+std::string l1_tile_key(int image_id, const std::string& spectrum, int row, int col) {
+    return "tile/" + std::to_string(image_id) + "/" + spectrum + "/" +
+           std::to_string(row) + "/" + std::to_string(col);
+}
+
+RouterCache::RouterCache(size_t capacity_bytes, size_t shards_count) {
+    shards_count = std::max<size_t>(1, shards_count);
+    for (size_t i = 0; i < shards_count; ++i) {
+        shards.emplace_back(new Shard());
+        shards.back()->capacity = capacity_bytes / shards_count;
+        shards.back()->generations.assign(GENERATION_STRIPES, 0);
+    }
+}
+
+RouterCache::Shard& RouterCache::shard_for(const std::string& key) {
+    return *shards[std::hash<std::string>()(key) % shards.size()];
+}
+
+uint64_t& RouterCache::generation_of(Shard& shard, const std::string& key) {
+    // Младшие разряды хеша уже выбрали шард
+    return shard.generations[std::hash<std::string>()(key) / shards.size() % GENERATION_STRIPES];
+}
+
+void RouterCache::drop(Shard& shard, std::list<Entry>::iterator it) {
+    shard.bytes -= it->charge;
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
+
+bool RouterCache::get(const std::string& key, std::string& value) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        shard.stats.misses++;
+        return false;
+    }
+    auto it = found->second;
+    if (it->expires <= std::chrono::steady_clock::now()) {
+        drop(shard, it);
+        shard.stats.expirations++;
+        shard.stats.misses++;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it);
+    value = it->value;
+    shard.stats.hits++;
+    return true;
+}
+
+void RouterCache::put(const std::string& key, const std::string& value, int ttl_ms) {
+    if (ttl_ms <= 0) {
+        return;
+    }
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    insert(shard, key, value, ttl_ms);
+}
+
+// Вставка под блокировкой шарда
+void RouterCache::insert(Shard& shard, const std::string& key, const std::string& value, int ttl_ms) {
+    size_t charge = key.size() + value.size() + ENTRY_OVERHEAD_BYTES;
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+        drop(shard, found->second);
+    }
+    // Одна большая запись не должна вытеснять весь шард
+    if (charge > shard.capacity / 4) {
+        shard.stats.too_large++;
+        return;
+    }
+    while (shard.bytes + charge > shard.capacity && !shard.lru.empty()) {
+        drop(shard, std::prev(shard.lru.end()));
+        shard.stats.evictions++;
+    }
+    shard.lru.push_front({key, value, charge, std::chrono::steady_clock::now() + std::chrono::milliseconds(ttl_ms)});
+    shard.index[key] = shard.lru.begin();
+    shard.bytes += charge;
+    shard.stats.insertions++;
+}
+
+uint64_t RouterCache::generation(const std::string& key) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    return generation_of(shard, key);
+}
+
+void RouterCache::put(const std::string& key, const std::string& value, int ttl_ms, uint64_t generation) {
+    if (ttl_ms <= 0) {
+        return;
+    }
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    if (generation_of(shard, key) != generation) {
+        shard.stats.stale_fills++;
+        return;
+    }
+    insert(shard, key, value, ttl_ms);
+}
+
+bool RouterCache::invalidate(const std::string& key) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    generation_of(shard, key)++;
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        return false;
+    }
+    drop(shard, found->second);
+    shard.stats.invalidations++;
+    return true;
+}
+
+RouterCacheStats RouterCache::get_stats() {
+    RouterCacheStats total;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mtx);
+        total.hits += shard->stats.hits;
+        total.misses += shard->stats.misses;
+        total.insertions += shard->stats.insertions;
+        total.evictions += shard->stats.evictions;
+        total.expirations += shard->stats.expirations;
+        total.invalidations += shard->stats.invalidations;
+        total.too_large += shard->stats.too_large;
+        total.stale_fills += shard->stats.stale_fills;
+        total.bytes += shard->bytes;
+        total.entries += shard->index.size();
+        total.capacity_bytes += shard->capacity;
+    }
+    return total;
+}
@@ -0,0 +1,86 @@
+#ifndef ROUTER_CACHE_H
+#define ROUTER_CACHE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Счетчики кеша маршрутизатора
+struct RouterCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    uint64_t expirations = 0;
+    uint64_t invalidations = 0;
+    uint64_t too_large = 0;  // Запись больше четверти шарда, не кешируется
+    uint64_t stale_fills = 0;  // Значение прочитано до invalidate, не кешируется
+    size_t bytes = 0;
+    size_t entries = 0;
+    size_t capacity_bytes = 0;
+};
+
+// Кеш L1 маршрутизатора: нагрузки тайлов и списки тайлов снимков в памяти,
+// чтобы самые востребованные отдавались без похода на storage-сервер.
+// Объем ограничен в байтах, ключи распределены по шардам со своей
+// блокировкой и LRU-списком. У каждой записи свой срок жизни: данные могли
+// измениться через другой маршрутизатор, а сбрасывает запись только этот
+class RouterCache {
+private:
+    struct Entry {
+        std::string key;
+        std::string value;
+        size_t charge;  // Учитываемый объем: ключ, значение и служебные поля
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    struct Shard {
+        std::list<Entry> lru;  // Начало списка - самые свежие
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+        size_t capacity = 0;
+        std::vector<uint64_t> generations;  // Поколения ключей по полосам, растут при invalidate
+        RouterCacheStats stats;
+        std::mutex mtx;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    Shard& shard_for(const std::string& key);
+    uint64_t& generation_of(Shard& shard, const std::string& key);
+    static void drop(Shard& shard, std::list<Entry>::iterator it);
+    static void insert(Shard& shard, const std::string& key, const std::string& value, int ttl_ms);
+
+public:
+    // capacity_bytes = 0 отключает кеш
+    explicit RouterCache(size_t capacity_bytes, size_t shards_count = 16);
+
+    // Значение по ключу; true при попадании
+    bool get(const std::string& key, std::string& value);
+
+    // Положить значение на ttl_ms
+    void put(const std::string& key, const std::string& value, int ttl_ms);
+
+    // Поколение ключа; растет с каждым invalidate. Чтение с storage-сервера
+    // берет его до запроса и передает в put: значение, прочитанное до записи,
+    // не попадет в кеш, если запись и invalidate завершились раньше put
+    uint64_t generation(const std::string& key);
+    void put(const std::string& key, const std::string& value, int ttl_ms, uint64_t generation);
+
+    // Удалить запись и сменить поколение ключа; true, если запись была
+    bool invalidate(const std::string& key);
+
+    // Суммарная статистика по всем шардам
+    RouterCacheStats get_stats();
+};
+
+// Ключ нагрузки тайла в кеше L1
+std::string l1_tile_key(int image_id, const std::string& spectrum, int row, int col);
+
+#endif // ROUTER_CACHE_H
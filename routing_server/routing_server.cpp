@@ -11,10 +11,58 @@
 #include <arpa/inet.h>
 #include <sstream>
 #include <algorithm>
+#include <set>
+#include <poll.h>
 #include <nlohmann/json.hpp>
+#include "live_view.h"
+#include "placement.h"
+#include "rendezvous.h"
+#include "upload_proxy.h"
+#include "hedged_read.h"
+#include "circuit_breaker.h"
+#include "image_search.h"
+#include "server_table.h"
+#include "tiering_policy.h"
+#include "router_cache.h"
+#include "single_flight.h"
+#include "swim.h"
+#include "anti_entropy.h"
+#include "gossip.h"
+#include "access_counter.h"
+#include "load_view.h"
+#include "snapshot_bootstrap.h"
+#include <chrono>
+#include <random>
+#include <thread>
+#include <netdb.h>
+#include <csignal>
 
 volatile bool g_routing_server_stop = false;
 const int MAX_EVENTS = 32;
+const int RECV_TIMEOUT_MS = 5000;
+const size_t MAX_REQUEST_SIZE = 256 * 1024 * 1024;
+// Таймаут на обмен с storage_server
+const int STORAGE_TIMEOUT_SEC = 10;
+// Число реплик тайла (задается в routing_server_options)
+static size_t g_tile_replicas = 2;
+// Размер ответа /images по умолчанию и наибольший
+const size_t DEFAULT_IMAGES_LIMIT = 100;
+const size_t MAX_IMAGES_LIMIT = 1000;
+// Адрес этого маршрутизатора ("ip:port") и срок ожидания подзапросов поиска
+static std::string g_self_address;
+static int g_scatter_timeout_ms = 2000;
+// Длина отсутствующего тайла в пакетном ответе
+const uint32_t TILE_BATCH_MISSING = 0xFFFFFFFF;
+// Кеш L1 нагрузок и списков тайлов (создается в routing_server_run)
+static RouterCache* g_l1_cache = nullptr;
+static int g_l1_tile_ttl_ms = 300000;
+// Списки тайлов снимков (GET /tiles): одинаковые запросы объединяются,
+// ответы кешируются в L1 на tiles_cache_ttl_ms
+static SingleFlight* g_tile_listings = nullptr;
+// epoll основного цикла: соединения keep-alive возвращаются в него после ответа
+static int g_epoll_fd = -1;
+// Членство маршрутизаторов по SWIM (nullptr, если swim_port = 0)
+static SwimMembership* g_swim = nullptr;
 
 // Структура для очереди сокетов
 struct {
@@ -89,18 +137,94 @@ int routing_server_run(const routing_server_options &opts) {
     master_addr.sin_addr.s_addr = opts.server_ip;
     master_addr.sin_port = opts.server_port;
 
+    // splice в сокет, закрытый storage-сервером, дает SIGPIPE (флага
+    // MSG_NOSIGNAL у splice нет): отказ реплики не должен завершать процесс
+    signal(SIGPIPE, SIG_IGN);
+    g_tile_replicas = std::max(1, opts.tile_replicas);
+    bool bootstrapped = false;
+    {
+        DBManager db_manager;
+        // Новый маршрутизатор начинает с каталога работающего, а не с пустой БД
+        if (!opts.bootstrap_peer.empty()) {
+            SnapshotBootstrapResult result = snapshot_bootstrap(db_manager, opts.bootstrap_peer);
+            bootstrapped = result.ok;
+            printf("Снимок каталога с %s: %s\n", opts.bootstrap_peer.c_str(),
+                   snapshot_result_json(result).c_str());
+        }
+        // Снимок таблицы серверов загружается до приема запросов
+        server_table_rebuild(db_manager);
+    }
+    g_scatter_timeout_ms = opts.scatter_timeout_ms;
+    g_self_address = std::string(inet_ntoa(master_addr.sin_addr)) + ":" +
+                     std::to_string(ntohs(master_addr.sin_port));
+    hedge_configure(opts.hedge_budget_percent);
+    g_l1_cache = new RouterCache(opts.l1_cache_bytes);
+    g_l1_tile_ttl_ms = opts.l1_tile_ttl_ms;
+    g_tile_listings = new SingleFlight(*g_l1_cache, opts.tiles_cache_ttl_ms);
+    if (!opts.tiering_rules_path.empty()) {
+        tiering_start_watcher(opts.tiering_rules_path, std::max(100, opts.tiering_reload_ms));
+    }
+    if (opts.anti_entropy_period_ms > 0) {
+        anti_entropy_start(g_self_address, opts.anti_entropy_period_ms);
+    }
+    if (opts.swim_port != 0) {
+        SwimConfig swim_config;
+        swim_config.protocol_period_ms = std::max(50, opts.swim_period_ms);
+        swim_config.ping_timeout_ms = std::max(10, swim_config.protocol_period_ms / 5);
+        g_swim = new SwimMembership(std::string(inet_ntoa(master_addr.sin_addr)) + ":" +
+                                    std::to_string(opts.swim_port), g_self_address, swim_config);
+        g_swim->set_listener([](const SwimMember& member) {
+            const char* state = member.state == SWIM_ALIVE ? "alive" :
+                                member.state == SWIM_SUSPECT ? "suspect" : "dead";
+            printf("SWIM: маршрутизатор %s (%s) - %s\n", member.http_address.c_str(),
+                   member.address.c_str(), state);
+        });
+        if (!g_swim->start(opts.swim_seeds)) {
+            delete g_swim;
+            g_swim = nullptr;
+        }
+    }
+
     int master_fd = create_master_socket(master_addr);
     if (master_fd < 0) {
         return -1;
     }
 
+    GossipConfig gossip_config;
+    gossip_config.fanout = opts.gossip_fanout;
+    gossip_config.ttl = opts.gossip_ttl;
+    gossip_config.flush_ms = std::max(0, opts.gossip_flush_ms);
+    if (opts.load_interval_ms > 0) {
+        // Сводки нагрузки серверов идут попутно с пакетами gossip
+        gossip_config.piggyback_idle_ms = opts.load_interval_ms;
+        load_view_configure(g_self_address, std::max(opts.load_interval_ms, opts.load_stale_ms), opts.load_max_entries);
+        gossip_set_piggyback(load_view_piggyback, [](const std::string& json) { load_view_merge(json); });
+    }
+    gossip_start(g_self_address, gossip_config);
+    if (opts.access_flush_ms > 0) {
+        DecayConfig access_config;
+        access_config.epoch_sec = std::max(1, opts.access_epoch_sec);
+        access_config.half_life_epochs = std::max(0.01, opts.access_half_life_epochs);
+        access_counter_start(g_self_address, access_config, opts.access_flush_ms, opts.access_sync_period_ms);
+    }
+
     // Отправляем информацию о создании сервера
     nlohmann::json server_info;
     server_info["adress"] = inet_ntoa(master_addr.sin_addr);
     server_info["priority"] = 1; // Приоритет по умолчанию
     gossip_broadcast("POST", "/router/add", server_info.dump());
+    if (bootstrapped) {
+        // Изменения между снимком и появлением в списках маршрутизаторов
+        // gossip сюда не принес: их добирает сверка с источником снимка
+        std::string peer = normalize_router_address(opts.bootstrap_peer);
+        std::thread([peer]() {
+            DBManager db_manager;
+            anti_entropy_run(db_manager, peer);
+        }).detach();
+    }
 
     int epl = epoll_create1(0);
+    g_epoll_fd = epl;
     epoll_event ev;
     ev.data.fd = master_fd;
     ev.events = EPOLLIN;
@@ -151,10 +275,14 @@ int routing_server_run(const routing_server_options &opts) {
     // Отправляем информацию об удалении сервера
     std::string server_address = inet_ntoa(master_addr.sin_addr);
     gossip_broadcast("DELETE", "/router/remove/" + server_address);
+    gossip_stop();
 
     for (const auto &wrk : workers) {
         pthread_join(wrk, nullptr);
     }
+    if (g_swim) {
+        g_swim->stop();
+    }
     return 0;
 }
 
@@ -198,119 +326,309 @@ HttpRequest parse_http_request(const char* buffer, size_t length) {
         }
     }
     
-    // Чтение тела запроса
-    std::getline(iss, req.body);
+    // Чтение тела запроса: все байты после пустой строки
+    size_t body_pos = request_str.find("\r\n\r\n");
+    if (body_pos != std::string::npos) {
+        req.body = request_str.substr(body_pos + 4);
+    }
     
     return req;
 }
 
-// Список спектров для холодного хранилища
-const char* COLD_STORAGE_SPECTRUMS[] = {
-    "B01",  // Coastal/Aerosol
-    "B09",  // Water Vapor
-    "B10",  // Cirrus
-    "B12",  // SWIR-2
-    "B05",  // Red-Edge 1
-    "B06",  // Red-Edge 2
-    "B07",  // Red-Edge 3
-    "B8A"   // Red-Edge 4
-};
-const int COLD_STORAGE_SPECTRUMS_COUNT = sizeof(COLD_STORAGE_SPECTRUMS) / sizeof(COLD_STORAGE_SPECTRUMS[0]);
-
+// Уровень по одному спектру - для загрузок без привязки к снимку
 storage_type_t determine_storage_type(const char* spectrum) {
-    // Проверяем, входит ли спектр в список для холодного хранилища
-    for (int i = 0; i < COLD_STORAGE_SPECTRUMS_COUNT; i++) {
-        if (strcmp(spectrum, COLD_STORAGE_SPECTRUMS[i]) == 0) {
-            return COLD_STORAGE;
-        }
+    TieringAttributes attrs;
+    attrs.spectrum = spectrum;
+    return tiering_current()->classify(attrs).tier;
+}
+
+// Уровень тайла для размещения и чтения - только по правилам спектра. Возраст
+// и частота снимка меняются со временем, а переноса тайлов между уровнями нет:
+// уровень по ним расходился бы у записи и чтения, перезапись оставляла бы старую
+// копию на прежнем уровне. Правила по возрасту, частоте и области пока видны
+// только в tiers_all_rules пробного прогона (/tiering/report)
+static storage_type_t classify_tile(const TileRef& tile) {
+    return determine_storage_type(tile.spectrum.c_str());
+}
+
+// Снимок таблицы серверов; до первой загрузки он читается из БД
+static std::shared_ptr<const ServerTable> current_server_table(DBManager& db_manager) {
+    std::shared_ptr<const ServerTable> table = server_table_current();
+    if (table->version == 0) {
+        server_table_rebuild(db_manager);
+        table = server_table_current();
     }
-    return HOT_STORAGE;
+    return table;
 }
 
 std::vector<ServerInfo> get_servers_by_type(DBManager& db_manager, const std::string& storage_type) {
-    // Получаем список серверов из базы данных
-    return db_manager.get_servers_by_type(storage_type);
+    // Список серверов берется из снимка в памяти, без обращения к БД
+    return server_table_class(*current_server_table(db_manager), storage_type);
 }
 
-ServerInfo select_optimal_server(const std::vector<ServerInfo>& servers, size_t data_size) {
-    ServerInfo best_server;
-    double best_score = -1;
-    
-    for (const auto& server : servers) {
-        // Вычисляем свободное место на SSD и HDD
-        double free_ssd = server.ssd_volume * (100 - server.ssd_fullness) / 100.0;
-        double free_hdd = server.hdd_volume * (100 - server.hdd_fullness) / 100.0;
-        
-        // Вычисляем общий показатель свободного места
-        double score = free_ssd + free_hdd;
-        
-        if (score > best_score) {
-            best_score = score;
-            best_server = server;
+// Объем уровней в таблице Servers задан в гигабайтах
+const double BYTES_PER_VOLUME_UNIT = 1024.0 * 1024.0 * 1024.0;
+
+// Свободное место сервера в байтах на диске уровня (горячий - SSD, холодный - HDD):
+// по последнему heartbeat, если он свежий, иначе по столбцам ssd_fullness/hdd_fullness из БД.
+// Место другого диска не считается: тайл уровня на него не пишется
+static double server_free_bytes(const ServerInfo& server, storage_type_t storage_type, live_state_t state,
+                                const LiveServerStats& live) {
+    if (state == LIVE_FRESH) {
+        return static_cast<double>(storage_type == HOT_STORAGE ? live.ssd_free_bytes : live.hdd_free_bytes);
+    }
+    if (storage_type == HOT_STORAGE) {
+        return server.ssd_volume * (100 - server.ssd_fullness) / 100.0 * BYTES_PER_VOLUME_UNIT;
+    }
+    return server.hdd_volume * (100 - server.hdd_fullness) / 100.0 * BYTES_PER_VOLUME_UNIT;
+}
+
+// Кандидат размещения по данным сервера, живому представлению и учету запросов
+// в полете. Запросы других маршрутизаторов и heartbeat, пришедшие не сюда,
+// берутся из сводок нагрузки (load_view.h)
+static PlacementCandidate make_candidate(const ServerInfo& server, storage_type_t storage_type,
+                                         live_state_t state, const LiveServerStats& live) {
+    PlacementCandidate candidate;
+    candidate.server_id = server.server_id;
+    candidate.free_bytes = server_free_bytes(server, storage_type, state, live);
+    candidate.in_flight = placement_in_flight(server.location);
+    candidate.latency_ms = placement_latency_ms(server.location);
+    if (state == LIVE_FRESH) {
+        candidate.queue_depth = live.queue_depth;
+        if (candidate.latency_ms == 0) {
+            candidate.latency_ms = live.latency_ms;
         }
     }
-    
-    return best_server;
+    LoadAggregate cluster;
+    if (load_view_lookup(server.location, cluster)) {
+        candidate.in_flight += cluster.in_flight;
+        if (state != LIVE_FRESH && cluster.has_heartbeat) {
+            candidate.queue_depth = cluster.queue_depth;
+            candidate.free_bytes = static_cast<double>(storage_type == HOT_STORAGE ? cluster.ssd_free_bytes
+                                                                                   : cluster.hdd_free_bytes);
+        }
+        if (candidate.latency_ms == 0 && cluster.has_latency) {
+            candidate.latency_ms = cluster.p50_ms;
+        }
+    }
+    return candidate;
 }
 
-int send_data_to_server(const ServerInfo& server, const char* data, size_t data_size) {
-    // Формируем URL сервера
-    std::string server_url = "http://" + server.location + ":8080/upload";
-    
-    // Отправляем данные на сервер
-    std::string response = send_request_to_storage("POST", "/upload", std::string(data, data_size));
-    
-    // Проверяем ответ
-    if (response.find("200 OK") != std::string::npos) {
+// Сервер, о котором есть свежий heartbeat в сводках других маршрутизаторов
+static bool cluster_heartbeat_fresh(const std::string& location) {
+    LoadAggregate cluster;
+    return load_view_lookup(location, cluster) && cluster.has_heartbeat;
+}
+
+// Выбор сервера методом "из двух случайных" с учетом места под data_size.
+// Серверы с пропущенными heartbeat рассматриваются только если других нет;
+// heartbeat, полученный другим маршрутизатором, тоже считается.
+// При отсутствии подходящего сервера возвращается server_id = -1
+ServerInfo select_optimal_server(const std::vector<ServerInfo>& servers, storage_type_t storage_type,
+                                 size_t data_size) {
+    thread_local std::mt19937_64 rng(std::random_device{}());
+
+    std::vector<PlacementCandidate> candidates;
+    std::vector<size_t> owners;
+    std::vector<PlacementCandidate> stale_candidates;
+    std::vector<size_t> stale_owners;
+
+    for (size_t i = 0; i < servers.size(); ++i) {
+        // Исключенные автоматом защиты серверы не участвуют в размещении
+        if (!breaker_available(servers[i].location)) {
+            continue;
+        }
+        LiveServerStats live;
+        live_state_t state = live_view_lookup(servers[i].location, live);
+        if (state == LIVE_STALE && !cluster_heartbeat_fresh(servers[i].location)) {
+            stale_candidates.push_back(make_candidate(servers[i], storage_type, state, live));
+            stale_owners.push_back(i);
+        } else {
+            candidates.push_back(make_candidate(servers[i], storage_type, state, live));
+            owners.push_back(i);
+        }
+    }
+
+    int idx = select_power_of_two(candidates, data_size, rng);
+    if (idx >= 0) {
+        return servers[owners[idx]];
+    }
+    idx = select_power_of_two(stale_candidates, data_size, rng);
+    if (idx >= 0) {
+        return servers[stale_owners[idx]];
+    }
+
+    ServerInfo none = ServerInfo();
+    none.server_id = -1;
+    return none;
+}
+
+// Вес сервера в rendezvous-хешировании - его полный объем по таблице Servers,
+// хешируется location. Оба одинаковы на всех маршрутизаторах (server_id - нет),
+// поэтому и владельцы ключей совпадают
+std::vector<HrwNode> make_hrw_nodes(const std::vector<ServerInfo>& servers) {
+    std::vector<HrwNode> nodes;
+    nodes.reserve(servers.size());
+    for (const auto& server : servers) {
+        HrwNode node;
+        node.location = server.location;
+        node.weight = std::max(1, server.ssd_volume + server.hdd_volume);
+        nodes.push_back(node);
+    }
+    return nodes;
+}
+
+// Во сколько раз нагрузка первой реплики должна превышать нагрузку другой,
+// чтобы чтение начиналось с другой. Порядок rendezvous-хеша меняется только
+// при заметной разнице: у первой реплики теплее кеш
+const double REPLICA_LOAD_RATIO = 2.0;
+
+// Перестановка вперед наименее нагруженной реплики по оценке placement_load
+static void prefer_unloaded_replica(std::vector<ServerInfo>& replicas, storage_type_t storage_type) {
+    if (replicas.size() < 2) {
+        return;
+    }
+    std::vector<double> loads;
+    for (const auto& replica : replicas) {
+        LiveServerStats live;
+        live_state_t state = live_view_lookup(replica.location, live);
+        loads.push_back(placement_load(make_candidate(replica, storage_type, state, live)));
+    }
+    size_t best = std::min_element(loads.begin(), loads.end()) - loads.begin();
+    if (best != 0 && loads[0] > loads[best] * REPLICA_LOAD_RATIO) {
+        std::swap(replicas[0], replicas[best]);
+    }
+}
+
+std::vector<ServerInfo> locate_tile_servers(DBManager& db_manager, const TileRef& tile, size_t count) {
+    return locate_tile_servers(db_manager, tile, count, classify_tile(tile));
+}
+
+std::vector<ServerInfo> locate_tile_servers(DBManager& db_manager, const TileRef& tile, size_t count,
+                                            storage_type_t storage_type) {
+    std::string storage_type_str = storage_type == HOT_STORAGE ? "hot" : "cold";
+    std::shared_ptr<const ServerTable> table = current_server_table(db_manager);
+    const std::vector<ServerInfo>& servers = server_table_class(*table, storage_type_str);
+
+    std::vector<ServerInfo> result;
+    std::string key = tile_placement_key(tile.image_id, tile.spectrum, tile.row, tile.col);
+    for (size_t idx : hrw_rank(key, server_table_hrw(*table, storage_type_str), count)) {
+        result.push_back(servers[idx]);
+    }
+    return result;
+}
+
+// Путь запроса к полезной нагрузке тайла на storage_server
+static std::map<std::string, std::string> tile_query_params(const TileRef& tile) {
+    std::map<std::string, std::string> params;
+    params["image_id"] = std::to_string(tile.image_id);
+    params["spectrum"] = tile.spectrum;
+    params["row"] = std::to_string(tile.row);
+    params["col"] = std::to_string(tile.col);
+    return params;
+}
+
+// Путь с query-параметрами к полезной нагрузке тайла
+static std::string tile_data_path(const TileRef& tile) {
+    std::string path = "/tiles/data?";
+    for (const auto& param : tile_query_params(tile)) {
+        if (path.back() != '?') path += "&";
+        path += param.first + "=" + param.second;
+    }
+    return path;
+}
+
+// Код статуса и тело ответа storage_server; 0 для пустого или битого ответа
+static int split_http_response(const std::string& response, std::string& body) {
+    size_t body_pos = response.find("\r\n\r\n");
+    if (response.compare(0, 9, "HTTP/1.1 ") != 0 || body_pos == std::string::npos) {
         return 0;
     }
-    return -1;
+    body = response.substr(body_pos + 4);
+    return std::atoi(response.c_str() + 9);
 }
 
-int distribute_to_storage(storage_type_t storage_type, const char* data, size_t data_size) {
-    // Определяем тип хранилища в строковом формате
-    std::string storage_type_str = (storage_type == HOT_STORAGE) ? "hot" : "cold";
-    
-    // Создаем экземпляр DBManager
-    DBManager db_manager;
-    
-    // Получаем список серверов нужного типа
-    std::vector<ServerInfo> servers = get_servers_by_type(db_manager, storage_type_str);
-    
-    if (servers.empty()) {
-        printf("Ошибка: не найдены серверы типа %s\n", storage_type_str.c_str());
+int connect_to_server(const std::string& location, std::string& host_header, bool nonblock, bool use_breaker) {
+    // location: "host" или "host:port", порт storage_server по умолчанию 8080
+    std::string host = location;
+    if (host.compare(0, 7, "http://") == 0) {
+        host = host.substr(7);
+    }
+    std::string port = "8080";
+    size_t colon = host.find(':');
+    if (colon != std::string::npos) {
+        port = host.substr(colon + 1);
+        host = host.substr(0, colon);
+    }
+    host_header = host + ":" + port;
+
+    // Исключенный сервер не задерживает рабочий поток: отказ без попытки соединения
+    if (use_breaker && !breaker_acquire(location)) {
         return -1;
     }
-    
-    // Выбираем оптимальный сервер
-    ServerInfo selected_server = select_optimal_server(servers, data_size);
-    
-    printf("Выбран сервер %d (тип: %s, свободное место: SSD %.1f%%, HDD %.1f%%)\n",
-           selected_server.server_id,
-           selected_server.class_type.c_str(),
-           100.0 - selected_server.ssd_fullness,
-           100.0 - selected_server.hdd_fullness);
-    
-    // Отправляем данные на выбранный сервер
-    return send_data_to_server(selected_server, data, data_size);
-}
 
-// Функция для отправки HTTP-запроса к storage_server
-std::string send_request_to_storage(const std::string& method, const std::string& path, 
-                                  const std::string& body = "", 
-                                  const std::map<std::string, std::string>& query_params = {}) {
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        return "";
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addr = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addr) != 0) {
+        if (use_breaker) {
+            breaker_record(location, false, 0);
+        }
+        return -1;
     }
 
-    sockaddr_in addr;
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(8080); // Порт storage_server
-    addr.sin_addr.s_addr = inet_addr("127.0.0.1"); // IP storage_server
+    int sock = socket(AF_INET, SOCK_STREAM | (nonblock ? SOCK_NONBLOCK : 0), 0);
+    if (sock < 0) {
+        freeaddrinfo(addr);
+        if (use_breaker) {
+            breaker_cancel(location);
+        }
+        return -1;
+    }
+    timeval tv = {STORAGE_TIMEOUT_SEC, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
 
-    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    int connected = connect(sock, addr->ai_addr, addr->ai_addrlen);
+    freeaddrinfo(addr);
+    if (connected < 0 && !(nonblock && errno == EINPROGRESS)) {
         close(sock);
+        if (use_breaker) {
+            breaker_record(location, false, 0);
+        }
+        return -1;
+    }
+    return sock;
+}
+
+// Итог обмена для автомата защиты: пустой ответ и 5xx - неудача
+static void record_server_outcome(const std::string& location, const std::string& response,
+                                  std::chrono::steady_clock::time_point started) {
+    std::string body;
+    int status = split_http_response(response, body);
+    breaker_record(location, status > 0 && status < 500, std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count());
+}
+
+// Чтение ответа storage_server до закрытия соединения
+static std::string read_server_response(int sock) {
+    char buffer[4096];
+    std::string response;
+    int bytes_read;
+    while ((bytes_read = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, bytes_read);
+    }
+    return response;
+}
+
+std::string send_request_to_server(const std::string& location, const std::string& method,
+                                   const std::string& path, const std::string& body,
+                                   const std::map<std::string, std::string>& query_params, bool use_breaker) {
+    std::string host_header;
+    auto started = std::chrono::steady_clock::now();
+    int sock = connect_to_server(location, host_header, false, use_breaker);
+    if (sock < 0) {
         return "";
     }
 
@@ -326,7 +644,7 @@ std::string send_request_to_storage(const std::string& method, const std::string
 
     // Формируем HTTP-запрос
     std::string request = method + " " + full_path + " HTTP/1.1\r\n";
-    request += "Host: localhost:8080\r\n";
+    request += "Host: " + host_header + "\r\n";
     request += "Content-Type: application/json\r\n";
     if (!body.empty()) {
         request += "Content-Length: " + std::to_string(body.size()) + "\r\n";
@@ -336,21 +654,561 @@ std::string send_request_to_storage(const std::string& method, const std::string
         request += body;
     }
 
-    // Отправляем запрос
-    send(sock, request.c_str(), request.size(), 0);
+    // Отправляем запрос: тело тайла может не уйти за один send
+    if (!send_all(sock, request.data(), request.size(), STORAGE_TIMEOUT_SEC * 1000)) {
+        close(sock);
+        if (use_breaker) {
+            breaker_record(location, false, 0);
+        }
+        return "";
+    }
 
     // Читаем ответ
-    char buffer[4096];
-    std::string response;
-    int bytes_read;
-    while ((bytes_read = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
-        response.append(buffer, bytes_read);
+    std::string response = read_server_response(sock);
+    close(sock);
+    if (use_breaker) {
+        record_server_outcome(location, response, started);
     }
+    return response;
+}
 
-    close(sock);
+// Значение заголовка запроса; false, если заголовка нет
+static bool header_value(const HttpRequest& req, const std::string& name, std::string& value) {
+    auto it = req.headers.find(name);
+    if (it == req.headers.end()) {
+        return false;
+    }
+    value = it->second;
+    // Заголовки разбираются построчно, у значения остается \r
+    if (!value.empty() && value.back() == '\r') {
+        value.pop_back();
+    }
+    return true;
+}
+
+// Ответ с нагрузкой тайла из кеша L1 - в том же виде, что у storage_server
+static std::string tile_payload_response(const std::string& payload) {
+    return "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n"
+           "Content-Length: " + std::to_string(payload.size()) + "\r\n\r\n" + payload;
+}
+
+// Тайл перезаписан или перенесен: копия в L1 больше не годится. Вызывается
+// после записи на storage: сброс до записи не мешал бы чтению, начатому
+// раньше, вернуть в L1 старую нагрузку. Такое чтение отбрасывает и смена
+// поколения ключа (RouterCache::generation)
+void invalidate_cached_tile(const TileRef& tile) {
+    g_l1_cache->invalidate(l1_tile_key(tile.image_id, tile.spectrum, tile.row, tile.col));
+}
+
+// Размещение тайла по rendezvous-хешу: тайл параллельно отправляется
+// g_tile_replicas серверам класса спектра с наибольшей оценкой ключа
+// (снимок, спектр, строка, столбец). Клиенту возвращается ответ владельца,
+// а если он недоступен - ответ любой успешно записавшей реплики
+static std::string upload_tile(DBManager& db_manager, const TileRef& tile, const std::string& payload) {
+    std::vector<ServerInfo> owners = locate_tile_servers(db_manager, tile, g_tile_replicas);
+    if (owners.empty()) {
+        return "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+    }
+
+    std::vector<std::string> responses(owners.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < owners.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            placement_begin(owners[i].location);
+            auto started = std::chrono::steady_clock::now();
+            responses[i] = send_request_to_server(owners[i].location, "POST", "/tiles/data",
+                                                  payload, tile_query_params(tile));
+            placement_end(owners[i].location, std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - started).count());
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    // И после неудачной записи: часть реплик могла ее принять
+    invalidate_cached_tile(tile);
+
+    for (const auto& storage_response : responses) {
+        std::string body;
+        int status = split_http_response(storage_response, body);
+        if (status >= 200 && status < 300) {
+            return storage_response;
+        }
+    }
+    return !responses[0].empty() ? responses[0] : "HTTP/1.1 502 Bad Gateway\r\nContent-Length: 0\r\n\r\n";
+}
+
+// Ключ списка тайлов снимка в g_tile_listings
+static std::string tile_listing_key(int image_id, bool by_frequency) {
+    return "/tiles?image_id=" + std::to_string(image_id) + (by_frequency ? "&sort=frequency" : "");
+}
+
+// Все storage-серверы из текущего снимка таблицы Servers
+static std::vector<ServerInfo> all_storage_servers(DBManager& db_manager) {
+    std::shared_ptr<const ServerTable> table = current_server_table(db_manager);
+    std::vector<ServerInfo> servers;
+    for (const auto& entry : table->by_id) {
+        servers.push_back(entry.second);
+    }
+    return servers;
+}
+
+// Один и тот же запрос ко всем серверам параллельно; ответы в порядке servers
+static std::vector<std::string> send_request_to_servers(const std::vector<ServerInfo>& servers,
+                                                        const std::string& method, const std::string& path,
+                                                        const std::string& body = "",
+                                                        const std::map<std::string, std::string>& query_params = {}) {
+    std::vector<std::string> responses(servers.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < servers.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            responses[i] = send_request_to_server(servers[i].location, method, path, body, query_params);
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    return responses;
+}
+
+// Первый успешный (2xx) ответ, иначе первый непустой, иначе 502
+static std::string first_success_response(const std::vector<std::string>& responses) {
+    for (const auto& response : responses) {
+        if (response.compare(0, 10, "HTTP/1.1 2") == 0) {
+            return response;
+        }
+    }
+    for (const auto& response : responses) {
+        if (!response.empty()) {
+            return response;
+        }
+    }
+    return "HTTP/1.1 502 Bad Gateway\r\nContent-Length: 0\r\n\r\n";
+}
+
+// GET /tiles: тайлы снимка разложены по владельцам rendezvous-хеша, поэтому
+// список собирается со всех серверов. Реплики одного тайла дают один URL.
+// Сервер сортирует по частоте только свои тайлы, общий список чередует их
+// по рангу: самые частые тайлы каждого сервера идут первыми
+static std::string fetch_tile_listing(DBManager& db_manager, const std::map<std::string, std::string>& params) {
+    std::vector<ServerInfo> servers = all_storage_servers(db_manager);
+    std::vector<std::string> responses = send_request_to_servers(servers, "GET", "/tiles", "", params);
+    std::vector<std::vector<std::string>> lists;
+    for (const auto& storage_response : responses) {
+        std::string body;
+        if (split_http_response(storage_response, body) != 200) {
+            continue;
+        }
+        try {
+            lists.push_back(nlohmann::json::parse(body).at("tiles").get<std::vector<std::string>>());
+        } catch (...) {
+        }
+    }
+    if (lists.empty() && !servers.empty()) {
+        return "HTTP/1.1 502 Bad Gateway\r\nContent-Length: 0\r\n\r\n";
+    }
+
+    nlohmann::json tiles = nlohmann::json::array();
+    std::set<std::string> seen;
+    for (size_t rank = 0;; ++rank) {
+        bool more = false;
+        for (const auto& list : lists) {
+            if (rank < list.size()) {
+                more = true;
+                if (seen.insert(list[rank]).second) {
+                    tiles.push_back(list[rank]);
+                }
+            }
+        }
+        if (!more) {
+            break;
+        }
+    }
+    nlohmann::json json_data;
+    json_data["tiles"] = tiles;
+    std::string json_response = json_data.dump();
+    return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+           "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+}
+
+// Пробный прогон политик: объем тайлов каждого спектра снимка собирается со всех
+// storage-серверов (/tiles/usage, реплики учитываются), признаки - из БД. Для
+// действующей политики и, если задана, кандидата байты по уровням и по правилам
+// считаются так же, как размещаются тайлы (classify_tile - только по спектру),
+// а для кандидата - сколько байтов пришлось бы перенести. Уровни со всеми
+// правилами (возраст, частота, область) - отдельно, в tiers_all_rules
+static std::string tiering_report(DBManager& db_manager, std::shared_ptr<const TieringPolicy> candidate) {
+    std::vector<ServerInfo> servers = all_storage_servers(db_manager);
+    std::vector<std::string> responses = send_request_to_servers(servers, "GET", "/tiles/usage");
+
+    std::map<std::pair<int, std::string>, long long> usage;
+    nlohmann::json unreachable = nlohmann::json::array();
+    for (size_t i = 0; i < servers.size(); ++i) {
+        std::string body;
+        if (split_http_response(responses[i], body) != 200) {
+            unreachable.push_back(servers[i].location);
+            continue;
+        }
+        try {
+            for (const auto& item : nlohmann::json::parse(body)) {
+                usage[{item.at("image_id").get<int>(), item.at("spectrum").get<std::string>()}] +=
+                    item.at("bytes").get<long long>();
+            }
+        } catch (...) {
+            unreachable.push_back(servers[i].location);
+        }
+    }
+
+    std::map<std::pair<int, std::string>, TieringAttributes> attributes;
+    double now = std::time(nullptr);
+    for (const auto& info : db_manager.get_spectrum_tiering(-1)) {
+        TieringAttributes& attrs = attributes[{info.image_id, info.spectrum_name}];
+        attrs.spectrum = info.spectrum_name;
+        attrs.age_days = std::max(0.0, (now - info.timestamp) / 86400.0);
+        long long hotness = access_counter_frequency(info.image_id, info.spectrum_name);
+        attrs.frequency = hotness >= 0 ? hotness : info.frequency;
+        attrs.geohash = info.geohash;
+    }
+
+    std::vector<std::shared_ptr<const TieringPolicy>> policies = {tiering_current()};
+    if (candidate) {
+        policies.push_back(candidate);
+    }
+    struct Totals {
+        long long tier_bytes[2] = {0, 0};
+        long long all_rules_bytes[2] = {0, 0};
+        std::vector<long long> rule_bytes;
+        long long default_bytes = 0;
+    };
+    std::vector<Totals> totals(policies.size());
+    for (size_t p = 0; p < policies.size(); ++p) {
+        totals[p].rule_bytes.assign(policies[p]->rules.size(), 0);
+    }
+    long long total_bytes = 0;
+    long long moved_to_cold = 0;
+    long long moved_to_hot = 0;
+    for (const auto& entry : usage) {
+        TieringAttributes attrs;
+        auto it = attributes.find(entry.first);
+        if (it != attributes.end()) {
+            attrs = it->second;
+        } else {
+            attrs.spectrum = entry.first.second;
+        }
+        // Признаки, по которым тайл размещается: только спектр
+        TieringAttributes placement_attrs;
+        placement_attrs.spectrum = attrs.spectrum;
+        total_bytes += entry.second;
+        std::vector<TieringDecision> decisions;
+        for (size_t p = 0; p < policies.size(); ++p) {
+            totals[p].all_rules_bytes[policies[p]->classify(attrs).tier] += entry.second;
+            TieringDecision decision = policies[p]->classify(placement_attrs);
+            totals[p].tier_bytes[decision.tier] += entry.second;
+            if (decision.rule >= 0) {
+                totals[p].rule_bytes[decision.rule] += entry.second;
+            } else {
+                totals[p].default_bytes += entry.second;
+            }
+            decisions.push_back(decision);
+        }
+        if (decisions.size() > 1 && decisions[0].tier != decisions[1].tier) {
+            (decisions[1].tier == COLD_STORAGE ? moved_to_cold : moved_to_hot) += entry.second;
+        }
+    }
+
+    nlohmann::json json_data;
+    json_data["servers"] = servers.size();
+    json_data["unreachable"] = unreachable;
+    json_data["spectrums"] = usage.size();
+    json_data["total_bytes"] = total_bytes;
+    const char* names[] = {"current", "candidate"};
+    for (size_t p = 0; p < policies.size(); ++p) {
+        nlohmann::json policy;
+        policy["version"] = policies[p]->version;
+        policy["source"] = policies[p]->source;
+        policy["tiers"]["hot"] = totals[p].tier_bytes[HOT_STORAGE];
+        policy["tiers"]["cold"] = totals[p].tier_bytes[COLD_STORAGE];
+        policy["tiers_all_rules"]["hot"] = totals[p].all_rules_bytes[HOT_STORAGE];
+        policy["tiers_all_rules"]["cold"] = totals[p].all_rules_bytes[COLD_STORAGE];
+        policy["rules"] = nlohmann::json::array();
+        for (size_t r = 0; r < policies[p]->rules.size(); ++r) {
+            const TieringRule& rule = policies[p]->rules[r];
+            policy["rules"].push_back({{"name", rule.name},
+                                       {"tier", rule.tier == HOT_STORAGE ? "hot" : "cold"},
+                                       {"bytes", totals[p].rule_bytes[r]},
+                                       {"applies_to_placement", rule.band_only()}});
+        }
+        policy["default"] = {{"tier", policies[p]->default_tier == HOT_STORAGE ? "hot" : "cold"},
+                             {"bytes", totals[p].default_bytes}};
+        json_data["policies"][names[p]] = policy;
+    }
+    if (candidate) {
+        json_data["moved_bytes"]["hot_to_cold"] = moved_to_cold;
+        json_data["moved_bytes"]["cold_to_hot"] = moved_to_hot;
+    }
+    std::string json_response = json_data.dump();
+    return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+           "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+}
+
+// Пакет тайлов: ключи группируются по владельцу, к каждому владельцу уходит
+// один пакетный запрос (параллельно), ответы собираются в исходном порядке.
+// Ключи неответившего владельца переходят к следующей реплике
+static std::string fetch_tile_batch(DBManager& db_manager, const std::string& request_body) {
+    std::vector<TileRef> tiles;
+    try {
+        nlohmann::json json_data = nlohmann::json::parse(request_body);
+        for (const auto& tile : json_data.at("tiles")) {
+            TileRef ref;
+            ref.image_id = tile.at("image_id");
+            ref.spectrum = tile.at("spectrum");
+            ref.row = tile.at("row");
+            ref.col = tile.at("col");
+            tiles.push_back(ref);
+        }
+    } catch (...) {
+        return "HTTP/1.1 400 Bad Request\r\n\r\n";
+    }
+    if (tiles.empty()) {
+        return "HTTP/1.1 400 Bad Request\r\n\r\n";
+    }
+
+    // Один снимок таблицы серверов на весь пакет
+    std::shared_ptr<const ServerTable> table = current_server_table(db_manager);
+
+    std::vector<std::string> payloads(tiles.size());
+    // vector<bool> хранит биты в общих словах, потоки писали бы в одно слово
+    std::vector<char> found(tiles.size(), 0);
+    std::vector<char> cached(tiles.size(), 0);
+    std::vector<uint64_t> generations(tiles.size(), 0);
+
+    // Реплики каждого тайла в порядке HRW-оценки; исключенные автоматом защиты - в конце
+    std::vector<std::vector<ServerInfo>> replicas(tiles.size());
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        access_counter_record(tiles[i].image_id, tiles[i].spectrum);
+        if (g_l1_cache->get(l1_tile_key(tiles[i].image_id, tiles[i].spectrum, tiles[i].row, tiles[i].col),
+                            payloads[i])) {
+            found[i] = cached[i] = 1;
+            continue;
+        }
+        generations[i] = g_l1_cache->generation(
+            l1_tile_key(tiles[i].image_id, tiles[i].spectrum, tiles[i].row, tiles[i].col));
+        std::string storage_type_str =
+            classify_tile(tiles[i]) == HOT_STORAGE ? "hot" : "cold";
+        std::string key = tile_placement_key(tiles[i].image_id, tiles[i].spectrum, tiles[i].row, tiles[i].col);
+        const std::vector<ServerInfo>& class_servers = server_table_class(*table, storage_type_str);
+        std::vector<ServerInfo> ejected;
+        for (size_t idx : hrw_rank(key, server_table_hrw(*table, storage_type_str), g_tile_replicas)) {
+            (breaker_available(class_servers[idx].location) ? replicas[i] : ejected).push_back(class_servers[idx]);
+        }
+        replicas[i].insert(replicas[i].end(), ejected.begin(), ejected.end());
+    }
+
+    // Тайлы группируются по текущей реплике, к каждой уходит один пакетный запрос
+    // (параллельно). Тайлы группы, на которую сервер не ответил, пробуются на
+    // следующей реплике, как при чтении одного тайла
+    std::vector<size_t> attempt(tiles.size(), 0);
+    std::vector<char> answered = cached;  // Сервер сообщил о тайле: нагрузка или ее нет
+    while (true) {
+        std::map<std::string, std::vector<size_t>> groups;
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            if (!answered[i] && attempt[i] < replicas[i].size()) {
+                groups[replicas[i][attempt[i]].location].push_back(i);
+            }
+        }
+        if (groups.empty()) {
+            break;
+        }
+
+        std::vector<std::thread> threads;
+        for (const auto& group : groups) {
+            threads.emplace_back([&, group]() {
+                nlohmann::json sub_request;
+                sub_request["tiles"] = nlohmann::json::array();
+                for (size_t i : group.second) {
+                    sub_request["tiles"].push_back({{"image_id", tiles[i].image_id},
+                                                    {"spectrum", tiles[i].spectrum},
+                                                    {"row", tiles[i].row}, {"col", tiles[i].col}});
+                }
+                std::string body;
+                std::string storage_response = send_request_to_server(group.first, "POST", "/tiles/batch",
+                                                                      sub_request.dump());
+                if (split_http_response(storage_response, body) != 200) {
+                    return;
+                }
+                // Каждая группа пишет только в свои позиции, блокировка не нужна
+                size_t offset = 0;
+                for (size_t i : group.second) {
+                    uint32_t len_be;
+                    if (offset + sizeof(len_be) > body.size()) {
+                        break;
+                    }
+                    memcpy(&len_be, body.data() + offset, sizeof(len_be));
+                    offset += sizeof(len_be);
+                    uint32_t len = ntohl(len_be);
+                    if (len == TILE_BATCH_MISSING) {
+                        answered[i] = 1;
+                        continue;
+                    }
+                    if (offset + len > body.size()) {
+                        break;
+                    }
+                    payloads[i] = body.substr(offset, len);
+                    found[i] = answered[i] = 1;
+                    offset += len;
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        for (const auto& group : groups) {
+            for (size_t i : group.second) {
+                if (!answered[i]) {
+                    attempt[i]++;
+                }
+            }
+        }
+    }
+
+    std::string body;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        if (found[i] && !cached[i]) {
+            g_l1_cache->put(l1_tile_key(tiles[i].image_id, tiles[i].spectrum, tiles[i].row, tiles[i].col),
+                            payloads[i], g_l1_tile_ttl_ms, generations[i]);
+        }
+        uint32_t len = found[i] ? static_cast<uint32_t>(payloads[i].size()) : TILE_BATCH_MISSING;
+        uint32_t len_be = htonl(len);
+        body.append(reinterpret_cast<const char*>(&len_be), sizeof(len_be));
+        if (found[i]) {
+            body += payloads[i];
+        }
+    }
+
+    std::string response = "HTTP/1.1 200 OK\r\n";
+    response += "Content-Type: application/octet-stream\r\n";
+    response += "X-Tile-Count: " + std::to_string(tiles.size()) + "\r\n";
+    response += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    response += body;
     return response;
 }
 
+// Больше этого тело отвергнутой загрузки не дочитывается: соединение закрывается
+const size_t UPLOAD_DRAIN_LIMIT = 1024 * 1024;
+
+// Ответ на загрузку, отвергнутую до пересылки тела. Закрытие сокета с
+// непрочитанными данными отправляет клиенту RST, и ответ может до него не
+// дойти: небольшое тело дочитывается, о закрытии сообщает Connection: close
+static std::string reject_upload(int client_fd, const HttpRequest& req, size_t content_length,
+                                 const std::string& status, const std::string& json_response = "") {
+    size_t prefix = std::min(req.body.size(), content_length);
+    if (content_length - prefix <= UPLOAD_DRAIN_LIMIT) {
+        discard_body(client_fd, content_length - prefix, RECV_TIMEOUT_MS);
+    }
+    return "HTTP/1.1 " + status + "\r\nConnection: close\r\n" +
+           (json_response.empty() ? "" : "Content-Type: application/json\r\n") +
+           "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+}
+
+// Потоковая пересылка тела /upload на выбранные storage-серверы.
+// Тело не собирается в памяти маршрутизатора: уже прочитанное вместе
+// с заголовками начало отправляется как есть, остальное - через splice,
+// а реплицируемому тайлу - сразу всем владельцам через tee (tee_body)
+static std::string proxy_upload(int client_fd, const HttpRequest& req, size_t content_length,
+                                DBManager& db_manager) {
+    std::string spectrum;
+    if (!header_value(req, "X-Spectrum", spectrum)) {
+        return reject_upload(client_fd, req, content_length, "400 Bad Request",
+                             "{\"error\": \"Spectrum header is required\"}");
+    }
+
+    // Выбор серверов: тайл с позицией - владельцы по rendezvous-хешу, остальное - по загрузке
+    std::vector<ServerInfo> servers;
+    std::string path = "/upload";
+    bool tile_upload = false;  // Тайл с позицией: после записи сбросить его копию в L1
+    TileRef uploaded_tile;
+    std::string image_id, tile_row, tile_col;
+    if (header_value(req, "X-Image-Id", image_id) && header_value(req, "X-Tile-Row", tile_row) &&
+        header_value(req, "X-Tile-Col", tile_col)) {
+        try {
+            uploaded_tile.image_id = std::stoi(image_id);
+            uploaded_tile.row = std::stoi(tile_row);
+            uploaded_tile.col = std::stoi(tile_col);
+        } catch (...) {
+            return reject_upload(client_fd, req, content_length, "400 Bad Request");
+        }
+        uploaded_tile.spectrum = spectrum;
+        servers = locate_tile_servers(db_manager, uploaded_tile, g_tile_replicas);
+        tile_upload = true;
+        path = tile_data_path(uploaded_tile);
+    } else {
+        storage_type_t storage_type = determine_storage_type(spectrum.c_str());
+        std::string storage_type_str = storage_type == HOT_STORAGE ? "hot" : "cold";
+        ServerInfo server = select_optimal_server(get_servers_by_type(db_manager, storage_type_str), storage_type,
+                                                  content_length);
+        if (server.server_id >= 0) {
+            servers.push_back(server);
+        }
+    }
+    if (servers.empty()) {
+        return reject_upload(client_fd, req, content_length, "503 Service Unavailable");
+    }
+
+    // Заголовки и уже прочитанное начало тела - каждому доступному серверу
+    auto started = std::chrono::steady_clock::now();
+    size_t prefix = std::min(req.body.size(), content_length);
+    std::vector<ServerInfo> targets;
+    std::vector<int> server_fds;
+    for (const auto& server : servers) {
+        std::string host_header;
+        int server_fd = connect_to_server(server.location, host_header);
+        if (server_fd < 0) {
+            continue;
+        }
+        std::string head = "POST " + path + " HTTP/1.1\r\n";
+        head += "Host: " + host_header + "\r\n";
+        head += "Content-Type: application/octet-stream\r\n";
+        head += "X-Spectrum: " + spectrum + "\r\n";
+        head += "Content-Length: " + std::to_string(content_length) + "\r\n\r\n";
+        if (!send_all(server_fd, head.data(), head.size(), STORAGE_TIMEOUT_SEC * 1000) ||
+            !send_all(server_fd, req.body.data(), prefix, STORAGE_TIMEOUT_SEC * 1000)) {
+            close(server_fd);
+            record_server_outcome(server.location, "", started);
+            continue;
+        }
+        placement_begin(server.location);
+        targets.push_back(server);
+        server_fds.push_back(server_fd);
+    }
+    if (targets.empty()) {
+        return reject_upload(client_fd, req, content_length, "502 Bad Gateway");
+    }
+
+    std::vector<bool> delivered;
+    size_t moved = tee_body(client_fd, server_fds, content_length - prefix, RECV_TIMEOUT_MS, delivered);
+    std::vector<std::string> responses(targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        if (delivered[i]) {
+            responses[i] = read_server_response(server_fds[i]);
+        }
+        close(server_fds[i]);
+        record_server_outcome(targets[i].location, responses[i], started);
+        placement_end(targets[i].location, std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - started).count());
+    }
+    // И после неудачной записи: часть реплик могла ее принять
+    if (tile_upload) {
+        invalidate_cached_tile(uploaded_tile);
+    }
+
+    if (moved < content_length - prefix) {
+        // Тело от клиента не дочитано
+        return "HTTP/1.1 502 Bad Gateway\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+    }
+    // Клиенту - ответ первой успешно записавшей реплики
+    return first_success_response(responses);
+}
+
 std::string process_http_request(const HttpRequest& req, DBManager& db_manager) {
     if (req.method == "POST" && req.path == "/router/add") {
         nlohmann::json data = nlohmann::json::parse(req.body);
@@ -377,49 +1235,332 @@ std::string process_http_request(const HttpRequest& req, DBManager& db_manager)
         s.location = data["location"];
         s.class_type = data["class"];
         db_manager.insert_server(s);
+        server_table_rebuild(db_manager);
+        anti_entropy_server_added(s.location);
+        anti_entropy_mark_dirty();
         gossip_broadcast("POST", "/server/add", req.body);
         return "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n";
     }
-    if (req.method == "DELETE" && req.path.find("/server/remove/") == 0) {
-        int id = std::stoi(req.path.substr(strlen("/server/remove/")));
-        db_manager.delete_server(id);
-        gossip_broadcast("DELETE", req.path);
+    if (req.method == "POST" && req.path == "/server/heartbeat") {
+        try {
+            nlohmann::json data = nlohmann::json::parse(req.body);
+            LiveServerStats stats;
+            stats.location = data.at("location");
+            stats.ssd_free_bytes = data["ssd"].value("free_bytes", 0ULL);
+            stats.ssd_total_bytes = data["ssd"].value("total_bytes", 0ULL);
+            stats.hdd_free_bytes = data["hdd"].value("free_bytes", 0ULL);
+            stats.hdd_total_bytes = data["hdd"].value("total_bytes", 0ULL);
+            stats.queue_depth = data.value("queue_depth", 0);
+            stats.latency_ms = data.value("latency_ms", 0.0);
+            stats.interval_ms = data.value("interval_ms", 0);
+            live_view_update(stats);
+        } catch (...) {
+            return "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+        }
+        return "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n";
+    }
+    if (req.method == "GET" && req.path == "/server/live") {
+        nlohmann::json servers = nlohmann::json::array();
+        for (const auto& entry : live_view_snapshot()) {
+            LiveServerStats stats;
+            live_state_t state = live_view_lookup(entry.first, stats);
+            nlohmann::json server;
+            server["location"] = entry.first;
+            server["state"] = state == LIVE_FRESH ? "fresh" : "stale";
+            server["ssd_free_bytes"] = stats.ssd_free_bytes;
+            server["hdd_free_bytes"] = stats.hdd_free_bytes;
+            server["queue_depth"] = stats.queue_depth;
+            server["latency_ms"] = stats.latency_ms;
+            servers.push_back(server);
+        }
+        std::string json_response = servers.dump();
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.method == "GET" && req.path == "/cluster/load") {
+        std::string json_response = load_view_json();
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.method == "GET" && req.path == "/metrics/hedge") {
+        HedgeStats stats = hedge_get_stats();
+        nlohmann::json json_data;
+        json_data["requests"] = stats.requests;
+        json_data["hedges_sent"] = stats.hedges_sent;
+        json_data["hedge_wins"] = stats.hedge_wins;
+        json_data["primary_wins"] = stats.primary_wins;
+        json_data["budget_denied"] = stats.budget_denied;
+        json_data["failovers"] = stats.failovers;
+        json_data["failures"] = stats.failures;
+        json_data["budget_percent"] = stats.budget_percent;
+        json_data["hedge_rate"] = stats.requests > 0
+            ? static_cast<double>(stats.hedges_sent) / stats.requests : 0.0;
+        json_data["hedge_win_rate"] = stats.hedges_sent > 0
+            ? static_cast<double>(stats.hedge_wins) / stats.hedges_sent : 0.0;
+        json_data["p95_ms"] = nlohmann::json::object();
+        for (const auto& entry : hedge_delays_snapshot()) {
+            json_data["p95_ms"][std::to_string(entry.first)] = entry.second;
+        }
+        std::string json_response = json_data.dump();
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.method == "GET" && req.path == "/metrics/breaker") {
+        nlohmann::json servers = nlohmann::json::object();
+        for (const auto& entry : breaker_snapshot()) {
+            nlohmann::json server;
+            server["state"] = entry.second.state == BREAKER_CLOSED ? "closed" :
+                              entry.second.state == BREAKER_OPEN ? "open" : "half_open";
+            server["error_rate"] = entry.second.error_rate;
+            server["latency_ms"] = entry.second.latency_ms;
+            server["consecutive_failures"] = entry.second.consecutive_failures;
+            server["ejections"] = entry.second.ejections;
+            server["ejected_for_ms"] = entry.second.ejected_for_ms;
+            server["rejected"] = entry.second.rejected;
+            servers[entry.first] = server;
+        }
+        std::string json_response = servers.dump();
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    // Пакет gossip: каждое новое сообщение применяется как исходный запрос,
+    // а его gossip_broadcast пересылает сообщение дальше
+    if (req.method == "POST" && req.path == "/gossip/batch") {
+        std::string json_response;
+        bool ok = gossip_receive_batch(req.body, [&db_manager](const std::string& method, const std::string& path,
+                                                               const std::string& body) {
+            HttpRequest message;
+            message.method = method;
+            message.path = path;
+            message.body = body;
+            process_http_request(message, db_manager);
+        }, json_response);
+        if (!ok) {
+            return "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+        }
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.method == "GET" && req.path == "/metrics/gossip") {
+        GossipStats stats = gossip_get_stats();
+        nlohmann::json json_data;
+        json_data["enqueued"] = stats.enqueued;
+        json_data["queue_dropped"] = stats.queue_dropped;
+        json_data["batches_sent"] = stats.batches_sent;
+        json_data["messages_sent"] = stats.messages_sent;
+        json_data["messages_per_batch"] = stats.batches_sent > 0
+            ? static_cast<double>(stats.messages_sent) / stats.batches_sent
+            : 0.0;
+        json_data["send_failures"] = stats.send_failures;
+        json_data["connections_opened"] = stats.connections_opened;
+        json_data["bytes_sent"] = stats.bytes_sent;
+        json_data["received"] = stats.received;
+        json_data["duplicates"] = stats.duplicates;
+        json_data["ttl_expired"] = stats.ttl_expired;
+        std::string json_response = json_data.dump();
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    // Счетчики обращений (CRDT): дельты приходят через gossip, полное состояние
+    // забирают другие маршрутизаторы
+    if (req.method == "POST" && req.path == "/crdt/access") {
+        if (!access_counter_merge(req.body)) {
+            return "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+        }
         return "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
     }
-
-    if (req.method == "POST" && req.path == "/upload") {
-        // Получаем спектр из заголовков
-        const char* spectrum = nullptr;
-        for (const auto& header : req.headers) {
-            if (header.first == "X-Spectrum") {
-                spectrum = header.second.c_str();
-                break;
+    if (req.method == "GET" && req.path == "/crdt/access") {
+        std::string json_response;
+        auto image_id = req.query_params.find("image_id");
+        auto spectrum = req.query_params.find("spectrum");
+        if (image_id != req.query_params.end() && spectrum != req.query_params.end()) {
+            try {
+                json_response = access_counter_key_json(std::stoi(image_id->second), spectrum->second);
+            } catch (...) {
+                return "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
             }
+        } else {
+            json_response = access_counter_state();
         }
-
-        if (!spectrum) {
-            return "HTTP/1.1 400 Bad Request\r\n"
-                   "Content-Type: application/json\r\n"
-                   "Content-Length: 45\r\n\r\n"
-                   "{\"error\": \"Spectrum header is required\"}";
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    // Сверка каталогов между маршрутизаторами
+    if (req.method == "POST" && req.path.compare(0, 6, "/sync/") == 0 && req.path != "/sync/run") {
+        std::string json_response;
+        if (!anti_entropy_serve(db_manager, req.path, req.body, json_response)) {
+            return "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
         }
-
-        // Определяем тип хранилища
-        storage_type_t storage_type = determine_storage_type(spectrum);
-
-        // Распределяем данные
-        if (distribute_to_storage(storage_type, req.body.c_str(), req.body.length()) != 0) {
-            return "HTTP/1.1 500 Internal Server Error\r\n"
-                   "Content-Type: application/json\r\n"
-                   "Content-Length: 35\r\n\r\n"
-                   "{\"error\": \"Storage distribution failed\"}";
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.method == "GET" && req.path == "/snapshot") {
+        std::string body;
+        if (!snapshot_serve(db_manager, g_self_address, body)) {
+            return "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
         }
-
-        // Возвращаем успешный ответ
-        return "HTTP/1.1 200 OK\r\n"
-               "Content-Type: application/json\r\n"
-               "Content-Length: 35\r\n\r\n"
-               "{\"message\": \"File uploaded successfully\"}";
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n"
+               "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+    if (req.method == "GET" && req.path == "/snapshot/status") {
+        std::string json_response = snapshot_result_json(snapshot_last_bootstrap());
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.method == "POST" && req.path == "/sync/run") {
+        auto peer = req.query_params.find("peer");
+        if (peer == req.query_params.end()) {
+            return "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+        }
+        std::string json_response = anti_entropy_round_json(
+            anti_entropy_run(db_manager, normalize_router_address(peer->second)));
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.method == "GET" && req.path == "/sync/stats") {
+        AntiEntropyStats stats = anti_entropy_stats();
+        nlohmann::json json_data;
+        json_data["rounds"] = stats.rounds;
+        json_data["failed_rounds"] = stats.failed_rounds;
+        json_data["rows_pulled"] = stats.rows_pulled;
+        json_data["rows_pushed"] = stats.rows_pushed;
+        json_data["conflicts"] = stats.conflicts;
+        json_data["bytes"] = stats.bytes;
+        json_data["last"] = nlohmann::json::parse(anti_entropy_round_json(stats.last));
+        std::string json_response = json_data.dump();
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.method == "GET" && req.path == "/cluster/members") {
+        nlohmann::json json_data;
+        json_data["enabled"] = g_swim != nullptr;
+        nlohmann::json members = nlohmann::json::array();
+        if (g_swim) {
+            for (const auto& member : g_swim->members()) {
+                nlohmann::json item;
+                item["address"] = member.address;
+                item["http_address"] = member.http_address;
+                item["state"] = member.state == SWIM_ALIVE ? "alive" :
+                                member.state == SWIM_SUSPECT ? "suspect" : "dead";
+                item["incarnation"] = member.incarnation;
+                members.push_back(item);
+            }
+            SwimStats stats = g_swim->get_stats();
+            json_data["stats"]["pings_sent"] = stats.pings_sent;
+            json_data["stats"]["acks_received"] = stats.acks_received;
+            json_data["stats"]["ping_reqs_sent"] = stats.ping_reqs_sent;
+            json_data["stats"]["indirect_acks"] = stats.indirect_acks;
+            json_data["stats"]["suspicions"] = stats.suspicions;
+            json_data["stats"]["deaths"] = stats.deaths;
+            json_data["stats"]["refutations"] = stats.refutations;
+        }
+        json_data["members"] = members;
+        std::string json_response = json_data.dump();
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.method == "GET" && req.path == "/metrics/l1") {
+        RouterCacheStats stats = g_l1_cache->get_stats();
+        nlohmann::json json_data;
+        json_data["hits"] = stats.hits;
+        json_data["misses"] = stats.misses;
+        json_data["hit_ratio"] = stats.hits + stats.misses > 0
+            ? static_cast<double>(stats.hits) / (stats.hits + stats.misses)
+            : 0.0;
+        json_data["insertions"] = stats.insertions;
+        json_data["evictions"] = stats.evictions;
+        json_data["expirations"] = stats.expirations;
+        json_data["invalidations"] = stats.invalidations;
+        json_data["too_large"] = stats.too_large;
+        json_data["stale_fills"] = stats.stale_fills;
+        json_data["bytes"] = stats.bytes;
+        json_data["entries"] = stats.entries;
+        json_data["capacity_bytes"] = stats.capacity_bytes;
+        std::string json_response = json_data.dump();
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.method == "GET" && req.path == "/metrics/coalesce") {
+        SingleFlightStats stats = g_tile_listings->get_stats();
+        nlohmann::json json_data;
+        json_data["requests"] = stats.requests;
+        json_data["upstream"] = stats.upstream;
+        json_data["coalesced"] = stats.coalesced;
+        json_data["cache_hits"] = stats.cache_hits;
+        json_data["invalidations"] = stats.invalidations;
+        json_data["saved_ratio"] = stats.requests > 0
+            ? static_cast<double>(stats.requests - stats.upstream) / stats.requests
+            : 0.0;
+        std::string json_response = json_data.dump();
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    // Политика уровней хранения: текущие правила, перезагрузка файла и пробный прогон
+    if (req.path == "/tiering") {
+        if (req.method != "GET") {
+            return "HTTP/1.1 405 Method Not Allowed\r\n\r\n";
+        }
+        std::shared_ptr<const TieringPolicy> policy = tiering_current();
+        nlohmann::json json_data;
+        json_data["version"] = policy->version;
+        json_data["source"] = policy->source;
+        json_data["policy"] = nlohmann::json::parse(tiering_rules_json(*policy));
+        json_data["not_applied_to_placement"] = tiering_unapplied_rules(*policy);
+        std::string json_response = json_data.dump();
+        return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.path == "/tiering/reload") {
+        if (req.method != "POST") {
+            return "HTTP/1.1 405 Method Not Allowed\r\n\r\n";
+        }
+        std::string error;
+        if (tiering_rules_path().empty()) {
+            error = "файл правил не задан";
+        } else if (tiering_load(tiering_rules_path(), error)) {
+            std::shared_ptr<const TieringPolicy> policy = tiering_current();
+            std::string json_response = nlohmann::json({{"version", policy->version},
+                                                        {"not_applied_to_placement",
+                                                         tiering_unapplied_rules(*policy)}}).dump();
+            return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                   "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+        }
+        std::string json_response = nlohmann::json({{"error", error}}).dump();
+        return "HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+    }
+    if (req.path == "/tiering/report") {
+        // GET - действующая политика, POST - еще и кандидат из тела запроса
+        std::shared_ptr<const TieringPolicy> candidate;
+        if (req.method == "POST") {
+            std::string error;
+            std::shared_ptr<TieringPolicy> parsed = tiering_parse(req.body, error);
+            if (!parsed) {
+                std::string json_response = nlohmann::json({{"error", error}}).dump();
+                return "HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\n"
+                       "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n" + json_response;
+            }
+            parsed->source = "request";
+            candidate = parsed;
+        } else if (req.method != "GET") {
+            return "HTTP/1.1 405 Method Not Allowed\r\n\r\n";
+        }
+        return tiering_report(db_manager, candidate);
+    }
+    if (req.method == "DELETE" && req.path.find("/server/remove/") == 0) {
+        int id = std::stoi(req.path.substr(strlen("/server/remove/")));
+        std::shared_ptr<const ServerTable> table = current_server_table(db_manager);
+        auto removed = table->by_id.find(id);
+        if (removed != table->by_id.end()) {
+            breaker_remove(removed->second.location);
+            anti_entropy_server_removed(removed->second.location);
+            live_view_remove(removed->second.location);
+        }
+        db_manager.delete_server(id);
+        anti_entropy_mark_dirty();
+        server_table_rebuild(db_manager);
+        gossip_broadcast("DELETE", req.path);
+        return "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
     }
 
     std::string response;
@@ -433,35 +1574,42 @@ std::string process_http_request(const HttpRequest& req, DBManager& db_manager)
                 req.query_params.find("east") != req.query_params.end() &&
                 req.query_params.find("west") != req.query_params.end()) {
                 
-                // Получаем координаты из параметров
-                float north = std::stof(req.query_params["north"]);
-                float south = std::stof(req.query_params["south"]);
-                float east = std::stof(req.query_params["east"]);
-                float west = std::stof(req.query_params["west"]);
-                
-                // Ищем изображения в БД
-                std::vector<ImageInfo> images = db_manager.search_images(north, south, east, west);
-                
-                // Формируем JSON-ответ
-                std::string json_response = "{\"images\":[";
-                for (size_t i = 0; i < images.size(); ++i) {
-                    if (i > 0) json_response += ",";
-                    json_response += "{";
-                    json_response += "\"filename\":\"" + images[i].filename + "\",";
-                    json_response += "\"timestamp\":\"" + images[i].timestamp + "\",";
-                    json_response += "\"source\":\"" + images[i].source + "\",";
-                    json_response += "\"north_lat\":" + std::to_string(images[i].north_lat) + ",";
-                    json_response += "\"south_lat\":" + std::to_string(images[i].south_lat) + ",";
-                    json_response += "\"east_lon\":" + std::to_string(images[i].east_lon) + ",";
-                    json_response += "\"west_lon\":" + std::to_string(images[i].west_lon);
-                    json_response += "}";
+                try {
+                    // Получаем координаты из параметров
+                    float north = std::stof(req.query_params.at("north"));
+                    float south = std::stof(req.query_params.at("south"));
+                    float east = std::stof(req.query_params.at("east"));
+                    float west = std::stof(req.query_params.at("west"));
+                    size_t limit = DEFAULT_IMAGES_LIMIT;
+                    if (req.query_params.count("limit")) {
+                        limit = std::min<size_t>(std::stoul(req.query_params.at("limit")), MAX_IMAGES_LIMIT);
+                    }
+
+                    // Опрашиваем маршрутизаторы, владеющие префиксами области,
+                    // и сливаем их ответы по времени съемки. Объявленных SWIM мертвыми
+                    // не ждем - они сразу попадают в missing_routers
+                    std::set<std::string> dead_routers;
+                    if (g_swim) {
+                        for (const auto& address : g_swim->dead_http_addresses()) {
+                            dead_routers.insert(address);
+                        }
+                    }
+                    ImageSearchResult found = scatter_search_images(db_manager, north, south, east, west,
+                                                                    limit, g_self_address, g_scatter_timeout_ms,
+                                                                    dead_routers);
+
+                    nlohmann::json missing = found.missing_routers;
+                    std::string json_response = "{\"images\":" + images_to_json(found.images) +
+                                                ",\"partial\":" + (found.partial ? "true" : "false") +
+                                                ",\"missing_routers\":" + missing.dump() + "}";
+
+                    response = "HTTP/1.1 200 OK\r\n";
+                    response += "Content-Type: application/json\r\n";
+                    response += "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n";
+                    response += json_response;
+                } catch (...) {
+                    response = "HTTP/1.1 400 Bad Request\r\n\r\n";
                 }
-                json_response += "]}";
-                
-                response = "HTTP/1.1 200 OK\r\n";
-                response += "Content-Type: application/json\r\n";
-                response += "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n";
-                response += json_response;
             } else {
                 response = "HTTP/1.1 400 Bad Request\r\n\r\n";
             }
@@ -484,6 +1632,7 @@ std::string process_http_request(const HttpRequest& req, DBManager& db_manager)
                 // Вставляем изображение в БД
                 int image_id = db_manager.insert_image(data);
                 if (image_id > 0) {
+                    anti_entropy_mark_dirty();
                     // Формируем JSON-ответ
                     std::string json_response = "{\"image_id\":" + std::to_string(image_id) + "}";
                     
@@ -499,6 +1648,32 @@ std::string process_http_request(const HttpRequest& req, DBManager& db_manager)
             }
         }
     }
+    // Подзапрос распределенного поиска: только локальная БД, без дальнейшей рассылки
+    else if (req.path == "/images/local") {
+        if (req.method == "GET" && req.query_params.count("prefixes")) {
+            std::vector<std::string> prefixes;
+            std::istringstream prefix_stream(req.query_params.at("prefixes"));
+            std::string prefix;
+            while (std::getline(prefix_stream, prefix, ',')) {
+                if (!prefix.empty()) {
+                    prefixes.push_back(prefix);
+                }
+            }
+            size_t limit = DEFAULT_IMAGES_LIMIT;
+            if (req.query_params.count("limit")) {
+                limit = std::min<size_t>(std::strtoul(req.query_params.at("limit").c_str(), nullptr, 10),
+                                         MAX_IMAGES_LIMIT);
+            }
+            std::string json_response = "{\"images\":" +
+                images_to_json(db_manager.search_images_by_prefixes(prefixes, static_cast<int>(limit))) + "}";
+            response = "HTTP/1.1 200 OK\r\n";
+            response += "Content-Type: application/json\r\n";
+            response += "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n";
+            response += json_response;
+        } else {
+            response = "HTTP/1.1 400 Bad Request\r\n\r\n";
+        }
+    }
     // Обработка запросов для работы с тайлами
     else if (req.path == "/tiles") {
         if (req.method == "GET") {
@@ -514,8 +1689,11 @@ std::string process_http_request(const HttpRequest& req, DBManager& db_manager)
                     params["sort"] = "frequency";
                 }
                 
-                // Отправляем запрос к storage_server
-                std::string storage_response = send_request_to_storage("GET", "/tiles", "", params);
+                // Список собирается со всех storage-серверов; клиенты, открывшие
+                // тот же снимок одновременно, получают ответ одного сбора
+                std::string storage_response = g_tile_listings->get(
+                    tile_listing_key(image_id, params.count("sort") > 0),
+                    [&db_manager, &params]() { return fetch_tile_listing(db_manager, params); });
                 
                 if (!storage_response.empty()) {
                     response = storage_response;
@@ -530,31 +1708,102 @@ std::string process_http_request(const HttpRequest& req, DBManager& db_manager)
             try {
                 // Парсим JSON из тела запроса
                 nlohmann::json json_data = nlohmann::json::parse(req.body);
-                
-                // Отправляем запрос к storage_server
-                std::string storage_response = send_request_to_storage("POST", "/tiles", req.body);
-                
-                if (!storage_response.empty()) {
-                    response = storage_response;
-                } else {
-                    response = "HTTP/1.1 500 Internal Server Error\r\n\r\n";
+                TileRef tile;
+                tile.image_id = json_data.at("image_id").get<int>();
+                tile.spectrum = json_data.at("spectrum").get<std::string>();
+                tile.row = json_data.at("tile_row").get<int>();
+                tile.col = json_data.at("tile_column").get<int>();
+
+                // Запись тайла - на его владельцев по rendezvous-хешу, как и нагрузка
+                response = first_success_response(send_request_to_servers(
+                    locate_tile_servers(db_manager, tile, g_tile_replicas), "POST", "/tiles", req.body));
+                if (response.compare(0, 10, "HTTP/1.1 2") == 0) {
+                    // Список тайлов снимка изменился
+                    g_tile_listings->invalidate(tile_listing_key(tile.image_id, false));
+                    g_tile_listings->invalidate(tile_listing_key(tile.image_id, true));
                 }
             } catch (...) {
                 response = "HTTP/1.1 400 Bad Request\r\n\r\n";
             }
         }
     }
+    // Пакетное получение тайлов: по одному запросу к каждому владельцу вместо N
+    else if (req.path == "/tiles/batch") {
+        if (req.method == "POST") {
+            response = fetch_tile_batch(db_manager, req.body);
+        } else {
+            response = "HTTP/1.1 405 Method Not Allowed\r\n\r\n";
+        }
+    }
+    // Чтение тайла у владельца по rendezvous-хешу
+    else if (req.path == "/tiles/data") {
+        TileRef tile;
+        try {
+            tile.image_id = std::stoi(req.query_params.at("image_id"));
+            tile.spectrum = req.query_params.at("spectrum");
+            tile.row = std::stoi(req.query_params.at("row"));
+            tile.col = std::stoi(req.query_params.at("col"));
+        } catch (...) {
+            return "HTTP/1.1 400 Bad Request\r\n\r\n";
+        }
+        if (req.method == "POST") {
+            response = upload_tile(db_manager, tile, req.body);
+        } else if (req.method == "GET") {
+            access_counter_record(tile.image_id, tile.spectrum);
+            std::string cache_key = l1_tile_key(tile.image_id, tile.spectrum, tile.row, tile.col);
+            std::string payload;
+            if (g_l1_cache->get(cache_key, payload)) {
+                return tile_payload_response(payload);
+            }
+            uint64_t generation = g_l1_cache->generation(cache_key);
+            // Чтение с хеджированием: медленная реплика не определяет хвост задержки
+            storage_type_t storage_type = classify_tile(tile);
+            std::vector<ServerInfo> replicas = locate_tile_servers(db_manager, tile, g_tile_replicas, storage_type);
+            prefer_unloaded_replica(replicas, storage_type);
+            std::string storage_response = hedged_get(replicas, tile_data_path(tile));
+            // После смены правил спектра тайл мог остаться на прежнем уровне
+            std::string body;
+            if (split_http_response(storage_response, body) == 404) {
+                storage_type_t other = storage_type == HOT_STORAGE ? COLD_STORAGE : HOT_STORAGE;
+                std::string other_response = hedged_get(
+                    locate_tile_servers(db_manager, tile, g_tile_replicas, other), tile_data_path(tile));
+                if (split_http_response(other_response, body) == 200) {
+                    storage_response = other_response;
+                }
+            }
+            if (split_http_response(storage_response, body) == 200) {
+                g_l1_cache->put(cache_key, body, g_l1_tile_ttl_ms, generation);
+            }
+            response = !storage_response.empty() ? storage_response
+                                                 : "HTTP/1.1 502 Bad Gateway\r\n\r\n";
+        } else {
+            response = "HTTP/1.1 405 Method Not Allowed\r\n\r\n";
+        }
+    }
     // Обработка запроса на инкремент частоты обращения к тайлу
     else if (req.path.find("/tiles/") == 0 && req.path.find("/increment") != std::string::npos) {
         if (req.method == "POST") {
-            // Отправляем запрос к storage_server
-            std::string storage_response = send_request_to_storage("POST", req.path);
-            
-            if (!storage_response.empty()) {
-                response = storage_response;
+            // С image_id и spectrum - владельцам тайла; без них тайл не найти
+            // по хешу, и запрос получают все серверы
+            std::vector<ServerInfo> servers;
+            auto image_param = req.query_params.find("image_id");
+            auto spectrum_param = req.query_params.find("spectrum");
+            if (image_param != req.query_params.end() && spectrum_param != req.query_params.end()) {
+                try {
+                    std::string path_part = req.path.substr(strlen("/tiles/"));
+                    TileRef tile;
+                    tile.image_id = std::stoi(image_param->second);
+                    tile.spectrum = spectrum_param->second;
+                    tile.row = std::stoi(path_part);
+                    tile.col = std::stoi(path_part.substr(path_part.find('/') + 1));
+                    servers = locate_tile_servers(db_manager, tile, g_tile_replicas);
+                } catch (...) {
+                    return "HTTP/1.1 400 Bad Request\r\n\r\n";
+                }
             } else {
-                response = "HTTP/1.1 500 Internal Server Error\r\n\r\n";
+                servers = all_storage_servers(db_manager);
             }
+            response = first_success_response(send_request_to_servers(servers, "POST", req.path));
         }
     }
     else {
@@ -564,19 +1813,130 @@ std::string process_http_request(const HttpRequest& req, DBManager& db_manager)
     return response;
 }
 
+// Ожидание данных на неблокирующем сокете; false по таймауту
+static bool wait_readable(int sock_fd) {
+    pollfd pfd = {sock_fd, POLLIN, 0};
+    return poll(&pfd, 1, RECV_TIMEOUT_MS) > 0;
+}
+
+// Чтение заголовков запроса. В raw может попасть и начало тела,
+// в content_length - длина тела по заголовку Content-Length
+ssize_t read_http_headers(int sock_fd, std::string &raw, size_t &content_length) {
+    char buf[65536];
+    size_t header_end = std::string::npos;
+
+    while (header_end == std::string::npos) {
+        ssize_t nbytes = recv(sock_fd, buf, sizeof(buf), 0);
+        if (nbytes > 0) {
+            raw.append(buf, nbytes);
+        } else if (nbytes == 0) {
+            return raw.size();
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (!wait_readable(sock_fd)) {
+                return raw.size();
+            }
+            continue;
+        } else {
+            return -1;
+        }
+        header_end = raw.find("\r\n\r\n");
+    }
+
+    content_length = 0;
+    std::string headers = raw.substr(0, header_end);
+    std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+    size_t cl_pos = headers.find("content-length:");
+    if (cl_pos != std::string::npos) {
+        content_length = std::strtoull(headers.c_str() + cl_pos + 15, nullptr, 10);
+    }
+    return raw.size();
+}
+
+// Дочитывание тела запроса после read_http_headers до длины content_length
+ssize_t read_http_body(int sock_fd, std::string &raw, size_t content_length) {
+    size_t header_end = raw.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        return raw.size();
+    }
+    size_t expected = header_end + 4 + content_length;
+    if (expected > MAX_REQUEST_SIZE) {
+        return -1;
+    }
+
+    char buf[65536];
+    while (raw.size() < expected) {
+        ssize_t nbytes = recv(sock_fd, buf, sizeof(buf), 0);
+        if (nbytes > 0) {
+            raw.append(buf, nbytes);
+        } else if (nbytes == 0) {
+            break;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (!wait_readable(sock_fd)) {
+                break;
+            }
+        } else {
+            return -1;
+        }
+    }
+    return raw.size();
+}
+
+// Чтение запроса целиком: заголовки и тело длиной Content-Length.
+// Сокет неблокирующий, поэтому между порциями ждем данные через poll
+ssize_t read_http_request(int sock_fd, std::string &raw) {
+    size_t content_length = 0;
+    if (read_http_headers(sock_fd, raw, content_length) < 0) {
+        return -1;
+    }
+    return read_http_body(sock_fd, raw, content_length);
+}
+
+// Является ли запрос загрузкой, тело которой пересылается потоком
+static bool is_streamed_upload(const std::string &raw) {
+    return raw.compare(0, 13, "POST /upload ") == 0 || raw.compare(0, 13, "POST /upload?") == 0;
+}
+
 // Модифицируем функцию handle_socket
+// Соединение остается открытым, только если клиент попросил keep-alive
+// и длина ответа известна из Content-Length
+static bool keep_connection(const HttpRequest& req, const std::string& raw, const std::string& response) {
+    std::string connection;
+    if (is_streamed_upload(raw) || !header_value(req, "Connection", connection)) {
+        return false;
+    }
+    std::transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
+    size_t head_end = response.find("\r\n\r\n");
+    return connection == "keep-alive" && head_end != std::string::npos &&
+           response.substr(0, head_end).find("Content-Length:") != std::string::npos;
+}
+
 int handle_socket(int sock_fd) {
-    char buf[4096];
-    ssize_t nbytes = recv(sock_fd, &buf, 4096, 0);
-    if ((nbytes <= 0) && (errno != EAGAIN)) {
+    std::string raw;
+    size_t content_length = 0;
+    ssize_t nbytes = read_http_headers(sock_fd, raw, content_length);
+    if (nbytes > 0 && !is_streamed_upload(raw)) {
+        nbytes = read_http_body(sock_fd, raw, content_length);
+    }
+    if (nbytes <= 0) {
         shutdown(sock_fd, SHUT_RDWR);
         close(sock_fd);
         return -1;
-    } else if (nbytes > 0) {
-        HttpRequest req = parse_http_request(buf, nbytes);
+    } else {
+        HttpRequest req = parse_http_request(raw.data(), raw.size());
         DBManager db_manager;
-        std::string response = process_http_request(req, db_manager);
-        send_response(sock_fd, response);
+        // Тело загрузки не читается целиком: оно пересылается на storage-сервер потоком
+        std::string response = is_streamed_upload(raw)
+            ? proxy_upload(sock_fd, req, content_length, db_manager)
+            : process_http_request(req, db_manager);
+        if (send_response(sock_fd, response) == 0 && keep_connection(req, raw, response)) {
+            // Следующий запрос по этому соединению придет через epoll основного цикла
+            epoll_event ev;
+            ev.data.fd = sock_fd;
+            ev.events = EPOLLIN;
+            if (epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, sock_fd, &ev) == 0) {
+                return 0;
+            }
+        }
         shutdown(sock_fd, SHUT_RDWR);
         close(sock_fd);
     }
@@ -585,9 +1945,21 @@ int handle_socket(int sock_fd) {
 
 // Функция отправки ответа
 int send_response(int socket_fd, const std::string &response) {
-    if (send(socket_fd, response.c_str(), response.size(), 0) < 0) {
-        perror("Cannot send to socket in send_response: ");
-        return -1;
+    // Бинарный ответ (пакет тайлов) может не поместиться в буфер сокета за раз
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(socket_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                pollfd pfd = {socket_fd, POLLOUT, 0};
+                if (poll(&pfd, 1, RECV_TIMEOUT_MS) > 0) {
+                    continue;
+                }
+            }
+            perror("Cannot send to socket in send_response: ");
+            return -1;
+        }
+        sent += n;
     }
     return 0; 
 }
\ No newline at end of file
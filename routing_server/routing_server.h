@@ -5,12 +5,37 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <sys/types.h>
 #include "db_manager.h"
+#include "rendezvous.h"
 
 struct routing_server_options {
     uint32_t server_ip;
     uint16_t server_port;
     int workers_count;
+    int tile_replicas = 2;              // На сколько серверов записывается тайл
+    double hedge_budget_percent = 5.0;  // Предел доли хеджированных чтений
+    int scatter_timeout_ms = 2000;      // Ожидание маршрутизаторов при поиске /images
+    std::string tiering_rules_path;     // JSON с правилами уровней хранения ("" - встроенные)
+    int tiering_reload_ms = 5000;       // Период проверки файла правил на изменения
+    int tiles_cache_ttl_ms = 1000;      // Время жизни кешированного списка тайлов (0 - без кеша)
+    size_t l1_cache_bytes = 256 * 1024 * 1024;  // Объем кеша L1 тайлов и списков (0 - без кеша)
+    int l1_tile_ttl_ms = 300000;        // Время жизни нагрузки тайла в L1
+    uint16_t swim_port = 0;             // UDP-порт членства SWIM (0 - выключено)
+    std::vector<std::string> swim_seeds;  // UDP-адреса "ip:port" известных маршрутизаторов
+    int swim_period_ms = 1000;          // Период протокола SWIM
+    int anti_entropy_period_ms = 30000;  // Период сверки каталога со случайным маршрутизатором (0 - выключено)
+    int gossip_fanout = 2;              // Маршрутизаторов на сообщение gossip на каждом шаге (не меньше 4)
+    int gossip_ttl = 4;                 // Шагов пересылки gossip (не меньше ceil(log2(n + 1)) + 2)
+    int gossip_flush_ms = 50;           // Сбор сообщений gossip в пакет перед отправкой
+    int access_flush_ms = 1000;         // Рассылка дельт счетчиков обращений (0 - счетчики выключены)
+    int access_sync_period_ms = 5000;   // Забор полного состояния счетчиков у случайного маршрутизатора
+    int access_epoch_sec = 3600;        // Эпоха счетчиков обращений
+    double access_half_life_epochs = 24;  // За столько эпох вклад обращений уменьшается вдвое
+    int load_interval_ms = 1000;        // Рассылка сводок нагрузки серверов без других сообщений gossip (0 - выключено)
+    int load_stale_ms = 5000;           // Сводки нагрузки старше этого не учитываются
+    size_t load_max_entries = 256;      // Сводок нагрузки в одном пакете gossip
+    std::string bootstrap_peer;         // Маршрутизатор "ip:port", с которого загружается снимок каталога при старте
 };
 
 // Флаг для остановки сервера
@@ -22,6 +47,13 @@ int routing_server_run(const routing_server_options &opts);
 // Функция обработки сокета
 int handle_socket(int sock_fd);
 
+// Чтение HTTP-запроса целиком (с телом по Content-Length)
+ssize_t read_http_request(int sock_fd, std::string &raw);
+
+// Чтение только заголовков (в raw может попасть начало тела) и дочитывание тела
+ssize_t read_http_headers(int sock_fd, std::string &raw, size_t &content_length);
+ssize_t read_http_body(int sock_fd, std::string &raw, size_t content_length);
+
 // Функция отправки ответа
 int send_response(int socket_fd, const std::string &response);
 
@@ -46,30 +78,53 @@ typedef enum {
     COLD_STORAGE
 } storage_type_t;
 
-// Функция для определения типа хранилища на основе спектра
+// Уровень хранилища по спектру согласно текущей политике (tiering_policy.h)
 storage_type_t determine_storage_type(const char* spectrum);
 
-// Функция для распределения данных в соответствующее хранилище
-int distribute_to_storage(storage_type_t storage_type, const char* data, size_t data_size);
-
-// Структура для хранения информации о сервере
-struct ServerInfo {
-    int server_id;
-    int ssd_fullness;
-    int ssd_volume;
-    int hdd_volume;
-    int hdd_fullness;
-    std::string location;
-    std::string class_type;
-};
+// Структура ServerInfo объявлена в db_manager.h
 
 // Функция для получения списка серверов определенного типа
 std::vector<ServerInfo> get_servers_by_type(DBManager& db_manager, const std::string& storage_type);
 
-// Функция для выбора оптимального сервера
-ServerInfo select_optimal_server(const std::vector<ServerInfo>& servers, size_t data_size);
+// Функция для выбора оптимального сервера; место учитывается на диске уровня
+// storage_type (горячий - SSD, холодный - HDD)
+ServerInfo select_optimal_server(const std::vector<ServerInfo>& servers, storage_type_t storage_type,
+                                 size_t data_size);
+
+// Соединение со storage-сервером по адресу "host[:port]" (порт по умолчанию 8080).
+// В host_header - значение для заголовка Host; -1 при ошибке.
+// С nonblock соединение устанавливается асинхронно (готовность - по POLLOUT).
+// Автомат защиты (circuit_breaker.h) - только для storage-серверов: запросы
+// к другим маршрутизаторам идут с use_breaker = false
+int connect_to_server(const std::string& location, std::string& host_header, bool nonblock = false,
+                      bool use_breaker = true);
+
+// Отправка HTTP-запроса на storage-сервер (или, с use_breaker = false, на другой
+// маршрутизатор) по адресу "host[:port]" (порт по умолчанию 8080)
+std::string send_request_to_server(const std::string& location, const std::string& method,
+                                   const std::string& path, const std::string& body = "",
+                                   const std::map<std::string, std::string>& query_params = {},
+                                   bool use_breaker = true);
+
+// Позиция тайла в запросах маршрутизатора
+struct TileRef {
+    int image_id = 0;
+    std::string spectrum;
+    int row = 0;
+    int col = 0;
+};
+
+// Узлы rendezvous-хеширования с весом по объему серверов
+std::vector<HrwNode> make_hrw_nodes(const std::vector<ServerInfo>& servers);
+
+// До count серверов уровня тайла в порядке убывания HRW-оценки
+// (первый - владелец, остальные - кандидаты в реплики).
+// Уровень выбирается политикой (tiering_policy.h) или задается явно
+std::vector<ServerInfo> locate_tile_servers(DBManager& db_manager, const TileRef& tile, size_t count);
+std::vector<ServerInfo> locate_tile_servers(DBManager& db_manager, const TileRef& tile, size_t count,
+                                            storage_type_t storage_type);
 
-// Функция для отправки данных на выбранный сервер
-int send_data_to_server(const ServerInfo& server, const char* data, size_t data_size);
+// Сбросить копию тайла в кеше L1 (запись тайла, перенос между уровнями)
+void invalidate_cached_tile(const TileRef& tile);
 
 #endif // ROUTING_SERVER_H 
\ No newline at end of file
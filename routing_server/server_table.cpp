@@ -0,0 +1,42 @@
+#include "server_table.h"
+#include "routing_server.h"
+#include <atomic>
+#include <mutex>
+
+// Классы серверов из ограничения CHECK таблицы Servers
+static const char* SERVER_CLASSES[] = {"hot", "cold", "mixed"};
+
+static std::shared_ptr<const ServerTable> g_server_table = std::make_shared<const ServerTable>();
+// Пересборки выполняются по одной, чтобы версии шли по порядку
+static std::mutex g_rebuild_mtx;
+
+std::shared_ptr<const ServerTable> server_table_current() {
+    return std::atomic_load(&g_server_table);
+}
+
+void server_table_rebuild(DBManager& db_manager) {
+    std::lock_guard<std::mutex> lock(g_rebuild_mtx);
+    auto table = std::make_shared<ServerTable>();
+    table->version = std::atomic_load(&g_server_table)->version + 1;
+    for (const char* class_type : SERVER_CLASSES) {
+        std::vector<ServerInfo> servers = db_manager.get_servers_by_type(class_type);
+        for (const auto& server : servers) {
+            table->by_id[server.server_id] = server;
+        }
+        table->hrw_by_class[class_type] = make_hrw_nodes(servers);
+        table->by_class[class_type].swap(servers);
+    }
+    std::atomic_store(&g_server_table, std::shared_ptr<const ServerTable>(std::move(table)));
+}
+
+const std::vector<ServerInfo>& server_table_class(const ServerTable& table, const std::string& class_type) {
+    static const std::vector<ServerInfo> empty;
+    auto it = table.by_class.find(class_type);
+    return it != table.by_class.end() ? it->second : empty;
+}
+
+const std::vector<HrwNode>& server_table_hrw(const ServerTable& table, const std::string& class_type) {
+    static const std::vector<HrwNode> empty;
+    auto it = table.hrw_by_class.find(class_type);
+    return it != table.hrw_by_class.end() ? it->second : empty;
+}
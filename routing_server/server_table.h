@@ -0,0 +1,34 @@
+#ifndef SERVER_TABLE_H
+#define SERVER_TABLE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "db_manager.h"
+#include "rendezvous.h"
+
+// Неизменяемый снимок таблицы Servers, сгруппированный по классу.
+// Читатели получают указатель на текущий снимок без блокировок и работают
+// с ним сколько угодно; новый снимок собирается целиком и подменяет старый
+// атомарно, старый освобождается, когда его отпустит последний читатель
+struct ServerTable {
+    uint64_t version = 0;
+    std::map<std::string, std::vector<ServerInfo>> by_class;   // "hot", "cold", "mixed"
+    std::map<std::string, std::vector<HrwNode>> hrw_by_class;  // Узлы rendezvous-хеширования в том же порядке
+    std::map<int, ServerInfo> by_id;
+};
+
+// Текущий снимок; пока таблица не загружалась - пустой снимок версии 0
+std::shared_ptr<const ServerTable> server_table_current();
+
+// Перечитать Servers из БД и опубликовать новый снимок.
+// Вызывается при старте, /server/add, /server/remove и их gossip-копиях
+void server_table_rebuild(DBManager& db_manager);
+
+// Серверы класса из текущего снимка
+const std::vector<ServerInfo>& server_table_class(const ServerTable& table, const std::string& class_type);
+const std::vector<HrwNode>& server_table_hrw(const ServerTable& table, const std::string& class_type);
+
+#endif // SERVER_TABLE_H
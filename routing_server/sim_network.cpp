@@ -0,0 +1,82 @@
+#include "sim_network.h"
+#include <algorithm>
+
+SimNetwork::SimNetwork(uint64_t seed) : rng_(seed) {}
+
+void SimNetwork::schedule(SimTime delay, std::function<void()> action) {
+    events_.push(Event{now_ + delay, next_order_++, std::move(action)});
+}
+
+void SimNetwork::every(SimTime first, SimTime period, std::function<void()> action) {
+    schedule(first, [this, period, action]() {
+        action();
+        every(period, period, action);
+    });
+}
+
+bool SimNetwork::send(int from, int to, std::function<void()> deliver) {
+    stats_.sent++;
+    if (!reachable(from, to)) {
+        stats_.partitioned++;
+        return false;
+    }
+    if (loss_ > 0 && std::uniform_real_distribution<double>(0, 1)(rng_) < loss_) {
+        stats_.lost++;
+        return false;
+    }
+    schedule(sample_latency(), [this, deliver]() {
+        stats_.delivered++;
+        deliver();
+    });
+    return true;
+}
+
+void SimNetwork::set_latency(double base_ms, double tail_ms) {
+    base_ms_ = base_ms;
+    tail_ms_ = tail_ms;
+}
+
+SimTime SimNetwork::sample_latency() {
+    double delay = base_ms_;
+    if (tail_ms_ > 0) {
+        delay += std::exponential_distribution<double>(1 / tail_ms_)(rng_);
+    }
+    return delay;
+}
+
+void SimNetwork::set_loss(double probability) {
+    loss_ = probability;
+}
+
+void SimNetwork::partition(const std::vector<int>& side) {
+    side_.clear();
+    for (int node : side) {
+        if (node >= static_cast<int>(side_.size())) {
+            side_.resize(node + 1, false);
+        }
+        side_[node] = true;
+    }
+}
+
+void SimNetwork::heal() {
+    side_.clear();
+}
+
+bool SimNetwork::reachable(int from, int to) const {
+    auto in_side = [this](int node) { return node >= 0 && node < static_cast<int>(side_.size()) && side_[node]; };
+    return in_side(from) == in_side(to);
+}
+
+void SimNetwork::run(SimTime until, const std::function<bool()>& stop) {
+    while (!events_.empty() && events_.top().time <= until) {
+        if (stop && stop()) {
+            return;
+        }
+        Event event = events_.top();
+        events_.pop();
+        now_ = event.time;
+        stats_.events++;
+        event.action();
+    }
+    now_ = std::max(now_, until);
+}
@@ -0,0 +1,81 @@
+#ifndef SIM_NETWORK_H
+#define SIM_NETWORK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+// Дискретно-событийная модель сети для имитации кластера в одном процессе.
+// Время модельное (мс) и идет скачками от события к событию, поэтому сотни
+// узлов и минуты работы кластера считаются за секунды, а прогон с тем же
+// seed повторяется в точности. Узлы - номера 0..n-1; сообщение доставляется
+// через задержку base + экспоненциальный хвост или теряется с заданной
+// вероятностью, а также если отправитель и получатель по разные стороны
+// разделения сети
+
+typedef double SimTime;
+
+struct SimNetworkStats {
+    uint64_t sent = 0;
+    uint64_t delivered = 0;
+    uint64_t lost = 0;         // Случайные потери
+    uint64_t partitioned = 0;  // Отброшены разделением сети
+    uint64_t events = 0;
+};
+
+class SimNetwork {
+public:
+    explicit SimNetwork(uint64_t seed);
+
+    SimTime now() const { return now_; }
+    std::mt19937_64& rng() { return rng_; }
+
+    // Действие через delay мс модельного времени
+    void schedule(SimTime delay, std::function<void()> action);
+
+    // Повтор действия каждые period мс, первый раз через first мс
+    void every(SimTime first, SimTime period, std::function<void()> action);
+
+    // Доставка сообщения от from к to; false - сообщение потеряно
+    bool send(int from, int to, std::function<void()> deliver);
+
+    // Задержка доставки: base_ms + экспоненциальная добавка со средним tail_ms
+    void set_latency(double base_ms, double tail_ms);
+    SimTime sample_latency();
+    void set_loss(double probability);
+
+    // Узлы side не обмениваются сообщениями с остальными до heal
+    void partition(const std::vector<int>& side);
+    void heal();
+    bool reachable(int from, int to) const;
+
+    // Обработка событий до момента until или пока stop не вернет true
+    void run(SimTime until, const std::function<bool()>& stop = nullptr);
+
+    const SimNetworkStats& stats() const { return stats_; }
+
+private:
+    struct Event {
+        SimTime time;
+        uint64_t order;  // Порядок постановки: равные по времени события детерминированы
+        std::function<void()> action;
+        bool operator>(const Event& other) const {
+            return time != other.time ? time > other.time : order > other.order;
+        }
+    };
+
+    SimTime now_ = 0;
+    uint64_t next_order_ = 0;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+    std::mt19937_64 rng_;
+    double base_ms_ = 0.5;
+    double tail_ms_ = 0.5;
+    double loss_ = 0;
+    std::vector<bool> side_;  // side_[node] - узел в отделенной части
+    SimNetworkStats stats_;
+};
+
+#endif // SIM_NETWORK_H
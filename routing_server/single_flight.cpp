@@ -0,0 +1,61 @@
+#include "single_flight.h"
+
+SingleFlight::SingleFlight(RouterCache& cache, int ttl_ms) : cache(cache), ttl_ms(ttl_ms) {}
+
+std::string SingleFlight::get(const std::string& key, const std::function<std::string()>& fetch) {
+    std::shared_ptr<Flight> flight;
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        stats.requests++;
+        std::string cached;
+        if (ttl_ms > 0 && cache.get(key, cached)) {
+            stats.cache_hits++;
+            return cached;
+        }
+
+        auto running = flights.find(key);
+        if (running != flights.end()) {
+            // Ждем ответа выполняющегося запроса
+            std::shared_ptr<Flight> leader = running->second;
+            stats.coalesced++;
+            cv.wait(lock, [&leader]() { return leader->done; });
+            return leader->response;
+        }
+        flight = std::make_shared<Flight>();
+        flights[key] = flight;
+        stats.upstream++;
+    }
+
+    std::string response;
+    try {
+        response = fetch();
+    } catch (...) {
+        response.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    flight->response = response;
+    flight->done = true;
+    flights.erase(key);
+    if (!flight->stale && response.compare(0, 10, "HTTP/1.1 2") == 0) {
+        cache.put(key, response, ttl_ms);
+    }
+    cv.notify_all();
+    return response;
+}
+
+void SingleFlight::invalidate(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (cache.invalidate(key)) {
+        stats.invalidations++;
+    }
+    auto running = flights.find(key);
+    if (running != flights.end()) {
+        running->second->stale = true;
+    }
+}
+
+SingleFlightStats SingleFlight::get_stats() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return stats;
+}
@@ -0,0 +1,54 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "router_cache.h"
+
+// Счетчики объединения запросов
+struct SingleFlightStats {
+    uint64_t requests = 0;       // Все обращения к get
+    uint64_t upstream = 0;       // Реально выполненные запросы к storage
+    uint64_t coalesced = 0;      // Дождались чужого запроса вместо своего
+    uint64_t cache_hits = 0;     // Ответ взят из кеша
+    uint64_t invalidations = 0;  // Записи, сброшенные invalidate
+};
+
+// Объединение одинаковых запросов: пока запрос с ключом выполняется, остальные
+// с тем же ключом ждут его ответа, а не делают свой. Успешный (2xx) ответ
+// кладется в кеш L1 на ttl_ms, так что и идущие следом запросы не уходят на storage
+class SingleFlight {
+private:
+    // Выполняющийся запрос, который ждут остальные
+    struct Flight {
+        bool done = false;
+        bool stale = false;  // Сброшен invalidate во время выполнения: ответ не кешируется
+        std::string response;
+    };
+
+    RouterCache& cache;
+    int ttl_ms;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::map<std::string, std::shared_ptr<Flight>> flights;
+    SingleFlightStats stats;
+
+public:
+    SingleFlight(RouterCache& cache, int ttl_ms);
+
+    // Ответ по ключу: из кеша, от уже идущего запроса или от fetch
+    std::string get(const std::string& key, const std::function<std::string()>& fetch);
+
+    // Сбросить кешированный ответ (данные по ключу изменились)
+    void invalidate(const std::string& key);
+
+    SingleFlightStats get_stats();
+};
+
+#endif // SINGLE_FLIGHT_H
@@ -0,0 +1,119 @@
+#include "snapshot_bootstrap.h"
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include "anti_entropy.h"
+#include "routing_server.h"
+
+// Сколько секунд готовый снимок отдается повторно
+const int SNAPSHOT_CACHE_SEC = 10;
+
+static std::mutex g_serve_mutex;  // Заодно не дает выгружать каталог параллельно
+static std::string g_cached_snapshot;
+static std::chrono::steady_clock::time_point g_cached_at;
+static std::mutex g_result_mutex;
+static SnapshotBootstrapResult g_last_result;
+
+bool snapshot_serve(DBManager& db_manager, const std::string& self_address, std::string& body) {
+    std::lock_guard<std::mutex> lock(g_serve_mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (!g_cached_snapshot.empty() && now - g_cached_at < std::chrono::seconds(SNAPSHOT_CACHE_SEC)) {
+        body = g_cached_snapshot;
+        return true;
+    }
+    CatalogSnapshot snapshot;
+    snapshot.source = self_address;
+    snapshot.created_at = std::time(nullptr);
+    snapshot.tables = catalog_snapshot_tables();
+    if (!db_manager.export_tables(snapshot.tables, snapshot.wal_position)) {
+        return false;
+    }
+    // Быстрый уровень zlib: текст COPY сжимается хорошо и так, а снимок
+    // собирается, пока новый маршрутизатор ждет
+    g_cached_snapshot = catalog_snapshot_encode(snapshot, 1);
+    g_cached_at = now;
+    body = g_cached_snapshot;
+    return true;
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+static SnapshotBootstrapResult finish(const SnapshotBootstrapResult& result) {
+    std::lock_guard<std::mutex> lock(g_result_mutex);
+    g_last_result = result;
+    return result;
+}
+
+SnapshotBootstrapResult snapshot_bootstrap(DBManager& db_manager, const std::string& peer) {
+    SnapshotBootstrapResult result;
+    result.peer = peer;
+    auto started = std::chrono::steady_clock::now();
+    std::string reply = send_request_to_server(peer, "GET", "/snapshot", "", {}, false);
+    size_t body_pos = reply.find("\r\n\r\n");
+    if (reply.compare(0, 12, "HTTP/1.1 200") != 0 || body_pos == std::string::npos) {
+        result.error = "snapshot request failed";
+        return finish(result);
+    }
+    result.bytes = reply.size() - body_pos - 4;
+    result.fetch_ms = elapsed_ms(started);
+
+    CatalogSnapshot snapshot;
+    if (!catalog_snapshot_decode(reply.substr(body_pos + 4), snapshot, result.error)) {
+        return finish(result);
+    }
+    // Имена таблиц попадают в COPY, поэтому берутся только известные, в своем
+    // порядке и со своими столбцами SERIAL
+    std::map<std::string, const CatalogTableCopy*> received;
+    for (const auto& table : snapshot.tables) {
+        received[table.table] = &table;
+    }
+    std::vector<CatalogTableCopy> tables = catalog_snapshot_tables();
+    for (auto& table : tables) {
+        auto it = received.find(table.table);
+        if (it == received.end()) {
+            result.error = "snapshot has no table " + table.table;
+            return finish(result);
+        }
+        table.data = it->second->data;
+        result.raw_bytes += table.data.size();
+        result.rows += catalog_snapshot_rows(table);
+    }
+    result.wal_position = snapshot.wal_position;
+    result.created_at = snapshot.created_at;
+
+    auto load_started = std::chrono::steady_clock::now();
+    if (!db_manager.import_tables(tables)) {
+        result.error = "snapshot load failed";
+        return finish(result);
+    }
+    result.load_ms = elapsed_ms(load_started);
+    anti_entropy_mark_dirty();
+    result.ok = true;
+    return finish(result);
+}
+
+SnapshotBootstrapResult snapshot_last_bootstrap() {
+    std::lock_guard<std::mutex> lock(g_result_mutex);
+    return g_last_result;
+}
+
+std::string snapshot_result_json(const SnapshotBootstrapResult& result) {
+    nlohmann::json json_data;
+    json_data["ok"] = result.ok;
+    json_data["peer"] = result.peer;
+    if (!result.error.empty()) {
+        json_data["error"] = result.error;
+    }
+    json_data["wal_position"] = result.wal_position;
+    json_data["created_at"] = result.created_at;
+    json_data["bytes"] = result.bytes;
+    json_data["raw_bytes"] = result.raw_bytes;
+    json_data["rows"] = result.rows;
+    json_data["fetch_ms"] = result.fetch_ms;
+    json_data["load_ms"] = result.load_ms;
+    return json_data.dump();
+}
@@ -0,0 +1,40 @@
+#ifndef SNAPSHOT_BOOTSTRAP_H
+#define SNAPSHOT_BOOTSTRAP_H
+
+#include <string>
+#include "catalog_snapshot.h"
+#include "db_manager.h"
+
+// Старт нового маршрутизатора со снимка каталога (catalog_snapshot.h):
+// работающий маршрутизатор отдает снимок по GET /snapshot, новый загружает
+// его через COPY вместо пустой БД, а изменения после снимка получает через
+// gossip и один раунд сверки (anti_entropy.h) с тем же маршрутизатором
+
+struct SnapshotBootstrapResult {
+    bool ok = false;
+    std::string peer;
+    std::string error;
+    std::string wal_position;  // Позиция WAL источника на момент снимка
+    int64_t created_at = 0;
+    size_t bytes = 0;          // Сжатый снимок
+    size_t raw_bytes = 0;      // Данные COPY всех таблиц
+    size_t rows = 0;
+    double fetch_ms = 0;
+    double load_ms = 0;
+};
+
+// GET /snapshot: сжатый снимок каталога. Снимок переиспользуется несколько
+// секунд, чтобы одновременно стартующие маршрутизаторы не выгружали БД
+// каждый заново. false - выгрузка не удалась
+bool snapshot_serve(DBManager& db_manager, const std::string& self_address, std::string& body);
+
+// Загрузка каталога со снимка маршрутизатора peer ("ip:port"). При ошибке
+// локальный каталог не меняется
+SnapshotBootstrapResult snapshot_bootstrap(DBManager& db_manager, const std::string& peer);
+
+// Итог последней загрузки (GET /snapshot/status)
+SnapshotBootstrapResult snapshot_last_bootstrap();
+
+std::string snapshot_result_json(const SnapshotBootstrapResult& result);
+
+#endif // SNAPSHOT_BOOTSTRAP_H
@@ -0,0 +1,482 @@
+#include "swim.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <nlohmann/json.hpp>
+
+// Наибольший размер датаграммы протокола
+const size_t SWIM_MAX_DATAGRAM = 8192;
+// Поток протокола просыпается не реже, чтобы вовремя заметить stop
+const int SWIM_MAX_WAIT_MS = 100;
+
+static bool parse_udp_address(const std::string& address, sockaddr_in& addr) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    addr = sockaddr_in();
+    addr.sin_family = AF_INET;
+    try {
+        addr.sin_port = htons(static_cast<uint16_t>(std::stoi(address.substr(colon + 1))));
+    } catch (...) {
+        return false;
+    }
+    return inet_pton(AF_INET, address.substr(0, colon).c_str(), &addr.sin_addr) == 1;
+}
+
+static const char* state_name(swim_state_t state) {
+    return state == SWIM_ALIVE ? "alive" : state == SWIM_SUSPECT ? "suspect" : "dead";
+}
+
+static swim_state_t parse_state(const std::string& name) {
+    return name == "suspect" ? SWIM_SUSPECT : name == "dead" ? SWIM_DEAD : SWIM_ALIVE;
+}
+
+SwimMembership::SwimMembership(const std::string& bind_address, const std::string& http_address,
+                               const SwimConfig& config)
+    : bind_address(bind_address), http_address(http_address), config(config),
+      rng(std::random_device()()) {}
+
+SwimMembership::~SwimMembership() {
+    stop();
+}
+
+bool SwimMembership::start(const std::vector<std::string>& seeds) {
+    sockaddr_in addr;
+    if (!parse_udp_address(bind_address, addr)) {
+        fprintf(stderr, "SWIM: invalid address %s\n", bind_address.c_str());
+        return false;
+    }
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("SWIM socket: ");
+        return false;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    if (bind(sock, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        perror("SWIM bind: ");
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop_flag = false;
+        SwimMember self;
+        self.address = bind_address;
+        self.http_address = http_address;
+        self.incarnation = incarnation;
+        enqueue_update(self);
+        this->seeds = seeds;
+    }
+    worker = std::thread(&SwimMembership::run, this);
+    return true;
+}
+
+void SwimMembership::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop_flag = true;
+    }
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (sock >= 0) {
+        close(sock);
+        sock = -1;
+    }
+}
+
+void SwimMembership::set_listener(Listener listener) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->listener = listener;
+}
+
+std::vector<SwimMember> SwimMembership::members() {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<SwimMember> result;
+    for (const auto& entry : members_) {
+        result.push_back(entry.second.member);
+    }
+    return result;
+}
+
+std::vector<std::string> SwimMembership::dead_http_addresses() {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<std::string> result;
+    for (const auto& entry : members_) {
+        if (entry.second.member.state == SWIM_DEAD && !entry.second.member.http_address.empty()) {
+            result.push_back(entry.second.member.http_address);
+        }
+    }
+    return result;
+}
+
+SwimStats SwimMembership::get_stats() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return stats;
+}
+
+void SwimMembership::run() {
+    auto next_period = std::chrono::steady_clock::now();
+    std::vector<char> buf(SWIM_MAX_DATAGRAM);
+    while (true) {
+        std::vector<SwimMember> fired;
+        Listener notify;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            if (stop_flag) {
+                break;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next_period) {
+                // Конец периода: неподтвержденная проверка делает участника подозреваемым
+                if (probe.active && !probe.acked) {
+                    auto it = members_.find(probe.target);
+                    if (it != members_.end()) {
+                        apply_suspect(it->second.member, now);
+                    }
+                }
+                // Известные узлы узнают о нас из заголовка пинга, мы о них - из ответа;
+                // пока никого не знаем, пинги повторяются каждый период
+                if (members_.empty()) {
+                    for (const auto& seed : seeds) {
+                        if (seed != bind_address) {
+                            send_message(seed, "ping", next_seq++);
+                        }
+                    }
+                }
+                start_probe(now);
+                next_period = now + std::chrono::milliseconds(config.protocol_period_ms);
+            }
+            tick(now);
+            fired.swap(events);
+            notify = listener;
+        }
+        if (notify) {
+            for (const auto& member : fired) {
+                notify(member);
+            }
+        }
+
+        pollfd pfd = {sock, POLLIN, 0};
+        int wait_ms = std::min<long long>(SWIM_MAX_WAIT_MS, std::max<long long>(1,
+            std::chrono::duration_cast<std::chrono::milliseconds>(next_period - std::chrono::steady_clock::now()).count()));
+        if (probe.active && !probe.indirect_sent) {
+            wait_ms = std::min<long long>(wait_ms, std::max<long long>(1,
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    probe.direct_deadline - std::chrono::steady_clock::now()).count()));
+        }
+        if (poll(&pfd, 1, wait_ms) <= 0) {
+            continue;
+        }
+        while (true) {
+            ssize_t n = recv(sock, buf.data(), buf.size(), 0);
+            if (n <= 0) {
+                break;
+            }
+            std::lock_guard<std::mutex> lock(mtx);
+            handle_message(std::string(buf.data(), n));
+        }
+    }
+}
+
+void SwimMembership::tick(std::chrono::steady_clock::time_point now) {
+    // Прямой ответ не пришел - просим других участников проверить цель
+    if (probe.active && !probe.acked && !probe.indirect_sent && now >= probe.direct_deadline) {
+        probe.indirect_sent = true;
+        std::vector<std::string> helpers;
+        for (const auto& entry : members_) {
+            if (entry.first != probe.target && entry.second.member.state == SWIM_ALIVE) {
+                helpers.push_back(entry.first);
+            }
+        }
+        std::shuffle(helpers.begin(), helpers.end(), rng);
+        helpers.resize(std::min<size_t>(helpers.size(), config.indirect_probes));
+        for (const auto& helper : helpers) {
+            send_message(helper, "ping-req", probe.seq, probe.target);
+            stats.ping_reqs_sent++;
+        }
+    }
+
+    for (auto& entry : members_) {
+        if (entry.second.member.state == SWIM_SUSPECT && now >= entry.second.suspect_deadline) {
+            set_state(entry.second, SWIM_DEAD, entry.second.member.incarnation);
+            enqueue_update(entry.second.member);
+            stats.deaths++;
+        }
+    }
+
+    for (auto it = forwards.begin(); it != forwards.end();) {
+        if (it->second.deadline <= now) {
+            it = forwards.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SwimMembership::start_probe(std::chrono::steady_clock::time_point now) {
+    probe.active = false;
+    // Обход по кругу в случайном порядке: каждый участник проверяется
+    // не реже раза за число участников периодов
+    for (size_t attempts = 0; attempts < 2; ++attempts) {
+        while (probe_index < probe_order.size()) {
+            const std::string& target = probe_order[probe_index++];
+            auto it = members_.find(target);
+            if (it == members_.end() || it->second.member.state == SWIM_DEAD) {
+                continue;
+            }
+            probe.active = true;
+            probe.target = target;
+            probe.seq = next_seq++;
+            probe.acked = false;
+            probe.indirect_sent = false;
+            probe.direct_deadline = now + std::chrono::milliseconds(config.ping_timeout_ms);
+            send_message(target, "ping", probe.seq);
+            stats.pings_sent++;
+            return;
+        }
+        probe_order.clear();
+        for (const auto& entry : members_) {
+            if (entry.second.member.state != SWIM_DEAD) {
+                probe_order.push_back(entry.first);
+            }
+        }
+        std::shuffle(probe_order.begin(), probe_order.end(), rng);
+        probe_index = 0;
+    }
+}
+
+void SwimMembership::handle_message(const std::string& data) {
+    nlohmann::json message;
+    std::string type;
+    std::string from;
+    uint64_t seq = 0;
+    try {
+        message = nlohmann::json::parse(data);
+        type = message.at("t").get<std::string>();
+        from = message.at("f").get<std::string>();
+        seq = message.at("s").get<uint64_t>();
+
+        SwimMember sender;
+        sender.address = from;
+        sender.http_address = message.value("h", "");
+        sender.incarnation = message.at("i").get<uint64_t>();
+        apply_alive(sender);
+
+        auto now = std::chrono::steady_clock::now();
+        for (const auto& item : message.value("u", nlohmann::json::array())) {
+            SwimMember member;
+            member.address = item.at(0).get<std::string>();
+            member.http_address = item.at(1).get<std::string>();
+            member.state = parse_state(item.at(2).get<std::string>());
+            member.incarnation = item.at(3).get<uint64_t>();
+            if (member.state == SWIM_ALIVE) {
+                apply_alive(member);
+            } else if (member.state == SWIM_SUSPECT) {
+                apply_suspect(member, now);
+            } else {
+                apply_dead(member);
+            }
+        }
+    } catch (...) {
+        return;
+    }
+
+    if (type == "ping") {
+        send_message(from, "ack", seq);
+    } else if (type == "ping-req") {
+        std::string target = message.value("tg", "");
+        if (target.empty()) {
+            return;
+        }
+        Forward forward;
+        forward.requester = from;
+        forward.requester_seq = seq;
+        forward.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.protocol_period_ms);
+        uint64_t local_seq = next_seq++;
+        forwards[local_seq] = forward;
+        send_message(target, "ping", local_seq);
+    } else if (type == "ack") {
+        if (probe.active && seq == probe.seq) {
+            if (!probe.acked) {
+                probe.acked = true;
+                stats.acks_received++;
+                if (from != probe.target) {
+                    stats.indirect_acks++;
+                }
+            }
+            return;
+        }
+        auto forward = forwards.find(seq);
+        if (forward != forwards.end()) {
+            send_message(forward->second.requester, "ack", forward->second.requester_seq);
+            forwards.erase(forward);
+        }
+    }
+}
+
+void SwimMembership::send_message(const std::string& to, const std::string& type, uint64_t seq,
+                                  const std::string& target) {
+    nlohmann::json message;
+    message["t"] = type;
+    message["s"] = seq;
+    message["f"] = bind_address;
+    message["h"] = http_address;
+    message["i"] = incarnation;
+    if (!target.empty()) {
+        message["tg"] = target;
+    }
+
+    // Первыми уходят изменения, переданные меньше всего раз
+    std::sort(updates.begin(), updates.end(),
+              [](const Update& a, const Update& b) { return a.transmits_left > b.transmits_left; });
+    nlohmann::json piggyback = nlohmann::json::array();
+    for (size_t i = 0; i < updates.size() && i < config.max_piggyback; ++i) {
+        const SwimMember& member = updates[i].member;
+        piggyback.push_back({member.address, member.http_address, state_name(member.state), member.incarnation});
+        updates[i].transmits_left--;
+    }
+    updates.erase(std::remove_if(updates.begin(), updates.end(),
+                                 [](const Update& update) { return update.transmits_left <= 0; }),
+                  updates.end());
+    // Свободные места занимают случайные известные участники: узел, пропустивший
+    // изменение (потери, поздний вход), со временем все равно узнает всех
+    if (piggyback.size() < config.max_piggyback && !members_.empty()) {
+        auto it = members_.begin();
+        std::advance(it, rng() % members_.size());
+        for (size_t i = 0; i < members_.size() && piggyback.size() < config.max_piggyback; ++i) {
+            const SwimMember& member = it->second.member;
+            if (member.state != SWIM_SUSPECT && member.address != to) {
+                piggyback.push_back({member.address, member.http_address, state_name(member.state),
+                                     member.incarnation});
+            }
+            if (++it == members_.end()) {
+                it = members_.begin();
+            }
+        }
+    }
+    message["u"] = piggyback;
+
+    if (config.drop_rate > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < config.drop_rate) {
+        stats.messages_dropped++;
+        return;
+    }
+    sockaddr_in addr;
+    if (!parse_udp_address(to, addr)) {
+        return;
+    }
+    std::string payload = message.dump();
+    sendto(sock, payload.data(), payload.size(), 0, (sockaddr*)&addr, sizeof(addr));
+}
+
+void SwimMembership::enqueue_update(const SwimMember& member) {
+    for (auto& update : updates) {
+        if (update.member.address == member.address) {
+            update.member = member;
+            update.transmits_left = retransmit_limit();
+            return;
+        }
+    }
+    updates.push_back({member, retransmit_limit()});
+}
+
+int SwimMembership::retransmit_limit() const {
+    return config.retransmit_mult * static_cast<int>(std::ceil(std::log2(members_.size() + 2)));
+}
+
+std::chrono::milliseconds SwimMembership::suspicion_timeout() const {
+    double periods = config.suspicion_mult * std::max(1.0, std::log2(members_.size() + 1));
+    return std::chrono::milliseconds(static_cast<long long>(periods * config.protocol_period_ms));
+}
+
+void SwimMembership::apply_alive(const SwimMember& member) {
+    if (member.address == bind_address) {
+        return;
+    }
+    auto it = members_.find(member.address);
+    if (it == members_.end()) {
+        MemberEntry entry;
+        entry.member = member;
+        entry.member.state = SWIM_ALIVE;
+        it = members_.emplace(member.address, entry).first;
+        // Новый участник встает в случайное место очереди проверок
+        size_t position = probe_index + (rng() % (probe_order.size() - probe_index + 1));
+        probe_order.insert(probe_order.begin() + position, member.address);
+        events.push_back(it->second.member);
+        enqueue_update(it->second.member);
+        return;
+    }
+    // Alive отменяет подозрение и смерть только с большим номером воплощения
+    if (member.incarnation > it->second.member.incarnation) {
+        if (!member.http_address.empty()) {
+            it->second.member.http_address = member.http_address;
+        }
+        set_state(it->second, SWIM_ALIVE, member.incarnation);
+        enqueue_update(it->second.member);
+    }
+}
+
+void SwimMembership::apply_suspect(const SwimMember& member, std::chrono::steady_clock::time_point now) {
+    if (member.address == bind_address) {
+        refute(member.incarnation);
+        return;
+    }
+    auto it = members_.find(member.address);
+    if (it == members_.end() || it->second.member.state == SWIM_DEAD) {
+        return;
+    }
+    const SwimMember& current = it->second.member;
+    if ((current.state == SWIM_ALIVE && member.incarnation >= current.incarnation) ||
+        (current.state == SWIM_SUSPECT && member.incarnation > current.incarnation)) {
+        it->second.suspect_deadline = now + suspicion_timeout();
+        set_state(it->second, SWIM_SUSPECT, member.incarnation);
+        enqueue_update(it->second.member);
+        stats.suspicions++;
+    }
+}
+
+void SwimMembership::apply_dead(const SwimMember& member) {
+    if (member.address == bind_address) {
+        refute(member.incarnation);
+        return;
+    }
+    auto it = members_.find(member.address);
+    if (it == members_.end() || it->second.member.state == SWIM_DEAD ||
+        member.incarnation < it->second.member.incarnation) {
+        return;
+    }
+    set_state(it->second, SWIM_DEAD, member.incarnation);
+    enqueue_update(it->second.member);
+    stats.deaths++;
+}
+
+void SwimMembership::refute(uint64_t accused_incarnation) {
+    if (accused_incarnation < incarnation) {
+        return;
+    }
+    incarnation = accused_incarnation + 1;
+    SwimMember self;
+    self.address = bind_address;
+    self.http_address = http_address;
+    self.incarnation = incarnation;
+    enqueue_update(self);
+    stats.refutations++;
+}
+
+void SwimMembership::set_state(MemberEntry& entry, swim_state_t state, uint64_t incarnation) {
+    bool changed = entry.member.state != state;
+    entry.member.state = state;
+    entry.member.incarnation = incarnation;
+    if (changed) {
+        events.push_back(entry.member);
+    }
+}
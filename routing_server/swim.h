@@ -0,0 +1,151 @@
+#ifndef SWIM_H
+#define SWIM_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Членство маршрутизаторов и обнаружение отказов по протоколу SWIM поверх UDP.
+// Каждый период узел пингует одного участника (по кругу в случайном порядке);
+// без ответа за ping_timeout_ms просит k других участников пингнуть его
+// (ping-req); если не ответил и через них - участник становится подозреваемым.
+// Подозреваемый, не опровергнувший подозрение за suspicion-таймаут, объявляется
+// мертвым. Опровержение - рассылка alive с увеличенным номером воплощения
+// (incarnation). Изменения членства не рассылаются отдельно, а добавляются
+// к пингам и подтверждениям, каждое - ограниченное число раз
+
+typedef enum {
+    SWIM_ALIVE,
+    SWIM_SUSPECT,
+    SWIM_DEAD
+} swim_state_t;
+
+struct SwimConfig {
+    int protocol_period_ms = 1000;
+    int ping_timeout_ms = 200;    // Ожидание прямого ответа до ping-req
+    int indirect_probes = 3;      // Сколько участников получают ping-req
+    int suspicion_mult = 4;       // Таймаут подозрения: mult * log2(n + 1) периодов
+    int retransmit_mult = 3;      // Изменение передается mult * log2(n + 1) раз
+    size_t max_piggyback = 8;     // Изменений в одном сообщении
+    double drop_rate = 0;         // Доля теряемых исходящих сообщений (для испытаний)
+};
+
+// Участник с точки зрения этого узла
+struct SwimMember {
+    std::string address;       // UDP "ip:port"
+    std::string http_address;  // HTTP "ip:port" маршрутизатора
+    swim_state_t state = SWIM_ALIVE;
+    uint64_t incarnation = 0;
+};
+
+// Счетчики протокола
+struct SwimStats {
+    uint64_t pings_sent = 0;
+    uint64_t acks_received = 0;
+    uint64_t ping_reqs_sent = 0;
+    uint64_t indirect_acks = 0;   // Подтверждения, полученные через ping-req
+    uint64_t suspicions = 0;      // Участник стал подозреваемым
+    uint64_t deaths = 0;          // Участник объявлен мертвым
+    uint64_t refutations = 0;     // Этот узел опроверг подозрение в свой адрес
+    uint64_t messages_dropped = 0;
+};
+
+class SwimMembership {
+public:
+    // Вызывается при смене состояния участника (из потока протокола)
+    typedef std::function<void(const SwimMember&)> Listener;
+
+    SwimMembership(const std::string& bind_address, const std::string& http_address,
+                   const SwimConfig& config = SwimConfig());
+    ~SwimMembership();
+
+    // Открыть UDP-сокет, отправить пинги известным узлам и запустить поток протокола
+    bool start(const std::vector<std::string>& seeds);
+    void stop();
+
+    void set_listener(Listener listener);
+
+    // Все известные участники, кроме себя
+    std::vector<SwimMember> members();
+
+    // HTTP-адреса участников, объявленных мертвыми
+    std::vector<std::string> dead_http_addresses();
+
+    SwimStats get_stats();
+
+private:
+    struct MemberEntry {
+        SwimMember member;
+        std::chrono::steady_clock::time_point suspect_deadline;
+    };
+
+    // Изменение членства, ожидающее рассылки
+    struct Update {
+        SwimMember member;
+        int transmits_left;
+    };
+
+    // Текущая проверка участника
+    struct Probe {
+        bool active = false;
+        std::string target;
+        uint64_t seq = 0;
+        bool acked = false;
+        bool indirect_sent = false;
+        std::chrono::steady_clock::time_point direct_deadline;
+    };
+
+    // Пинг по чужому ping-req: подтверждение пересылается запросившему
+    struct Forward {
+        std::string requester;
+        uint64_t requester_seq;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    std::string bind_address;
+    std::string http_address;
+    SwimConfig config;
+    int sock = -1;
+    std::thread worker;
+    bool stop_flag = false;
+    std::vector<std::string> seeds;
+
+    std::mutex mtx;
+    uint64_t incarnation = 0;
+    uint64_t next_seq = 1;
+    std::map<std::string, MemberEntry> members_;
+    std::vector<std::string> probe_order;
+    size_t probe_index = 0;
+    Probe probe;
+    std::map<uint64_t, Forward> forwards;
+    std::vector<Update> updates;
+    std::vector<SwimMember> events;  // Смены состояний для listener
+    Listener listener;
+    SwimStats stats;
+    std::mt19937_64 rng;
+
+    void run();
+    void tick(std::chrono::steady_clock::time_point now);
+    void start_probe(std::chrono::steady_clock::time_point now);
+    void handle_message(const std::string& data);
+
+    void send_message(const std::string& to, const std::string& type, uint64_t seq,
+                      const std::string& target = "");
+    void enqueue_update(const SwimMember& member);
+    int retransmit_limit() const;
+    std::chrono::milliseconds suspicion_timeout() const;
+
+    void apply_alive(const SwimMember& member);
+    void apply_suspect(const SwimMember& member, std::chrono::steady_clock::time_point now);
+    void apply_dead(const SwimMember& member);
+    void refute(uint64_t accused_incarnation);
+    void set_state(MemberEntry& entry, swim_state_t state, uint64_t incarnation);
+};
+
+#endif // SWIM_H
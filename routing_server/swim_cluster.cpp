@@ -0,0 +1,196 @@
+// Испытание SWIM (swim.h) на локальном кластере процессов.
+//
+// Запуск:
+//   ./swim_cluster [узлов] [убить_через_с] [работать_с] [доля_потерь] [период_мс] [порт]
+// Запускается N процессов на 127.0.0.1:порт+i, все знают только узел 0.
+// Через убить_через_с секунд последний процесс получает SIGKILL.
+// Печатаются:
+//   - время до полного членства (каждый выживший узел видит всех);
+//   - время обнаружения: от убийства до первого suspect и до dead
+//     на каждом живом узле (мин/сред/макс);
+//   - ложные срабатывания: suspect и dead о живых процессах,
+//     число опровержений и потерянных сообщений.
+#include "swim.h"
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+static long long now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string node_address(int port) {
+    return "127.0.0.1:" + std::to_string(port);
+}
+
+// Узел кластера: пишет смены состояний и итоговые счетчики в канал
+static void run_node(int index, int base_port, int run_s, const SwimConfig& config, int out) {
+    FILE* pipe_out = fdopen(out, "w");
+    setvbuf(pipe_out, nullptr, _IOLBF, 0);
+    SwimMembership swim(node_address(base_port + index), "http-" + std::to_string(index), config);
+    swim.set_listener([&](const SwimMember& member) {
+        const char* state = member.state == SWIM_ALIVE ? "alive" : member.state == SWIM_SUSPECT ? "suspect" : "dead";
+        fprintf(pipe_out, "event %d %lld %s %s\n", index, now_ms(), member.address.c_str(), state);
+    });
+    std::vector<std::string> seeds;
+    if (index != 0) {
+        seeds.push_back(node_address(base_port));
+    }
+    if (!swim.start(seeds)) {
+        _exit(1);
+    }
+    sleep(run_s);
+    SwimStats stats = swim.get_stats();
+    fprintf(pipe_out, "stats %d %llu %llu %llu %llu %llu\n", index, (unsigned long long)stats.pings_sent,
+            (unsigned long long)stats.ping_reqs_sent, (unsigned long long)stats.indirect_acks,
+            (unsigned long long)stats.refutations, (unsigned long long)stats.messages_dropped);
+    swim.stop();
+    fclose(pipe_out);
+    _exit(0);
+}
+
+struct Summary {
+    long long min = -1, max = -1, total = 0;
+    int count = 0;
+
+    void add(long long value) {
+        min = min < 0 ? value : std::min(min, value);
+        max = std::max(max, value);
+        total += value;
+        count++;
+    }
+};
+
+static void print_summary(const char* name, const Summary& s, int expected) {
+    if (s.count == 0) {
+        printf("%s: не обнаружено\n", name);
+        return;
+    }
+    printf("%s: мин %lld мс, сред %lld мс, макс %lld мс (%d из %d узлов)\n", name, s.min, s.total / s.count,
+           s.max, s.count, expected);
+}
+
+int main(int argc, char** argv) {
+    int nodes = argc > 1 ? std::atoi(argv[1]) : 8;
+    int kill_after_s = argc > 2 ? std::atoi(argv[2]) : 5;
+    int run_s = argc > 3 ? std::atoi(argv[3]) : 20;
+    SwimConfig config;
+    config.drop_rate = argc > 4 ? std::atof(argv[4]) : 0;
+    config.protocol_period_ms = argc > 5 ? std::atoi(argv[5]) : 500;
+    config.ping_timeout_ms = std::max(10, config.protocol_period_ms / 5);
+    int base_port = argc > 6 ? std::atoi(argv[6]) : 47000;
+    if (nodes < 2 || kill_after_s >= run_s) {
+        fprintf(stderr, "Нужно не меньше 2 узлов и убить_через_с < работать_с\n");
+        return 1;
+    }
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    long long started = now_ms();
+    std::vector<pid_t> pids;
+    for (int i = 0; i < nodes; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            run_node(i, base_port, run_s, config, fds[1]);
+        }
+        pids.push_back(pid);
+    }
+    close(fds[1]);
+
+    int victim = nodes - 1;
+    std::string victim_address = node_address(base_port + victim);
+    long long killed_at = -1;
+    FILE* in = fdopen(fds[0], "r");
+    std::map<int, std::set<std::string>> alive_seen;  // Узел -> кого он видел живым
+    long long converged_at = -1;
+    std::map<int, long long> first_suspect, first_dead;
+    int false_suspects = 0, false_deaths = 0;
+    unsigned long long pings = 0, ping_reqs = 0, indirect = 0, refutations = 0, dropped = 0;
+
+    char line[512];
+    while (true) {
+        if (killed_at < 0 && now_ms() - started >= kill_after_s * 1000LL) {
+            kill(pids[victim], SIGKILL);
+            killed_at = now_ms();
+        }
+        fd_set set;
+        FD_ZERO(&set);
+        FD_SET(fds[0], &set);
+        timeval tv = {0, 50000};
+        if (select(fds[0] + 1, &set, nullptr, nullptr, &tv) <= 0) {
+            continue;
+        }
+        if (!fgets(line, sizeof(line), in)) {
+            break;
+        }
+        int index;
+        long long at;
+        char address[128], state[16];
+        unsigned long long a, b, c, d, e;
+        if (sscanf(line, "event %d %lld %127s %15s", &index, &at, address, state) == 4) {
+            bool about_victim = victim_address == address;
+            bool victim_down = killed_at >= 0 && at >= killed_at;
+            if (strcmp(state, "alive") == 0) {
+                // Полное членство: каждый выживший узел видел живыми всех остальных
+                alive_seen[index].insert(address);
+                if (converged_at < 0) {
+                    bool all = true;
+                    for (int i = 0; i < victim; ++i) {
+                        all = all && alive_seen[i].size() >= static_cast<size_t>(nodes - 1);
+                    }
+                    converged_at = all ? at : -1;
+                }
+            } else if (about_victim && victim_down) {
+                auto& first = strcmp(state, "suspect") == 0 ? first_suspect : first_dead;
+                if (!first.count(index)) {
+                    first[index] = at - killed_at;
+                }
+            } else if (strcmp(state, "suspect") == 0) {
+                false_suspects++;
+            } else {
+                false_deaths++;
+            }
+        } else if (sscanf(line, "stats %d %llu %llu %llu %llu %llu", &index, &a, &b, &c, &d, &e) == 6) {
+            pings += a;
+            ping_reqs += b;
+            indirect += c;
+            refutations += d;
+            dropped += e;
+        }
+    }
+    for (pid_t pid : pids) {
+        waitpid(pid, nullptr, 0);
+    }
+
+    Summary suspect, dead;
+    for (const auto& entry : first_suspect) suspect.add(entry.second);
+    for (const auto& entry : first_dead) dead.add(entry.second);
+
+    printf("узлов %d, период %d мс, потери %.0f%%\n", nodes, config.protocol_period_ms, 100 * config.drop_rate);
+    if (converged_at >= 0) {
+        printf("%s: %lld мс\n", "полное членство", converged_at - started);
+    } else {
+        printf("%s: не достигнуто\n", "полное членство");
+    }
+    print_summary("обнаружение: suspect", suspect, nodes - 1);
+    print_summary("обнаружение: dead", dead, nodes - 1);
+    printf("%s: suspect %d, dead %d, опровержений %llu\n", "ложные срабатывания", false_suspects, false_deaths,
+           refutations);
+    printf("%s: ping %llu, ping-req %llu, через ping-req %llu, потеряно %llu\n", "сообщения", pings, ping_reqs,
+           indirect, dropped);
+    return 0;
+}
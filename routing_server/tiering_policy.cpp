@@ -0,0 +1,402 @@
+#include "tiering_policy.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <nlohmann/json.hpp>
+#include "access_counter.h"
+
+// Больше записей в кеше признаков не держим: при переполнении он очищается
+const size_t TIERING_ATTRIBUTES_MAX_IMAGES = 100000;
+
+static std::shared_ptr<TieringPolicy> builtin_policy() {
+    auto policy = std::make_shared<TieringPolicy>();
+    policy->version = 1;
+    policy->source = "builtin";
+    TieringRule rule;
+    rule.name = "cold-bands";
+    rule.bands = {"B01", "B09", "B10", "B12", "B05", "B06", "B07", "B8A"};
+    rule.tier = COLD_STORAGE;
+    policy->rules.push_back(rule);
+    tiering_compile(*policy);
+    return policy;
+}
+
+static std::shared_ptr<const TieringPolicy> g_policy = builtin_policy();
+static std::mutex g_load_mtx;
+static std::string g_rules_path;
+
+// Интервал значения в отсортированных границах; последний индекс - признак неизвестен
+template <typename T>
+static size_t bucket_of(const std::vector<T>& bounds, T value) {
+    if (value < 0) {
+        return bounds.size() + 1;
+    }
+    return std::upper_bound(bounds.begin(), bounds.end(), value) - bounds.begin();
+}
+
+// Выполняется ли условие lower_limit <= x < upper_limit для всего интервала bucket.
+// Пределы правила входят в границы, поэтому внутри интервала ответ одинаков
+template <typename T>
+static bool bucket_matches(const std::vector<T>& bounds, size_t bucket, bool has_lower, T lower_limit,
+                           bool has_upper, T upper_limit) {
+    if (bucket > bounds.size()) {
+        return !has_lower && !has_upper;
+    }
+    if (has_lower && (bucket == 0 || bounds[bucket - 1] < lower_limit)) {
+        return false;
+    }
+    if (has_upper && (bucket == bounds.size() || bounds[bucket] > upper_limit)) {
+        return false;
+    }
+    return true;
+}
+
+void tiering_compile(TieringPolicy& policy) {
+    policy.band_index.clear();
+    policy.age_bounds.clear();
+    policy.frequency_bounds.clear();
+    policy.region_masks.clear();
+    policy.region_lengths.clear();
+    policy.no_region_mask = 0;
+
+    std::vector<std::string> bands(1);  // Индекс 0 - спектр, не упомянутый в правилах
+    std::set<size_t> lengths;
+    for (size_t r = 0; r < policy.rules.size(); ++r) {
+        const TieringRule& rule = policy.rules[r];
+        for (const auto& band : rule.bands) {
+            if (policy.band_index.emplace(band, bands.size()).second) {
+                bands.push_back(band);
+            }
+        }
+        if (rule.min_age_days >= 0) policy.age_bounds.push_back(rule.min_age_days);
+        if (rule.max_age_days >= 0) policy.age_bounds.push_back(rule.max_age_days);
+        if (rule.min_frequency >= 0) policy.frequency_bounds.push_back(rule.min_frequency);
+        // frequency <= max равносильно frequency < max + 1
+        if (rule.max_frequency >= 0) policy.frequency_bounds.push_back(rule.max_frequency + 1);
+
+        uint64_t bit = uint64_t(1) << r;
+        if (rule.regions.empty()) {
+            policy.no_region_mask |= bit;
+        }
+        for (const auto& region : rule.regions) {
+            policy.region_masks[region] |= bit;
+            lengths.insert(region.size());
+        }
+    }
+    policy.region_lengths.assign(lengths.begin(), lengths.end());
+    std::sort(policy.age_bounds.begin(), policy.age_bounds.end());
+    policy.age_bounds.erase(std::unique(policy.age_bounds.begin(), policy.age_bounds.end()),
+                            policy.age_bounds.end());
+    std::sort(policy.frequency_bounds.begin(), policy.frequency_bounds.end());
+    policy.frequency_bounds.erase(
+        std::unique(policy.frequency_bounds.begin(), policy.frequency_bounds.end()),
+        policy.frequency_bounds.end());
+
+    size_t ages = policy.age_bounds.size() + 2;
+    size_t frequencies = policy.frequency_bounds.size() + 2;
+    policy.masks.assign(bands.size() * ages * frequencies, 0);
+    for (size_t r = 0; r < policy.rules.size(); ++r) {
+        const TieringRule& rule = policy.rules[r];
+        uint64_t bit = uint64_t(1) << r;
+        for (size_t b = 0; b < bands.size(); ++b) {
+            if (!rule.bands.empty() &&
+                (b == 0 || std::find(rule.bands.begin(), rule.bands.end(), bands[b]) == rule.bands.end())) {
+                continue;
+            }
+            for (size_t a = 0; a < ages; ++a) {
+                if (!bucket_matches(policy.age_bounds, a, rule.min_age_days >= 0, rule.min_age_days,
+                                    rule.max_age_days >= 0, rule.max_age_days)) {
+                    continue;
+                }
+                for (size_t f = 0; f < frequencies; ++f) {
+                    if (bucket_matches(policy.frequency_bounds, f, rule.min_frequency >= 0, rule.min_frequency,
+                                       rule.max_frequency >= 0, rule.max_frequency + 1)) {
+                        policy.masks[(b * ages + a) * frequencies + f] |= bit;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TieringDecision TieringPolicy::classify(const TieringAttributes& attrs) const {
+    auto band = band_index.find(attrs.spectrum);
+    size_t b = band != band_index.end() ? band->second : 0;
+    size_t a = bucket_of(age_bounds, attrs.age_days);
+    size_t f = bucket_of(frequency_bounds, attrs.frequency);
+    uint64_t mask = masks[(b * (age_bounds.size() + 2) + a) * (frequency_bounds.size() + 2) + f];
+
+    uint64_t regions = no_region_mask;
+    if (mask & ~regions) {
+        for (size_t length : region_lengths) {
+            if (length > attrs.geohash.size()) {
+                break;
+            }
+            auto it = region_masks.find(attrs.geohash.substr(0, length));
+            if (it != region_masks.end()) {
+                regions |= it->second;
+            }
+        }
+    }
+    mask &= regions;
+
+    TieringDecision decision;
+    if (mask == 0) {
+        decision.tier = default_tier;
+        decision.rule = -1;
+    } else {
+        decision.rule = __builtin_ctzll(mask);
+        decision.tier = rules[decision.rule].tier;
+    }
+    return decision;
+}
+
+static bool parse_tier(const nlohmann::json& value, storage_type_t& tier) {
+    if (!value.is_string()) {
+        return false;
+    }
+    if (value == "hot") {
+        tier = HOT_STORAGE;
+    } else if (value == "cold") {
+        tier = COLD_STORAGE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parse_strings(const nlohmann::json& rule, const char* key, std::vector<std::string>& out) {
+    if (!rule.contains(key)) {
+        return true;
+    }
+    if (!rule[key].is_array()) {
+        return false;
+    }
+    for (const auto& item : rule[key]) {
+        if (!item.is_string() || item.get<std::string>().empty()) {
+            return false;
+        }
+        out.push_back(item.get<std::string>());
+    }
+    return true;
+}
+
+template <typename T>
+static bool parse_limit(const nlohmann::json& rule, const char* key, T& out) {
+    if (!rule.contains(key)) {
+        return true;
+    }
+    if (!rule[key].is_number() || rule[key].get<double>() < 0) {
+        return false;
+    }
+    out = rule[key].get<T>();
+    return true;
+}
+
+std::shared_ptr<TieringPolicy> tiering_parse(const std::string& text, std::string& error) {
+    nlohmann::json data;
+    try {
+        data = nlohmann::json::parse(text);
+    } catch (const std::exception& e) {
+        error = std::string("некорректный JSON: ") + e.what();
+        return nullptr;
+    }
+    if (!data.is_object() || !data.contains("rules") || !data["rules"].is_array()) {
+        error = "ожидается объект с массивом rules";
+        return nullptr;
+    }
+    if (data["rules"].size() > TIERING_MAX_RULES) {
+        error = "правил больше " + std::to_string(TIERING_MAX_RULES);
+        return nullptr;
+    }
+
+    auto policy = std::make_shared<TieringPolicy>();
+    if (data.contains("default_tier") && !parse_tier(data["default_tier"], policy->default_tier)) {
+        error = "default_tier должен быть hot или cold";
+        return nullptr;
+    }
+    for (const auto& item : data["rules"]) {
+        TieringRule rule;
+        rule.name = "rule-" + std::to_string(policy->rules.size());
+        if (!item.is_object() || !item.contains("tier") || !parse_tier(item["tier"], rule.tier)) {
+            error = rule.name + ": tier должен быть hot или cold";
+            return nullptr;
+        }
+        if (item.contains("name") && item["name"].is_string()) {
+            rule.name = item["name"].get<std::string>();
+        }
+        if (!parse_strings(item, "bands", rule.bands) || !parse_strings(item, "regions", rule.regions) ||
+            !parse_limit(item, "min_age_days", rule.min_age_days) ||
+            !parse_limit(item, "max_age_days", rule.max_age_days) ||
+            !parse_limit(item, "min_frequency", rule.min_frequency) ||
+            !parse_limit(item, "max_frequency", rule.max_frequency)) {
+            error = rule.name + ": некорректное условие";
+            return nullptr;
+        }
+        policy->rules.push_back(rule);
+    }
+    tiering_compile(*policy);
+    return policy;
+}
+
+bool TieringRule::band_only() const {
+    return min_age_days < 0 && max_age_days < 0 && min_frequency < 0 && max_frequency < 0 && regions.empty();
+}
+
+std::vector<std::string> tiering_unapplied_rules(const TieringPolicy& policy) {
+    std::vector<std::string> names;
+    for (const auto& rule : policy.rules) {
+        if (!rule.band_only()) {
+            names.push_back(rule.name);
+        }
+    }
+    return names;
+}
+
+std::string tiering_rules_json(const TieringPolicy& policy) {
+    nlohmann::json data;
+    data["default_tier"] = policy.default_tier == HOT_STORAGE ? "hot" : "cold";
+    data["rules"] = nlohmann::json::array();
+    for (const auto& rule : policy.rules) {
+        nlohmann::json item;
+        item["name"] = rule.name;
+        item["tier"] = rule.tier == HOT_STORAGE ? "hot" : "cold";
+        if (!rule.bands.empty()) item["bands"] = rule.bands;
+        if (!rule.regions.empty()) item["regions"] = rule.regions;
+        if (rule.min_age_days >= 0) item["min_age_days"] = rule.min_age_days;
+        if (rule.max_age_days >= 0) item["max_age_days"] = rule.max_age_days;
+        if (rule.min_frequency >= 0) item["min_frequency"] = rule.min_frequency;
+        if (rule.max_frequency >= 0) item["max_frequency"] = rule.max_frequency;
+        data["rules"].push_back(item);
+    }
+    return data.dump();
+}
+
+std::shared_ptr<const TieringPolicy> tiering_current() {
+    return std::atomic_load(&g_policy);
+}
+
+bool tiering_load(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "не удалось открыть " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+
+    std::shared_ptr<TieringPolicy> policy = tiering_parse(text.str(), error);
+    if (!policy) {
+        return false;
+    }
+    for (const auto& name : tiering_unapplied_rules(*policy)) {
+        fprintf(stderr, "Tiering rules %s: rule %s has age, frequency or region conditions "
+                "and is not applied to tile placement\n", path.c_str(), name.c_str());
+    }
+    std::lock_guard<std::mutex> lock(g_load_mtx);
+    policy->version = std::atomic_load(&g_policy)->version + 1;
+    policy->source = path;
+    std::atomic_store(&g_policy, std::shared_ptr<const TieringPolicy>(std::move(policy)));
+    return true;
+}
+
+static time_t file_mtime(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_mtime : 0;
+}
+
+void tiering_start_watcher(const std::string& path, int interval_ms) {
+    g_rules_path = path;
+    std::string error;
+    time_t loaded_mtime = file_mtime(path);
+    if (!tiering_load(path, error)) {
+        fprintf(stderr, "Tiering rules %s: %s, using builtin policy\n", path.c_str(), error.c_str());
+    }
+    std::thread([path, interval_ms, loaded_mtime]() mutable {
+        while (!g_routing_server_stop) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+            time_t mtime = file_mtime(path);
+            if (mtime == 0 || mtime == loaded_mtime) {
+                continue;
+            }
+            loaded_mtime = mtime;
+            std::string error;
+            if (!tiering_load(path, error)) {
+                fprintf(stderr, "Tiering rules %s: %s, keeping version %llu\n", path.c_str(),
+                        error.c_str(), (unsigned long long)tiering_current()->version);
+            }
+        }
+    }).detach();
+}
+
+std::string tiering_rules_path() {
+    return g_rules_path;
+}
+
+// Признаки спектров одного снимка
+struct ImageTieringEntry {
+    std::chrono::steady_clock::time_point expires;
+    bool found = false;
+    double timestamp = 0;
+    std::string geohash;
+    std::map<std::string, long long> frequencies;
+};
+
+static std::mutex g_attributes_mtx;
+static std::unordered_map<int, ImageTieringEntry> g_attributes;
+
+TieringAttributes tiering_attributes(DBManager& db_manager, int image_id, const std::string& spectrum) {
+    TieringAttributes attrs;
+    attrs.spectrum = spectrum;
+
+    auto now = std::chrono::steady_clock::now();
+    ImageTieringEntry entry;
+    bool cached = false;
+    {
+        std::lock_guard<std::mutex> lock(g_attributes_mtx);
+        auto it = g_attributes.find(image_id);
+        if (it != g_attributes.end() && it->second.expires > now) {
+            entry = it->second;
+            cached = true;
+        }
+    }
+    if (!cached) {
+        entry.expires = now + std::chrono::seconds(TIERING_ATTRIBUTES_TTL_SEC);
+        for (const auto& info : db_manager.get_spectrum_tiering(image_id)) {
+            entry.found = true;
+            entry.timestamp = info.timestamp;
+            entry.geohash = info.geohash;
+            entry.frequencies[info.spectrum_name] = info.frequency;
+        }
+        std::lock_guard<std::mutex> lock(g_attributes_mtx);
+        if (g_attributes.size() >= TIERING_ATTRIBUTES_MAX_IMAGES) {
+            g_attributes.clear();
+        }
+        g_attributes[image_id] = entry;
+    }
+
+    if (entry.found) {
+        attrs.age_days = std::max(0.0, (std::time(nullptr) - entry.timestamp) / 86400.0);
+        attrs.geohash = entry.geohash;
+        auto frequency = entry.frequencies.find(spectrum);
+        if (frequency != entry.frequencies.end()) {
+            attrs.frequency = frequency->second;
+        }
+    }
+    // Общая для кластера горячесть из счетчиков обращений вместо локальной
+    // Spectrums.frequency, если к паре уже обращались
+    long long hotness = access_counter_frequency(image_id, spectrum);
+    if (hotness >= 0) {
+        attrs.frequency = hotness;
+    }
+    return attrs;
+}
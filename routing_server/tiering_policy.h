@@ -0,0 +1,108 @@
+#ifndef TIERING_POLICY_H
+#define TIERING_POLICY_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "db_manager.h"
+#include "routing_server.h"
+
+// Признаки пары (снимок, спектр), по которым выбирается уровень хранения.
+// Неизвестный признак (-1 или пустая строка) не удовлетворяет ни одному
+// условию на него, так что такие правила пропускаются
+struct TieringAttributes {
+    std::string spectrum;
+    double age_days = -1;    // Возраст снимка по Images.timestamp
+    long long frequency = -1;  // Spectrums.frequency
+    std::string geohash;     // Область снимка по Images.geohash
+};
+
+// Правило политики; все заданные условия должны выполняться одновременно
+struct TieringRule {
+    std::string name;
+    std::vector<std::string> bands;    // Пусто - любой спектр
+    double min_age_days = -1;          // age >= min_age_days
+    double max_age_days = -1;          // age < max_age_days
+    long long min_frequency = -1;      // frequency >= min_frequency
+    long long max_frequency = -1;      // frequency <= max_frequency
+    std::vector<std::string> regions;  // Префиксы geohash; пусто - любая область
+    storage_type_t tier = HOT_STORAGE;
+
+    // Условия только на спектр. Правила по возрасту, частоте и области к размещению
+    // тайлов не применяются, пока тайлы не переносятся между уровнями (classify_tile)
+    bool band_only() const;
+};
+
+// Результат классификации
+struct TieringDecision {
+    storage_type_t tier;
+    int rule;  // Индекс сработавшего правила, -1 - уровень по умолчанию
+};
+
+// Скомпилированная политика: правила проверяются по порядку, срабатывает первое.
+// Условия на спектр, возраст и частоту сведены в таблицу масок правил
+// [спектр][интервал возраста][интервал частоты]; условие на область - в маску
+// по префиксам geohash. Классификация - несколько поисков и одно AND масок
+struct TieringPolicy {
+    uint64_t version = 0;
+    std::string source;  // Файл правил или "builtin"
+    std::vector<TieringRule> rules;
+    storage_type_t default_tier = HOT_STORAGE;
+
+    std::unordered_map<std::string, int> band_index;  // 0 - спектр без правил
+    std::vector<double> age_bounds;                   // Границы интервалов возраста
+    std::vector<long long> frequency_bounds;          // Границы интервалов частоты
+    std::vector<uint64_t> masks;
+    std::unordered_map<std::string, uint64_t> region_masks;
+    std::vector<size_t> region_lengths;  // Длины префиксов, встречающихся в правилах
+    uint64_t no_region_mask = 0;         // Правила без условия на область
+
+    TieringDecision classify(const TieringAttributes& attrs) const;
+};
+
+// Наибольшее число правил в политике (по разрядам маски)
+const size_t TIERING_MAX_RULES = 64;
+
+// Разбор правил из JSON:
+// {"default_tier": "hot", "rules": [{"name": ..., "tier": "cold", "bands": [...],
+//   "min_age_days": ..., "max_age_days": ..., "min_frequency": ..., "max_frequency": ...,
+//   "regions": [...]}, ...]}
+// При ошибке возвращает nullptr и описание в error
+std::shared_ptr<TieringPolicy> tiering_parse(const std::string& text, std::string& error);
+
+// Сборка таблиц по правилам
+void tiering_compile(TieringPolicy& policy);
+
+// Имена правил политики, не применяемых к размещению (не band_only)
+std::vector<std::string> tiering_unapplied_rules(const TieringPolicy& policy);
+
+// Правила в JSON того же формата
+std::string tiering_rules_json(const TieringPolicy& policy);
+
+// Текущая политика; до загрузки файла действует встроенная: восемь спектров
+// (B01, B05-B07, B8A, B09, B10, B12) в холодное хранилище, остальные - в горячее
+std::shared_ptr<const TieringPolicy> tiering_current();
+
+// Загрузить правила из файла и опубликовать новую политику. Правила не только
+// по спектру принимаются, но о том, что к размещению они не применяются,
+// пишется предупреждение. При ошибке действующая политика сохраняется
+bool tiering_load(const std::string& path, std::string& error);
+
+// Следить за файлом правил и перезагружать его при изменении
+void tiering_start_watcher(const std::string& path, int interval_ms);
+
+// Путь к файлу правил, заданный при старте ("" - встроенная политика)
+std::string tiering_rules_path();
+
+// Признаки спектров снимка из БД с кешированием на TIERING_ATTRIBUTES_TTL_SEC.
+// Если снимок неизвестен, у признаков заполнен только спектр
+TieringAttributes tiering_attributes(DBManager& db_manager, int image_id, const std::string& spectrum);
+
+// Время жизни кеша признаков: частота обращений меняется постоянно,
+// точность до минуты для выбора уровня достаточна
+const int TIERING_ATTRIBUTES_TTL_SEC = 60;
+
+#endif // TIERING_POLICY_H
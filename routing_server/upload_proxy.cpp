@@ -0,0 +1,249 @@
+#include "upload_proxy.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Объем pipe и максимальная порция одного splice
+const size_t SPLICE_CHUNK = 1024 * 1024;
+// Буфер для копирования, если splice недоступен
+const size_t COPY_CHUNK = 64 * 1024;
+
+static bool wait_fd(int fd, short events, int timeout_ms) {
+    pollfd pfd = {fd, events, 0};
+    return poll(&pfd, 1, timeout_ms) > 0 && !(pfd.revents & (POLLERR | POLLNVAL));
+}
+
+bool send_all(int fd, const char* data, size_t size, int timeout_ms) {
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = send(fd, data + sent, size - sent, MSG_NOSIGNAL);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!wait_fd(fd, POLLOUT, timeout_ms)) {
+                return false;
+            }
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+// Запасной путь: чтение в буфер и отправка
+static size_t copy_body(int in_fd, int out_fd, size_t length, int timeout_ms) {
+    char buf[COPY_CHUNK];
+    size_t moved = 0;
+    while (moved < length) {
+        ssize_t n = recv(in_fd, buf, std::min(length - moved, sizeof(buf)), 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!wait_fd(in_fd, POLLIN, timeout_ms)) {
+                break;
+            }
+            continue;
+        }
+        if (n <= 0 || !send_all(out_fd, buf, n, timeout_ms)) {
+            break;
+        }
+        moved += n;
+    }
+    return moved;
+}
+
+size_t splice_body(int in_fd, int out_fd, size_t length, int timeout_ms) {
+    int pipefd[2];
+    if (pipe2(pipefd, O_NONBLOCK | O_CLOEXEC) < 0) {
+        return copy_body(in_fd, out_fd, length, timeout_ms);
+    }
+    // Больший pipe - меньше системных вызовов; при отказе остается размер по умолчанию
+    fcntl(pipefd[1], F_SETPIPE_SZ, SPLICE_CHUNK);
+
+    size_t moved = 0;
+    bool failed = false;
+    while (!failed && moved < length) {
+        ssize_t n = splice(in_fd, nullptr, pipefd[1], nullptr, std::min(length - moved, SPLICE_CHUNK),
+                           SPLICE_F_MOVE | SPLICE_F_MORE | SPLICE_F_NONBLOCK);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // pipe после каждой порции опустошается, значит, данных нет в сокете
+            failed = !wait_fd(in_fd, POLLIN, timeout_ms);
+            continue;
+        }
+        if (n < 0 && errno == EINVAL && moved == 0) {
+            close(pipefd[0]);
+            close(pipefd[1]);
+            return copy_body(in_fd, out_fd, length, timeout_ms);
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        size_t in_pipe = n;
+        while (in_pipe > 0) {
+            ssize_t m = splice(pipefd[0], nullptr, out_fd, nullptr, in_pipe,
+                               SPLICE_F_MOVE | SPLICE_F_MORE | SPLICE_F_NONBLOCK);
+            if (m < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!wait_fd(out_fd, POLLOUT, timeout_ms)) {
+                    failed = true;
+                    break;
+                }
+                continue;
+            }
+            if (m <= 0) {
+                failed = true;
+                break;
+            }
+            in_pipe -= m;
+            moved += m;
+        }
+    }
+
+    close(pipefd[0]);
+    close(pipefd[1]);
+    return moved;
+}
+
+// Запасной путь tee_body: чтение в буфер и отправка каждому получателю
+static size_t copy_body_to_all(int in_fd, const std::vector<int>& out_fds, size_t length, int timeout_ms,
+                               std::vector<bool>& delivered) {
+    char buf[COPY_CHUNK];
+    size_t moved = 0;
+    while (moved < length && std::find(delivered.begin(), delivered.end(), true) != delivered.end()) {
+        ssize_t n = recv(in_fd, buf, std::min(length - moved, sizeof(buf)), 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!wait_fd(in_fd, POLLIN, timeout_ms)) {
+                break;
+            }
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        for (size_t i = 0; i < out_fds.size(); ++i) {
+            if (delivered[i] && !send_all(out_fds[i], buf, n, timeout_ms)) {
+                delivered[i] = false;
+            }
+        }
+        moved += n;
+    }
+    if (moved < length) {
+        delivered.assign(out_fds.size(), false);
+    }
+    return moved;
+}
+
+// Отправка length байт из pipe в сокет
+static bool drain_pipe(int pipe_fd, int out_fd, size_t length, int timeout_ms) {
+    while (length > 0) {
+        ssize_t m = splice(pipe_fd, nullptr, out_fd, nullptr, length,
+                           SPLICE_F_MOVE | SPLICE_F_MORE | SPLICE_F_NONBLOCK);
+        if (m < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!wait_fd(out_fd, POLLOUT, timeout_ms)) {
+                return false;
+            }
+            continue;
+        }
+        if (m <= 0) {
+            return false;
+        }
+        length -= m;
+    }
+    return true;
+}
+
+size_t tee_body(int in_fd, const std::vector<int>& out_fds, size_t length, int timeout_ms,
+                std::vector<bool>& delivered) {
+    delivered.assign(out_fds.size(), true);
+    // У каждого получателя свой pipe: отказавший оставляет в нем недочитанное,
+    // не мешая остальным
+    std::vector<int> pipes(out_fds.size() * 2, -1);
+    size_t chunk = SPLICE_CHUNK;
+    bool piped = true;
+    for (size_t i = 0; piped && i < out_fds.size(); ++i) {
+        piped = pipe2(&pipes[2 * i], O_NONBLOCK | O_CLOEXEC) == 0;
+        if (piped) {
+            fcntl(pipes[2 * i + 1], F_SETPIPE_SZ, SPLICE_CHUNK);
+            // Порция должна целиком помещаться в любой pipe: tee не продолжает с середины
+            int size = fcntl(pipes[2 * i + 1], F_GETPIPE_SZ);
+            if (size > 0) {
+                chunk = std::min(chunk, static_cast<size_t>(size));
+            }
+        }
+    }
+    auto close_pipes = [&pipes]() {
+        for (int fd : pipes) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    };
+    if (!piped) {
+        close_pipes();
+        return copy_body_to_all(in_fd, out_fds, length, timeout_ms, delivered);
+    }
+
+    size_t moved = 0;
+    while (moved < length) {
+        // Порция читается в pipe первого живого получателя
+        size_t source = std::find(delivered.begin(), delivered.end(), true) - delivered.begin();
+        if (source == out_fds.size()) {
+            break;
+        }
+        ssize_t n = splice(in_fd, nullptr, pipes[2 * source + 1], nullptr, std::min(length - moved, chunk),
+                           SPLICE_F_MOVE | SPLICE_F_MORE | SPLICE_F_NONBLOCK);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!wait_fd(in_fd, POLLIN, timeout_ms)) {
+                break;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINVAL && moved == 0) {
+            close_pipes();
+            return copy_body_to_all(in_fd, out_fds, length, timeout_ms, delivered);
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        // tee не забирает данные из pipe источника, поэтому копии делаются
+        // до того, как порция уйдет его получателю
+        for (size_t i = source + 1; i < out_fds.size(); ++i) {
+            if (delivered[i] && tee(pipes[2 * source], pipes[2 * i + 1], n, SPLICE_F_NONBLOCK) != n) {
+                delivered[i] = false;
+            }
+        }
+        for (size_t i = source; i < out_fds.size(); ++i) {
+            if (delivered[i] && !drain_pipe(pipes[2 * i], out_fds[i], n, timeout_ms)) {
+                delivered[i] = false;
+            }
+        }
+        moved += n;
+    }
+    close_pipes();
+    if (moved < length) {
+        delivered.assign(out_fds.size(), false);
+    }
+    return moved;
+}
+
+size_t discard_body(int in_fd, size_t length, int timeout_ms) {
+    char buf[COPY_CHUNK];
+    size_t discarded = 0;
+    while (discarded < length) {
+        ssize_t n = recv(in_fd, buf, std::min(length - discarded, sizeof(buf)), 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!wait_fd(in_fd, POLLIN, timeout_ms)) {
+                break;
+            }
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        discarded += n;
+    }
+    return discarded;
+}
@@ -0,0 +1,29 @@
+#ifndef UPLOAD_PROXY_H
+#define UPLOAD_PROXY_H
+
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+
+// Пересылка length байт из in_fd в out_fd через pipe вызовами splice:
+// данные идут сокет -> pipe -> сокет внутри ядра, без копий в память процесса.
+// in_fd может быть неблокирующим, ожидание данных - через poll с timeout_ms.
+// Если splice не поддерживается для дескрипторов, используется обычное копирование.
+// Возвращает число переданных байт (меньше length при ошибке или обрыве)
+size_t splice_body(int in_fd, int out_fd, size_t length, int timeout_ms);
+
+// Та же пересылка сразу в несколько out_fds (реплики): порция тела попадает
+// в pipe одного получателя и копируется tee(2) в pipe остальных, тоже без
+// копий в память процесса. Отказавший получатель исключается, остальные
+// продолжают. Возвращает число прочитанных из in_fd байт; delivered[i] -
+// получатель i принял их все. Чтение прекращается, если не осталось ни одного
+size_t tee_body(int in_fd, const std::vector<int>& out_fds, size_t length, int timeout_ms,
+                std::vector<bool>& delivered);
+
+// Дочитать и отбросить до length байт тела; число отброшенных байт
+size_t discard_body(int in_fd, size_t length, int timeout_ms);
+
+// Отправка буфера целиком; false при ошибке
+bool send_all(int fd, const char* data, size_t size, int timeout_ms);
+
+#endif // UPLOAD_PROXY_H
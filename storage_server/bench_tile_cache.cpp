@@ -0,0 +1,190 @@
+// Воспроизведение трассы обращений к тайлам на кеше W-TinyLFU и на простом LRU.
+//
+// Запуск:
+//   ./bench_tile_cache [capacity_mb] [trace_file]
+// Формат трассы: по строке на обращение "<ключ> [размер_в_байтах]".
+// Без файла генерируется синтетическая трасса: обращения к горячему набору
+// по закону Ципфа, перемежающиеся разовыми сканированиями целых снимков.
+#include "tile_cache.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <list>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct TraceRecord {
+    std::string key;
+    size_t size;
+};
+
+const size_t DEFAULT_TILE_BYTES = 64 * 1024;
+
+// Базовая линия для сравнения: LRU без фильтра допуска
+class LruBaseline {
+private:
+    size_t capacity;
+    size_t bytes = 0;
+    std::list<std::pair<std::string, size_t>> lru;
+    std::unordered_map<std::string, std::list<std::pair<std::string, size_t>>::iterator> index;
+
+public:
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    explicit LruBaseline(size_t capacity) : capacity(capacity) {}
+
+    void access(const std::string& key, size_t size) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            hits++;
+            lru.splice(lru.begin(), lru, it->second);
+            return;
+        }
+        misses++;
+        lru.emplace_front(key, size);
+        index[key] = lru.begin();
+        bytes += size;
+        while (bytes > capacity && !lru.empty()) {
+            bytes -= lru.back().second;
+            index.erase(lru.back().first);
+            lru.pop_back();
+            evictions++;
+        }
+    }
+};
+
+static std::vector<TraceRecord> load_trace(const char* path) {
+    std::vector<TraceRecord> trace;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream iss(line);
+        TraceRecord record;
+        record.size = DEFAULT_TILE_BYTES;
+        if (iss >> record.key) {
+            iss >> record.size;
+            trace.push_back(record);
+        }
+    }
+    return trace;
+}
+
+static std::vector<TraceRecord> synthetic_trace() {
+    const int hot_tiles = 20000;
+    const int accesses = 1000000;
+    const int scan_every = 100000;
+    const int scan_length = 30000;
+
+    std::mt19937_64 rng(42);
+    // Веса Ципфа (s = 0.9) для горячего набора
+    std::vector<double> cdf(hot_tiles);
+    double sum = 0;
+    for (int i = 0; i < hot_tiles; ++i) {
+        sum += 1.0 / std::pow(i + 1, 0.9);
+        cdf[i] = sum;
+    }
+    std::uniform_real_distribution<double> uniform(0, sum);
+
+    std::vector<TraceRecord> trace;
+    trace.reserve(accesses + (accesses / scan_every) * scan_length);
+    int scan_id = 0;
+    for (int i = 0; i < accesses; ++i) {
+        if (i > 0 && i % scan_every == 0) {
+            // Массовое сканирование снимка: каждый тайл читается один раз
+            for (int j = 0; j < scan_length; ++j) {
+                trace.push_back({"scan" + std::to_string(scan_id) + "/B04/" +
+                                 std::to_string(j / 100) + "/" + std::to_string(j % 100),
+                                 DEFAULT_TILE_BYTES});
+            }
+            scan_id++;
+        }
+        int rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        trace.push_back({"hot/B04/" + std::to_string(rank / 200) + "/" + std::to_string(rank % 200),
+                         DEFAULT_TILE_BYTES});
+    }
+    return trace;
+}
+
+// Однопоточное воспроизведение: на промахе тайл "читается с диска" и кладется в кеш
+static void replay_tinylfu(const std::vector<TraceRecord>& trace, size_t capacity) {
+    TileCache cache(capacity);
+    std::string payload;
+    std::unordered_map<size_t, std::string> payloads;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& record : trace) {
+        if (!cache.get(record.key, payload)) {
+            auto& data = payloads[record.size];
+            if (data.size() != record.size) {
+                data.assign(record.size, 'x');
+            }
+            cache.put(record.key, data, cache.generation(record.key));
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TileCacheStats stats = cache.get_stats();
+    printf("W-TinyLFU: hit ratio %.4f, evictions %llu, admission rejects %llu, %.0f ops/s\n",
+           static_cast<double>(stats.hits) / (stats.hits + stats.misses),
+           static_cast<unsigned long long>(stats.evictions),
+           static_cast<unsigned long long>(stats.admission_rejects),
+           trace.size() / seconds);
+}
+
+static void replay_lru(const std::vector<TraceRecord>& trace, size_t capacity) {
+    LruBaseline cache(capacity);
+    for (const auto& record : trace) {
+        cache.access(record.key, record.size);
+    }
+    printf("LRU:       hit ratio %.4f, evictions %llu\n",
+           static_cast<double>(cache.hits) / (cache.hits + cache.misses),
+           static_cast<unsigned long long>(cache.evictions));
+}
+
+// Многопоточное воспроизведение для оценки конкуренции за блокировки шардов
+static void replay_concurrent(const std::vector<TraceRecord>& trace, size_t capacity, int threads_count) {
+    TileCache cache(capacity);
+    std::string data(DEFAULT_TILE_BYTES, 'x');
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; ++t) {
+        threads.emplace_back([&, t]() {
+            std::string payload;
+            for (size_t i = t; i < trace.size(); i += threads_count) {
+                if (!cache.get(trace[i].key, payload)) {
+                    cache.put(trace[i].key, data, cache.generation(trace[i].key));
+                }
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    TileCacheStats stats = cache.get_stats();
+    printf("W-TinyLFU x%d threads: hit ratio %.4f, %.0f ops/s\n", threads_count,
+           static_cast<double>(stats.hits) / (stats.hits + stats.misses), trace.size() / seconds);
+}
+
+int main(int argc, char** argv) {
+    size_t capacity_mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    size_t capacity = capacity_mb * 1024 * 1024;
+    std::vector<TraceRecord> trace = argc > 2 ? load_trace(argv[2]) : synthetic_trace();
+    if (trace.empty()) {
+        fprintf(stderr, "Пустая трасса\n");
+        return 1;
+    }
+
+    printf("Трасса: %zu обращений, кеш %zu МБ\n", trace.size(), capacity_mb);
+    replay_lru(trace, capacity);
+    replay_tinylfu(trace, capacity);
+    replay_concurrent(trace, capacity, std::max(2u, std::thread::hardware_concurrency()));
+    return 0;
+}
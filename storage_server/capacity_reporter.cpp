@@ -0,0 +1,150 @@
+#include "capacity_reporter.h"
+#include "storage_server.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/statvfs.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <nlohmann/json.hpp>
+
+// Вес нового измерения в скользящем среднем задержки
+const double LATENCY_EWMA_ALPHA = 0.1;
+// Таймаут на соединение и ответ маршрутизатора
+const int HEARTBEAT_TIMEOUT_SEC = 2;
+
+static std::mutex g_latency_mtx;
+static double g_latency_ewma_ms = 0;
+
+bool measure_tier(const std::string& path, TierCapacity& tier) {
+    if (path.empty()) {
+        return false;
+    }
+    struct statvfs st;
+    if (statvfs(path.c_str(), &st) != 0) {
+        perror(("statvfs " + path).c_str());
+        return false;
+    }
+    tier.free_bytes = static_cast<uint64_t>(st.f_bavail) * st.f_frsize;
+    tier.total_bytes = static_cast<uint64_t>(st.f_blocks) * st.f_frsize;
+    return true;
+}
+
+void capacity_record_latency(double ms) {
+    std::lock_guard<std::mutex> lock(g_latency_mtx);
+    if (g_latency_ewma_ms == 0) {
+        g_latency_ewma_ms = ms;
+    } else {
+        g_latency_ewma_ms = LATENCY_EWMA_ALPHA * ms + (1 - LATENCY_EWMA_ALPHA) * g_latency_ewma_ms;
+    }
+}
+
+double capacity_latency_ms() {
+    std::lock_guard<std::mutex> lock(g_latency_mtx);
+    return g_latency_ewma_ms;
+}
+
+CapacityReporter::CapacityReporter(const std::string& location, const std::string& ssd_path,
+                                   const std::string& hdd_path,
+                                   const std::vector<std::string>& routers, int interval_ms)
+    : location(location), ssd_path(ssd_path), hdd_path(hdd_path),
+      routers(routers), interval_ms(interval_ms) {}
+
+CapacityReporter::~CapacityReporter() {
+    stop();
+}
+
+void CapacityReporter::start() {
+    if (routers.empty() || worker.joinable()) {
+        return;
+    }
+    stop_flag = false;
+    worker = std::thread(&CapacityReporter::run, this);
+}
+
+void CapacityReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop_flag = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+CapacityReport CapacityReporter::collect() {
+    CapacityReport report;
+    report.location = location;
+    measure_tier(ssd_path, report.ssd);
+    measure_tier(hdd_path, report.hdd);
+    report.queue_depth = storage_queue_depth();
+    report.latency_ms = capacity_latency_ms();
+    return report;
+}
+
+bool CapacityReporter::send_report(const std::string& router, const CapacityReport& report) {
+    size_t colon = router.find(':');
+    std::string host = router.substr(0, colon);
+    int port = colon == std::string::npos ? 8080 : std::stoi(router.substr(colon + 1));
+
+    nlohmann::json body;
+    body["location"] = report.location;
+    body["ssd"]["free_bytes"] = report.ssd.free_bytes;
+    body["ssd"]["total_bytes"] = report.ssd.total_bytes;
+    body["hdd"]["free_bytes"] = report.hdd.free_bytes;
+    body["hdd"]["total_bytes"] = report.hdd.total_bytes;
+    body["queue_depth"] = report.queue_depth;
+    body["latency_ms"] = report.latency_ms;
+    body["interval_ms"] = interval_ms;
+    std::string payload = body.dump();
+
+    std::string request = "POST /server/heartbeat HTTP/1.1\r\n";
+    request += "Host: " + host + "\r\n";
+    request += "Content-Type: application/json\r\n";
+    request += "Content-Length: " + std::to_string(payload.size()) + "\r\n\r\n" + payload;
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return false;
+    }
+    timeval tv = {HEARTBEAT_TIMEOUT_SEC, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+
+    bool ok = false;
+    if (connect(sock, (sockaddr*)&addr, sizeof(addr)) == 0 &&
+        send(sock, request.c_str(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size()) {
+        char buf[64];
+        ssize_t n = recv(sock, buf, sizeof(buf) - 1, 0);
+        if (n > 0) {
+            buf[n] = '\0';
+            ok = strncmp(buf, "HTTP/1.1 2", 10) == 0;
+        }
+    }
+    close(sock);
+    return ok;
+}
+
+void CapacityReporter::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stop_flag) {
+        lock.unlock();
+        CapacityReport report = collect();
+        for (const auto& router : routers) {
+            if (!send_report(router, report)) {
+                fprintf(stderr, "Heartbeat to %s failed\n", router.c_str());
+            }
+        }
+        lock.lock();
+        cv.wait_for(lock, std::chrono::milliseconds(interval_ms), [this]() { return stop_flag; });
+    }
+}
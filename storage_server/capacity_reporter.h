@@ -0,0 +1,66 @@
+#ifndef CAPACITY_REPORTER_H
+#define CAPACITY_REPORTER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Занятость одного уровня хранения (SSD или HDD)
+struct TierCapacity {
+    uint64_t free_bytes = 0;
+    uint64_t total_bytes = 0;
+};
+
+// Снимок состояния сервера, отправляемый маршрутизаторам
+struct CapacityReport {
+    std::string location;  // Адрес сервера в таблице Servers, "ip:port"
+    TierCapacity ssd;
+    TierCapacity hdd;
+    size_t queue_depth = 0;
+    double latency_ms = 0;  // Сглаженная задержка обработки запроса
+};
+
+// Измерение свободного места по пути через statvfs
+bool measure_tier(const std::string& path, TierCapacity& tier);
+
+// Учет задержки обработки запроса (EWMA), вызывается рабочими потоками
+void capacity_record_latency(double ms);
+double capacity_latency_ms();
+
+// Фоновый поток, периодически отправляющий heartbeat с реальной
+// занятостью дисков, глубиной очереди и задержкой на маршрутизаторы
+class CapacityReporter {
+private:
+    std::string location;
+    std::string ssd_path;
+    std::string hdd_path;
+    std::vector<std::string> routers;  // "ip:port"
+    int interval_ms;
+
+    std::thread worker;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stop_flag = false;
+
+    void run();
+
+public:
+    CapacityReporter(const std::string& location, const std::string& ssd_path, const std::string& hdd_path,
+                     const std::vector<std::string>& routers, int interval_ms);
+    ~CapacityReporter();
+
+    void start();
+    void stop();
+
+    // Текущий снимок состояния
+    CapacityReport collect();
+
+    // Отправка снимка на один маршрутизатор; true при ответе 2xx
+    bool send_report(const std::string& router, const CapacityReport& report);
+};
+
+#endif // CAPACITY_REPORTER_H
@@ -43,7 +43,20 @@ CREATE TABLE IF NOT EXISTS Tiles (
     spectrum TEXT NOT NULL,
     image_id INTEGER NOT NULL,
     tile_url TEXT NOT NULL,
-    frequency INTEGER DEFAULT 0
+    frequency INTEGER DEFAULT 0,
+    payload_hash TEXT,
+    constant_value SMALLINT,
+    payload_size BIGINT DEFAULT 0
+);
+
+CREATE UNIQUE INDEX IF NOT EXISTS idx_tiles_position
+    ON Tiles (image_id, spectrum, tile_row, tile_column);
+
+-- Уникальные полезные нагрузки тайлов со счетчиком ссылок
+CREATE TABLE IF NOT EXISTS Tile_Payloads (
+    payload_hash TEXT PRIMARY KEY,
+    payload_size BIGINT NOT NULL,
+    ref_count INTEGER NOT NULL DEFAULT 0
 );
 SQL
 )
@@ -3,6 +3,7 @@
 #include <vector>
 #include <libpq-fe.h>
 #include <stdexcept>
+#include "db_records.h"
 
 class DBManager {
 private:
@@ -23,8 +24,25 @@ private:
         PQclear(res);
     }
 
+    // Параметризованный запрос, возвращающий строки
+    PGresult* execParams(const std::string& query, const std::vector<std::string>& params) {
+        std::vector<const char*> values;
+        for (const auto& p : params) {
+            values.push_back(p.c_str());
+        }
+        PGresult* res = PQexecParams(conn, query.c_str(), values.size(), NULL,
+                                     values.data(), NULL, NULL, 0);
+        ExecStatusType status = PQresultStatus(res);
+        if (status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK) {
+            std::string error = PQerrorMessage(conn);
+            PQclear(res);
+            throw std::runtime_error("Ошибка выполнения запроса: " + error);
+        }
+        return res;
+    }
+
 public:
-    DBManager(const std::string& dbname, 
+    DBManager(const std::string& dbname = "tiles_db", 
               const std::string& user = "postgres",
               const std::string& password = "",
               const std::string& host = "localhost",
@@ -131,4 +149,170 @@ public:
         PQclear(res);
         return tiles;
     }
-}; 
\ No newline at end of file
+
+    // Получить дескриптор полезной нагрузки тайла
+    TilePayloadRecord get_tile_payload(int image_id, const std::string& spectrum,
+                                       int tile_row, int tile_column) {
+        PGresult* res = execParams(
+            "SELECT COALESCE(payload_hash, ''), COALESCE(constant_value, -1), "
+            "COALESCE(payload_size, 0) FROM Tiles "
+            "WHERE image_id = $1 AND spectrum = $2 AND tile_row = $3 AND tile_column = $4",
+            {std::to_string(image_id), spectrum, std::to_string(tile_row), std::to_string(tile_column)});
+
+        TilePayloadRecord record;
+        if (PQntuples(res) > 0) {
+            record.found = true;
+            record.payload_hash = PQgetvalue(res, 0, 0);
+            record.constant_value = std::stoi(PQgetvalue(res, 0, 1));
+            record.payload_size = std::stoll(PQgetvalue(res, 0, 2));
+        }
+        PQclear(res);
+        return record;
+    }
+
+    // Получить дескрипторы нагрузок для набора тайлов одним запросом.
+    // Результат выровнен по порядку keys
+    std::vector<TilePayloadRecord> get_tile_payloads(const std::vector<TileKey>& keys) {
+        std::vector<TilePayloadRecord> records(keys.size());
+        if (keys.empty()) {
+            return records;
+        }
+
+        std::string ids = "{", spectrums = "{", rows = "{", cols = "{";
+        for (size_t i = 0; i < keys.size(); i++) {
+            const char* sep = i > 0 ? "," : "";
+            ids += sep + std::to_string(keys[i].image_id);
+            std::string spectrum;
+            for (char c : keys[i].spectrum) {
+                if (c == '"' || c == '\\') spectrum += '\\';
+                spectrum += c;
+            }
+            spectrums += sep + ("\"" + spectrum + "\"");
+            rows += sep + std::to_string(keys[i].tile_row);
+            cols += sep + std::to_string(keys[i].tile_column);
+        }
+        ids += "}"; spectrums += "}"; rows += "}"; cols += "}";
+
+        PGresult* res = execParams(
+            "SELECT k.ord - 1, COALESCE(t.payload_hash, ''), COALESCE(t.constant_value, -1), "
+            "COALESCE(t.payload_size, 0) "
+            "FROM UNNEST($1::int[], $2::text[], $3::int[], $4::int[]) WITH ORDINALITY "
+            "AS k(image_id, spectrum, tile_row, tile_column, ord) "
+            "JOIN Tiles t ON t.image_id = k.image_id AND t.spectrum = k.spectrum "
+            "AND t.tile_row = k.tile_row AND t.tile_column = k.tile_column",
+            {ids, spectrums, rows, cols});
+
+        int rows_count = PQntuples(res);
+        for (int i = 0; i < rows_count; i++) {
+            TilePayloadRecord& record = records[std::stoul(PQgetvalue(res, i, 0))];
+            record.found = true;
+            record.payload_hash = PQgetvalue(res, i, 1);
+            record.constant_value = std::stoi(PQgetvalue(res, i, 2));
+            record.payload_size = std::stoll(PQgetvalue(res, i, 3));
+        }
+        PQclear(res);
+        return records;
+    }
+
+    // Спектры, для которых у снимка есть тайлы
+    std::vector<std::string> get_image_spectrums(int image_id) {
+        PGresult* res = execParams("SELECT DISTINCT spectrum FROM Tiles WHERE image_id = $1",
+                                   {std::to_string(image_id)});
+        std::vector<std::string> spectrums;
+        int rows = PQntuples(res);
+        for (int i = 0; i < rows; i++) {
+            spectrums.push_back(PQgetvalue(res, i, 0));
+        }
+        PQclear(res);
+        return spectrums;
+    }
+
+    // Добавить или обновить тайл вместе со ссылкой на нагрузку
+    void upsert_tile_payload(int image_id, const std::string& spectrum, int tile_row, int tile_column,
+                             const std::string& tile_url, const std::string& payload_hash,
+                             int constant_value, long long payload_size) {
+        PGresult* res = execParams(
+            "INSERT INTO Tiles (tile_row, tile_column, spectrum, image_id, tile_url, "
+            "payload_hash, constant_value, payload_size) "
+            "VALUES ($1, $2, $3, $4, $5, NULLIF($6, ''), NULLIF($7::int, -1), $8) "
+            "ON CONFLICT (image_id, spectrum, tile_row, tile_column) DO UPDATE SET "
+            "tile_url = EXCLUDED.tile_url, payload_hash = EXCLUDED.payload_hash, "
+            "constant_value = EXCLUDED.constant_value, payload_size = EXCLUDED.payload_size",
+            {std::to_string(tile_row), std::to_string(tile_column), spectrum,
+             std::to_string(image_id), tile_url, payload_hash,
+             std::to_string(constant_value), std::to_string(payload_size)});
+        PQclear(res);
+    }
+
+    // Увеличить счетчик ссылок на нагрузку, вернуть новое значение
+    int acquire_tile_payload(const std::string& payload_hash, long long payload_size) {
+        PGresult* res = execParams(
+            "INSERT INTO Tile_Payloads (payload_hash, payload_size, ref_count) VALUES ($1, $2, 1) "
+            "ON CONFLICT (payload_hash) DO UPDATE SET ref_count = Tile_Payloads.ref_count + 1 "
+            "RETURNING ref_count",
+            {payload_hash, std::to_string(payload_size)});
+        int ref_count = std::stoi(PQgetvalue(res, 0, 0));
+        PQclear(res);
+        return ref_count;
+    }
+
+    // Уменьшить счетчик ссылок, при нуле удалить запись; вернуть остаток
+    int release_tile_payload(const std::string& payload_hash) {
+        PGresult* res = execParams(
+            "UPDATE Tile_Payloads SET ref_count = ref_count - 1 "
+            "WHERE payload_hash = $1 RETURNING ref_count",
+            {payload_hash});
+        int ref_count = PQntuples(res) > 0 ? std::stoi(PQgetvalue(res, 0, 0)) : 0;
+        PQclear(res);
+
+        if (ref_count <= 0) {
+            res = execParams("DELETE FROM Tile_Payloads WHERE payload_hash = $1 AND ref_count <= 0",
+                             {payload_hash});
+            PQclear(res);
+        }
+        return ref_count;
+    }
+
+    // Статистика дедупликации тайлов снимка: физический объем считается
+    // по уникальным нагрузкам, константные тайлы места не занимают
+    DedupStats get_dedup_stats(int image_id) {
+        PGresult* res = execParams(
+            "SELECT COUNT(*), COUNT(constant_value), COUNT(DISTINCT payload_hash), "
+            "COALESCE(SUM(payload_size), 0), "
+            "COALESCE((SELECT SUM(p.payload_size) FROM Tile_Payloads p WHERE p.payload_hash IN "
+            "(SELECT payload_hash FROM Tiles WHERE image_id = $1)), 0) "
+            "FROM Tiles WHERE image_id = $1",
+            {std::to_string(image_id)});
+
+        DedupStats stats;
+        if (PQntuples(res) > 0) {
+            stats.tiles_total = std::stoi(PQgetvalue(res, 0, 0));
+            stats.tiles_constant = std::stoi(PQgetvalue(res, 0, 1));
+            stats.unique_payloads = std::stoi(PQgetvalue(res, 0, 2));
+            stats.logical_bytes = std::stoll(PQgetvalue(res, 0, 3));
+            stats.physical_bytes = std::stoll(PQgetvalue(res, 0, 4));
+        }
+        PQclear(res);
+        return stats;
+    }
+
+    // Объем тайлов по всем спектрам всех снимков
+    std::vector<SpectrumUsage> get_spectrum_usage() {
+        PGresult* res = execParams(
+            "SELECT image_id, spectrum, COUNT(*), COALESCE(SUM(payload_size), 0) "
+            "FROM Tiles GROUP BY image_id, spectrum",
+            {});
+        std::vector<SpectrumUsage> usage;
+        int rows = PQntuples(res);
+        for (int i = 0; i < rows; i++) {
+            SpectrumUsage item;
+            item.image_id = std::stoi(PQgetvalue(res, i, 0));
+            item.spectrum = PQgetvalue(res, i, 1);
+            item.tiles = std::stoi(PQgetvalue(res, i, 2));
+            item.bytes = std::stoll(PQgetvalue(res, i, 3));
+            usage.push_back(item);
+        }
+        PQclear(res);
+        return usage;
+    }
+};
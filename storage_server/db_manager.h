@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <tuple>
+#include "db_records.h"
 
 class DBManager {
 private:
@@ -17,7 +18,7 @@ private:
     void executeQuery(const std::string& query);
 
 public:
-    DBManager(const std::string& dbname, 
+    DBManager(const std::string& dbname = "tiles_db", 
               const std::string& user = "postgres",
               const std::string& password = "",
               const std::string& host = "localhost",
@@ -36,6 +37,33 @@ public:
 
     // Получить все данные из таблицы Tiles
     std::vector<std::tuple<int, int, int, std::string, int, std::string, int>> getAllTiles();
+
+    // Получить дескриптор полезной нагрузки тайла
+    TilePayloadRecord get_tile_payload(int image_id, const std::string& spectrum,
+                                       int tile_row, int tile_column);
+
+    // Получить дескрипторы нагрузок для набора тайлов одним запросом
+    std::vector<TilePayloadRecord> get_tile_payloads(const std::vector<TileKey>& keys);
+
+    // Спектры, для которых у снимка есть тайлы
+    std::vector<std::string> get_image_spectrums(int image_id);
+
+    // Добавить или обновить тайл вместе со ссылкой на нагрузку
+    void upsert_tile_payload(int image_id, const std::string& spectrum, int tile_row, int tile_column,
+                             const std::string& tile_url, const std::string& payload_hash,
+                             int constant_value, long long payload_size);
+
+    // Увеличить счетчик ссылок на нагрузку, вернуть новое значение
+    int acquire_tile_payload(const std::string& payload_hash, long long payload_size);
+
+    // Уменьшить счетчик ссылок, при нуле удалить запись; вернуть остаток
+    int release_tile_payload(const std::string& payload_hash);
+
+    // Статистика дедупликации тайлов снимка
+    DedupStats get_dedup_stats(int image_id);
+
+    // Объем тайлов по всем спектрам всех снимков
+    std::vector<SpectrumUsage> get_spectrum_usage();
 };
 
 #endif // DB_MANAGER_H 
\ No newline at end of file
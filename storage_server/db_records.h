@@ -0,0 +1,39 @@
+#ifndef DB_RECORDS_H
+#define DB_RECORDS_H
+
+#include <string>
+
+// Ключ тайла: снимок, спектр и позиция в сетке
+struct TileKey {
+    int image_id;
+    std::string spectrum;
+    int tile_row;
+    int tile_column;
+};
+
+// Запись о полезной нагрузке тайла
+struct TilePayloadRecord {
+    bool found = false;
+    std::string payload_hash;   // Пусто для константных тайлов
+    int constant_value = -1;    // Значение заполнения или -1
+    long long payload_size = 0;
+};
+
+// Статистика дедупликации по снимку
+struct DedupStats {
+    int tiles_total = 0;
+    int tiles_constant = 0;
+    int unique_payloads = 0;
+    long long logical_bytes = 0;   // Сумма размеров всех тайлов
+    long long physical_bytes = 0;  // Реально занятое место на диске
+};
+
+// Объем тайлов одного спектра снимка на сервере
+struct SpectrumUsage {
+    int image_id = 0;
+    std::string spectrum;
+    int tiles = 0;
+    long long bytes = 0;  // Сумма размеров тайлов
+};
+
+#endif // DB_RECORDS_H
@@ -13,10 +13,20 @@
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <poll.h>
 #include <nlohmann/json.hpp>
+#include "tile_store.h"
+#include "tile_cache.h"
+#include "tile_prefetcher.h"
+#include "capacity_reporter.h"
+#include <chrono>
 
 volatile bool g_storage_server_stop = false;
 const int MAX_EVENTS = 32;
+const int RECV_TIMEOUT_MS = 5000;
+const size_t MAX_REQUEST_SIZE = 256 * 1024 * 1024;
+const size_t MAX_TILE_BATCH = 1024;
+const uint32_t TILE_BATCH_MISSING = 0xFFFFFFFF;
 
 // Структура для очереди сокетов
 struct {
@@ -27,6 +37,21 @@ struct {
 pthread_cond_t g_condvar;
 pthread_mutex_t g_condvar_mtx = PTHREAD_MUTEX_INITIALIZER;
 
+// Кеш тайлов в памяти и предзагрузчик соседних тайлов
+TileCache* g_tile_cache = nullptr;
+TilePrefetcher* g_tile_prefetcher = nullptr;
+
+// Отправка heartbeat с реальной занятостью на маршрутизаторы
+CapacityReporter* g_capacity_reporter = nullptr;
+
+// Глубина очереди принятых, но еще не обработанных соединений
+size_t storage_queue_depth() {
+    pthread_mutex_lock(&g_handle_socks.mtx);
+    size_t depth = g_handle_socks.que.size();
+    pthread_mutex_unlock(&g_handle_socks.mtx);
+    return depth;
+}
+
 // Установка неблокирующего режима для сокета
 int set_nonblock(int fd) {
     int flags;
@@ -109,6 +134,23 @@ int storage_server_run(const storage_server_options &opts) {
         perror("pthread_cond_init: ");
     }
 
+    g_tile_cache = new TileCache(opts.cache_bytes);
+    if (opts.prefetch_radius >= 0) {
+        g_tile_prefetcher = new TilePrefetcher(*g_tile_cache, opts.storage_path, opts.prefetch_radius);
+        g_tile_prefetcher->start();
+    }
+
+    // Маршрутизаторы узнают сервер по location: server_id у каждого из них свой
+    std::string location = opts.location;
+    if (location.empty()) {
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &master_addr.sin_addr, ip, sizeof(ip));
+        location = std::string(ip) + ":" + std::to_string(ntohs(master_addr.sin_port));
+    }
+    g_capacity_reporter = new CapacityReporter(location, opts.ssd_path, opts.hdd_path,
+                                               opts.routers, opts.heartbeat_interval_ms);
+    g_capacity_reporter->start();
+
     std::vector<pthread_t> workers;
     workers.resize(opts.workers_count);
     for (int i = 0; i < opts.workers_count; ++i) {
@@ -147,6 +189,16 @@ int storage_server_run(const storage_server_options &opts) {
     for (const auto &wrk : workers) {
         pthread_join(wrk, nullptr);
     }
+    g_capacity_reporter->stop();
+    delete g_capacity_reporter;
+    g_capacity_reporter = nullptr;
+    if (g_tile_prefetcher) {
+        g_tile_prefetcher->stop();
+        delete g_tile_prefetcher;
+        g_tile_prefetcher = nullptr;
+    }
+    delete g_tile_cache;
+    g_tile_cache = nullptr;
     return 0;
 }
 
@@ -190,12 +242,52 @@ HttpRequest parse_http_request(const char* buffer, size_t length) {
         }
     }
     
-    // Чтение тела запроса
-    std::getline(iss, req.body);
+    // Чтение тела запроса: тело может быть бинарным (полезная нагрузка тайла),
+    // поэтому берем все байты после пустой строки, а не одну строку
+    size_t body_pos = request_str.find("\r\n\r\n");
+    if (body_pos != std::string::npos) {
+        req.body = request_str.substr(body_pos + 4);
+    }
     
     return req;
 }
 
+// Извлечение ключа тайла из query-параметров image_id, spectrum, row, col
+static bool parse_tile_key(const HttpRequest& req, TileKey& key) {
+    try {
+        key.image_id = std::stoi(req.query_params.at("image_id"));
+        key.spectrum = req.query_params.at("spectrum");
+        key.tile_row = std::stoi(req.query_params.at("row"));
+        key.tile_column = std::stoi(req.query_params.at("col"));
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+// Разбор тела пакетного запроса:
+// {"tiles": [{"image_id": 1, "spectrum": "B04", "row": 0, "col": 1}, ...]}
+static bool parse_tile_batch(const std::string& body, std::vector<TileKey>& keys) {
+    try {
+        nlohmann::json json_data = nlohmann::json::parse(body);
+        const auto& tiles = json_data.at("tiles");
+        if (!tiles.is_array() || tiles.size() > MAX_TILE_BATCH) {
+            return false;
+        }
+        for (const auto& tile : tiles) {
+            TileKey key;
+            key.image_id = tile.at("image_id");
+            key.spectrum = tile.at("spectrum");
+            key.tile_row = tile.at("row");
+            key.tile_column = tile.at("col");
+            keys.push_back(key);
+        }
+    } catch (...) {
+        return false;
+    }
+    return !keys.empty();
+}
+
 // Обработка HTTP-запроса
 std::string process_http_request(const HttpRequest& req, DBManager& db_manager, const std::string& storage_path) {
     std::string response;
@@ -272,6 +364,191 @@ std::string process_http_request(const HttpRequest& req, DBManager& db_manager,
             }
         }
     }
+    // Пакетная выдача тайлов одним бинарным ответом
+    else if (req.path == "/tiles/batch") {
+        std::vector<TileKey> keys;
+        if (req.method != "POST" || !parse_tile_batch(req.body, keys)) {
+            response = "HTTP/1.1 400 Bad Request\r\n\r\n";
+        } else {
+            // Сначала отдаем то, что есть в кеше, остальное читаем пакетом
+            std::vector<std::string> payloads(keys.size());
+            std::vector<bool> found(keys.size(), false);
+            std::vector<TileKey> missing_keys;
+            std::vector<size_t> missing_pos;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                if (g_tile_cache && g_tile_cache->get(tile_cache_key(keys[i]), payloads[i])) {
+                    found[i] = true;
+                } else {
+                    missing_keys.push_back(keys[i]);
+                    missing_pos.push_back(i);
+                }
+            }
+            if (!missing_keys.empty()) {
+                std::vector<uint64_t> generations;
+                for (const auto& key : missing_keys) {
+                    generations.push_back(g_tile_cache ? g_tile_cache->generation(tile_cache_key(key)) : 0);
+                }
+                std::vector<std::string> loaded;
+                std::vector<bool> loaded_found;
+                tile_store_get_batch(db_manager, storage_path, missing_keys, loaded, loaded_found);
+                for (size_t i = 0; i < missing_keys.size(); ++i) {
+                    if (loaded_found[i]) {
+                        if (g_tile_cache) {
+                            g_tile_cache->put(tile_cache_key(missing_keys[i]), loaded[i], generations[i]);
+                        }
+                        payloads[missing_pos[i]].swap(loaded[i]);
+                        found[missing_pos[i]] = true;
+                    }
+                }
+            }
+            if (g_tile_prefetcher) {
+                for (const auto& key : keys) {
+                    g_tile_prefetcher->on_tile_read(key);
+                }
+            }
+
+            // Формат тела: для каждого запрошенного тайла по порядку
+            // 4 байта длины (big-endian, 0xFFFFFFFF - тайла нет) и сами байты
+            std::string body;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                uint32_t len = found[i] ? static_cast<uint32_t>(payloads[i].size()) : TILE_BATCH_MISSING;
+                uint32_t len_be = htonl(len);
+                body.append(reinterpret_cast<const char*>(&len_be), sizeof(len_be));
+                if (found[i]) {
+                    body += payloads[i];
+                }
+            }
+
+            response = "HTTP/1.1 200 OK\r\n";
+            response += "Content-Type: application/octet-stream\r\n";
+            response += "X-Tile-Count: " + std::to_string(keys.size()) + "\r\n";
+            response += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+            response += body;
+        }
+    }
+    // Запись и чтение полезной нагрузки тайла
+    else if (req.path == "/tiles/data") {
+        TileKey key;
+        if (!parse_tile_key(req, key)) {
+            response = "HTTP/1.1 400 Bad Request\r\n\r\n";
+        } else if (req.method == "POST") {
+            tile_store_result_t result = tile_store_put(db_manager, storage_path, key,
+                                                        req.body.data(), req.body.size());
+            if (g_tile_cache) {
+                g_tile_cache->invalidate(tile_cache_key(key));
+            }
+            if (result == TILE_STORE_ERROR) {
+                response = "HTTP/1.1 500 Internal Server Error\r\n\r\n";
+            } else {
+                const char* stored = result == TILE_STORED_NEW ? "new" :
+                                     result == TILE_STORED_DEDUP ? "dedup" : "constant";
+                std::string json_response = std::string("{\"stored\":\"") + stored + "\"}";
+                response = "HTTP/1.1 201 Created\r\n";
+                response += "Content-Type: application/json\r\n";
+                response += "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n";
+                response += json_response;
+            }
+        } else if (req.method == "GET") {
+            std::string payload;
+            std::string cache_key = tile_cache_key(key);
+            bool found = g_tile_cache && g_tile_cache->get(cache_key, payload);
+            uint64_t generation = found || !g_tile_cache ? 0 : g_tile_cache->generation(cache_key);
+            if (!found && tile_store_get(db_manager, storage_path, key, payload)) {
+                found = true;
+                if (g_tile_cache) {
+                    g_tile_cache->put(cache_key, payload, generation);
+                }
+            }
+            if (found && g_tile_prefetcher) {
+                g_tile_prefetcher->on_tile_read(key);
+            }
+            if (found) {
+                response = "HTTP/1.1 200 OK\r\n";
+                response += "Content-Type: application/octet-stream\r\n";
+                response += "Content-Length: " + std::to_string(payload.size()) + "\r\n\r\n";
+                response += payload;
+            } else {
+                response = "HTTP/1.1 404 Not Found\r\n\r\n";
+            }
+        }
+    }
+    // Метрики кеша тайлов и предзагрузчика
+    else if (req.path == "/metrics/cache") {
+        if (req.method == "GET" && g_tile_cache) {
+            TileCacheStats cache_stats = g_tile_cache->get_stats();
+            nlohmann::json json_data;
+            json_data["cache"]["hits"] = cache_stats.hits;
+            json_data["cache"]["misses"] = cache_stats.misses;
+            json_data["cache"]["evictions"] = cache_stats.evictions;
+            json_data["cache"]["admission_rejects"] = cache_stats.admission_rejects;
+            json_data["cache"]["stale_fills"] = cache_stats.stale_fills;
+            json_data["cache"]["hit_ratio"] = cache_stats.hits + cache_stats.misses > 0
+                ? static_cast<double>(cache_stats.hits) / (cache_stats.hits + cache_stats.misses)
+                : 0.0;
+            json_data["cache"]["bytes"] = cache_stats.bytes;
+            json_data["cache"]["entries"] = cache_stats.entries;
+            json_data["prefetch"]["useful"] = cache_stats.prefetch_useful;
+            json_data["prefetch"]["wasted"] = cache_stats.prefetch_wasted;
+            if (g_tile_prefetcher) {
+                PrefetchStats prefetch_stats = g_tile_prefetcher->get_stats();
+                json_data["prefetch"]["requested"] = prefetch_stats.requested;
+                json_data["prefetch"]["loaded"] = prefetch_stats.loaded;
+                json_data["prefetch"]["skipped"] = prefetch_stats.skipped;
+                json_data["prefetch"]["radius"] = prefetch_stats.radius;
+            }
+            std::string json_response = json_data.dump();
+
+            response = "HTTP/1.1 200 OK\r\n";
+            response += "Content-Type: application/json\r\n";
+            response += "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n";
+            response += json_response;
+        } else {
+            response = "HTTP/1.1 404 Not Found\r\n\r\n";
+        }
+    }
+    // Коэффициент дедупликации тайлов снимка
+    else if (req.path == "/tiles/dedup") {
+        if (req.method == "GET" && req.query_params.count("image_id")) {
+            DedupStats stats = db_manager.get_dedup_stats(std::stoi(req.query_params.at("image_id")));
+            double ratio = stats.physical_bytes > 0
+                ? static_cast<double>(stats.logical_bytes) / stats.physical_bytes
+                : 0.0;
+
+            nlohmann::json json_data;
+            json_data["tiles_total"] = stats.tiles_total;
+            json_data["tiles_constant"] = stats.tiles_constant;
+            json_data["unique_payloads"] = stats.unique_payloads;
+            json_data["logical_bytes"] = stats.logical_bytes;
+            json_data["physical_bytes"] = stats.physical_bytes;
+            json_data["dedup_ratio"] = ratio;
+            std::string json_response = json_data.dump();
+
+            response = "HTTP/1.1 200 OK\r\n";
+            response += "Content-Type: application/json\r\n";
+            response += "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n";
+            response += json_response;
+        } else {
+            response = "HTTP/1.1 400 Bad Request\r\n\r\n";
+        }
+    }
+    // Объем тайлов по спектрам снимков - для отчета политики уровней хранения
+    else if (req.path == "/tiles/usage") {
+        if (req.method == "GET") {
+            nlohmann::json json_data = nlohmann::json::array();
+            for (const auto& item : db_manager.get_spectrum_usage()) {
+                json_data.push_back({{"image_id", item.image_id}, {"spectrum", item.spectrum},
+                                     {"tiles", item.tiles}, {"bytes", item.bytes}});
+            }
+            std::string json_response = json_data.dump();
+
+            response = "HTTP/1.1 200 OK\r\n";
+            response += "Content-Type: application/json\r\n";
+            response += "Content-Length: " + std::to_string(json_response.size()) + "\r\n\r\n";
+            response += json_response;
+        } else {
+            response = "HTTP/1.1 405 Method Not Allowed\r\n\r\n";
+        }
+    }
     // Обработка запроса на инкремент частоты обращения к тайлу
     else if (req.path.find("/tiles/") == 0 && req.path.find("/increment") != std::string::npos) {
         if (req.method == "POST") {
@@ -302,17 +579,66 @@ std::string process_http_request(const HttpRequest& req, DBManager& db_manager,
     return response;
 }
 
+// Чтение запроса целиком: заголовки и тело длиной Content-Length.
+// Сокет неблокирующий, поэтому между порциями ждем данные через poll
+ssize_t read_http_request(int sock_fd, std::string &raw) {
+    char buf[65536];
+    size_t header_end = std::string::npos;
+    size_t expected = 0;
+
+    while (true) {
+        ssize_t nbytes = recv(sock_fd, buf, sizeof(buf), 0);
+        if (nbytes > 0) {
+            raw.append(buf, nbytes);
+        } else if (nbytes == 0) {
+            break;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (header_end != std::string::npos && raw.size() >= expected) {
+                break;
+            }
+            pollfd pfd = {sock_fd, POLLIN, 0};
+            if (poll(&pfd, 1, RECV_TIMEOUT_MS) <= 0) {
+                break;
+            }
+            continue;
+        } else {
+            return -1;
+        }
+
+        if (header_end == std::string::npos) {
+            header_end = raw.find("\r\n\r\n");
+            if (header_end != std::string::npos) {
+                expected = header_end + 4;
+                std::string headers = raw.substr(0, header_end);
+                std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+                size_t cl_pos = headers.find("content-length:");
+                if (cl_pos != std::string::npos) {
+                    expected += std::strtoull(headers.c_str() + cl_pos + 15, nullptr, 10);
+                }
+                if (expected > MAX_REQUEST_SIZE) {
+                    return -1;
+                }
+            }
+        }
+        if (header_end != std::string::npos && raw.size() >= expected) {
+            break;
+        }
+    }
+    return raw.size();
+}
+
 // Функция обработки сокета
 int handle_socket(int sock_fd, const std::string &storage_path) {
-    char buf[4096];
-    ssize_t nbytes = recv(sock_fd, &buf, 4096, 0);
-    if ((nbytes <= 0) && (errno != EAGAIN)) {
+    auto started = std::chrono::steady_clock::now();
+    std::string raw;
+    ssize_t nbytes = read_http_request(sock_fd, raw);
+    if (nbytes <= 0) {
         shutdown(sock_fd, SHUT_RDWR);
         close(sock_fd);
         return -1;
-    } else if (nbytes > 0) {
+    } else {
         // Парсим HTTP-запрос
-        HttpRequest req = parse_http_request(buf, nbytes);
+        HttpRequest req = parse_http_request(raw.data(), raw.size());
         
         // Создаем экземпляр DBManager
         DBManager db_manager;
@@ -322,6 +648,8 @@ int handle_socket(int sock_fd, const std::string &storage_path) {
         
         // Отправляем ответ
         send_response(sock_fd, response);
+        capacity_record_latency(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - started).count());
         shutdown(sock_fd, SHUT_RDWR);
         close(sock_fd);
     }
@@ -330,8 +658,21 @@ int handle_socket(int sock_fd, const std::string &storage_path) {
 
 // Функция отправки ответа
 int send_response(int socket_fd, const std::string &response) {
-    if (send(socket_fd, response.c_str(), response.size(), 0) < 0) {
-        perror("Cannot send to socket in send_response: ");
-        return -1;
+    // Ответ с полезной нагрузкой может не поместиться в буфер сокета за раз
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(socket_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                pollfd pfd = {socket_fd, POLLOUT, 0};
+                if (poll(&pfd, 1, RECV_TIMEOUT_MS) > 0) {
+                    continue;
+                }
+            }
+            perror("Cannot send to socket in send_response: ");
+            return -1;
+        }
+        sent += n;
     }
-    return 0; 
\ No newline at end of file
+    return 0; 
+}
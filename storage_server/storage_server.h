@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <sys/types.h>
 #include "db_manager.h"
 
 struct storage_server_options {
@@ -12,6 +13,14 @@ struct storage_server_options {
     uint16_t server_port;
     int workers_count;
     std::string storage_path;  // Путь для хранения файлов
+    size_t cache_bytes = 256 * 1024 * 1024;  // Объем кеша тайлов в памяти
+    int prefetch_radius = 1;   // Начальный радиус предзагрузки, -1 - выключена
+    std::string location;      // Адрес в таблице Servers маршрутизаторов, "ip:port";
+                               // пустой - server_ip:server_port
+    std::string ssd_path;      // Точки монтирования уровней для statvfs
+    std::string hdd_path;
+    std::vector<std::string> routers;  // Маршрутизаторы для heartbeat, "ip:port"
+    int heartbeat_interval_ms = 5000;
 };
 
 // Флаг для остановки сервера
@@ -20,9 +29,15 @@ extern volatile bool g_storage_server_stop;
 // Основная функция запуска сервера
 int storage_server_run(const storage_server_options &opts);
 
+// Глубина очереди соединений, ожидающих рабочего потока
+size_t storage_queue_depth();
+
 // Функция обработки сокета
 int handle_socket(int sock_fd, const std::string &storage_path);
 
+// Чтение HTTP-запроса целиком (с телом по Content-Length)
+ssize_t read_http_request(int sock_fd, std::string &raw);
+
 // Функция отправки ответа
 int send_response(int socket_fd, const std::string &response);
 
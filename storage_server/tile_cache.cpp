@@ -0,0 +1,287 @@
+#include "tile_cache.h"
+#include <algorithm>
+#include <functional>
+
+// Доля окна и защищенного сегмента (как в Caffeine: 1% и 80% от main)
+const double WINDOW_SHARE = 0.01;
+const double PROTECTED_SHARE = 0.8;
+// Средний размер тайла для оценки числа записей при выборе размера sketch
+const size_t AVERAGE_TILE_BYTES = 16 * 1024;
+// Полос поколений на шард: общая полоса у нескольких ключей только лишний раз
+// отменяет заполнение
+const size_t GENERATION_STRIPES = 256;
+// Максимальное значение 4-битного счетчика
+const uint64_t SKETCH_COUNTER_MAX = 15;
+
+static const uint64_t SKETCH_SEEDS[4] = {
+    0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL,
+    0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL
+};
+
+// Перемешивание битов (splitmix64), чтобы строки sketch были независимы
+static inline uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+std::string tile_cache_key(const TileKey& key) {
+    return std::to_string(key.image_id) + "/" + key.spectrum + "/" +
+           std::to_string(key.tile_row) + "/" + std::to_string(key.tile_column);
+}
+
+FrequencySketch::FrequencySketch(size_t expected_entries) {
+    size_t words = 1;
+    while (words < std::max<size_t>(expected_entries, 64)) {
+        words <<= 1;
+    }
+    table.assign(words, 0);
+    mask = words - 1;
+    sample_size = 10 * std::max<size_t>(expected_entries, 64);
+}
+
+void FrequencySketch::increment(uint64_t hash) {
+    bool added = false;
+    for (int row = 0; row < 4; ++row) {
+        uint64_t h = mix64(hash ^ SKETCH_SEEDS[row]);
+        uint64_t& word = table[h & mask];
+        int shift = static_cast<int>((h >> 60) & 15) * 4;
+        if (((word >> shift) & 0xF) < SKETCH_COUNTER_MAX) {
+            word += 1ULL << shift;
+            added = true;
+        }
+    }
+    if (added && ++additions >= sample_size) {
+        reset();
+    }
+}
+
+int FrequencySketch::frequency(uint64_t hash) const {
+    uint64_t result = SKETCH_COUNTER_MAX;
+    for (int row = 0; row < 4; ++row) {
+        uint64_t h = mix64(hash ^ SKETCH_SEEDS[row]);
+        int shift = static_cast<int>((h >> 60) & 15) * 4;
+        result = std::min(result, (table[h & mask] >> shift) & 0xF);
+    }
+    return static_cast<int>(result);
+}
+
+// Старение: все счетчики делятся пополам
+void FrequencySketch::reset() {
+    for (auto& word : table) {
+        word = (word >> 1) & 0x7777777777777777ULL;
+    }
+    additions /= 2;
+}
+
+TileCache::TileCache(size_t capacity_bytes, size_t shards_count) {
+    shards_count = std::max<size_t>(shards_count, 1);
+    size_t shard_capacity = capacity_bytes / shards_count;
+    for (size_t i = 0; i < shards_count; ++i) {
+        std::unique_ptr<Shard> shard(new Shard());
+        shard->window_capacity = std::max<size_t>(static_cast<size_t>(shard_capacity * WINDOW_SHARE),
+                                                  AVERAGE_TILE_BYTES);
+        shard->window_capacity = std::min(shard->window_capacity, shard_capacity);
+        shard->main_capacity = shard_capacity - shard->window_capacity;
+        shard->protected_capacity = static_cast<size_t>(shard->main_capacity * PROTECTED_SHARE);
+        shard->sketch.reset(new FrequencySketch(shard_capacity / AVERAGE_TILE_BYTES));
+        shard->generations.assign(GENERATION_STRIPES, 0);
+        shards.push_back(std::move(shard));
+    }
+}
+
+TileCache::Shard& TileCache::shard_for(uint64_t hash) {
+    return *shards[mix64(hash) % shards.size()];
+}
+
+uint64_t& TileCache::generation_of(Shard& shard, uint64_t hash) {
+    return shard.generations[hash % GENERATION_STRIPES];
+}
+
+std::list<TileCache::Entry>& TileCache::list_of(Shard& shard, Segment segment) {
+    switch (segment) {
+        case WINDOW: return shard.window;
+        case PROBATION: return shard.probation;
+        default: return shard.protected_;
+    }
+}
+
+size_t& TileCache::bytes_of(Shard& shard, Segment segment) {
+    switch (segment) {
+        case WINDOW: return shard.window_bytes;
+        case PROBATION: return shard.probation_bytes;
+        default: return shard.protected_bytes;
+    }
+}
+
+// Перенос записи в начало другого сегмента (итераторы при splice не меняются)
+void TileCache::move_to(Shard& shard, std::list<Entry>::iterator it, Segment segment) {
+    bytes_of(shard, it->segment) -= it->payload.size();
+    list_of(shard, segment).splice(list_of(shard, segment).begin(), list_of(shard, it->segment), it);
+    it->segment = segment;
+    bytes_of(shard, segment) += it->payload.size();
+}
+
+void TileCache::drop(Shard& shard, std::list<Entry>::iterator it, bool evicted) {
+    if (evicted) {
+        shard.stats.evictions++;
+        if (it->prefetched) {
+            shard.stats.prefetch_wasted++;
+        }
+    }
+    bytes_of(shard, it->segment) -= it->payload.size();
+    shard.index.erase(it->key);
+    list_of(shard, it->segment).erase(it);
+}
+
+void TileCache::on_hit(Shard& shard, std::list<Entry>::iterator it) {
+    if (it->segment == PROBATION) {
+        move_to(shard, it, PROTECTED);  // Повторное обращение - в защищенный сегмент
+    } else {
+        list_of(shard, it->segment).splice(list_of(shard, it->segment).begin(),
+                                           list_of(shard, it->segment), it);
+    }
+}
+
+// Восстановление лимитов сегментов после вставки или попадания
+void TileCache::rebalance(Shard& shard) {
+    // Переполнение защищенного сегмента - понижение хвоста в probation
+    while (shard.protected_bytes > shard.protected_capacity && !shard.protected_.empty()) {
+        move_to(shard, std::prev(shard.protected_.end()), PROBATION);
+    }
+
+    // Перезапись записи main большей нагрузкой: вытеснение с хвоста probation,
+    // затем protected (перезаписанная запись в начале сегмента - последней)
+    while (shard.probation_bytes + shard.protected_bytes > shard.main_capacity) {
+        std::list<Entry>& victims = shard.probation.empty() ? shard.protected_ : shard.probation;
+        drop(shard, std::prev(victims.end()), true);
+    }
+
+    // Вытесненные из окна кандидаты проходят фильтр допуска TinyLFU
+    while (shard.window_bytes > shard.window_capacity && !shard.window.empty()) {
+        auto candidate = std::prev(shard.window.end());
+        size_t size = candidate->payload.size();
+        if (size > shard.main_capacity) {
+            drop(shard, candidate, true);
+            continue;
+        }
+
+        bool admitted = true;
+        while (shard.probation_bytes + shard.protected_bytes + size > shard.main_capacity) {
+            std::list<Entry>& victims = shard.probation.empty() ? shard.protected_ : shard.probation;
+            auto victim = std::prev(victims.end());
+            if (shard.sketch->frequency(candidate->hash) > shard.sketch->frequency(victim->hash)) {
+                drop(shard, victim, true);
+            } else {
+                admitted = false;
+                break;
+            }
+        }
+
+        if (admitted) {
+            move_to(shard, candidate, PROBATION);
+        } else {
+            shard.stats.admission_rejects++;
+            drop(shard, candidate, true);
+        }
+    }
+}
+
+bool TileCache::get(const std::string& key, std::string& payload) {
+    uint64_t hash = std::hash<std::string>{}(key);
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.sketch->increment(hash);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        shard.stats.misses++;
+        return false;
+    }
+
+    shard.stats.hits++;
+    if (it->second->prefetched) {
+        shard.stats.prefetch_useful++;
+        it->second->prefetched = false;
+    }
+    payload = it->second->payload;
+    on_hit(shard, it->second);
+    rebalance(shard);
+    return true;
+}
+
+uint64_t TileCache::generation(const std::string& key) {
+    uint64_t hash = std::hash<std::string>{}(key);
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    return generation_of(shard, hash);
+}
+
+void TileCache::put(const std::string& key, const std::string& payload, uint64_t generation, bool prefetched) {
+    uint64_t hash = std::hash<std::string>{}(key);
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    if (generation_of(shard, hash) != generation) {
+        shard.stats.stale_fills++;
+        return;
+    }
+    if (payload.size() > shard.window_capacity + shard.main_capacity) {
+        return;
+    }
+    // Предзагрузка - не обращение клиента, частоту не увеличиваем
+    if (!prefetched) {
+        shard.sketch->increment(hash);
+    }
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        auto entry = it->second;
+        bytes_of(shard, entry->segment) -= entry->payload.size();
+        entry->payload = payload;
+        bytes_of(shard, entry->segment) += entry->payload.size();
+        // Запись по запросу клиента снимает пометку предзагрузки
+        entry->prefetched = entry->prefetched && prefetched;
+        list_of(shard, entry->segment).splice(list_of(shard, entry->segment).begin(),
+                                              list_of(shard, entry->segment), entry);
+    } else {
+        shard.window.push_front(Entry{key, payload, hash, WINDOW, prefetched});
+        shard.window_bytes += payload.size();
+        shard.index[key] = shard.window.begin();
+    }
+    rebalance(shard);
+}
+
+bool TileCache::contains(const std::string& key) {
+    Shard& shard = shard_for(std::hash<std::string>{}(key));
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    return shard.index.count(key) > 0;
+}
+
+void TileCache::invalidate(const std::string& key) {
+    uint64_t hash = std::hash<std::string>{}(key);
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    generation_of(shard, hash)++;
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        drop(shard, it->second, false);
+    }
+}
+
+TileCacheStats TileCache::get_stats() {
+    TileCacheStats total;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mtx);
+        total.hits += shard->stats.hits;
+        total.misses += shard->stats.misses;
+        total.evictions += shard->stats.evictions;
+        total.admission_rejects += shard->stats.admission_rejects;
+        total.prefetch_useful += shard->stats.prefetch_useful;
+        total.prefetch_wasted += shard->stats.prefetch_wasted;
+        total.stale_fills += shard->stats.stale_fills;
+        total.bytes += shard->window_bytes + shard->probation_bytes + shard->protected_bytes;
+        total.entries += shard->index.size();
+    }
+    return total;
+}
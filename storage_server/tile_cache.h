@@ -0,0 +1,119 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "db_records.h"
+
+// Счетчики кеша тайлов
+struct TileCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t admission_rejects = 0;  // Кандидат из окна проиграл жертве из main по частоте
+    uint64_t prefetch_useful = 0;    // Предзагруженный тайл затем запросили
+    uint64_t prefetch_wasted = 0;    // Предзагруженный тайл вытеснен без обращений
+    uint64_t stale_fills = 0;        // Заполнение отброшено: тайл перезаписан после чтения
+    size_t bytes = 0;
+    size_t entries = 0;
+};
+
+// Ключ кеша: "image_id/spectrum/row/col"
+std::string tile_cache_key(const TileKey& key);
+
+// Count-min sketch с 4-битными счетчиками и периодическим старением
+// (все счетчики делятся пополам), чтобы частоты отражали недавнюю популярность
+class FrequencySketch {
+private:
+    std::vector<uint64_t> table;  // 16 счетчиков по 4 бита в каждом слове
+    uint64_t mask;                // Число слов - степень двойки
+    uint64_t additions = 0;
+    uint64_t sample_size;
+
+    void reset();
+
+public:
+    explicit FrequencySketch(size_t expected_entries);
+
+    void increment(uint64_t hash);
+    int frequency(uint64_t hash) const;
+};
+
+// Кеш полезных нагрузок тайлов в памяти, ограниченный по байтам.
+// Политика W-TinyLFU: новые записи попадают в маленькое окно LRU,
+// вытесненные из окна допускаются в основной сегментированный LRU
+// (probation + protected) только если их частота по sketch выше,
+// чем у жертвы из probation. Так разовые массовые сканирования
+// не вымывают горячий набор. Ключи распределены по шардам,
+// у каждого шарда своя блокировка
+class TileCache {
+private:
+    enum Segment { WINDOW, PROBATION, PROTECTED };
+
+    struct Entry {
+        std::string key;
+        std::string payload;
+        uint64_t hash;
+        Segment segment;
+        bool prefetched;  // Загружен предзагрузчиком и еще не запрашивался
+    };
+
+    struct Shard {
+        std::list<Entry> window;     // Начало списка - самые свежие
+        std::list<Entry> probation;
+        std::list<Entry> protected_;
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        std::unique_ptr<FrequencySketch> sketch;
+        std::vector<uint64_t> generations;  // Поколения ключей по полосам, растут при invalidate
+        size_t window_bytes = 0;
+        size_t probation_bytes = 0;
+        size_t protected_bytes = 0;
+        size_t window_capacity = 0;
+        size_t main_capacity = 0;
+        size_t protected_capacity = 0;
+        TileCacheStats stats;
+        std::mutex mtx;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    Shard& shard_for(uint64_t hash);
+    static uint64_t& generation_of(Shard& shard, uint64_t hash);
+    static std::list<Entry>& list_of(Shard& shard, Segment segment);
+    static size_t& bytes_of(Shard& shard, Segment segment);
+    static void move_to(Shard& shard, std::list<Entry>::iterator it, Segment segment);
+    static void drop(Shard& shard, std::list<Entry>::iterator it, bool evicted);
+    static void on_hit(Shard& shard, std::list<Entry>::iterator it);
+    static void rebalance(Shard& shard);
+
+public:
+    explicit TileCache(size_t capacity_bytes, size_t shards_count = 16);
+
+    // Получить тайл; true при попадании
+    bool get(const std::string& key, std::string& payload);
+
+    // Поколение ключа; берется до чтения тайла из хранилища и передается в put
+    uint64_t generation(const std::string& key);
+
+    // Положить прочитанный тайл; prefetched = true для записей предзагрузчика.
+    // Если после generation ключ сбрасывали (тайл перезаписан), нагрузка могла
+    // устареть и не кладется: сравнение идет под блокировкой шарда
+    void put(const std::string& key, const std::string& payload, uint64_t generation, bool prefetched = false);
+
+    // Есть ли тайл в кеше (без обновления статистики и порядка)
+    bool contains(const std::string& key);
+
+    // Удалить тайл (после перезаписи нагрузки) и сменить поколение ключа
+    void invalidate(const std::string& key);
+
+    // Суммарная статистика по всем шардам
+    TileCacheStats get_stats();
+};
+
+#endif // TILE_CACHE_H
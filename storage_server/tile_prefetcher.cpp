@@ -0,0 +1,186 @@
+#include "tile_prefetcher.h"
+#include "tile_store.h"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+// Ограничение очереди: при всплеске чтений старые триггеры не копятся
+const size_t PREFETCH_QUEUE_LIMIT = 256;
+// Сколько исходов предзагрузки накопить перед подстройкой радиуса
+const uint64_t PREFETCH_ADAPT_WINDOW = 64;
+const double PREFETCH_GROW_RATIO = 0.6;
+const double PREFETCH_SHRINK_RATIO = 0.25;
+const size_t PREFETCH_BANDS_CACHE_LIMIT = 1024;
+
+TilePrefetcher::TilePrefetcher(TileCache& cache, const std::string& storage_path,
+                               int initial_radius, int max_radius)
+    : cache(cache), storage_path(storage_path), radius(initial_radius), max_radius(max_radius) {}
+
+TilePrefetcher::~TilePrefetcher() {
+    stop();
+}
+
+void TilePrefetcher::start() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (worker.joinable()) {
+        return;
+    }
+    stop_flag = false;
+    worker = std::thread(&TilePrefetcher::run, this);
+}
+
+void TilePrefetcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop_flag = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void TilePrefetcher::enqueue_locked(const TileKey& key) {
+    std::string cache_key = tile_cache_key(key);
+    if (queued.count(cache_key)) {
+        return;
+    }
+    if (queue.size() >= PREFETCH_QUEUE_LIMIT) {
+        queued.erase(tile_cache_key(queue.front()));
+        queue.pop_front();
+    }
+    queue.push_back(key);
+    queued.insert(cache_key);
+}
+
+void TilePrefetcher::on_tile_read(const TileKey& key) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        enqueue_locked(key);
+    }
+    cv.notify_one();
+}
+
+// Подстройка радиуса по доле полезных предзагрузок за последнее окно
+void TilePrefetcher::adapt_radius() {
+    TileCacheStats cache_stats = cache.get_stats();
+    uint64_t useful = cache_stats.prefetch_useful - last_useful;
+    uint64_t wasted = cache_stats.prefetch_wasted - last_wasted;
+    if (useful + wasted < PREFETCH_ADAPT_WINDOW) {
+        return;
+    }
+
+    double ratio = static_cast<double>(useful) / (useful + wasted);
+    int r = radius.load();
+    if (ratio > PREFETCH_GROW_RATIO && r < max_radius) {
+        radius.store(r + 1);
+    } else if (ratio < PREFETCH_SHRINK_RATIO && r > 0) {
+        radius.store(r - 1);
+    }
+    last_useful = cache_stats.prefetch_useful;
+    last_wasted = cache_stats.prefetch_wasted;
+}
+
+// Фоновый поток: для каждого прочитанного тайла собирает кандидатов
+// (кольца соседей от ближних к дальним и другие спектры) и загружает
+// отсутствующие в кеше одним пакетным чтением
+void TilePrefetcher::run() {
+    std::unique_ptr<DBManager> db;
+    try {
+        db.reset(new DBManager());
+    } catch (const std::exception& e) {
+        fprintf(stderr, "TilePrefetcher disabled: %s\n", e.what());
+        return;
+    }
+    DBManager& db_manager = *db;
+
+    while (true) {
+        TileKey trigger;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this]() { return stop_flag || !queue.empty(); });
+            if (stop_flag) {
+                break;
+            }
+            trigger = queue.front();
+            queue.pop_front();
+            queued.erase(tile_cache_key(trigger));
+        }
+
+        std::vector<TileKey> candidates;
+        int r = radius.load();
+        for (int ring = 1; ring <= r; ++ring) {
+            for (int dr = -ring; dr <= ring; ++dr) {
+                for (int dc = -ring; dc <= ring; ++dc) {
+                    if (std::abs(dr) != ring && std::abs(dc) != ring) {
+                        continue;  // Внутренние кольца уже добавлены
+                    }
+                    TileKey neighbor = trigger;
+                    neighbor.tile_row += dr;
+                    neighbor.tile_column += dc;
+                    if (neighbor.tile_row >= 0 && neighbor.tile_column >= 0) {
+                        candidates.push_back(neighbor);
+                    }
+                }
+            }
+        }
+
+        try {
+            auto bands = image_bands.find(trigger.image_id);
+            if (bands == image_bands.end()) {
+                if (image_bands.size() >= PREFETCH_BANDS_CACHE_LIMIT) {
+                    image_bands.clear();
+                }
+                bands = image_bands.emplace(trigger.image_id,
+                                            db_manager.get_image_spectrums(trigger.image_id)).first;
+            }
+            for (const auto& band : bands->second) {
+                if (band != trigger.spectrum) {
+                    TileKey other = trigger;
+                    other.spectrum = band;
+                    candidates.push_back(other);
+                }
+            }
+        } catch (const std::exception& e) {
+            fprintf(stderr, "TilePrefetcher: %s\n", e.what());
+        }
+
+        std::vector<TileKey> missing;
+        for (const auto& candidate : candidates) {
+            if (cache.contains(tile_cache_key(candidate))) {
+                skipped++;
+            } else {
+                missing.push_back(candidate);
+            }
+        }
+        requested += missing.size();
+
+        if (!missing.empty()) {
+            std::vector<uint64_t> generations;
+            for (const auto& key : missing) {
+                generations.push_back(cache.generation(tile_cache_key(key)));
+            }
+            std::vector<std::string> payloads;
+            std::vector<bool> found;
+            tile_store_get_batch(db_manager, storage_path, missing, payloads, found);
+            for (size_t i = 0; i < missing.size(); ++i) {
+                // Тайл, перезаписанный во время чтения, кеш сам не примет (поколение сменилось)
+                if (found[i]) {
+                    cache.put(tile_cache_key(missing[i]), payloads[i], generations[i], true);
+                    loaded++;
+                }
+            }
+        }
+
+        adapt_radius();
+    }
+}
+
+PrefetchStats TilePrefetcher::get_stats() {
+    PrefetchStats result;
+    result.requested = requested.load();
+    result.loaded = loaded.load();
+    result.skipped = skipped.load();
+    result.radius = radius.load();
+    return result;
+}
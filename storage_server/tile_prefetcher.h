@@ -0,0 +1,69 @@
+#ifndef TILE_PREFETCHER_H
+#define TILE_PREFETCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tile_cache.h"
+
+// Состояние предзагрузчика для метрик
+struct PrefetchStats {
+    uint64_t requested = 0;  // Тайлов поставлено в очередь
+    uint64_t loaded = 0;     // Тайлов загружено в кеш
+    uint64_t skipped = 0;    // Уже были в кеше или в очереди
+    int radius = 0;          // Текущий радиус по строкам/столбцам
+};
+
+// Предзагрузка тайлов по пространственной близости: при чтении тайла
+// в фоне загружаются соседи по строкам/столбцам и тот же тайл в других
+// спектрах снимка. Радиус подстраивается по доле полезных предзагрузок
+class TilePrefetcher {
+private:
+    TileCache& cache;
+    std::string storage_path;
+
+    std::deque<TileKey> queue;
+    std::set<std::string> queued;  // Ключи в очереди, чтобы не дублировать
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread worker;
+    bool stop_flag = false;
+
+    std::atomic<int> radius;
+    int max_radius;
+    std::atomic<uint64_t> requested{0};
+    std::atomic<uint64_t> loaded{0};
+    std::atomic<uint64_t> skipped{0};
+
+    // Спектры снимков, чтобы не спрашивать БД на каждое чтение
+    std::map<int, std::vector<std::string>> image_bands;
+
+    // Значения счетчиков кеша на момент последней подстройки радиуса
+    uint64_t last_useful = 0;
+    uint64_t last_wasted = 0;
+
+    void run();
+    void enqueue_locked(const TileKey& key);
+    void adapt_radius();
+
+public:
+    TilePrefetcher(TileCache& cache, const std::string& storage_path,
+                   int initial_radius = 1, int max_radius = 3);
+    ~TilePrefetcher();
+
+    void start();
+    void stop();
+
+    // Вызывается после чтения тайла клиентом
+    void on_tile_read(const TileKey& key);
+
+    PrefetchStats get_stats();
+};
+
+#endif // TILE_PREFETCHER_H
@@ -0,0 +1,433 @@
+#include "tile_store.h"
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <unistd.h>
+#include <pthread.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+inline uint64_t xxh_merge_round(uint64_t acc, uint64_t val) {
+    acc ^= xxh_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+} // namespace
+
+// Потоков чтения файлов на все пакетные запросы процесса
+const size_t BATCH_READ_THREADS = 8;
+
+// XXH64: быстрый некриптографический хеш, достаточный для адресации тайлов
+uint64_t tile_hash64(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        const uint8_t* limit = end - 32;
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        do {
+            v1 = xxh_round(v1, read64(p)); p += 8;
+            v2 = xxh_round(v2, read64(p)); p += 8;
+            v3 = xxh_round(v3, read64(p)); p += 8;
+            v4 = xxh_round(v4, read64(p)); p += 8;
+        } while (p <= limit);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh_merge_round(h, v1);
+        h = xxh_merge_round(h, v2);
+        h = xxh_merge_round(h, v3);
+        h = xxh_merge_round(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+
+    h += static_cast<uint64_t>(size);
+
+    while (p + 8 <= end) {
+        h ^= xxh_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string tile_hash_hex(const void* data, size_t size) {
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << tile_hash64(data, size);
+    return oss.str();
+}
+
+bool tile_is_constant(const char* data, size_t size, uint8_t* value) {
+    if (size == 0) {
+        return false;
+    }
+    // Сравниваем буфер со сдвинутым на один байт самим собой
+    if (size > 1 && memcmp(data, data + 1, size - 1) != 0) {
+        return false;
+    }
+    *value = static_cast<uint8_t>(data[0]);
+    return true;
+}
+
+std::string tile_blob_path(const std::string& storage_path, const std::string& payload_hash) {
+    // Раскладываем файлы по подкаталогам по первым двум символам хеша
+    return storage_path + "/blobs/" + payload_hash.substr(0, 2) + "/" + payload_hash + ".bin";
+}
+
+// Запись файла нагрузки через временный файл и rename, чтобы читатели
+// никогда не видели частично записанный тайл
+static bool write_blob(const std::string& path, const char* data, size_t size) {
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec)) {
+        return true;  // Содержимое определяется хешем, перезаписывать не нужно
+    }
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    if (ec) {
+        return false;
+    }
+
+    std::string tmp_path = path + ".tmp." + std::to_string(getpid()) + "." +
+                           std::to_string(static_cast<unsigned long>(pthread_self()));
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(data, size);
+        if (!out) {
+            std::filesystem::remove(tmp_path, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+// Блокировки записи тайлов, по хешу позиции и по хешу нагрузки. Позиция
+// держится всю запись: иначе две записи одного тайла обе освободят прежнюю
+// нагрузку. Нагрузка держится от проверки файла до счетчика ссылок и от
+// освобождения до удаления файла: иначе файл удаляется между проверкой
+// и ссылкой другой записи. Одновременно берется не больше одной каждого вида
+const size_t TILE_LOCK_STRIPES = 256;
+static std::mutex g_position_locks[TILE_LOCK_STRIPES];
+static std::mutex g_payload_locks[TILE_LOCK_STRIPES];
+
+static std::mutex& position_lock(const TileKey& key) {
+    size_t h = std::hash<std::string>()(key.spectrum);
+    h ^= std::hash<long long>()((static_cast<long long>(key.image_id) << 40) ^
+                                (static_cast<long long>(key.tile_row) << 20) ^ key.tile_column) +
+         0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return g_position_locks[h % TILE_LOCK_STRIPES];
+}
+
+// Имена с суффиксом коллизии делят блокировку с основным именем
+static std::mutex& payload_lock(const std::string& payload_hash) {
+    return g_payload_locks[std::hash<std::string>()(payload_hash.substr(0, 16)) % TILE_LOCK_STRIPES];
+}
+
+// Совпадает ли файл нагрузки с данными байт в байт
+static bool blob_equals(const std::string& path, const char* data, size_t size) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    char buf[64 * 1024];
+    size_t pos = 0;
+    while (pos < size) {
+        size_t chunk = std::min(sizeof(buf), size - pos);
+        in.read(buf, chunk);
+        if (static_cast<size_t>(in.gcount()) != chunk || memcmp(buf, data + pos, chunk) != 0) {
+            return false;
+        }
+        pos += chunk;
+    }
+    return in.peek() == std::ifstream::traits_type::eof();
+}
+
+// Имя нагрузки (под payload_lock): хеш, если файла с ним нет или в нем те же
+// байты; иначе - совпадение хешей разных данных, пробуются "хеш-1", "хеш-2"...
+// Отсутствующий файл записывается. Пусто - ошибка записи
+static std::string resolve_blob(const std::string& storage_path, const std::string& hash,
+                                const char* data, size_t size) {
+    for (int attempt = 0;; ++attempt) {
+        std::string name = attempt == 0 ? hash : hash + "-" + std::to_string(attempt);
+        std::string path = tile_blob_path(storage_path, name);
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec)) {
+            return write_blob(path, data, size) ? name : std::string();
+        }
+        if (blob_equals(path, data, size)) {
+            return name;
+        }
+    }
+}
+
+// Освобождение ссылки на нагрузку; файл удаляется вместе с последней ссылкой
+static void release_blob(DBManager& db_manager, const std::string& storage_path,
+                         const std::string& payload_hash) {
+    if (payload_hash.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(payload_lock(payload_hash));
+    if (db_manager.release_tile_payload(payload_hash) == 0) {
+        std::error_code ec;
+        std::filesystem::remove(tile_blob_path(storage_path, payload_hash), ec);
+    }
+}
+
+tile_store_result_t tile_store_put(DBManager& db_manager, const std::string& storage_path,
+                                   const TileKey& key, const char* data, size_t size) {
+    try {
+        std::lock_guard<std::mutex> position_guard(position_lock(key));
+        TilePayloadRecord previous = db_manager.get_tile_payload(key.image_id, key.spectrum,
+                                                                 key.tile_row, key.tile_column);
+        std::string tile_url = "tile_" + std::to_string(key.image_id) + "_" + key.spectrum + "_" +
+                               std::to_string(key.tile_row) + "_" +
+                               std::to_string(key.tile_column) + ".bin";
+
+        uint8_t fill = 0;
+        if (tile_is_constant(data, size, &fill)) {
+            // Константный тайл: только дескриптор (значение и размер), без файла
+            db_manager.upsert_tile_payload(key.image_id, key.spectrum, key.tile_row, key.tile_column,
+                                           tile_url, "", fill, size);
+            if (previous.found) {
+                release_blob(db_manager, storage_path, previous.payload_hash);
+            }
+            return TILE_STORED_CONSTANT;
+        }
+
+        // Хеш только выбирает кандидата: общий файл берется после сравнения байт
+        std::string hash = tile_hash_hex(data, size);
+        std::string payload_hash;
+        int ref_count;
+        {
+            std::lock_guard<std::mutex> payload_guard(payload_lock(hash));
+            payload_hash = resolve_blob(storage_path, hash, data, size);
+            if (payload_hash.empty()) {
+                return TILE_STORE_ERROR;
+            }
+            if (previous.found && previous.payload_hash == payload_hash) {
+                return TILE_STORED_DEDUP;  // Повторная загрузка того же тайла
+            }
+            ref_count = db_manager.acquire_tile_payload(payload_hash, size);
+        }
+        db_manager.upsert_tile_payload(key.image_id, key.spectrum, key.tile_row, key.tile_column,
+                                       tile_url, payload_hash, -1, size);
+        if (previous.found) {
+            release_blob(db_manager, storage_path, previous.payload_hash);
+        }
+        return ref_count > 1 ? TILE_STORED_DEDUP : TILE_STORED_NEW;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "tile_store_put: %s\n", e.what());
+        return TILE_STORE_ERROR;
+    }
+}
+
+// Чтение нагрузки по дескриптору (константный тайл разворачивается в буфер)
+static bool read_payload(const std::string& storage_path, const TilePayloadRecord& record,
+                         std::string& out) {
+    if (record.constant_value >= 0) {
+        out.assign(static_cast<size_t>(record.payload_size),
+                   static_cast<char>(record.constant_value));
+        return true;
+    }
+
+    std::ifstream in(tile_blob_path(storage_path, record.payload_hash), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    out.resize(static_cast<size_t>(record.payload_size));
+    in.read(&out[0], out.size());
+    return static_cast<size_t>(in.gcount()) == out.size();
+}
+
+bool tile_store_get(DBManager& db_manager, const std::string& storage_path,
+                    const TileKey& key, std::string& out) {
+    try {
+        TilePayloadRecord record = db_manager.get_tile_payload(key.image_id, key.spectrum,
+                                                               key.tile_row, key.tile_column);
+        if (!record.found) {
+            return false;
+        }
+        return read_payload(storage_path, record, out);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "tile_store_get: %s\n", e.what());
+        return false;
+    }
+}
+
+// Задание пула: индексы 0..count-1 разбираются по одному из общего счетчика
+struct BatchReadJob {
+    std::function<void(size_t)> task;
+    size_t count = 0;
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t completed = 0;
+
+    // Разбор индексов, пока они есть
+    void drain() {
+        size_t i, done = 0;
+        while ((i = next.fetch_add(1)) < count) {
+            task(i);
+            done++;
+        }
+        if (done > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            completed += done;
+            if (completed == count) {
+                cv.notify_all();
+            }
+        }
+    }
+};
+
+// Общий на процесс пул чтения файлов для пакетных запросов: потоки
+// создаются один раз, их число не зависит от числа одновременных запросов
+struct BatchReadPool {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::shared_ptr<BatchReadJob>> queue;
+    bool started = false;
+};
+
+// Пул не разрушается: при выходе процесса его ждут отсоединенные потоки,
+// а разрушение condition_variable с ожидающими зависает
+static BatchReadPool& batch_read_pool() {
+    static BatchReadPool* pool = new BatchReadPool();
+    return *pool;
+}
+
+static void batch_read_worker() {
+    BatchReadPool& pool = batch_read_pool();
+    while (true) {
+        std::shared_ptr<BatchReadJob> job;
+        {
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            pool.cv.wait(lock, [&pool]() { return !pool.queue.empty(); });
+            job = pool.queue.front();
+            pool.queue.pop_front();
+        }
+        job->drain();
+    }
+}
+
+// task(i) для всех i < count на потоках пула и текущем потоке. Текущий поток
+// разбирает индексы сам, поэтому занятый пул только замедляет запрос
+static void batch_read_parallel(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    auto job = std::make_shared<BatchReadJob>();
+    job->task = task;
+    job->count = count;
+    if (count > 1) {
+        BatchReadPool& pool = batch_read_pool();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (!pool.started) {
+            for (size_t t = 0; t < BATCH_READ_THREADS; ++t) {
+                std::thread(batch_read_worker).detach();
+            }
+            pool.started = true;
+        }
+        // Помощников не больше, чем индексов сверх своего
+        for (size_t t = 0; t < std::min(BATCH_READ_THREADS, count - 1); ++t) {
+            pool.queue.push_back(job);
+        }
+        pool.cv.notify_all();
+    }
+    job->drain();
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->cv.wait(lock, [&job]() { return job->completed == job->count; });
+}
+
+void tile_store_get_batch(DBManager& db_manager, const std::string& storage_path,
+                          const std::vector<TileKey>& keys,
+                          std::vector<std::string>& payloads, std::vector<bool>& found) {
+    payloads.assign(keys.size(), std::string());
+    found.assign(keys.size(), false);
+
+    std::vector<TilePayloadRecord> records;
+    try {
+        records = db_manager.get_tile_payloads(keys);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "tile_store_get_batch: %s\n", e.what());
+        return;
+    }
+
+    // Файлы читают общий пул и сам поток запроса. vector<bool> не
+    // потокобезопасен, поэтому результаты собираем в отдельный массив char
+    std::vector<char> ok(keys.size(), 0);
+    batch_read_parallel(records.size(), [&](size_t i) {
+        if (records[i].found) {
+            ok[i] = read_payload(storage_path, records[i], payloads[i]) ? 1 : 0;
+        }
+    });
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        found[i] = ok[i] != 0;
+    }
+}
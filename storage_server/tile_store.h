@@ -0,0 +1,47 @@
+#ifndef TILE_STORE_H
+#define TILE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "db_manager.h"
+
+// Результат записи тайла в хранилище
+typedef enum {
+    TILE_STORED_NEW,       // Полезная нагрузка записана впервые
+    TILE_STORED_DEDUP,     // Такая же нагрузка уже была, увеличен счетчик ссылок
+    TILE_STORED_CONSTANT,  // Тайл из одного значения, хранится только дескриптор
+    TILE_STORE_ERROR
+} tile_store_result_t;
+
+// 64-битный хеш содержимого тайла (XXH64)
+uint64_t tile_hash64(const void* data, size_t size, uint64_t seed = 0);
+
+// Хеш в виде 16 hex-символов, используется как имя файла и ключ в БД
+std::string tile_hash_hex(const void* data, size_t size);
+
+// Проверка, что тайл состоит из одного повторяющегося байта (nodata, края сцены)
+bool tile_is_constant(const char* data, size_t size, uint8_t* value);
+
+// Путь к файлу полезной нагрузки по её хешу
+std::string tile_blob_path(const std::string& storage_path, const std::string& payload_hash);
+
+// Запись тайла: константные тайлы сохраняются дескриптором,
+// одинаковые нагрузки - один раз со счетчиком ссылок. Нагрузки с одинаковым
+// хешем сравниваются побайтно, при коллизии файл получает суффикс "-N".
+// Записи одной позиции и одной нагрузки из разных потоков идут по очереди
+tile_store_result_t tile_store_put(DBManager& db_manager, const std::string& storage_path,
+                                   const TileKey& key, const char* data, size_t size);
+
+// Чтение тайла (константный тайл разворачивается в буфер нужного размера)
+bool tile_store_get(DBManager& db_manager, const std::string& storage_path,
+                    const TileKey& key, std::string& out);
+
+// Пакетное чтение тайлов: дескрипторы берутся одним запросом к БД,
+// файлы читаются параллельно общим пулом потоков. found[i] == false, если тайла нет
+void tile_store_get_batch(DBManager& db_manager, const std::string& storage_path,
+                          const std::vector<TileKey>& keys,
+                          std::vector<std::string>& payloads, std::vector<bool>& found);
+
+#endif // TILE_STORE_H